@@ -25,6 +25,9 @@ QMAKE_APPLE_DEVICE_ARCHS = x86_64 arm64
 # Serial port detection not currently supported on mac
 macx: DEFINES += "SKIPSERIALDETECT"
 
+# Uncomment to skip building unit tests (run with "make check")
+#DEFINES += "SKIPTESTS"
+
 # Uncomment to disable plugin support
 #DEFINES += "SKIPPLUGINS"
 
@@ -5,12 +5,22 @@ include(AuTerm-includes.pri)
 SUBDIRS += \
     AuTerm
 
+!contains(DEFINES, SKIPTESTS) {
+    SUBDIRS += \
+        AuTerm/test
+}
+
 !contains(DEFINES, SKIPPLUGINS) {
     !contains(DEFINES, SKIPPLUGIN_MCUMGR) {
         SUBDIRS += \
             plugins/mcumgr
 
         AuTerm.depends += plugins/mcumgr
+
+        !contains(DEFINES, SKIPTESTS) {
+            SUBDIRS += \
+                plugins/mcumgr/test
+        }
     }
 
     !contains(DEFINES, SKIPPLUGIN_LOGGER) {
@@ -10,21 +10,36 @@ QT += core gui widgets serialport
 
 TARGET = AuTerm
 TEMPLATE = app
+CONFIG += c++17
 
 SOURCES += main.cpp\
+    AutCapture.cpp \
     AutEscape.cpp \
+    AutFileStream.cpp \
+    AutLogView.cpp \
     AutLogger.cpp \
     AutMainWindow.cpp \
     AutPlugin.cpp \
     AutPopup.cpp \
-    AutScrollEdit.cpp
+    AutRingBuffer.cpp \
+    AutScrollEdit.cpp \
+    AutScrollback.cpp \
+    AutSearch.cpp \
+    AutSerialWorker.cpp
 
 HEADERS  += \
+    AutCapture.h \
     AutEscape.h \
+    AutFileStream.h \
+    AutLogView.h \
     AutLogger.h \
     AutMainWindow.h \
     AutPopup.h \
-    AutScrollEdit.h
+    AutRingBuffer.h \
+    AutScrollEdit.h \
+    AutScrollback.h \
+    AutSearch.h \
+    AutSerialWorker.h
 
 FORMS    += \
     AutMainWindow.ui \
@@ -43,6 +58,14 @@ RESOURCES += \
         AutAutomation.ui
 }
 
+# Speed test
+!contains(DEFINES, SKIPSPEEDTEST) {
+    SOURCES += \
+        AutSpeedTest.cpp
+    HEADERS += \
+        AutSpeedTest.h
+}
+
 # Scripting form
 !contains(DEFINES, SKIPSCRIPTINGFORM) {
     SOURCES += \
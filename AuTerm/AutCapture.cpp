@@ -0,0 +1,241 @@
+/******************************************************************************
+** Copyright (C) 2024 Jamie M.
+**
+** Project: AuTerm
+**
+** Module: AutCapture.cpp
+**
+** Notes:
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include "AutCapture.h"
+#include "AutEscape.h"
+#include <QDateTime>
+#include <string.h>
+
+/******************************************************************************/
+// Constants
+/******************************************************************************/
+static const char capture_magic[] = "AuTC";
+const quint8 capture_version = 1;
+//Largest record accepted by the reader, larger lengths indicate a corrupt file (64MiB)
+const quint32 capture_max_record_size = 64 * 1024 * 1024;
+
+/******************************************************************************/
+// Local Functions or Private Members
+/******************************************************************************/
+static void capture_write_uint(uint8_t *buffer, quint64 value, uint8_t size)
+{
+    //Values are stored little endian
+    uint8_t i = 0;
+
+    while (i < size)
+    {
+        buffer[i] = (uint8_t)(value >> (i * 8));
+        ++i;
+    }
+}
+
+static quint64 capture_read_uint(const uint8_t *buffer, uint8_t size)
+{
+    quint64 value = 0;
+
+    while (size > 0)
+    {
+        --size;
+        value = (value << 8) | buffer[size];
+    }
+
+    return value;
+}
+
+AutCapture::AutCapture()
+{
+}
+
+AutCapture::~AutCapture()
+{
+    close();
+}
+
+unsigned char AutCapture::open(QString filename)
+{
+    //Starts a new capture, replacing any existing file
+    QMutexLocker locker(&record_mutex);
+    uint8_t header[capture_header_size] = {};
+    unsigned char result = writer.OpenLogFile(filename, true);
+
+    if (result != LOG_OK)
+    {
+        return result;
+    }
+
+    writer.ClearLog();
+    memcpy(header, capture_magic, 4);
+    header[4] = capture_version;
+    capture_write_uint(&header[8], (quint64)QDateTime::currentMSecsSinceEpoch(), 8);
+    writer.WriteRawLogData((const char *)header, sizeof(header));
+    timer.start();
+
+    return LOG_OK;
+}
+
+void AutCapture::close()
+{
+    QMutexLocker locker(&record_mutex);
+
+    writer.CloseLogFile();
+}
+
+bool AutCapture::is_open()
+{
+    return writer.IsLogOpen();
+}
+
+void AutCapture::add_record(capture_direction_t direction, const QByteArray *data)
+{
+    add_record(direction, data->constData(), data->length());
+}
+
+void AutCapture::add_record(capture_direction_t direction, const char *data, qint32 length)
+{
+    //Adds a record of data sent or received, timestamped with the time since the capture started
+    QMutexLocker locker(&record_mutex);
+    uint8_t header[capture_record_header_size];
+
+    if (writer.IsLogOpen() == false)
+    {
+        //Closed since the caller checked
+        return;
+    }
+
+    header[0] = direction;
+    capture_write_uint(&header[1], (quint64)timer.nsecsElapsed(), 8);
+    capture_write_uint(&header[9], (quint64)length, 4);
+    writer.WriteRawLogData((const char *)header, sizeof(header));
+    writer.WriteRawLogData(data, length);
+}
+
+AutCaptureReader::AutCaptureReader()
+{
+    start_time = 0;
+}
+
+bool AutCaptureReader::open(QString filename)
+{
+    //Opens a capture file and checks the header
+    uint8_t header[capture_header_size];
+
+    close();
+    file.setFileName(filename);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    if (file.read((char *)header, sizeof(header)) != sizeof(header) || memcmp(header, capture_magic, 4) != 0 || header[4] != capture_version)
+    {
+        file.close();
+        return false;
+    }
+
+    start_time = (qint64)capture_read_uint(&header[8], 8);
+
+    return true;
+}
+
+void AutCaptureReader::close()
+{
+    if (file.isOpen() == true)
+    {
+        file.close();
+    }
+}
+
+bool AutCaptureReader::next_record(capture_record_t *record)
+{
+    //Reads the next record, returns false at the end of the file or if the file is truncated or corrupt
+    uint8_t header[capture_record_header_size];
+    quint32 length;
+
+    if (file.read((char *)header, sizeof(header)) != sizeof(header))
+    {
+        return false;
+    }
+
+    length = (quint32)capture_read_uint(&header[9], 4);
+
+    if (header[0] > CAPTURE_DIRECTION_TX || length > capture_max_record_size)
+    {
+        return false;
+    }
+
+    record->direction = (capture_direction_t)header[0];
+    record->timestamp = capture_read_uint(&header[1], 8);
+    record->data.resize(length);
+
+    return (file.read(record->data.data(), length) == length);
+}
+
+qint64 AutCaptureReader::get_start_time()
+{
+    return start_time;
+}
+
+bool AutCaptureReader::convert_to_text(QString input, QString output)
+{
+    //Converts a capture file to text, one line per record with the time since the start, time since the previous record, direction and escaped data
+    AutCaptureReader reader;
+    capture_record_t record;
+    QFile output_file(output);
+    quint64 previous = 0;
+
+    if (reader.open(input) == false)
+    {
+        return false;
+    }
+
+    if (!output_file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+    {
+        return false;
+    }
+
+    output_file.write(QString("Capture started ").append(QDateTime::fromMSecsSinceEpoch(reader.get_start_time()).toString("dd/MM/yyyy @ hh:mm:ss.zzz")).append("\n").toUtf8());
+
+    while (reader.next_record(&record) == true)
+    {
+        QByteArray line = QByteArray::number((double)record.timestamp / 1000000000.0, 'f', 9);
+
+        line.append(" +").append(QByteArray::number((double)(record.timestamp - previous) / 1000000.0, 'f', 3)).append("ms ");
+        line.append(record.direction == CAPTURE_DIRECTION_RX ? "RX " : "TX ").append(QByteArray::number(record.data.length())).append(": ");
+        record.data.replace("\\", "\\\\").replace("\t", "\\t").replace("\r", "\\r").replace("\n", "\\n").replace("\x1b", "\\1b");
+        AutEscape::replace_unprintable(&record.data, true);
+        line.append(record.data).append("\n");
+        output_file.write(line);
+        previous = record.timestamp;
+    }
+
+    output_file.close();
+
+    return true;
+}
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
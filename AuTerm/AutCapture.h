@@ -0,0 +1,102 @@
+/******************************************************************************
+** Copyright (C) 2024 Jamie M.
+**
+** Project: AuTerm
+**
+** Module: AutCapture.h
+**
+** Notes:
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+#ifndef AUTCAPTURE_H
+#define AUTCAPTURE_H
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include "AutLogger.h"
+
+/******************************************************************************/
+// Constants
+/******************************************************************************/
+//Size of the capture file header: magic (4), version (1), reserved (3), start time in ms since epoch UTC (8)
+const quint8 capture_header_size = 16;
+//Size of each record header: direction (1), timestamp in ns since capture start (8), payload length (4)
+const quint8 capture_record_header_size = 13;
+
+/******************************************************************************/
+// Enum typedefs
+/******************************************************************************/
+enum capture_direction_t : uint8_t {
+    CAPTURE_DIRECTION_RX = 0,
+    CAPTURE_DIRECTION_TX,
+};
+
+/******************************************************************************/
+// Forward declaration of Class, Struct & Unions
+/******************************************************************************/
+struct capture_record_t {
+    capture_direction_t direction;
+    quint64 timestamp;
+    QByteArray data;
+};
+
+/******************************************************************************/
+// Class definitions
+/******************************************************************************/
+//Writes received and transmitted data to a binary capture file with timestamps, records can be added from
+//any thread (received serial data is added from the serial I/O thread so timestamps are taken on arrival)
+class AutCapture
+{
+public:
+    AutCapture();
+    ~AutCapture();
+    unsigned char open(QString filename);
+    void close();
+    bool is_open();
+    void add_record(capture_direction_t direction, const QByteArray *data);
+    void add_record(capture_direction_t direction, const char *data, qint32 length);
+
+private:
+    AutLogger writer; //Writes the capture data from a background thread
+    QElapsedTimer timer; //Monotonic time since the capture was started
+    QMutex record_mutex; //Keeps each record's header and data together, and records in timestamp order
+};
+
+//Reads records back from a capture file, for replaying or converting to text
+class AutCaptureReader
+{
+public:
+    AutCaptureReader();
+    bool open(QString filename);
+    void close();
+    bool next_record(capture_record_t *record);
+    qint64 get_start_time();
+    static bool convert_to_text(QString input, QString output);
+
+private:
+    QFile file; //Capture file being read
+    qint64 start_time; //Start time of the capture, in ms since epoch UTC
+};
+
+#endif // AUTCAPTURE_H
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
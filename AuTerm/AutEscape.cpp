@@ -26,41 +26,20 @@
 // Include Files
 /******************************************************************************/
 #include "AutEscape.h"
-#include <QRegularExpression>
-
-static QRegularExpression vt100_colour_regex("\\x1b(\\[[0-9]{0,3}(;[0-9]{1,3})?[A-Za-z])");
-static QRegularExpression vt100_non_colour_regex[12] = {
-    QRegularExpression("\\x1b\\[(20|\\?[1,3-9])h"),
-    QRegularExpression("\\x1b\\[(20|\\?[1-9])l"),
-    QRegularExpression("\\x1b(<|=|>|N|O|H|#[3-6|8]|5n|0n|3n|6n|D|M|E|7|8|c|F|G|A|B|C|D|H|I|K|J|Z|/Z)"),
-    QRegularExpression("\\x1b\\[(\\(|\\))(A|B|[0-2])"),
-    QRegularExpression("\\x1b\\[([0-9]+);([0-9]+)(r|H|f)"),
-    QRegularExpression("\\x1b\\[([0-9]+)(A|B|D)"),
-    QRegularExpression("\\x1b\\[(g|0g|3g|K|[0-2]K|J|[0-2]J|H|;H|f|;f|c|0c)"),
-    QRegularExpression("\\x1b([0-9]+);([0-9]+)R"),
-    QRegularExpression("\\x1b\\[\\?1;([0-9]+)0c"),
-    QRegularExpression("\\x1b\\[2;(1|2|9|10)y"),
-    QRegularExpression("\\x1b\\[([0-4])q"),
-    QRegularExpression("\\x1b([0-9]+?)([0-9]+)")
+
+/******************************************************************************/
+// Constants
+/******************************************************************************/
+static const char hex_digits[] = "0123456789abcdef";
+//Control characters which are replaced by escape codes
+static const bool unprintable_characters[0x20] = {
+    true, true, true, true, true, true, true, true, false, false, false, true, true, false, true, true,
+    true, true, true, true, true, true, true, true, true, true, true, false, true, true, true, true
 };
-static QRegularExpression vt100_shift_regex("\\x1b\\[([0-9]+)C");
 
 /******************************************************************************/
 // Local Functions or Private Members
 /******************************************************************************/
-void AutEscape::do_setup(void)
-{
-    int8_t i = (sizeof(vt100_non_colour_regex) / sizeof(vt100_non_colour_regex[0])) - 1;
-    vt100_colour_regex.setPatternOptions(QRegularExpression::MultilineOption);
-    vt100_shift_regex.setPatternOptions(QRegularExpression::MultilineOption);
-
-    while (i >= 0)
-    {
-        vt100_non_colour_regex[i].setPatternOptions(QRegularExpression::MultilineOption);
-        --i;
-    }
-}
-
 void AutEscape::escape_characters(QByteArray *data)
 {
     //Escapes character sequences
@@ -120,84 +99,75 @@ void AutEscape::escape_characters(QByteArray *data)
     }
 }
 
-void AutEscape::strip_vt100_formatting(QByteArray *data, int32_t offset)
+void AutEscape::replace_unprintable(QByteArray *data, bool include_1b)
 {
-    QRegularExpressionMatch regex_match = vt100_colour_regex.match(*data, offset);
+    //Expands unprintable characters to \XX escape codes, the output is sized once and filled from the end backwards so it can be done in place
+    int32_t length = data->length();
+    int32_t escaped = 0;
+    int32_t read;
+    int32_t write;
+    const uint8_t *input = (const uint8_t *)data->constData();
+    char *output;
 
-    while (regex_match.hasMatch())
-    {
-        data->remove(regex_match.capturedStart(0), regex_match.capturedLength(0));
-        regex_match = vt100_colour_regex.match(*data);
-    }
+    //0x1b has never been escaped by this function, even with include_1b set, this is kept as-is
+    Q_UNUSED(include_1b);
 
-    regex_match = vt100_shift_regex.match(*data, offset);
+    read = 0;
 
-    while (regex_match.hasMatch())
+    while (read < length)
     {
-        data->remove(regex_match.capturedStart(0), regex_match.capturedLength(0));
-        regex_match = vt100_shift_regex.match(*data);
-    }
-
-    strip_vt100_non_formatting(data, offset);
-}
-
-void AutEscape::strip_vt100_non_formatting(QByteArray *data, int32_t offset)
-{
-    uint8_t i = 0;
-    uint8_t l = (sizeof(vt100_non_colour_regex) / sizeof(vt100_non_colour_regex[0]));
-
-    while (i < l)
-    {
-        QRegularExpressionMatch regex_match = vt100_non_colour_regex[i].match(*data, offset);
-
-        while (regex_match.hasMatch())
+        if (input[read] < 0x20 && unprintable_characters[input[read]] == true)
         {
-            data->remove(regex_match.capturedStart(0), regex_match.capturedLength(0));
-            regex_match = vt100_non_colour_regex[i].match(*data);
+            ++escaped;
         }
 
-        ++i;
+        ++read;
     }
-}
 
-void AutEscape::replace_unprintable(QByteArray *data, bool include_1b)
-{
-    int32_t i = data->length() - 1;
+    if (escaped == 0)
+    {
+        return;
+    }
 
-    while (i >= 0)
+    data->resize(length + (escaped * 2));
+    output = data->data();
+    read = length - 1;
+    write = data->length() - 1;
+
+    while (read >= 0)
     {
-        uint8_t current = (uint8_t)data->at(i);
+        uint8_t current = (uint8_t)output[read];
 
-        if (current < 0x08 || (current >= 0x0b && current <= 0x0c) || (current >= 0x0e && current <= 0x0f))
+        if (current < 0x20 && unprintable_characters[current] == true)
         {
-            data->replace(i, 1, QString("\\0").append(QString::number(current, 16)).toUtf8());
+            output[write--] = hex_digits[current & 0x0f];
+            output[write--] = hex_digits[current >> 4];
+            output[write--] = '\\';
         }
-        else if ((current >= 0x10 && current <= 0x1a) || (current >= 0x1c && current <= 0x1f && (include_1b == true || current != 0x1b)))
+        else
         {
-            data->replace(i, 1, QString("\\").append(QString::number(current, 16)).toUtf8());
+            output[write--] = (char)current;
         }
 
-        --i;
+        --read;
     }
 }
 
 void AutEscape::to_hex(QByteArray *data)
 {
+    //Each byte is replaced by 2 lowercase hex digits, filled from the end backwards so it can be done in place
     int32_t i = data->length() - 1;
+    char *output;
+
+    data->resize(data->length() * 2);
+    output = data->data();
 
     while (i >= 0)
     {
-        uint8_t current = (uint8_t)data->at(i);
-
-        if (current <= 0x0f)
-        {
-            data->replace(i, 1, QString("0").append(QString::number(current, 16)).toUtf8());
-        }
-        else
-        {
-            data->replace(i, 1, QString::number(current, 16).toUtf8());
-        }
+        uint8_t current = (uint8_t)output[i];
 
+        output[(i * 2) + 1] = hex_digits[current & 0x0f];
+        output[(i * 2)] = hex_digits[current >> 4];
         --i;
     }
 }
@@ -0,0 +1,456 @@
+/******************************************************************************
+** Copyright (C) 2024 Jamie M.
+**
+** Project: AuTerm
+**
+** Module: AutFileStream.cpp
+**
+** Notes:
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include "AutFileStream.h"
+
+/******************************************************************************/
+// Constants
+/******************************************************************************/
+//Amount of data kept in flight when the transport speed is not known yet (the previous fixed block size)
+const qint32 file_stream_default_block = 512;
+//Limits on the amount of data kept in flight
+const qint32 file_stream_minimum_block = 64;
+const qint32 file_stream_maximum_block = 65536;
+//Amount of transmit time kept in the OS buffer, so the transport is not starved between writes but cancelling is quick
+const qint32 file_stream_buffer_time_ms = 50;
+//More data is sent once the OS buffer is less than 1/this full
+const qint32 file_stream_refill_fraction = 2;
+//The measured throughput is multiplied by this when sizing blocks, so the amount in flight can grow on fast transports
+const qint32 file_stream_measured_headroom = 2;
+//Approximate bits per byte on the wire (start bit, 8 data bits, stop bit)
+const qint32 file_stream_bits_per_byte = 10;
+//Period the instantaneous throughput is measured over, and the minimum span needed before it is used
+const qint32 file_stream_rate_window_ms = 1000;
+const qint32 file_stream_rate_minimum_span_ms = 100;
+//How often paced data is sent
+const qint32 file_stream_pace_interval_ms = 10;
+//Defaults for the paced and line modes
+const qint32 file_stream_target_rate_default = 1000;
+const qint32 file_stream_ack_timeout_default = 5000;
+
+/******************************************************************************/
+// Local Functions or Private Members
+/******************************************************************************/
+AutFileStream::AutFileStream(QObject *parent) : QObject(parent)
+{
+    stream_mode = FILE_STREAM_MODE_FLOW;
+    running = false;
+    baud_rate = 0;
+    target_rate = file_stream_target_rate_default;
+    ack_data = "\n";
+    waiting_ack = false;
+    ack_timeout_ms = file_stream_ack_timeout_default;
+    file_size = 0;
+    bytes_sent = 0;
+    bytes_written = 0;
+    stopped_ms = 0;
+    pace_last_ms = 0;
+    pace_credit = 0;
+    last_block_size = 0;
+
+    pace_timer.setInterval(file_stream_pace_interval_ms);
+    connect(&pace_timer, SIGNAL(timeout()), this, SLOT(pace_tick()));
+    ack_timer.setSingleShot(true);
+    connect(&ack_timer, SIGNAL(timeout()), this, SLOT(ack_timeout()));
+}
+
+bool AutFileStream::open(const QString &filename)
+{
+    //Opens the file to stream, start() must be called afterwards to begin sending it
+    if (running == true)
+    {
+        return false;
+    }
+
+    if (file.isOpen() == true)
+    {
+        file.close();
+    }
+
+    file.setFileName(filename);
+
+    if (file.open(QIODevice::ReadOnly) == false)
+    {
+        return false;
+    }
+
+    file_size = file.size();
+    return true;
+}
+
+void AutFileStream::start(file_stream_mode_t mode)
+{
+    //Resets statistics and sends the first block or line of the open file
+    if (running == true || file.isOpen() == false)
+    {
+        return;
+    }
+
+    stream_mode = mode;
+    running = true;
+    waiting_ack = false;
+    ack_buffer.clear();
+    bytes_sent = 0;
+    bytes_written = 0;
+    stopped_ms = 0;
+    pace_last_ms = 0;
+    pace_credit = 0;
+    last_block_size = 0;
+    rate_samples.clear();
+    elapsed.start();
+
+    if (stream_mode == FILE_STREAM_MODE_LINE_ACK)
+    {
+        send_line();
+    }
+    else
+    {
+        if (stream_mode == FILE_STREAM_MODE_PACED)
+        {
+            pace_timer.start();
+        }
+
+        send_blocks();
+    }
+}
+
+void AutFileStream::cancel()
+{
+    if (running == true)
+    {
+        finish(FILE_STREAM_RESULT_CANCELLED);
+    }
+}
+
+bool AutFileStream::is_running()
+{
+    return running;
+}
+
+void AutFileStream::set_baud_rate(qint32 baud_rate)
+{
+    //Used to size blocks, 0 if the transport has no baud rate
+    this->baud_rate = baud_rate;
+}
+
+void AutFileStream::set_target_rate(qint32 bytes_per_second)
+{
+    target_rate = (bytes_per_second > 0 ? bytes_per_second : file_stream_target_rate_default);
+}
+
+void AutFileStream::set_acknowledgement(const QByteArray &ack, qint32 timeout_ms)
+{
+    //In line mode, the next line is sent when ack is received (or when the previous line has been written if ack is empty)
+    ack_data = ack;
+    ack_timeout_ms = timeout_ms;
+}
+
+void AutFileStream::data_written(qint64 length)
+{
+    if (running == false)
+    {
+        return;
+    }
+
+    bytes_written += length;
+
+    //Keep the written totals for the last rate window
+    file_stream_sample_t sample;
+    sample.elapsed_ms = elapsed.elapsed();
+    sample.bytes_written = bytes_written;
+    rate_samples.enqueue(sample);
+
+    while (rate_samples.length() > 2 && (sample.elapsed_ms - rate_samples.head().elapsed_ms) > file_stream_rate_window_ms)
+    {
+        rate_samples.dequeue();
+    }
+
+    if (stream_mode == FILE_STREAM_MODE_LINE_ACK)
+    {
+        if (ack_data.isEmpty() == true && waiting_ack == true && bytes_written >= bytes_sent)
+        {
+            //Line has been written and no acknowledgement is used
+            waiting_ack = false;
+
+            if (file.atEnd() == true)
+            {
+                finish(FILE_STREAM_RESULT_FINISHED);
+            }
+            else
+            {
+                send_line();
+            }
+        }
+    }
+    else
+    {
+        send_blocks();
+    }
+}
+
+void AutFileStream::data_received(const QByteArray &data)
+{
+    //Checks received data for the acknowledgement of the last line sent
+    if (running == false || stream_mode != FILE_STREAM_MODE_LINE_ACK || waiting_ack == false || ack_data.isEmpty() == true)
+    {
+        return;
+    }
+
+    ack_buffer.append(data);
+
+    if (ack_buffer.indexOf(ack_data) == -1)
+    {
+        //Only keep enough data to match an acknowledgement split over several reads
+        if (ack_buffer.length() >= ack_data.length())
+        {
+            ack_buffer.remove(0, (ack_buffer.length() - ack_data.length() + 1));
+        }
+
+        return;
+    }
+
+    waiting_ack = false;
+    ack_timer.stop();
+
+    if (file.atEnd() == true)
+    {
+        finish(FILE_STREAM_RESULT_FINISHED);
+    }
+    else
+    {
+        send_line();
+    }
+}
+
+file_stream_mode_t AutFileStream::get_mode()
+{
+    return stream_mode;
+}
+
+quint64 AutFileStream::get_file_size()
+{
+    return file_size;
+}
+
+quint64 AutFileStream::get_bytes_sent()
+{
+    return bytes_sent;
+}
+
+quint64 AutFileStream::get_bytes_written()
+{
+    return bytes_written;
+}
+
+qint64 AutFileStream::get_elapsed_ms()
+{
+    return (running == true ? elapsed.elapsed() : stopped_ms);
+}
+
+quint64 AutFileStream::get_instant_rate()
+{
+    //Bytes per second written over the last rate window, 0 if not enough data has been written to tell
+    qint64 span;
+
+    if (rate_samples.length() < 2)
+    {
+        return 0;
+    }
+
+    if (running == true && (elapsed.elapsed() - rate_samples.last().elapsed_ms) > file_stream_rate_window_ms)
+    {
+        //Nothing has been written recently
+        return 0;
+    }
+
+    span = rate_samples.last().elapsed_ms - rate_samples.head().elapsed_ms;
+
+    if (span < file_stream_rate_minimum_span_ms)
+    {
+        return 0;
+    }
+
+    return (rate_samples.last().bytes_written - rate_samples.head().bytes_written) * 1000 / span;
+}
+
+quint64 AutFileStream::get_average_rate()
+{
+    qint64 elapsed_ms = get_elapsed_ms();
+
+    if (elapsed_ms <= 0)
+    {
+        return 0;
+    }
+
+    return bytes_written * 1000 / elapsed_ms;
+}
+
+qint32 AutFileStream::get_block_size()
+{
+    return last_block_size;
+}
+
+qint32 AutFileStream::get_ack_timeout()
+{
+    return ack_timeout_ms;
+}
+
+void AutFileStream::pace_tick()
+{
+    //Adds pacing credit for the time since the last tick, limited so a stall is not followed by a burst
+    qint64 now = elapsed.elapsed();
+    qint64 maximum_credit = qMax((qint64)target_rate * file_stream_buffer_time_ms, (qint64)1000);
+
+    pace_credit += (now - pace_last_ms) * target_rate;
+    pace_last_ms = now;
+
+    if (pace_credit > maximum_credit)
+    {
+        pace_credit = maximum_credit;
+    }
+
+    send_blocks();
+}
+
+void AutFileStream::ack_timeout()
+{
+    if (running == true && waiting_ack == true)
+    {
+        finish(FILE_STREAM_RESULT_ACK_TIMEOUT);
+    }
+}
+
+void AutFileStream::send_blocks()
+{
+    //Tops up the OS buffer to the target amount once it has drained below the refill level
+    qint64 in_flight = (bytes_written < bytes_sent ? (qint64)(bytes_sent - bytes_written) : 0);
+    qint64 size;
+    qint32 target;
+
+    if (file.atEnd() == true)
+    {
+        if (in_flight == 0)
+        {
+            //All data has been written
+            finish(FILE_STREAM_RESULT_FINISHED);
+        }
+
+        return;
+    }
+
+    target = target_in_flight();
+
+    if (in_flight > (target / file_stream_refill_fraction))
+    {
+        return;
+    }
+
+    size = target - in_flight;
+
+    if (stream_mode == FILE_STREAM_MODE_PACED)
+    {
+        size = qMin(size, (pace_credit / 1000));
+
+        if (size <= 0)
+        {
+            return;
+        }
+
+        pace_credit -= size * 1000;
+    }
+
+    send(file.read(size));
+}
+
+void AutFileStream::send_line()
+{
+    //Sends the next line (or part of a very long line)
+    waiting_ack = true;
+    ack_buffer.clear();
+
+    if (send(file.readLine(file_stream_maximum_block)) == true && ack_data.isEmpty() == false && ack_timeout_ms > 0)
+    {
+        ack_timer.start(ack_timeout_ms);
+    }
+}
+
+bool AutFileStream::send(const QByteArray &data)
+{
+    if (data.isEmpty() == true)
+    {
+        //Only reached if reading failed, the end of the file is checked for before reading
+        finish((file.atEnd() == true ? FILE_STREAM_RESULT_FINISHED : FILE_STREAM_RESULT_READ_ERROR));
+        return false;
+    }
+
+    last_block_size = data.length();
+    bytes_sent += data.length();
+    emit transmit(data);
+
+    return true;
+}
+
+void AutFileStream::finish(file_stream_result_t result)
+{
+    stopped_ms = elapsed.elapsed();
+    running = false;
+    waiting_ack = false;
+    pace_timer.stop();
+    ack_timer.stop();
+    file.close();
+
+    emit finished(result);
+}
+
+qint32 AutFileStream::target_in_flight()
+{
+    //Amount of data to keep in the OS buffer, from the baud rate (if known) or the measured throughput if that is higher
+    qint64 target = file_stream_default_block;
+    qint64 measured = (qint64)get_instant_rate() * file_stream_measured_headroom * file_stream_buffer_time_ms / 1000;
+
+    if (baud_rate > 0)
+    {
+        target = (qint64)baud_rate / file_stream_bits_per_byte * file_stream_buffer_time_ms / 1000;
+    }
+
+    if (measured > target)
+    {
+        target = measured;
+    }
+
+    if (stream_mode == FILE_STREAM_MODE_PACED)
+    {
+        //No more than the pacing allows should be queued
+        target = qMin(target, qMax(((qint64)target_rate * file_stream_buffer_time_ms / 1000), (qint64)1));
+        return (qint32)target;
+    }
+
+    return (qint32)qBound((qint64)file_stream_minimum_block, target, (qint64)file_stream_maximum_block);
+}
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
@@ -0,0 +1,136 @@
+/******************************************************************************
+** Copyright (C) 2024 Jamie M.
+**
+** Project: AuTerm
+**
+** Module: AutFileStream.h
+**
+** Notes:
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+#ifndef AUTFILESTREAM_H
+#define AUTFILESTREAM_H
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include <QObject>
+#include <QByteArray>
+#include <QFile>
+#include <QQueue>
+#include <QTimer>
+#include <QElapsedTimer>
+
+/******************************************************************************/
+// Enum typedefs
+/******************************************************************************/
+enum file_stream_mode_t {
+    FILE_STREAM_MODE_FLOW = 0, //As fast as the transport accepts data
+    FILE_STREAM_MODE_PACED, //Limited to a target number of bytes per second
+    FILE_STREAM_MODE_LINE_ACK, //One line at a time, each waits for an acknowledgement to be received
+
+    FILE_STREAM_MODE_COUNT
+};
+
+enum file_stream_result_t {
+    FILE_STREAM_RESULT_FINISHED = 0,
+    FILE_STREAM_RESULT_CANCELLED,
+    FILE_STREAM_RESULT_ACK_TIMEOUT,
+    FILE_STREAM_RESULT_READ_ERROR
+};
+
+/******************************************************************************/
+// Forward declaration of Class, Struct & Unions
+/******************************************************************************/
+//Number of bytes written by a point in time, used for the instantaneous throughput
+struct file_stream_sample_t {
+    qint64 elapsed_ms;
+    quint64 bytes_written;
+};
+
+/******************************************************************************/
+// Class definitions
+/******************************************************************************/
+//Streams a file out, with no user interface. Data to send is emitted with transmit() and the owner passes
+//back written byte counts (and received data in line mode), so it can be driven by any transport
+class AutFileStream : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AutFileStream(QObject *parent = nullptr);
+    bool open(const QString &filename);
+    void start(file_stream_mode_t mode);
+    void cancel();
+    bool is_running();
+    void set_baud_rate(qint32 baud_rate);
+    void set_target_rate(qint32 bytes_per_second);
+    void set_acknowledgement(const QByteArray &ack, qint32 timeout_ms);
+    void data_written(qint64 length);
+    void data_received(const QByteArray &data);
+    file_stream_mode_t get_mode();
+    quint64 get_file_size();
+    quint64 get_bytes_sent();
+    quint64 get_bytes_written();
+    qint64 get_elapsed_ms();
+    quint64 get_instant_rate();
+    quint64 get_average_rate();
+    qint32 get_block_size();
+    qint32 get_ack_timeout();
+
+signals:
+    //Data which should be written to the transport
+    void transmit(QByteArray data);
+    //Emitted once when the stream stops for any reason, the file is closed before this is emitted
+    void finished(file_stream_result_t result);
+
+private slots:
+    void pace_tick();
+    void ack_timeout();
+
+private:
+    void send_blocks();
+    void send_line();
+    bool send(const QByteArray &data);
+    void finish(file_stream_result_t result);
+    qint32 target_in_flight();
+
+    QFile file;
+    file_stream_mode_t stream_mode;
+    bool running;
+    qint32 baud_rate; //Configured transport speed in bits per second, 0 if not known (e.g. plugin transports)
+    qint32 target_rate; //Bytes per second in paced mode
+    QByteArray ack_data; //Received data which acknowledges a line in line mode
+    QByteArray ack_buffer; //Received data not yet matched against ack_data
+    bool waiting_ack; //True when a line has been sent and has not been acknowledged yet
+    qint32 ack_timeout_ms; //0 to wait forever
+    quint64 file_size;
+    quint64 bytes_sent;
+    quint64 bytes_written;
+    qint64 stopped_ms; //Length of the stream once stopped
+    qint64 pace_last_ms; //Time the pacing credit was last updated
+    qint64 pace_credit; //Thousandths of a byte which can be sent now in paced mode
+    qint32 last_block_size; //Size of the last block sent
+    QElapsedTimer elapsed; //Time since the stream started
+    QQueue<file_stream_sample_t> rate_samples; //Written totals over the last rate window
+    QTimer pace_timer; //Sends paced data
+    QTimer ack_timer; //Stops line mode if an acknowledgement is not received
+};
+
+#endif // AUTFILESTREAM_H
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
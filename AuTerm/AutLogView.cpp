@@ -0,0 +1,848 @@
+/******************************************************************************
+** Copyright (C) 2024 Jamie M.
+**
+** Project: AuTerm
+**
+** Module: AutLogView.cpp
+**
+** Notes:
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include "AutLogView.h"
+#include <QPainter>
+#include <QScrollBar>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QClipboard>
+#include <QApplication>
+#include <QInputDialog>
+#include <string.h>
+#include <climits>
+#include <algorithm>
+
+/******************************************************************************/
+// Constants
+/******************************************************************************/
+//Number of line offsets found before they are added to the shared index
+const qint32 index_block_lines = 65536;
+//Interval at which the view is updated whilst the index is being built
+const qint32 index_update_interval_ms = 100;
+//Default number of characters per tab stop
+const qint32 tab_stop_characters_default = 8;
+//Lines longer than this are cut off when displayed
+const qint64 line_display_limit = 16384;
+//Margin around the text
+const qint32 text_margin = 4;
+//Size of each chunk of the file data searched by find, chunks overlap by the length of the text being searched for
+const qsizetype find_chunk_size = 16 * 1024 * 1024;
+//Opacity of the background of lines matching a find all search
+const qint32 search_hit_alpha = 64;
+static const char hex_digits_lower[] = "0123456789abcdef";
+static const char hex_digits_upper[] = "0123456789ABCDEF";
+
+/******************************************************************************/
+// Local Functions or Private Members
+/******************************************************************************/
+AutLogViewIndexer::AutLogViewIndexer(AutLogView *parent_view)
+{
+    view = parent_view;
+    stopping.storeRelease(0);
+}
+
+void AutLogViewIndexer::stop()
+{
+    stopping.storeRelease(1);
+}
+
+void AutLogViewIndexer::run()
+{
+    //Finds the start of each line, the file data does not change whilst this runs
+    QVector<qint64> block;
+    const char *position = view->data + view->data_start;
+    const char *end = view->data + view->data_size;
+
+    block.reserve(index_block_lines);
+
+    while (position < end && stopping.loadAcquire() == 0)
+    {
+        const char *newline = (const char *)memchr(position, '\n', (end - position));
+
+        if (newline == nullptr || (newline + 1) >= end)
+        {
+            break;
+        }
+
+        block.append((newline + 1) - view->data);
+        position = newline + 1;
+
+        if (block.length() >= index_block_lines)
+        {
+            view->index_mutex.lock();
+            view->line_starts.append(block);
+            view->index_mutex.unlock();
+            block.clear();
+        }
+    }
+
+    view->index_mutex.lock();
+    view->line_starts.append(block);
+    view->index_complete = true;
+    view->index_mutex.unlock();
+}
+
+AutLogViewFinder::AutLogViewFinder(QObject *parent) : QThread(parent)
+{
+    data = nullptr;
+    data_size = 0;
+    data_start = 0;
+    find_from = 0;
+    find_backwards = false;
+    find_id = 0;
+    cancelling.storeRelease(0);
+}
+
+AutLogViewFinder::~AutLogViewFinder()
+{
+    cancel();
+}
+
+void AutLogViewFinder::start_find(const char *file_data, qsizetype file_size, qsizetype file_start, const QByteArray &text, qsizetype from, bool backwards)
+{
+    //Starts a new search, any existing search is cancelled first. The data must stay mapped until the search has finished or been cancelled
+    cancel();
+
+    data = file_data;
+    data_size = file_size;
+    data_start = file_start;
+    find_text = text;
+    matcher.setPattern(text);
+    find_from = from;
+    find_backwards = backwards;
+    ++find_id;
+    cancelling.storeRelease(0);
+    this->start(QThread::LowPriority);
+}
+
+void AutLogViewFinder::cancel()
+{
+    //Stops the search and waits for the thread to exit
+    if (this->isRunning() == true)
+    {
+        cancelling.storeRelease(1);
+        this->wait();
+    }
+}
+
+quint32 AutLogViewFinder::get_find_id()
+{
+    return find_id;
+}
+
+qsizetype AutLogViewFinder::find_forward(qsizetype from, qsizetype last)
+{
+    //Returns the offset of the first match which starts between from and last, or -1 if there is none
+    while (from <= last && cancelling.loadAcquire() == 0)
+    {
+        qsizetype length = qMin((data_size - from), (find_chunk_size + find_text.length() - 1));
+        qsizetype found = matcher.indexIn((data + from), (int)length, 0);
+
+        if (found != -1)
+        {
+            //This is the first match after from, it may be in the overlap with the next chunk
+            return ((from + found) <= last ? (from + found) : -1);
+        }
+
+        from += find_chunk_size;
+    }
+
+    return -1;
+}
+
+qsizetype AutLogViewFinder::find_backward(qsizetype from, qsizetype first)
+{
+    //Returns the offset of the last match which starts between first and from, or -1 if there is none
+    while (from >= first && cancelling.loadAcquire() == 0)
+    {
+        qsizetype chunk_start = qMax(first, (from - find_chunk_size + 1));
+        qsizetype length = qMin(data_size, (from + find_text.length())) - chunk_start;
+        QByteArray chunk = QByteArray::fromRawData((data + chunk_start), (int)length);
+        qsizetype found = chunk.lastIndexOf(find_text, (int)(from - chunk_start));
+
+        if (found != -1)
+        {
+            return (chunk_start + found);
+        }
+
+        from = chunk_start - 1;
+    }
+
+    return -1;
+}
+
+void AutLogViewFinder::run()
+{
+    //Searches from the start offset to the end of the data (or the start, if searching backwards), then wraps around
+    qsizetype found;
+
+    if (find_backwards == false)
+    {
+        found = find_forward(find_from, (data_size - 1));
+
+        if (found == -1)
+        {
+            found = find_forward(data_start, (qMin(find_from, data_size) - 1));
+        }
+    }
+    else
+    {
+        found = find_backward((find_from - 1), data_start);
+
+        if (found == -1)
+        {
+            found = find_backward((data_size - 1), qMax(find_from, data_start));
+        }
+    }
+
+    if (cancelling.loadAcquire() == 0)
+    {
+        emit find_finished(find_id, found);
+    }
+}
+
+AutLogView::AutLogView(QWidget *parent) : QAbstractScrollArea(parent)
+{
+    data = nullptr;
+    data_size = 0;
+    data_start = 0;
+    index_complete = true;
+    indexer = nullptr;
+    selected_first = -1;
+    selected_last = -1;
+    tab_stop_characters = tab_stop_characters_default;
+    longest_line = 0;
+    search_running = false;
+
+    this->setFocusPolicy(Qt::StrongFocus);
+    this->viewport()->setBackgroundRole(QPalette::Base);
+    this->viewport()->setAutoFillBackground(true);
+
+    index_timer.setInterval(index_update_interval_ms);
+    connect(&index_timer, SIGNAL(timeout()), this, SLOT(index_update()));
+    connect(&search, SIGNAL(search_results(quint32,QVector<qint64>)), this, SLOT(search_results(quint32,QVector<qint64>)));
+    connect(&search, SIGNAL(search_finished(quint32,qint64,bool)), this, SLOT(search_finished(quint32,qint64,bool)));
+    connect(&finder, SIGNAL(find_finished(quint32,qint64)), this, SLOT(find_finished(quint32,qint64)));
+}
+
+AutLogView::~AutLogView()
+{
+    clear();
+}
+
+bool AutLogView::open_file(QString filename)
+{
+    //Maps the file and starts building the line index, the view is usable straight away
+    clear();
+    file.setFileName(filename);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    data_size = file.size();
+
+    if (data_size > 0)
+    {
+        data = (const char *)file.map(0, data_size);
+
+        if (data == nullptr)
+        {
+            //Mapping is not supported for this file, read it instead
+            fallback_data = file.readAll();
+            data = fallback_data.constData();
+            data_size = fallback_data.length();
+        }
+    }
+
+    if (data_size >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0)
+    {
+        //Skip UTF-8 BOM
+        data_start = 3;
+    }
+
+    line_starts.append(data_start);
+
+    if (data_size > data_start)
+    {
+        index_complete = false;
+        indexer = new AutLogViewIndexer(this);
+        indexer->start(QThread::LowPriority);
+        index_timer.start();
+    }
+
+    update_scrollbars();
+    this->viewport()->update();
+
+    return true;
+}
+
+void AutLogView::clear()
+{
+    //Closes the current file, the searches must be stopped before the data is unmapped
+    index_timer.stop();
+    search.cancel();
+    finder.cancel();
+    search_hits.clear();
+    search_running = false;
+
+    if (indexer != nullptr)
+    {
+        indexer->stop();
+        indexer->wait();
+        delete indexer;
+        indexer = nullptr;
+    }
+
+    if (file.isOpen() == true)
+    {
+        if (data != nullptr && fallback_data.isEmpty() == true)
+        {
+            file.unmap((uchar *)data);
+        }
+
+        file.close();
+    }
+
+    fallback_data.clear();
+    data = nullptr;
+    data_size = 0;
+    data_start = 0;
+    line_starts.clear();
+    index_complete = true;
+    selected_first = -1;
+    selected_last = -1;
+    longest_line = 0;
+    this->verticalScrollBar()->setValue(0);
+    this->horizontalScrollBar()->setValue(0);
+    update_scrollbars();
+    this->viewport()->update();
+}
+
+void AutLogView::setTabStopDistance(qreal distance)
+{
+    //Tabs are expanded to spaces when drawn, convert the distance to a number of characters
+    qint32 space_width = this->fontMetrics().horizontalAdvance(' ');
+
+    tab_stop_characters = (space_width > 0 ? qMax(1, qRound(distance / space_width)) : tab_stop_characters_default);
+    this->viewport()->update();
+}
+
+qint64 AutLogView::line_count()
+{
+    QMutexLocker locker(&index_mutex);
+    return line_starts.length();
+}
+
+QByteArray AutLogView::line_data(qint64 line)
+{
+    //Returns the raw data of a line, without the line ending. Lines after the end of the current index are returned empty
+    qint64 start;
+    qint64 end;
+
+    index_mutex.lock();
+
+    if (line < 0 || line >= line_starts.length())
+    {
+        index_mutex.unlock();
+        return QByteArray();
+    }
+
+    start = line_starts.at(line);
+    end = ((line + 1) < line_starts.length() ? line_starts.at(line + 1) : (index_complete == true ? data_size : start));
+    index_mutex.unlock();
+
+    while (end > start && (data[end - 1] == '\n' || data[end - 1] == '\r'))
+    {
+        --end;
+    }
+
+    return QByteArray::fromRawData(data + start, (end - start));
+}
+
+qint64 AutLogView::search_line_count(bool *complete)
+{
+    //Called from the search thread, lines are searched whilst the index is still being built
+    QMutexLocker locker(&index_mutex);
+
+    *complete = index_complete;
+
+    if (index_complete == false && line_starts.length() > 0)
+    {
+        //The last line in the index is not known to be complete yet
+        return line_starts.length() - 1;
+    }
+
+    return line_starts.length();
+}
+
+QByteArray AutLogView::search_line_data(qint64 line)
+{
+    return line_data(line);
+}
+
+qint64 AutLogView::line_start(qint64 line)
+{
+    //Returns the file offset of the start of a line
+    QMutexLocker locker(&index_mutex);
+
+    if (line < 0 || line >= line_starts.length())
+    {
+        return data_start;
+    }
+
+    return line_starts.at(line);
+}
+
+qint64 AutLogView::line_from_position(qint64 position)
+{
+    //Binary search for the line containing a file offset
+    QMutexLocker locker(&index_mutex);
+    QVector<qint64>::const_iterator found = std::upper_bound(line_starts.constBegin(), line_starts.constEnd(), position);
+
+    return qMax((qint64)0, (qint64)(found - line_starts.constBegin()) - 1);
+}
+
+QString AutLogView::escape_line(const char *line, qint64 length)
+{
+    //Expands tabs and escapes control characters, in the same way the log used to be displayed
+    QByteArray output;
+    qint64 i = 0;
+    qint32 column = 0;
+
+    if (length > line_display_limit)
+    {
+        length = line_display_limit;
+    }
+
+    output.reserve(length + 16);
+
+    while (i < length)
+    {
+        uint8_t current = (uint8_t)line[i];
+
+        if (current == '\t')
+        {
+            qint32 spaces = tab_stop_characters - (column % tab_stop_characters);
+
+            output.append(spaces, ' ');
+            column += spaces;
+        }
+        else if (current == '\r')
+        {
+            //Carriage returns are not displayed
+        }
+        else if (current < 0x20)
+        {
+            output.append('\\');
+
+            if (current < 0x10)
+            {
+                output.append('0');
+                output.append(hex_digits_upper[current]);
+            }
+            else
+            {
+                output.append(hex_digits_lower[current >> 4]);
+                output.append(hex_digits_lower[current & 0x0f]);
+            }
+
+            column += 3;
+        }
+        else
+        {
+            output.append((char)current);
+
+            if ((current & 0xc0) != 0x80)
+            {
+                //Only count the first byte of UTF-8 characters
+                ++column;
+            }
+        }
+
+        ++i;
+    }
+
+    return QString::fromUtf8(output);
+}
+
+void AutLogView::update_scrollbars()
+{
+    qint32 line_height = this->fontMetrics().lineSpacing();
+    qint32 visible_lines = qMax(1, (this->viewport()->height() / line_height));
+    qint64 lines = line_count();
+
+    this->verticalScrollBar()->setPageStep(visible_lines);
+    this->verticalScrollBar()->setSingleStep(1);
+    this->verticalScrollBar()->setRange(0, (int)qMin((qint64)INT_MAX, qMax((qint64)0, (lines - visible_lines))));
+    this->horizontalScrollBar()->setPageStep(this->viewport()->width());
+    this->horizontalScrollBar()->setSingleStep(this->fontMetrics().horizontalAdvance(' ') * 4);
+    this->horizontalScrollBar()->setRange(0, qMax(0, (longest_line - this->viewport()->width() + (text_margin * 2))));
+}
+
+void AutLogView::index_update()
+{
+    //Extends the scrollbars as more of the index is built
+    bool complete;
+
+    index_mutex.lock();
+    complete = index_complete;
+    index_mutex.unlock();
+
+    update_scrollbars();
+    this->viewport()->update();
+
+    if (complete == true)
+    {
+        index_timer.stop();
+    }
+}
+
+void AutLogView::paintEvent(QPaintEvent *)
+{
+    //Only the lines in view are converted and drawn
+    QPainter painter(this->viewport());
+    QFontMetrics metrics = this->fontMetrics();
+    qint32 line_height = metrics.lineSpacing();
+    qint64 line = this->verticalScrollBar()->value();
+    qint64 lines = line_count();
+    qint32 y = 0;
+    qint32 x = text_margin - this->horizontalScrollBar()->value();
+    qint32 widest = longest_line;
+
+    if (data == nullptr)
+    {
+        return;
+    }
+
+    painter.setFont(this->font());
+
+    while (line < lines && y < this->viewport()->height())
+    {
+        QByteArray raw = line_data(line);
+        QString text = escape_line(raw.constData(), raw.length());
+        qint32 width = metrics.horizontalAdvance(text);
+
+        if (line >= selected_first && line <= selected_last)
+        {
+            painter.fillRect(0, y, this->viewport()->width(), line_height, this->palette().brush(QPalette::Highlight));
+            painter.setPen(this->palette().color(QPalette::HighlightedText));
+        }
+        else
+        {
+            if (search_hits.isEmpty() == false && std::binary_search(search_hits.constBegin(), search_hits.constEnd(), line) == true)
+            {
+                //Line matches the find all search
+                QColor hit_colour = this->palette().color(QPalette::Highlight);
+
+                hit_colour.setAlpha(search_hit_alpha);
+                painter.fillRect(0, y, this->viewport()->width(), line_height, hit_colour);
+            }
+
+            painter.setPen(this->palette().color(QPalette::Text));
+        }
+
+        painter.drawText(x, (y + metrics.ascent()), text);
+
+        if (width > widest)
+        {
+            widest = width;
+        }
+
+        y += line_height;
+        ++line;
+    }
+
+    if (search_running == true || search_hits.isEmpty() == false)
+    {
+        //Show the number of matches in the top right corner
+        QString status = QString::number(search_hits.length()).append(search_hits.length() == 1 ? " match" : " matches").append(search_running == true ? " (searching...)" : "");
+        qint32 status_width = metrics.horizontalAdvance(status) + (text_margin * 2);
+        QRect status_rect((this->viewport()->width() - status_width), 0, status_width, line_height);
+
+        painter.fillRect(status_rect, this->palette().brush(QPalette::ToolTipBase));
+        painter.setPen(this->palette().color(QPalette::ToolTipText));
+        painter.drawText(status_rect, Qt::AlignCenter, status);
+    }
+
+    if (widest != longest_line)
+    {
+        longest_line = widest;
+        update_scrollbars();
+    }
+}
+
+void AutLogView::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    update_scrollbars();
+}
+
+void AutLogView::changeEvent(QEvent *event)
+{
+    QAbstractScrollArea::changeEvent(event);
+
+    if (event->type() == QEvent::FontChange)
+    {
+        longest_line = 0;
+        update_scrollbars();
+        this->viewport()->update();
+    }
+}
+
+void AutLogView::mousePressEvent(QMouseEvent *event)
+{
+    //Selects a line, shift extends the selection
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    qint64 line = this->verticalScrollBar()->value() + (qint64)(event->position().y() / this->fontMetrics().lineSpacing());
+#else
+    qint64 line = this->verticalScrollBar()->value() + (qint64)(event->pos().y() / this->fontMetrics().lineSpacing());
+#endif
+
+    if (line >= line_count())
+    {
+        return;
+    }
+
+    if ((event->modifiers() & Qt::ShiftModifier) && selected_first != -1)
+    {
+        if (line < selected_first)
+        {
+            selected_first = line;
+        }
+        else
+        {
+            selected_last = line;
+        }
+    }
+    else
+    {
+        selected_first = line;
+        selected_last = line;
+    }
+
+    this->viewport()->update();
+}
+
+void AutLogView::keyPressEvent(QKeyEvent *event)
+{
+    if (event->matches(QKeySequence::Copy) && selected_first != -1)
+    {
+        //Copy selected lines
+        QByteArray copy_data;
+        qint64 line = selected_first;
+
+        while (line <= selected_last)
+        {
+            copy_data.append(line_data(line)).append('\n');
+            ++line;
+        }
+
+        QApplication::clipboard()->setText(QString::fromUtf8(copy_data));
+    }
+    else if (event->matches(QKeySequence::SelectAll))
+    {
+        selected_first = 0;
+        selected_last = line_count() - 1;
+        this->viewport()->update();
+    }
+    else if (event->matches(QKeySequence::Find))
+    {
+        bool ok;
+        QString text = QInputDialog::getText(this, "Find", "Find text:", QLineEdit::Normal, QString::fromUtf8(search_text), &ok);
+
+        if (ok == true && text.isEmpty() == false)
+        {
+            search_text = text.toUtf8();
+            find(search_text, false);
+        }
+    }
+    else if (event->key() == Qt::Key_F && (event->modifiers() & Qt::ControlModifier) && (event->modifiers() & Qt::ShiftModifier))
+    {
+        //Find all lines matching a regular expression
+        bool ok;
+        QString text = QInputDialog::getText(this, "Find All", "Regular expression:", QLineEdit::Normal, QString::fromUtf8(search_text), &ok);
+
+        if (ok == true && text.isEmpty() == false)
+        {
+            search_text = text.toUtf8();
+            find_all(text, true, true);
+        }
+    }
+    else if (event->matches(QKeySequence::FindNext) && (search_hits.isEmpty() == false || search_text.isEmpty() == false))
+    {
+        if (find_hit(false) == false)
+        {
+            find(search_text, false);
+        }
+    }
+    else if (event->matches(QKeySequence::FindPrevious) && (search_hits.isEmpty() == false || search_text.isEmpty() == false))
+    {
+        if (find_hit(true) == false)
+        {
+            find(search_text, true);
+        }
+    }
+    else if (event->key() == Qt::Key_Home && (event->modifiers() & Qt::ControlModifier))
+    {
+        this->verticalScrollBar()->setValue(0);
+    }
+    else if (event->key() == Qt::Key_End && (event->modifiers() & Qt::ControlModifier))
+    {
+        this->verticalScrollBar()->setValue(this->verticalScrollBar()->maximum());
+    }
+    else
+    {
+        QAbstractScrollArea::keyPressEvent(event);
+    }
+}
+
+void AutLogView::scroll_to_line(qint64 line)
+{
+    //Selects a line and scrolls it into the middle of the view
+    selected_first = line;
+    selected_last = line;
+    this->verticalScrollBar()->setValue((int)qMin((qint64)INT_MAX, qMax((qint64)0, (line - (this->verticalScrollBar()->pageStep() / 2)))));
+    this->viewport()->update();
+}
+
+bool AutLogView::find(const QByteArray &text, bool backwards)
+{
+    //Starts a background search of the mapped file data from the selected line (or top of the view), wrapping around
+    //at the end. The view moves to the match once it has been found
+    qsizetype start;
+    qint64 from_line = (selected_first != -1 ? selected_first : this->verticalScrollBar()->value());
+
+    if (data == nullptr || text.isEmpty() == true)
+    {
+        return false;
+    }
+
+    if (backwards == false)
+    {
+        start = ((from_line + 1) < line_count() ? line_start(from_line + 1) : data_size);
+    }
+    else
+    {
+        start = line_start(from_line);
+    }
+
+    finder.start_find(data, data_size, data_start, text, start, backwards);
+
+    return true;
+}
+
+void AutLogView::find_finished(quint32 id, qint64 position)
+{
+    if (id != finder.get_find_id() || position == -1)
+    {
+        return;
+    }
+
+    scroll_to_line(line_from_position(position));
+}
+
+bool AutLogView::find_all(QString pattern, bool regex, bool case_sensitive)
+{
+    //Starts a background search for all matching lines, matches are shown as they are found
+    search_hits.clear();
+    search_running = false;
+
+    if (data == nullptr)
+    {
+        this->viewport()->update();
+        return false;
+    }
+
+    search_running = search.start_search(this, pattern, regex, case_sensitive);
+    this->viewport()->update();
+
+    return search_running;
+}
+
+bool AutLogView::find_hit(bool backwards)
+{
+    //Moves to the next or previous line from the find all results, wrapping around at the end
+    QVector<qint64>::const_iterator found;
+    qint64 from_line = (selected_first != -1 ? selected_first : this->verticalScrollBar()->value());
+
+    if (search_hits.isEmpty() == true)
+    {
+        return false;
+    }
+
+    if (backwards == false)
+    {
+        found = std::upper_bound(search_hits.constBegin(), search_hits.constEnd(), from_line);
+
+        if (found == search_hits.constEnd())
+        {
+            found = search_hits.constBegin();
+        }
+    }
+    else
+    {
+        found = std::lower_bound(search_hits.constBegin(), search_hits.constEnd(), from_line);
+        found = (found == search_hits.constBegin() ? search_hits.constEnd() : found) - 1;
+    }
+
+    scroll_to_line(*found);
+
+    return true;
+}
+
+void AutLogView::search_results(quint32 id, QVector<qint64> lines)
+{
+    //Results are in line order, so can be appended
+    if (id != search.get_search_id())
+    {
+        return;
+    }
+
+    search_hits.append(lines);
+    this->viewport()->update();
+}
+
+void AutLogView::search_finished(quint32 id, qint64, bool)
+{
+    if (id != search.get_search_id())
+    {
+        return;
+    }
+
+    search_running = false;
+    this->viewport()->update();
+
+    if (search_hits.isEmpty() == false && selected_first == -1)
+    {
+        find_hit(false);
+    }
+}
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
@@ -0,0 +1,163 @@
+/******************************************************************************
+** Copyright (C) 2024 Jamie M.
+**
+** Project: AuTerm
+**
+** Module: AutLogView.h
+**
+** Notes:
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+#ifndef AUTLOGVIEW_H
+#define AUTLOGVIEW_H
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include <QAbstractScrollArea>
+#include <QFile>
+#include <QMutex>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <QAtomicInteger>
+#include <QByteArrayMatcher>
+#include "AutSearch.h"
+
+/******************************************************************************/
+// Forward declaration of Class, Struct & Unions
+/******************************************************************************/
+class AutLogView;
+
+/******************************************************************************/
+// Class definitions
+/******************************************************************************/
+//Builds the line offset index of a log file in the background
+class AutLogViewIndexer : public QThread
+{
+public:
+    explicit AutLogViewIndexer(AutLogView *parent_view);
+    void stop();
+
+protected:
+    void run() override;
+
+private:
+    AutLogView *view;
+    QAtomicInteger<int> stopping;
+};
+
+//Finds the next or previous occurrence of text in the log file data in a background thread, the data is searched in
+//chunks so files larger than 2GiB can be searched
+class AutLogViewFinder : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit AutLogViewFinder(QObject *parent = nullptr);
+    ~AutLogViewFinder();
+    void start_find(const char *file_data, qsizetype file_size, qsizetype file_start, const QByteArray &text, qsizetype from, bool backwards);
+    void cancel();
+    quint32 get_find_id();
+
+signals:
+    void find_finished(quint32 id, qint64 position);
+
+protected:
+    void run() override;
+
+private:
+    qsizetype find_forward(qsizetype from, qsizetype last);
+    qsizetype find_backward(qsizetype from, qsizetype first);
+
+    const char *data; //Log file data being searched
+    qsizetype data_size; //Size of the log file data
+    qsizetype data_start; //Offset of the first line, after any UTF-8 BOM
+    QByteArray find_text; //Text being searched for
+    QByteArrayMatcher matcher; //Used for forward searches
+    qsizetype find_from; //Offset the search starts at
+    bool find_backwards; //True to search towards the start of the file
+    QAtomicInteger<int> cancelling; //Set to stop the search
+    quint32 find_id; //Increased for each search, so a result from a cancelled search which is still queued can be ignored
+};
+
+//Read-only viewer for large log files. The file is memory mapped and only the
+//visible lines are rendered, with control characters escaped as they are drawn
+class AutLogView : public QAbstractScrollArea, public AutSearchSource
+{
+    Q_OBJECT
+
+public:
+    explicit AutLogView(QWidget *parent = 0);
+    ~AutLogView();
+    bool open_file(QString filename);
+    void clear();
+    void setTabStopDistance(qreal distance);
+    qint64 line_count();
+    QByteArray line_data(qint64 line);
+    bool find(const QByteArray &text, bool backwards);
+    bool find_all(QString pattern, bool regex, bool case_sensitive);
+    qint64 search_line_count(bool *complete) override;
+    QByteArray search_line_data(qint64 line) override;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void changeEvent(QEvent *event) override;
+
+private slots:
+    void index_update();
+    void search_results(quint32 id, QVector<qint64> lines);
+    void search_finished(quint32 id, qint64 matches, bool cancelled);
+    void find_finished(quint32 id, qint64 position);
+
+private:
+    void update_scrollbars();
+    QString escape_line(const char *data, qint64 length);
+    qint64 line_start(qint64 line);
+    qint64 line_from_position(qint64 position);
+    void scroll_to_line(qint64 line);
+    bool find_hit(bool backwards);
+
+    QFile file; //Log file being viewed
+    QByteArray fallback_data; //Log file contents, if the file could not be memory mapped
+    const char *data; //Start of the log file data
+    qint64 data_size; //Size of the log file data
+    qint64 data_start; //Offset of the first line, after any UTF-8 BOM
+    QVector<qint64> line_starts; //Offset of the start of each line, added to by the indexer
+    QMutex index_mutex; //Protects line_starts
+    bool index_complete; //True once the indexer has finished
+    AutLogViewIndexer *indexer; //Background line index thread
+    QTimer index_timer; //Updates the scrollbars whilst the index is being built
+    qint64 selected_first; //First selected line (-1 if none)
+    qint64 selected_last; //Last selected line
+    QByteArray search_text; //Last text searched for
+    qint32 tab_stop_characters; //Number of characters per tab stop
+    qint32 longest_line; //Width of the longest line drawn, for the horizontal scrollbar
+    AutSearch search; //Background search for all matching lines
+    AutLogViewFinder finder; //Background search for the next or previous match
+    QVector<qint64> search_hits; //Lines matching the last find all, in order
+    bool search_running; //True whilst the background search is in progress
+
+    friend class AutLogViewIndexer;
+};
+
+#endif // AUTLOGVIEW_H
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
@@ -26,52 +26,193 @@
 // Include Files
 /******************************************************************************/
 #include "AutLogger.h"
+#include <QFileInfo>
+#include <QDir>
+
+/******************************************************************************/
+// Constants
+/******************************************************************************/
+//Buffered data size at which the writer thread is woken up early (256KiB)
+const qint32 log_flush_threshold = 256 * 1024;
+//Maximum time data is held in the buffer before being written
+const quint32 log_flush_interval_ms = 500;
+//Buffered data size at which writes block until the writer has caught up (64MiB)
+const qint32 log_buffer_limit = 64 * 1024 * 1024;
+//Size of each part of a rotated log file which is compressed at a time (1MiB)
+const qint64 log_compress_chunk_size = 1024 * 1024;
+//Number of attempts to find an unused name for a rotated log file
+const quint8 log_rotate_name_attempts = 100;
+const char log_utf8_bom[] = "\xEF\xBB\xBF";
 
 /******************************************************************************/
 // Local Functions or Private Members
 /******************************************************************************/
+struct crc32_table_t
+{
+    quint32 table[256];
+};
+
+//Standard CRC32 (as used by gzip), the table is generated at compile time
+static constexpr crc32_table_t crc32_generate_table(quint32 polynomial)
+{
+    crc32_table_t table = {};
+
+    for (quint32 n = 0; n < 256; n++)
+    {
+        quint32 value = n;
+
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            value = (value & 1) ? (polynomial ^ (value >> 1)) : (value >> 1);
+        }
+
+        table.table[n] = value;
+    }
+
+    return table;
+}
+
+static constexpr crc32_table_t crc32_table = crc32_generate_table(0xedb88320);
+
+static quint32 crc32_update(quint32 crc, const char *data, qint64 length)
+{
+    qint64 i = 0;
+
+    crc = ~crc;
+
+    while (i < length)
+    {
+        crc = crc32_table.table[(crc ^ (uint8_t)data[i]) & 0xff] ^ (crc >> 8);
+        ++i;
+    }
+
+    return ~crc;
+}
+
+static bool gzip_write_member(QFile *output_file, const QByteArray &data)
+{
+    //Writes data as one gzip member. qCompress output is a 4 byte length, 2 byte zlib header, deflate data and 4 byte
+    //adler32, gzip only needs the deflate data. qCompress returns no deflate data for empty input, so an empty final
+    //block is used for that
+    QByteArray header("\x1f\x8b\x08\x00\x00\x00\x00\x00\x00\xff", 10);
+    QByteArray compressed;
+    const char *deflate_data = "\x03\x00";
+    qint64 deflate_length = 2;
+    quint32 crc = crc32_update(0, data.constData(), data.length());
+    quint32 size = (quint32)data.length();
+    uint8_t trailer[8];
+
+    if (data.isEmpty() == false)
+    {
+        compressed = qCompress(data, 9);
+
+        if (compressed.length() < 10)
+        {
+            return false;
+        }
+
+        deflate_data = compressed.constData() + 6;
+        deflate_length = compressed.length() - 10;
+    }
+
+    trailer[0] = (uint8_t)crc;
+    trailer[1] = (uint8_t)(crc >> 8);
+    trailer[2] = (uint8_t)(crc >> 16);
+    trailer[3] = (uint8_t)(crc >> 24);
+    trailer[4] = (uint8_t)size;
+    trailer[5] = (uint8_t)(size >> 8);
+    trailer[6] = (uint8_t)(size >> 16);
+    trailer[7] = (uint8_t)(size >> 24);
+
+    return (output_file->write(header) == header.length() && output_file->write(deflate_data, deflate_length) == deflate_length && output_file->write((const char *)trailer, sizeof(trailer)) == sizeof(trailer));
+}
+
+AutLoggerThread::AutLoggerThread(AutLogger *parent_logger)
+{
+    logger = parent_logger;
+}
+
+void AutLoggerThread::run()
+{
+    logger->writer_run();
+}
+
+AutLoggerCompressThread::AutLoggerCompressThread(QString filename)
+{
+    compress_filename = filename;
+}
+
+void AutLoggerCompressThread::run()
+{
+    AutLogger::compress_file(compress_filename);
+}
+
 AutLogger::AutLogger(QWidget *parent) : QWidget(parent)
 {
     //Initial values
     mbLogOpen = false;
+    log_binary = false;
+    mpLogFile = nullptr;
+    writer_thread = nullptr;
+    writer_stop = false;
+    writer_flush = false;
+    writer_clear = false;
+    log_size = 0;
+    rotate_size = 0;
+    rotate_age = 0;
+    rotate_compress = false;
 }
 
 AutLogger::~AutLogger()
 {
-    if (mbLogOpen == true)
-    {
-        //Log is open, flush the buffer, close it and delete it's handle
-        mpLogFile->flush();
-        mbLogOpen = false;
-        delete mpStreamOut;
-        delete mpLogFile;
-    }
+    //Write any outstanding data and close the log
+    CloseLogFile();
 }
 
-unsigned char AutLogger::OpenLogFile(QString strFilename)
+unsigned char AutLogger::OpenLogFile(QString strFilename, bool binary)
 {
     //Opens the log file specified
     bool bNewFile = QFile::exists(strFilename);
     if (mbLogOpen == false)
     {
         //Open log file
+        log_binary = binary;
         mpLogFile = new QFile(strFilename);
-        if (!mpLogFile->open(QIODevice::Append | QIODevice::Text))
+        if (!mpLogFile->open(log_open_mode()))
         {
             //Unable to open file
+            delete mpLogFile;
+            mpLogFile = nullptr;
             return LOG_ERR_ACCESS;
         }
-        mpStreamOut = new QDataStream(mpLogFile);
-        if (bNewFile == false)
+
+        log_filename = strFilename;
+        log_size = mpLogFile->size();
+        log_started = QDateTime::currentDateTime();
+        buffer.clear();
+        buffer.reserve(log_flush_threshold * 2);
+        writer_stop = false;
+        writer_flush = false;
+        writer_clear = false;
+
+        if (log_binary == true)
+        {
+            //Binary files have no header
+        }
+        else if (bNewFile == false)
         {
             //Create UTF-8 header
-            mpStreamOut->writeRawData("\xEF\xBB\xBF", 3);
+            append_data(log_utf8_bom, (sizeof(log_utf8_bom) - 1));
         }
         else
         {
             //Add a newline
-            mpStreamOut->writeRawData("\r\n", 2);
+            append_data("\r\n", 2);
         }
+
+        //Data is written to the file from a background thread
+        writer_thread = new AutLoggerThread(this);
+        writer_thread->start(QThread::LowPriority);
         mbLogOpen = true;
         return LOG_OK;
     }
@@ -84,13 +225,52 @@ unsigned char AutLogger::OpenLogFile(QString strFilename)
 
 void AutLogger::CloseLogFile()
 {
-    //Closes the log file
+    //Closes the log file, once the writer thread has written all outstanding data
     if (mbLogOpen == true)
     {
-        mpLogFile->flush();
+        buffer_mutex.lock();
+        writer_stop = true;
+        buffer_wake.wakeAll();
+        buffer_mutex.unlock();
+
+        writer_thread->wait();
+        delete writer_thread;
+        writer_thread = nullptr;
+
+        //Let any rotated logs finish being compressed
+        while (compress_threads.isEmpty() == false)
+        {
+            AutLoggerCompressThread *compress_thread = compress_threads.takeFirst();
+            compress_thread->wait();
+            delete compress_thread;
+        }
+
         mbLogOpen = false;
-        delete mpStreamOut;
+        mpLogFile->close();
         delete mpLogFile;
+        mpLogFile = nullptr;
+        buffer.clear();
+        buffer.squeeze();
+    }
+}
+
+void AutLogger::append_data(const char *data, qint32 length)
+{
+    //Adds data to the buffer, the writer thread is woken up once enough data has been buffered
+    QMutexLocker locker(&buffer_mutex);
+
+    while (buffer.length() >= log_buffer_limit && writer_stop == false && writer_thread != nullptr)
+    {
+        //Writer has fallen far behind, wait rather than using unbounded memory
+        buffer_space.wait(&buffer_mutex);
+    }
+
+    buffer.append(data, length);
+    log_size += length;
+
+    if (buffer.length() >= log_flush_threshold)
+    {
+        buffer_wake.wakeAll();
     }
 }
 
@@ -100,7 +280,8 @@ unsigned char AutLogger::WriteLogData(QString strData)
     if (mbLogOpen == true)
     {
         //Log opened
-        mpStreamOut->writeRawData(strData.toUtf8(), strData.toUtf8().length());
+        QByteArray baData = strData.toUtf8();
+        append_data(baData.constData(), baData.length());
         return LOG_OK;
     }
     else
@@ -116,7 +297,23 @@ unsigned char AutLogger::WriteRawLogData(QByteArray baData)
     if (mbLogOpen == true)
     {
         //Log opened
-        mpStreamOut->writeRawData(baData, baData.length());
+        append_data(baData.constData(), baData.length());
+        return LOG_OK;
+    }
+    else
+    {
+        //Log not opened
+        return LOG_NOT_OPEN;
+    }
+}
+
+unsigned char AutLogger::WriteRawLogData(const char *data, qint32 length)
+{
+    //Writes raw data to the log file
+    if (mbLogOpen == true)
+    {
+        //Log opened
+        append_data(data, length);
         return LOG_OK;
     }
     else
@@ -126,13 +323,15 @@ unsigned char AutLogger::WriteRawLogData(QByteArray baData)
     }
 }
 
-unsigned short AutLogger::GetLogSize()
+qint64 AutLogger::GetLogSize()
 {
-    //Returns the size of the log
+    //Returns the size of the log, including data which has not yet been written
+    QMutexLocker locker(&buffer_mutex);
+
     if (mbLogOpen == true)
     {
         //Log open
-        return mpLogFile->size();
+        return log_size;
     }
     else
     {
@@ -146,21 +345,37 @@ void AutLogger::ClearLog()
     //Clears out the log
     if (mbLogOpen == true)
     {
-        //Resize file to be empty
-        mpLogFile->flush();
-        mpLogFile->resize(0);
+        //Discard buffered data, the writer thread will resize the file to be empty
+        QMutexLocker locker(&buffer_mutex);
+        buffer.clear();
+        writer_clear = true;
+        log_size = 0;
+        locker.unlock();
+
+        if (log_binary == false)
+        {
+            //Write the UTF-8 BOM
+            append_data(log_utf8_bom, (sizeof(log_utf8_bom) - 1));
+        }
 
-        //Write the UTF-8 BOM
-        mpStreamOut->writeRawData("\xEF\xBB\xBF", 3);
+        FlushLog();
     }
 }
 
+void AutLogger::FlushLog()
+{
+    //Requests that buffered data is written to the file now
+    QMutexLocker locker(&buffer_mutex);
+    writer_flush = true;
+    buffer_wake.wakeAll();
+}
+
 QString AutLogger::GetLogName()
 {
-    if (mpLogFile->isOpen() == true)
+    if (mbLogOpen == true)
     {
         //Log open, return log file name
-        return mpLogFile->fileName();
+        return log_filename;
     }
     else
     {
@@ -175,6 +390,228 @@ bool AutLogger::IsLogOpen()
     return mbLogOpen;
 }
 
+void AutLogger::SetRotation(qint64 max_size, qint32 max_age, bool compress)
+{
+    //Sets when the log file is rotated: when it reaches max_size bytes or is older than max_age minutes (0 disables either)
+    QMutexLocker locker(&buffer_mutex);
+    rotate_size = max_size;
+    rotate_age = max_age;
+    rotate_compress = compress;
+}
+
+QIODevice::OpenMode AutLogger::log_open_mode()
+{
+    return (log_binary == true ? QIODevice::OpenMode(QIODevice::Append) : (QIODevice::Append | QIODevice::Text));
+}
+
+void AutLogger::writer_run()
+{
+    //Writer thread, takes all buffered data and writes it to the file in one go
+    QByteArray write_buffer;
+    bool clear;
+    bool stop = false;
+
+    write_buffer.reserve(log_flush_threshold * 2);
+
+    while (stop == false)
+    {
+        buffer_mutex.lock();
+
+        if (buffer.length() < log_flush_threshold && writer_stop == false && writer_flush == false)
+        {
+            buffer_wake.wait(&buffer_mutex, log_flush_interval_ms);
+        }
+
+        //Swapping keeps the allocations of both buffers, so neither side reallocates
+        write_buffer.swap(buffer);
+        clear = writer_clear;
+        stop = writer_stop;
+        writer_clear = false;
+        writer_flush = false;
+        buffer_space.wakeAll();
+        buffer_mutex.unlock();
+
+        if (mpLogFile->isOpen() == false && writer_reopen() == true)
+        {
+            //Log file could not be reopened after rotation before, but can be now
+            buffer_mutex.lock();
+            log_size = mpLogFile->size() + write_buffer.length() + buffer.length();
+            buffer_mutex.unlock();
+        }
+
+        if (mpLogFile->isOpen() == false)
+        {
+            //Nowhere to write to, this has already been reported
+            write_buffer.resize(0);
+            continue;
+        }
+
+        if (clear == true)
+        {
+            mpLogFile->flush();
+            mpLogFile->resize(0);
+        }
+
+        if (write_buffer.length() > 0)
+        {
+            mpLogFile->write(write_buffer);
+            write_buffer.resize(0);
+        }
+
+        mpLogFile->flush();
+
+        if (stop == false)
+        {
+            writer_rotate();
+        }
+    }
+}
+
+bool AutLogger::writer_rotate()
+{
+    //Rotates the log file if it has reached the size or age limit, the old file is renamed with the date and time
+    QString rotated_name;
+    QFileInfo file_info(log_filename);
+    qint64 size_limit;
+    qint32 age_limit;
+    bool compress;
+    uint8_t i = 0;
+
+    buffer_mutex.lock();
+    size_limit = rotate_size;
+    age_limit = rotate_age;
+    compress = rotate_compress;
+    buffer_mutex.unlock();
+
+    if (!((size_limit > 0 && mpLogFile->size() >= size_limit) || (age_limit > 0 && log_started.secsTo(QDateTime::currentDateTime()) >= ((qint64)age_limit * 60))))
+    {
+        return false;
+    }
+
+    while (i < log_rotate_name_attempts)
+    {
+        rotated_name = file_info.dir().filePath(QString(file_info.completeBaseName()).append("_").append(log_started.toString("yyyyMMdd-hhmmss")).append(i > 0 ? QString("_").append(QString::number(i)) : QString()).append(file_info.suffix().isEmpty() ? QString() : QString(".").append(file_info.suffix())));
+
+        if (QFile::exists(rotated_name) == false && QFile::exists(QString(rotated_name).append(".gz")) == false)
+        {
+            break;
+        }
+
+        ++i;
+    }
+
+    if (i == log_rotate_name_attempts)
+    {
+        return false;
+    }
+
+    mpLogFile->close();
+
+    if (QFile::rename(log_filename, rotated_name) == false)
+    {
+        //Could not rename, carry on with the existing file
+        log_started = QDateTime::currentDateTime();
+
+        if (writer_reopen() == false)
+        {
+            emit log_error(QString("Unable to reopen log file ").append(log_filename).append(" after failing to rotate it: ").append(mpLogFile->errorString()).append(". Log data will be discarded until it can be reopened."));
+        }
+
+        return false;
+    }
+
+    log_started = QDateTime::currentDateTime();
+
+    if (writer_reopen() == false)
+    {
+        emit log_error(QString("Unable to open new log file ").append(log_filename).append(" after rotating the previous log to ").append(rotated_name).append(": ").append(mpLogFile->errorString()).append(". Log data will be discarded until it can be opened."));
+    }
+    else
+    {
+        buffer_mutex.lock();
+        log_size = mpLogFile->size() + buffer.length();
+        buffer_mutex.unlock();
+    }
+
+    if (compress == true)
+    {
+        //Compressing can take a while, it is done on another thread so that log data can still be written
+        AutLoggerCompressThread *compress_thread;
+        qint32 thread_index = 0;
+
+        while (thread_index < compress_threads.length())
+        {
+            if (compress_threads.at(thread_index)->isFinished() == true)
+            {
+                delete compress_threads.takeAt(thread_index);
+            }
+            else
+            {
+                ++thread_index;
+            }
+        }
+
+        compress_thread = new AutLoggerCompressThread(rotated_name);
+        compress_threads.append(compress_thread);
+        compress_thread->start(QThread::LowestPriority);
+    }
+
+    return true;
+}
+
+bool AutLogger::writer_reopen()
+{
+    //Opens the log file again after it was closed to be rotated, a new text log file starts with the UTF-8 BOM
+    if (!mpLogFile->open(log_open_mode()))
+    {
+        return false;
+    }
+
+    if (log_binary == false && mpLogFile->size() == 0)
+    {
+        mpLogFile->write(log_utf8_bom, (sizeof(log_utf8_bom) - 1));
+    }
+
+    return true;
+}
+
+bool AutLogger::compress_file(QString filename)
+{
+    //Compresses a file to gzip format using Qt's zlib, the original file is removed if successful. The file is compressed
+    //a chunk at a time so memory use does not depend on the file size, each chunk is a separate gzip member, which gzip
+    //tools decompress as one file
+    QFile input_file(filename);
+    QFile output_file(QString(filename).append(".gz"));
+    QByteArray data;
+
+    if (!input_file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    if (!output_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        return false;
+    }
+
+    do
+    {
+        data = input_file.read(log_compress_chunk_size);
+
+        if ((data.isEmpty() == true && input_file.atEnd() == false) || gzip_write_member(&output_file, data) == false)
+        {
+            output_file.close();
+            output_file.remove();
+            return false;
+        }
+    } while (input_file.atEnd() == false);
+
+    input_file.close();
+    output_file.close();
+
+    return QFile::remove(filename);
+}
+
 /******************************************************************************/
 // END OF FILE
 /******************************************************************************/
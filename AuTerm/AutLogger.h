@@ -29,7 +29,11 @@
 /******************************************************************************/
 #include <QWidget>
 #include <QFile>
-#include <QDataStream>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QDateTime>
+#include <QList>
 
 /******************************************************************************/
 // Constants
@@ -39,28 +43,89 @@ const qint8 LOG_ERR_OPEN_ALREADY = 1; //Log already open
 const qint8 LOG_ERR_ACCESS       = 2; //Access denied to log file
 const qint8 LOG_NOT_OPEN         = 3; //Log file not open
 
+/******************************************************************************/
+// Forward declaration of Class, Struct & Unions
+/******************************************************************************/
+class AutLogger;
+
 /******************************************************************************/
 // Class definitions
 /******************************************************************************/
+class AutLoggerThread : public QThread
+{
+public:
+    explicit AutLoggerThread(AutLogger *parent_logger);
+
+protected:
+    void run() override;
+
+private:
+    AutLogger *logger;
+};
+
+class AutLoggerCompressThread : public QThread
+{
+public:
+    explicit AutLoggerCompressThread(QString filename);
+
+protected:
+    void run() override;
+
+private:
+    QString compress_filename;
+};
+
 class AutLogger : public QWidget
 {
     Q_OBJECT
 public:
     explicit AutLogger(QWidget *parent = 0);
     ~AutLogger();
-    unsigned char OpenLogFile(QString strFilename);
+    unsigned char OpenLogFile(QString strFilename, bool binary = false);
     void CloseLogFile();
     unsigned char WriteLogData(QString strData);
     unsigned char WriteRawLogData(QByteArray baData);
-    unsigned short GetLogSize();
+    unsigned char WriteRawLogData(const char *data, qint32 length);
+    qint64 GetLogSize();
     void ClearLog();
+    void FlushLog();
     QString GetLogName();
     bool IsLogOpen();
+    void SetRotation(qint64 max_size, qint32 max_age, bool compress);
+
+signals:
+    //Emitted from the writer thread when data can no longer be written to the log file
+    void log_error(QString message);
 
 private:
+    void append_data(const char *data, qint32 length);
+    QIODevice::OpenMode log_open_mode();
+    void writer_run();
+    bool writer_rotate();
+    bool writer_reopen();
+    static bool compress_file(QString filename);
+
     bool mbLogOpen; //True when log file is open
-    QFile *mpLogFile; //Contains the handle of log file
-    QDataStream *mpStreamOut; //Contains the handle to the data steam
+    bool log_binary; //True if the log file is binary, with no text conversion or UTF-8 header
+    QFile *mpLogFile; //Contains the handle of log file, only used by the writer thread whilst open
+    QString log_filename; //Name of the open log file
+    AutLoggerThread *writer_thread; //Thread which writes buffered data to the log file
+    QList<AutLoggerCompressThread *> compress_threads; //Threads compressing rotated log files, only used by the writer thread whilst open
+    QMutex buffer_mutex; //Protects all of the following members
+    QWaitCondition buffer_wake; //Signalled when the writer should wake up
+    QWaitCondition buffer_space; //Signalled when the writer has taken data from the buffer
+    QByteArray buffer; //Data waiting to be written
+    bool writer_stop; //True when the writer should finish writing and exit
+    bool writer_flush; //True when the writer should write all data immediately
+    bool writer_clear; //True when the log file should be truncated before the buffered data is written
+    qint64 log_size; //Size of the current log file, including data in the buffer
+    qint64 rotate_size; //Size in bytes at which the log is rotated, 0 if disabled
+    qint32 rotate_age; //Age in minutes after which the log is rotated, 0 if disabled
+    bool rotate_compress; //True if rotated logs should be gzip compressed
+    QDateTime log_started; //Time when the current log file was started
+
+    friend class AutLoggerThread;
+    friend class AutLoggerCompressThread;
 };
 
 #endif // AUTLOGGER_H
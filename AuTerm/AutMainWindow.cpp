@@ -79,11 +79,13 @@
 #define transport_dataBits gspSerialPort.dataBits
 #define transport_stopBits gspSerialPort.stopBits
 #define transport_parity gspSerialPort.parity
-#define transport_write gspSerialPort.write
 #define transport_bytesAvailable gspSerialPort.bytesAvailable
 #define transport_peek gspSerialPort.peek
 #define transport_read gspSerialPort.read
 #define transport_readAll gspSerialPort.readAll
+#define transport_read_into gspSerialPort.read_into
+#define transport_peek_pointer gspSerialPort.peek_pointer
+#define transport_consume gspSerialPort.consume
 #define transport_clear gspSerialPort.clear
 #define transport_setBreakEnabled gspSerialPort.setBreakEnabled
 #define transport_setRequestToSend gspSerialPort.setRequestToSend
@@ -352,6 +354,10 @@ AutMainWindow::AutMainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::
 #ifndef SKIPSPEEDTEST
     gtmrSpeedTestDelayTimer = 0;
     gbSpeedTestRunning = false;
+    gpSpeedTest = new AutSpeedTest(this);
+    gpSpeedTest->set_report_errors(true);
+    connect(gpSpeedTest, SIGNAL(transmit(QByteArray)), this, SLOT(SpeedTestTransmit(QByteArray)));
+    connect(gpSpeedTest, SIGNAL(verify_error(QByteArray,QByteArray)), this, SLOT(SpeedTestVerifyError(QByteArray,QByteArray)));
 #endif
 
 #ifndef SKIPAUTOMATIONFORM
@@ -377,16 +383,19 @@ AutMainWindow::AutMainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::
     plugin_active_transport = nullptr;
 #endif
 
-#ifndef SKIPSPEEDTEST
-    //Also reserve 64KB of RAM to reduce mallocs when speed testing
-    gbaSpeedReceivedData.reserve(65536);
-#endif
-
     //Load settings from configuration files
     LoadSettings();
 
-    //Create logging handle
+    //Create logging handles
     gpMainLog = new AutLogger();
+    connect(gpMainLog, SIGNAL(log_error(QString)), this, SLOT(log_error(QString)));
+    gpCapture = new AutCapture();
+    gspSerialPort.set_capture(gpCapture);
+
+    //Setup file streaming
+    gpFileStream = new AutFileStream(this);
+    connect(gpFileStream, SIGNAL(transmit(QByteArray)), this, SLOT(FileStreamTransmit(QByteArray)));
+    connect(gpFileStream, SIGNAL(finished(file_stream_result_t)), this, SLOT(FileStreamFinished(file_stream_result_t)));
 
     //Move to 'Config' tab
     ui->selector_Tab->setCurrentIndex(ui->selector_Tab->indexOf(ui->tab_Config));
@@ -444,6 +453,7 @@ AutMainWindow::AutMainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::
     connect(ui->text_TermEditData, SIGNAL(enter_pressed()), this, SLOT(enter_pressed()));
     connect(ui->text_TermEditData, SIGNAL(key_pressed(int,QChar)), this, SLOT(key_pressed(int,QChar)));
     connect(ui->text_TermEditData, SIGNAL(vt100_send(QByteArray)), this, SLOT(vt100_send(QByteArray)));
+    connect(ui->text_TermEditData, SIGNAL(history_search_status(qint64,bool)), this, SLOT(history_search_status(qint64,bool)));
 
     //Initialise popup message
     gpmErrorForm = new PopupMessage(this);
@@ -504,6 +514,7 @@ AutMainWindow::AutMainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::
     gpMenu->addAction("Copy All")->setData(MenuActionCopyAll);
     gpMenu->addAction("Paste")->setData(MenuActionPaste);
     gpMenu->addAction("Select All")->setData(MenuActionSelectAll);
+    gpMenu->addAction("Search History...")->setData(MenuActionSearchHistory);
 
     //Create balloon menu items
     gpBalloonMenu = new QMenu(this);
@@ -529,6 +540,11 @@ AutMainWindow::AutMainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::
     connect(gpSpeedMenu, SIGNAL(triggered(QAction*)), this, SLOT(SpeedMenuSelected(QAction*)), Qt::AutoConnection);
 #endif
 
+    //Status bar entry for receive buffer usage of the serial I/O thread
+    label_io_statistics = new QLabel(this);
+    label_io_statistics->setToolTip("Data buffered between the serial I/O thread and the display, stalls counts how many times reading from the port was paused because the display fell behind. Display shows data waiting to be displayed, how long updating the display took and how many times data was skipped (only added to the history) to catch up");
+    ui->statusBar->addPermanentWidget(label_io_statistics);
+
     //Configure the signal timer
     gpSignalTimer = new QTimer(this);
     connect(gpSignalTimer, SIGNAL(timeout()), this, SLOT(SerialStatusSlot()));
@@ -544,6 +560,18 @@ AutMainWindow::AutMainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::
     gtmrTextUpdateTimer.setInterval(gpTermSettings->value("TextUpdateInterval", DefaultTextUpdateInterval).toInt());
     connect(&gtmrTextUpdateTimer, SIGNAL(timeout()), this, SLOT(UpdateReceiveText()));
 
+    //Received data is displayed in frames of limited size, further frames follow shortly whilst data is waiting
+    gtmrDisplayBacklogTimer.setSingleShot(true);
+    gtmrDisplayBacklogTimer.setInterval(DisplayBacklogFrameInterval);
+    connect(&gtmrDisplayBacklogTimer, SIGNAL(timeout()), this, SLOT(UpdateReceiveText()));
+    gintDisplayFrameBudget = gpTermSettings->value("DisplayFrameBudget", DefaultDisplayFrameBudget).toUInt();
+    gintDisplayBytesPerMs = DisplayInitialBytesPerMs;
+    gintDisplayFrames = 0;
+    gintDisplayFramesSkipped = 0;
+    gintDisplayFrameTime = 0;
+    gintDisplayFrameTimePeak = 0;
+    gintDisplayBacklog = 0;
+
 #ifndef SKIPSPEEDTEST
     //Set update speed display timer to be single shot only and connect to slot
     gtmrSpeedUpdateTimer.setSingleShot(true);
@@ -655,6 +683,7 @@ AutMainWindow::AutMainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::
 
     //Setup the terminal scrollback buffer size
     ui->text_TermEditData->setup_scrollback(gpTermSettings->value("ScrollbackBufferSize", DefaultScrollbackBufferSize).toUInt());
+    ui->text_TermEditData->set_history_size(gpTermSettings->value("DisplayHistorySize", DefaultDisplayHistorySize).toUInt() * 1024 * 1024);
 
     //Inform terminal what to do with VT100 control codes
     if (ui->radio_vt100_ignore->isChecked() == true)
@@ -1106,6 +1135,9 @@ AutMainWindow::~AutMainWindow()
         gpMainLog->CloseLogFile();
     }
 
+    //Close capture file before quitting
+    gpCapture->close();
+
     //Close popups if open
     if (gpmErrorForm->isVisible())
     {
@@ -1156,13 +1188,6 @@ AutMainWindow::~AutMainWindow()
         delete gpSysTray;
     }
 
-    //Clear up streaming data if opened
-    if (gbTermBusy == true && gbStreamingFile == true)
-    {
-        gpStreamFileHandle->close();
-        delete gpStreamFileHandle;
-    }
-
 #ifndef SKIPONLINE
     if (gnmManager != 0)
     {
@@ -1173,10 +1198,6 @@ AutMainWindow::~AutMainWindow()
 
     display_buffers.clear();
 
-#ifndef SKIPSPEEDTEST
-    gbaSpeedReceivedData.squeeze();
-#endif
-
 #ifndef SKIPPLUGINS
     //Clear up plugins
     int32_t i = 0;
@@ -1205,6 +1226,8 @@ AutMainWindow::~AutMainWindow()
 
     //Delete variables
     delete gpMainLog;
+    gspSerialPort.set_capture(nullptr);
+    delete gpCapture;
     delete gpPredefinedDevice;
     delete gpTermSettings;
     delete gpErrorMessages;
@@ -1282,10 +1305,7 @@ void AutMainWindow::on_btn_TermClose_clicked(bool from_plugin)
         if (gbStreamingFile == true)
         {
             //Clear up file stream
-            gtmrStreamTimer.invalidate();
-            gbStreamingFile = false;
-            gpStreamFileHandle->close();
-            delete gpStreamFileHandle;
+            gpFileStream->cancel();
         }
 #ifndef SKIPSPEEDTEST
         else if (gbSpeedTestRunning == true)
@@ -1335,9 +1355,12 @@ void AutMainWindow::on_btn_TermClose_clicked(bool from_plugin)
                 gtmrSpeedTestStats10s.stop();
             }
 
-            //Clear buffers
-            gbaSpeedMatchData.clear();
-            gbaSpeedReceivedData.clear();
+            //Stop the speed test and show where errors happened
+            if (gpSpeedTest->is_running() == true)
+            {
+                gpSpeedTest->stop();
+                OutputSpeedTestErrorPositions();
+            }
 
             //Show finished message in status bar
             ui->statusBar->showMessage("Speed testing failed due to serial port being closed.");
@@ -1401,6 +1424,9 @@ void AutMainWindow::on_btn_TermClose_clicked(bool from_plugin)
             gpMainLog->CloseLogFile();
         }
 
+        //Close capture file if open
+        gpCapture->close();
+
         //Enable log options
         ui->edit_LogFile->setEnabled(true);
         ui->check_LogEnable->setEnabled(true);
@@ -1523,6 +1549,20 @@ void AutMainWindow::SerialRead()
     QByteArray baOrigData = transport_readAll();
 //    qDebug() << "Received: " << baOrigData;
 
+    if (baOrigData.isEmpty())
+    {
+        //Notifications from the serial I/O thread are coalesced, data may have already been read
+        return;
+    }
+
+#ifndef SKIPPLUGINS_TRANSPORT
+    if (plugin_active_transport != nullptr && gpCapture->is_open() == true)
+    {
+        //Data from the serial port is captured on the I/O thread as it arrives
+        gpCapture->add_record(CAPTURE_DIRECTION_RX, &baOrigData);
+    }
+#endif
+
 
 #ifndef SKIPPLUGINS
     if (gbPluginHideTerminalOutput == false || gbPluginRunning == false)
@@ -1577,6 +1617,12 @@ void AutMainWindow::SerialRead()
         ui->label_TermRx->setText(QString::number(gintRXBytes));
     }
 
+    if (gbStreamingFile == true)
+    {
+        //Line by line streaming waits for acknowledgements in received data
+        gpFileStream->data_received(baOrigData);
+    }
+
 #ifndef SKIPPLUGINS
     if (gbPluginRunning == true)
     {
@@ -1636,9 +1682,7 @@ void AutMainWindow::MenuSelected(QAction* qaAction)
                 gpTermSettings->setValue("LastOtherFileDirectory", SplitFilePath(strFilename).at(0));
 
                 //File was selected - start streaming it out
-                gpStreamFileHandle = new QFile(strFilename);
-
-                if (!gpStreamFileHandle->open(QIODevice::ReadOnly))
+                if (gpFileStream->open(strFilename) == false)
                 {
                     //Unable to open file
                     QString strMessage = tr("Error during file streaming: Access to selected file is denied: ").append(strFilename);
@@ -1653,25 +1697,27 @@ void AutMainWindow::MenuSelected(QAction* qaAction)
                 gchTermMode = 50;
                 ui->btn_Cancel->setEnabled(true);
 
-                //Save the size of the file
-                gintStreamBytesSize = gpStreamFileHandle->size();
-                gintStreamBytesRead = 0;
                 gintStreamBytesProgress = StreamProgress;
 
-                //Start a timer
-                gtmrStreamTimer.start();
+                //Block sizes are based on the baud rate, which plugin transports do not have
+#ifndef SKIPPLUGINS_TRANSPORT
+                gpFileStream->set_baud_rate((plugin_active_transport == nullptr ? gspSerialPort.baudRate() : 0));
+#else
+                gpFileStream->set_baud_rate(gspSerialPort.baudRate());
+#endif
+                gpFileStream->set_target_rate(gpTermSettings->value("StreamRate", DefaultStreamRate).toUInt());
+                QByteArray baAck = gpTermSettings->value("StreamAck", DefaultStreamAck).toString().toUtf8();
+                AutEscape::escape_characters(&baAck);
+                gpFileStream->set_acknowledgement(baAck, gpTermSettings->value("StreamAckTimeout", DefaultStreamAckTimeout).toUInt());
 
-                //Reads out each block
-                QByteArray baFileData = gpStreamFileHandle->read(FileReadBlock);
-                transport_write(baFileData);
-                gintQueuedTXBytes += baFileData.size();
-                gintStreamBytesRead = baFileData.length();
-                gpMainLog->WriteLogData(QString(baFileData).append("\n"));
-                if (gpStreamFileHandle->atEnd())
+                quint32 intStreamMode = gpTermSettings->value("StreamMode", DefaultStreamMode).toUInt();
+                if (intStreamMode >= FILE_STREAM_MODE_COUNT)
                 {
-                    //Finished sending
-                    FinishStream(false);
+                    intStreamMode = FILE_STREAM_MODE_FLOW;
                 }
+
+                //Sends out the first block or line, the rest is sent as data is written
+                gpFileStream->start((file_stream_mode_t)intStreamMode);
             }
         }
     }
@@ -1851,6 +1897,31 @@ void AutMainWindow::MenuSelected(QAction* qaAction)
         //Select all text
         ui->text_TermEditData->selectAll();
     }
+    else if (intItem == MenuActionSearchHistory)
+    {
+        //Search all received data, including lines no longer in the display
+        bool ok;
+        QString pattern = QInputDialog::getText(this, "Search History", "Regular expression (F3/Shift+F3 move between matches):", QLineEdit::Normal, gstrHistorySearch, &ok);
+
+        if (ok == true && pattern.isEmpty() == false)
+        {
+            gstrHistorySearch = pattern;
+
+            if (ui->text_TermEditData->search_history(pattern, true, true) == false)
+            {
+                ui->statusBar->showMessage("Search History: invalid regular expression");
+            }
+            else
+            {
+                ui->statusBar->showMessage("Search History: searching...");
+            }
+        }
+    }
+}
+
+void AutMainWindow::history_search_status(qint64 matches, bool finished)
+{
+    ui->statusBar->showMessage(QString("Search History: ").append(QString::number(matches)).append(matches == 1 ? " match" : " matches").append(finished == true ? "" : " (searching...)"));
 }
 
 void AutMainWindow::balloontriggered(QAction* qaAction)
@@ -2091,6 +2162,8 @@ void AutMainWindow::SerialStatus(bool bType)
         //Disable timer
         gpSignalTimer->stop();
     }
+
+    UpdateIOStatistics();
 }
 
 void AutMainWindow::SerialStatusSlot()
@@ -2099,6 +2172,33 @@ void AutMainWindow::SerialStatusSlot()
     SerialStatus(0);
 }
 
+void AutMainWindow::UpdateIOStatistics()
+{
+    //Shows how much received data is waiting between the serial I/O thread and the GUI thread, and between the GUI thread and the display
+    QString strStatistics;
+
+#ifndef SKIPPLUGINS_TRANSPORT
+    if (gspSerialPort.isOpen() == true && plugin_active_transport == nullptr)
+#else
+    if (gspSerialPort.isOpen() == true)
+#endif
+    {
+        strStatistics = QString("RX buffer: %1/%2 KiB (peak %3 KiB), stalls: %4").arg(gspSerialPort.buffered_bytes() / 1024).arg(gspSerialPort.buffer_size() / 1024).arg(gspSerialPort.buffer_high_water() / 1024).arg(gspSerialPort.buffer_stalls());
+    }
+
+    if (transport_isOpen() == true && gintDisplayFrames > 0)
+    {
+        if (strStatistics.isEmpty() == false)
+        {
+            strStatistics.append(", ");
+        }
+
+        strStatistics.append(QString("display: %1 KiB waiting, frame %2 ms (peak %3 ms), skipped: %4").arg(gintDisplayBacklog / 1024).arg((double)gintDisplayFrameTime / 1000.0, 0, 'f', 1).arg((double)gintDisplayFrameTimePeak / 1000.0, 0, 'f', 1).arg(gintDisplayFramesSkipped));
+    }
+
+    label_io_statistics->setText(strStatistics);
+}
+
 void AutMainWindow::OpenDevice(bool from_plugin)
 {
     //Function to open serial port
@@ -2155,6 +2255,9 @@ void AutMainWindow::OpenDevice(bool from_plugin)
             gpMainLog->CloseLogFile();
         }
 
+        //Close capture file if open
+        gpCapture->close();
+
         gtmrPortOpened.invalidate();
     }
 
@@ -2454,6 +2557,7 @@ void AutMainWindow::OpenDevice(bool from_plugin)
         if (ui->check_LogEnable->isChecked() == true)
         {
             //Logging is enabled
+            gpMainLog->SetRotation(((qint64)gpTermSettings->value("LogRotateSize", DefaultLogRotateSize).toUInt() * 1024 * 1024), gpTermSettings->value("LogRotateAge", DefaultLogRotateAge).toUInt(), gpTermSettings->value("LogCompressRotated", DefaultLogCompressRotated).toBool());
 #ifdef TARGET_OS_MAC
             if (gpMainLog->OpenLogFile(QString((ui->edit_LogFile->text().left(1) == "/" || ui->edit_LogFile->text().left(1) == "\\") ? "" : QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).append("/").append(ui->edit_LogFile->text())) == LOG_OK)
 #else
@@ -2489,6 +2593,14 @@ void AutMainWindow::OpenDevice(bool from_plugin)
             }
         }
 
+        //Open capture file
+        if (gpTermSettings->value("CaptureFile", DefaultCaptureFile).toString().isEmpty() == false && gpCapture->open(gpTermSettings->value("CaptureFile", DefaultCaptureFile).toString()) != LOG_OK)
+        {
+            QString strMessage = tr("Error whilst opening capture file.\nPlease ensure you have access to the capture file ").append(gpTermSettings->value("CaptureFile", DefaultCaptureFile).toString()).append(" and have enough free space on your hard drive.");
+            gpmErrorForm->SetMessage(&strMessage);
+            gpmErrorForm->show();
+        }
+
         //Allow file drops for uploads
         setAcceptDrops(true);
 
@@ -2590,10 +2702,7 @@ void AutMainWindow::SerialError(QSerialPort::SerialPortError speErrorCode)
         if (gbStreamingFile == true)
         {
             //Clear up file stream
-            gtmrStreamTimer.invalidate();
-            gbStreamingFile = false;
-            gpStreamFileHandle->close();
-            delete gpStreamFileHandle;
+            gpFileStream->cancel();
         }
 #ifndef SKIPSPEEDTEST
         else if (gbSpeedTestRunning == true)
@@ -2643,9 +2752,12 @@ void AutMainWindow::SerialError(QSerialPort::SerialPortError speErrorCode)
                 gtmrSpeedTestStats10s.stop();
             }
 
-            //Clear buffers
-            gbaSpeedMatchData.clear();
-            gbaSpeedReceivedData.clear();
+            //Stop the speed test and show where errors happened
+            if (gpSpeedTest->is_running() == true)
+            {
+                gpSpeedTest->stop();
+                OutputSpeedTestErrorPositions();
+            }
 
             //Show finished message in status bar
             ui->statusBar->showMessage("Speed testing failed due to serial port error.");
@@ -2705,6 +2817,9 @@ void AutMainWindow::SerialError(QSerialPort::SerialPortError speErrorCode)
             gpMainLog->CloseLogFile();
         }
 
+        //Close capture file if open
+        gpCapture->close();
+
         //Enable log options
         ui->edit_LogFile->setEnabled(true);
         ui->check_LogEnable->setEnabled(true);
@@ -2843,33 +2958,13 @@ void AutMainWindow::SerialBytesWritten(qint64 intByteCount)
 
         if (gbStreamingFile == true)
         {
-            //File stream in progress, read out a block
-            QByteArray baFileData = gpStreamFileHandle->read(FileReadBlock);
-            transport_write(baFileData);
-            gintQueuedTXBytes += baFileData.size();
-            gintStreamBytesRead += baFileData.length();
-            if (gpStreamFileHandle->atEnd())
-            {
-                //Finished sending
-                FinishStream(false);
-            }
-            else if (gintStreamBytesRead > gintStreamBytesProgress)
-            {
-                //Progress output
-                update_buffer(QString("Streamed ").append(QString::number(gintStreamBytesRead)).append(" bytes (").append(QString::number(gintStreamBytesRead*100/gintStreamBytesSize)).append("%).\n").toUtf8(), false);
-                gintStreamBytesProgress = gintStreamBytesProgress + StreamProgress;
-            }
+            //File stream in progress, more data is sent once enough has been written
+            gpFileStream->data_written(intByteCount);
 
-            //Update status bar
-            if (gintStreamBytesRead == gintStreamBytesSize)
+            if (gbStreamingFile == true)
             {
-                //Finished streaming file
-                ui->statusBar->showMessage("File streaming complete!");
-            }
-            else
-            {
-                //Still streaming
-                ui->statusBar->showMessage(QString("Streamed ").append(QString::number(gintStreamBytesRead).append(" bytes of ").append(QString::number(gintStreamBytesSize))).append(" (").append(QString::number(gintStreamBytesRead*100/gintStreamBytesSize)).append("%)"));
+                //Still streaming, update status bar
+                ui->statusBar->showMessage(QString("Streamed ").append(QString::number(gpFileStream->get_bytes_written()).append(" bytes of ").append(QString::number(gpFileStream->get_file_size()))).append(" (").append(QString::number(gpFileStream->get_bytes_written()*100/gpFileStream->get_file_size())).append("%) [").append(QString::number(gpFileStream->get_instant_rate())).append(" bytes/second]"));
             }
         }
     }
@@ -2887,7 +2982,7 @@ void AutMainWindow::on_btn_Cancel_clicked()
         if (gbStreamingFile == true)
         {
             //Cancel stream
-            FinishStream(true);
+            gpFileStream->cancel();
         }
     }
 
@@ -2905,44 +3000,171 @@ void AutMainWindow::on_btn_Cancel_clicked()
     ui->btn_Cancel->setEnabled(false);
 }
 
-void AutMainWindow::FinishStream(bool bType)
+void AutMainWindow::FileStreamTransmit(QByteArray baData)
+{
+    //Sends a block (or line) of the file being streamed
+    transport_write(baData);
+    gintQueuedTXBytes += baData.size();
+
+    if (ui->check_LogEnable->isChecked())
+    {
+        //Add to log
+        gpMainLog->WriteRawLogData(baData);
+    }
+
+    if (gpFileStream->get_bytes_sent() > gintStreamBytesProgress && gpFileStream->get_bytes_sent() < gpFileStream->get_file_size())
+    {
+        //Progress output
+        update_buffer(QString("Streamed ").append(QString::number(gpFileStream->get_bytes_sent())).append(" bytes (").append(QString::number(gpFileStream->get_bytes_sent()*100/gpFileStream->get_file_size())).append("%), ").append(QString::number(gpFileStream->get_instant_rate())).append(" bytes/second (average ").append(QString::number(gpFileStream->get_average_rate())).append(" bytes/second).\n").toUtf8(), false);
+        gintStreamBytesProgress = (gpFileStream->get_bytes_sent() / StreamProgress + 1) * StreamProgress;
+    }
+}
+
+void AutMainWindow::FileStreamFinished(file_stream_result_t result)
 {
     //Sending a file stream has finished
-    if (bType == true)
+    QString strDuration = QString::number(1 + (gpFileStream->get_elapsed_ms() / 1000LL)).append(" seconds");
+    QString strRate = QString(" [~").append(QString::number(gpFileStream->get_average_rate())).append(" bytes/second]");
+
+    if (result == FILE_STREAM_RESULT_CANCELLED)
     {
         //Stream cancelled
-        update_buffer(QString("\nCancelled stream after ").append(QString::number(gintStreamBytesRead)).append(" bytes (").append(QString::number(1+(gtmrStreamTimer.nsecsElapsed()/1000000000LL))).append(" seconds) [~").append(QString::number((gintStreamBytesRead/(1+gtmrStreamTimer.nsecsElapsed()/1000000000LL)))).append(" bytes/second].\n").toUtf8(), false);
+        update_buffer(QString("\nCancelled stream after ").append(QString::number(gpFileStream->get_bytes_sent())).append(" bytes (").append(strDuration).append(")").append(strRate).append(".\n").toUtf8(), false);
         ui->statusBar->showMessage("File streaming cancelled.");
     }
+    else if (result == FILE_STREAM_RESULT_ACK_TIMEOUT)
+    {
+        //Line was not acknowledged
+        update_buffer(QString("\nStopped stream after ").append(QString::number(gpFileStream->get_bytes_sent())).append(" bytes (").append(strDuration).append("): no acknowledgement received within ").append(QString::number(gpFileStream->get_ack_timeout())).append("ms.\n").toUtf8(), false);
+        ui->statusBar->showMessage("File streaming stopped: no acknowledgement received.");
+    }
+    else if (result == FILE_STREAM_RESULT_READ_ERROR)
+    {
+        //File could not be read
+        update_buffer(QString("\nStopped stream after ").append(QString::number(gpFileStream->get_bytes_sent())).append(" bytes (").append(strDuration).append("): error reading file.\n").toUtf8(), false);
+        ui->statusBar->showMessage("File streaming failed: error reading file.");
+    }
     else
     {
         //Stream finished
-        update_buffer(QString("\nFinished streaming file, ").append(QString::number(gintStreamBytesRead)).append(" bytes sent in ").append(QString::number(1+(gtmrStreamTimer.nsecsElapsed()/1000000000LL))).append(" seconds [~").append(QString::number((gintStreamBytesRead/(1+gtmrStreamTimer.nsecsElapsed()/1000000000LL)))).append(" bytes/second].\n").toUtf8(), false);
+        update_buffer(QString("\nFinished streaming file, ").append(QString::number(gpFileStream->get_bytes_sent())).append(" bytes sent in ").append(strDuration).append(strRate).append(".\n").toUtf8(), false);
         ui->statusBar->showMessage("File streaming complete!");
     }
 
     //Clear up
-    gtmrStreamTimer.invalidate();
     gbTermBusy = false;
     gbStreamingFile = false;
     gchTermMode = 0;
-    gpStreamFileHandle->close();
-    delete gpStreamFileHandle;
     ui->btn_Cancel->setEnabled(false);
 }
 
+void AutMainWindow::log_error(QString message)
+{
+    //Writing to the log file has failed in the background
+    gpmErrorForm->SetMessage(&message);
+    gpmErrorForm->show();
+}
+
 void AutMainWindow::UpdateReceiveText()
 {
-    //Updates the receive text buffer
-    if (ui->selector_Tab->currentWidget() == ui->tab_Term)
+    //Updates the receive text buffer, the amount of data shown at once is limited to what can be displayed within the frame
+    //budget so that the window stays responsive, the rest is shown in following frames
+    display_buffer_list lstFrame;
+    QElapsedTimer tmrFrame;
+    quint64 intFrameBytes;
+    quint64 intShownBytes = 0;
+    bool bSkip = false;
+    qint32 i = 0;
+
+    if (ui->selector_Tab->currentWidget() != ui->tab_Term)
     {
-        ui->text_TermEditData->add_display_data(&display_buffers);
-        display_update_pending = false;
-        display_buffers.clear();
+        display_update_pending = true;
+        return;
+    }
+
+    display_update_pending = false;
+
+    if (display_buffers.isEmpty() == true)
+    {
+        //Nothing received, only outgoing data may need updating
+        ui->text_TermEditData->update_display();
+        return;
+    }
+
+    gintDisplayBacklog = 0;
+    while (i < display_buffers.length())
+    {
+        gintDisplayBacklog += display_buffers.at(i).data.length();
+        ++i;
+    }
+
+    intFrameBytes = qMax(gintDisplayBytesPerMs * gintDisplayFrameBudget, (quint64)DisplayMinimumFrameBytes);
+
+    if (gintDisplayFrameBudget == 0)
+    {
+        //Not limited
+        lstFrame.swap(display_buffers);
+    }
+    else if (gintDisplayBacklog > (intFrameBytes * DisplayFloodFrames) && ui->text_TermEditData->can_skip_to_tail() == true)
+    {
+        //Too far behind to catch up, all waiting data goes to the history but only what would be left after trimming is shown
+        lstFrame.swap(display_buffers);
+        bSkip = true;
+        ++gintDisplayFramesSkipped;
     }
     else
     {
-        display_update_pending = true;
+        //Take up to a frame of data
+        while (display_buffers.isEmpty() == false && intShownBytes < intFrameBytes)
+        {
+            if ((quint64)display_buffers.first().data.length() <= (intFrameBytes - intShownBytes))
+            {
+                intShownBytes += display_buffers.first().data.length();
+                lstFrame.append(display_buffers.takeFirst());
+            }
+            else
+            {
+                //Split the data, keeping \r\n together as they are converted to a single newline
+                display_buffer_struct stPart;
+                qint32 intSplit = (qint32)(intFrameBytes - intShownBytes);
+
+                if (display_buffers.first().data.at(intSplit - 1) == '\r')
+                {
+                    ++intSplit;
+                }
+
+                stPart.data = display_buffers.first().data.left(intSplit);
+                stPart.apply_formatting = display_buffers.first().apply_formatting;
+                display_buffers.first().data.remove(0, intSplit);
+                intShownBytes += intSplit;
+                lstFrame.append(stPart);
+            }
+        }
+    }
+
+    tmrFrame.start();
+    ui->text_TermEditData->add_display_data(&lstFrame, bSkip);
+    gintDisplayFrameTime = tmrFrame.nsecsElapsed() / 1000LL;
+    ++gintDisplayFrames;
+
+    if (gintDisplayFrameTime > gintDisplayFrameTimePeak)
+    {
+        gintDisplayFrameTimePeak = gintDisplayFrameTime;
+    }
+
+    if (bSkip == false && intShownBytes >= DisplayMinimumFrameBytes && gintDisplayFrameTime > 0)
+    {
+        //Update the display speed from full frames, averaged over several frames
+        quint64 intBytesPerMs = qMax(((quint64)intShownBytes * 1000ULL / (quint64)gintDisplayFrameTime), (quint64)1);
+        gintDisplayBytesPerMs = ((gintDisplayBytesPerMs * 3ULL) + intBytesPerMs) / 4ULL;
+    }
+
+    gintDisplayBacklog -= (bSkip == true || gintDisplayFrameBudget == 0 ? gintDisplayBacklog : intShownBytes);
+
+    if (display_buffers.isEmpty() == false && gtmrDisplayBacklogTimer.isActive() == false)
+    {
+        //More data is waiting, show the next frame once other events have been processed
+        gtmrDisplayBacklogTimer.start();
     }
 }
 
@@ -3624,6 +3846,46 @@ void AutMainWindow::LoadSettings()
         {
             gpTermSettings->setValue("ScrollbackBufferSize", DefaultScrollbackBufferSize); //The number of lines in the terminal scrollback buffer
         }
+        if (gpTermSettings->value("DisplayHistorySize").isNull())
+        {
+            gpTermSettings->setValue("DisplayHistorySize", DefaultDisplayHistorySize); //(Unlisted option) Memory in MiB used to keep received data history when the display buffer is trimmed
+        }
+        if (gpTermSettings->value("LogRotateSize").isNull())
+        {
+            gpTermSettings->setValue("LogRotateSize", DefaultLogRotateSize); //(Unlisted option) Size in MiB at which the log file is renamed and a new one started (0 to disable)
+        }
+        if (gpTermSettings->value("LogRotateAge").isNull())
+        {
+            gpTermSettings->setValue("LogRotateAge", DefaultLogRotateAge); //(Unlisted option) Age in minutes after which the log file is renamed and a new one started (0 to disable)
+        }
+        if (gpTermSettings->value("LogCompressRotated").isNull())
+        {
+            gpTermSettings->setValue("LogCompressRotated", DefaultLogCompressRotated); //(Unlisted option) Set to 1 to gzip compress log files once they have been rotated
+        }
+        if (gpTermSettings->value("CaptureFile").isNull())
+        {
+            gpTermSettings->setValue("CaptureFile", DefaultCaptureFile); //(Unlisted option) File to write a timestamped binary capture of sent and received data to (empty to disable)
+        }
+        if (gpTermSettings->value("DisplayFrameBudget").isNull())
+        {
+            gpTermSettings->setValue("DisplayFrameBudget", DefaultDisplayFrameBudget); //(Unlisted option) Time in mS that received data is displayed for before the window is updated and the rest is displayed in following frames (0 to display all waiting data at once)
+        }
+        if (gpTermSettings->value("StreamMode").isNull())
+        {
+            gpTermSettings->setValue("StreamMode", DefaultStreamMode); //(Unlisted option) How files are streamed out: 0 = as fast as the port accepts data, 1 = paced to StreamRate bytes per second, 2 = line by line waiting for StreamAck after each line
+        }
+        if (gpTermSettings->value("StreamRate").isNull())
+        {
+            gpTermSettings->setValue("StreamRate", DefaultStreamRate); //(Unlisted option) Target bytes per second when paced streaming is used
+        }
+        if (gpTermSettings->value("StreamAck").isNull())
+        {
+            gpTermSettings->setValue("StreamAck", DefaultStreamAck); //(Unlisted option) Escaped data received from the device which acknowledges a line when line by line streaming is used (empty to send each line once the previous line has been written)
+        }
+        if (gpTermSettings->value("StreamAckTimeout").isNull())
+        {
+            gpTermSettings->setValue("StreamAckTimeout", DefaultStreamAckTimeout); //(Unlisted option) Time in mS to wait for a line to be acknowledged before the stream is stopped (0 to wait forever)
+        }
         if (gpTermSettings->value("ConfigVersion").isNull() || gpTermSettings->value("ConfigVersion").toString() != UwVersion)
         {
             //Update configuration version
@@ -3677,12 +3939,9 @@ void AutMainWindow::on_combo_LogFile_currentIndexChanged(int)
     {
         //Open the log file for reading
         QFile fileLogFile(QString(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).append("/").append(ui->combo_LogFile->currentText()));
-        if (fileLogFile.open(QFile::ReadOnly | QFile::Text))
+        if (ui->text_LogData->open_file(fileLogFile.fileName()) == true)
         {
-            //Get the contents of the log file
-            ui->text_LogData->setPlainText(fileLogFile.readAll().replace('\0', "\\00").replace("\x01", "\\01").replace("\x02", "\\02").replace("\x03", "\\03").replace("\x04", "\\04").replace("\x05", "\\05").replace("\x06", "\\06").replace("\x07", "\\07").replace("\x08", "\\08").replace("\x0b", "\\0B").replace("\x0c", "\\0C").replace("\x0e", "\\0E").replace("\x0f", "\\0F").replace("\x10", "\\10").replace("\x11", "\\11").replace("\x12", "\\12").replace("\x13", "\\13").replace("\x14", "\\14").replace("\x15", "\\15").replace("\x16", "\\16").replace("\x17", "\\17").replace("\x18", "\\18").replace("\x19", "\\19").replace("\x1a", "\\1a").replace("\x1b", "\\1b").replace("\x1c", "\\1c").replace("\x1d", "\\1d").replace("\x1e", "\\1e").replace("\x1f", "\\1f"));
-            fileLogFile.close();
-
+            //Log file is mapped and indexed in the background, only the visible part is drawn
             //Information about the log file
             QFileInfo fiFileInfo(fileLogFile.fileName());
             char cPrefixes[4] = {'K', 'M', 'G', 'T'};
@@ -3900,9 +4159,12 @@ void AutMainWindow::on_btn_SpeedStartStop_clicked()
                 gtmrSpeedTestStats10s.stop();
             }
 
-            //Clear buffers
-            gbaSpeedMatchData.clear();
-            gbaSpeedReceivedData.clear();
+            //Stop the speed test and show where errors happened
+            if (gpSpeedTest->is_running() == true)
+            {
+                gpSpeedTest->stop();
+                OutputSpeedTestErrorPositions();
+            }
 
             //Show message that test has finished
             ui->statusBar->showMessage("Speed testing finished.");
@@ -3966,12 +4228,6 @@ void AutMainWindow::SpeedMenuSelected(QAction *qaAction)
         gintSpeedBytesReceived10s = 0;
         gintSpeedBytesSent = 0;
         gintSpeedBytesSent10s = 0;
-        gintSpeedBufferCount = 0;
-        gintSpeedTestStatPacketsSent = 0;
-        gintSpeedTestStatPacketsReceived = 0;
-        gintSpeedTestReceiveIndex = 0;
-        gintSpeedTestStatSuccess = 0;
-        gintSpeedTestStatErrors = 0;
         gbSpeedTestReceived = false;
         gintDelayedSpeedTestReceive = 0;
 
@@ -3997,33 +4253,30 @@ void AutMainWindow::SpeedMenuSelected(QAction *qaAction)
         ui->label_SpeedTx->setText("0");
         ui->label_SpeedTime->setText("00:00:00:00");
 
-        //Clear received buffer and data match buffer
-        gbaSpeedMatchData.clear();
-        gbaSpeedReceivedData.clear();
-
         //Check if this is a string match or throughput-only test
+        QByteArray baMatchData;
         if (ui->combo_SpeedDataType->currentIndex() != 0)
         {
             //Escape character codes if enabled
+            baMatchData = ui->edit_SpeedTestData->text().toUtf8();
             if (ui->check_SpeedStringUnescape->isChecked())
             {
                 //Escape
-                gbaSpeedMatchData = ui->edit_SpeedTestData->text().toUtf8();
-                AutEscape::escape_characters(&gbaSpeedMatchData);
-            }
-            else
-            {
-                //Normal
-                gbaSpeedMatchData = ui->edit_SpeedTestData->text().toUtf8();
+                AutEscape::escape_characters(&baMatchData);
             }
 
             //Set length of match data
-            gintSpeedTestMatchDataLength = gbaSpeedMatchData.length();
+            gintSpeedTestMatchDataLength = baMatchData.length();
         }
+        gpSpeedTest->set_pattern(baMatchData);
+        gpSpeedTest->set_buffer_sizes(ui->edit_speed_test_minimum_buffer_size->value(), ui->edit_speed_test_chunk_append_size->value());
 
         //By default, no send delay
         gintDelayedSpeedTestSend = 0;
 
+        //Round-trip latency can only be measured when sent data is received back
+        gpSpeedTest->start(chItem != SpeedMenuActionRecv && chItem != SpeedMenuActionSend);
+
         if (chItem == SpeedMenuActionRecv)
         {
             //Receive only test
@@ -4035,7 +4288,7 @@ void AutMainWindow::SpeedMenuSelected(QAction *qaAction)
             gchSpeedTestMode = SPEED_MODE_TRANSMIT;
 
             //Send data
-            SendSpeedTestData(ui->edit_speed_test_chunk_append_size->value());
+            gpSpeedTest->send_data(ui->edit_speed_test_chunk_append_size->value());
         }
         else if (chItem == SpeedMenuActionSendRecv || chItem == SpeedMenuActionSendRecv5Delay || chItem == SpeedMenuActionSendRecv10Delay || chItem == SpeedMenuActionSendRecv15Delay)
         {
@@ -4054,7 +4307,7 @@ void AutMainWindow::SpeedMenuSelected(QAction *qaAction)
             else
             {
                 //Send immediately
-                SendSpeedTestData(ui->edit_speed_test_chunk_append_size->value());
+                gpSpeedTest->send_data(ui->edit_speed_test_chunk_append_size->value());
             }
         }
 
@@ -4358,30 +4611,18 @@ void AutMainWindow::on_btn_SpeedCopy_clicked()
         append(ui->edit_SpeedPacketsBad->text()).
         append("\r\n    > Rx Error Rate % (Packets): ").
         append(ui->edit_SpeedPacketsErrorRate->text()).
+        append("\r\n    > Round-trip latency p50/p99/p99.9 (us): ").
+        append(gpSpeedTest->get_latency_count() == 0 ? QString("N/A") : QString::number(gpSpeedTest->get_latency_percentile(50.0)).append("/").append(QString::number(gpSpeedTest->get_latency_percentile(99.0))).append("/").append(QString::number(gpSpeedTest->get_latency_percentile(99.9)))).
         append("\r\n=================================\r\n"));
 }
 
-void AutMainWindow::SendSpeedTestData(int intMaxLength)
+void AutMainWindow::SpeedTestTransmit(QByteArray baData)
 {
-    //Send string out. It's OK to send less than the maximum length but not more, unless none fit
-    int intSendTimes = 1;
-
-    if (intMaxLength > gintSpeedTestMatchDataLength)
-    {
-        intSendTimes = (intMaxLength / gintSpeedTestMatchDataLength);
-    }
-
+    //Send speed test data out
     if (ui->check_SpeedShowTX->isChecked())
     {
         //Show TX data in terminal
-        int print_times = intSendTimes;
-
-        while (print_times > 0)
-        {
-            //Append to buffer
-            gbaSpeedDisplayBuffer.append(gbaSpeedMatchData);
-            --print_times;
-        }
+        gbaSpeedDisplayBuffer.append(baData);
 
         if (!gtmrSpeedUpdateTimer.isActive())
         {
@@ -4389,14 +4630,7 @@ void AutMainWindow::SendSpeedTestData(int intMaxLength)
         }
     }
 
-    while (intSendTimes > 0)
-    {
-        //Send out until finished
-        transport_write(gbaSpeedMatchData);
-        gintSpeedBufferCount += gintSpeedTestMatchDataLength;
-        --intSendTimes;
-        ++gintSpeedTestStatPacketsSent;
-    }
+    transport_write(baData);
 }
 
 void AutMainWindow::SpeedTestBytesWritten(qint64 intByteCount)
@@ -4404,13 +4638,8 @@ void AutMainWindow::SpeedTestBytesWritten(qint64 intByteCount)
     //Serial port bytes have been written in speed test mode
     if ((gchSpeedTestMode & SPEED_MODE_TRANSMIT) == SPEED_MODE_TRANSMIT)
     {
-        //Sending data in speed test
-        gintSpeedBufferCount -= intByteCount;
-        if (gintSpeedBufferCount <= ui->edit_speed_test_minimum_buffer_size->value())
-        {
-            //Buffer has space: send more data
-            SendSpeedTestData(ui->edit_speed_test_chunk_append_size->value());
-        }
+        //Sending data in speed test, more data is sent when the buffer has space
+        gpSpeedTest->data_written(intByteCount);
     }
 
     //Add to bytes sent counters
@@ -4447,176 +4676,118 @@ void AutMainWindow::SpeedTestReceive()
 
         if (ui->combo_SpeedDataType->currentIndex() != 0)
         {
-            //Test data is OK
-            int32_t remove_size = 0;
-            gbaSpeedReceivedData.append(transport_read(received_bytes));
-            while (remove_size < gbaSpeedReceivedData.length())
+            //Test data is OK, check it in place in the receive buffer where the transport supports that
+            qint64 intRemaining = received_bytes;
+
+            while (intRemaining > 0)
             {
-                //Data to check
-                int SizeToTest = gintSpeedTestMatchDataLength - gintSpeedTestReceiveIndex;
-                if ((SizeToTest + remove_size) > gbaSpeedReceivedData.length())
+                qint64 intLength;
+                const char *pData = transport_peek_pointer(&intLength);
+
+                if (pData == nullptr || intLength <= 0)
                 {
-                    SizeToTest = gbaSpeedReceivedData.length() - remove_size;
+                    //Not supported, check a copy
+                    gpSpeedTest->data_received(transport_read(intRemaining));
+                    break;
                 }
 
-                //Optimised search check function. for testing only
-                int32_t i = 0;
-                bool good = true;
-                pointer_buf rec_buf;
-                pointer_buf match_buf;
-                rec_buf.p8 = ((uint8_t *)gbaSpeedReceivedData.data() + remove_size);
-                match_buf.p8 = ((uint8_t *)gbaSpeedMatchData.data() + gintSpeedTestReceiveIndex);
-
-                while (i < SizeToTest)
+                if (intLength > intRemaining)
                 {
-                    uint32_t loop_check_size = 8;
-                    switch (SizeToTest - i)
-                    {
-                    case 1:
-                        if (*rec_buf.p8 != *match_buf.p8)
-                        {
-                                good = false;
-                        }
-                        loop_check_size = 1;
-                        break;
-                    case 2:
-                        if (*rec_buf.p16 != *match_buf.p16)
-                        {
-                                good = false;
-                        }
-                        loop_check_size = 2;
-                        break;
-                    case 3:
-                        if (*rec_buf.p16 != *match_buf.p16 || *(rec_buf.p8+2) != *(match_buf.p8+2))
-                        {
-                                good = false;
-                        }
-                        loop_check_size = 3;
-                        break;
-                    case 4:
-                        if (*rec_buf.p32 != *match_buf.p32)
-                        {
-                                good = false;
-                        }
-                        loop_check_size = 4;
-                        break;
-                    case 5:
-                        if (*rec_buf.p32 != *match_buf.p32 || *(rec_buf.p8 + 4) != *(match_buf.p8 + 4))
-                        {
-                                good = false;
-                        }
-                        loop_check_size = 5;
-                        break;
-                    case 6:
-                        if (*rec_buf.p32 != *match_buf.p32 || *(rec_buf.p16 + 2) != *(match_buf.p16 + 2))
-                        {
-                                good = false;
-                        }
-                        loop_check_size = 6;
-                        break;
-                    case 7:
-                        if (*rec_buf.p32 != *match_buf.p32 || *(rec_buf.p16 + 2) != *(match_buf.p16 + 2) || *(rec_buf.p8 + 6) != *(match_buf.p8 + 6))
-                        {
-                                good = false;
-                        }
-                        loop_check_size = 7;
-                        break;
-                    default:
-                        if (*rec_buf.p64 != *match_buf.p64)
-                        {
-                                good = false;
-                        }
-                        break;
-                    }
-
-                    if (good == false)
-                    {
-                        break;
-                    }
-
-                    i += loop_check_size;
-                    rec_buf.p8 += loop_check_size;
-                    match_buf.p8 += loop_check_size;
+                    intLength = intRemaining;
                 }
 
-                if (good == true)
+                gpSpeedTest->data_received(QByteArray::fromRawData(pData, intLength));
+                transport_consume(intLength);
+                intRemaining -= intLength;
+            }
+        }
+    }
+}
+
+void AutMainWindow::SpeedTestVerifyError(QByteArray baReceived, QByteArray baExpected)
+{
+    //Received speed test data did not match
+    if (ui->check_SpeedShowErrors->isChecked())
+    {
+        //Show error - find mismatch position
+        QString strFirst(baReceived);
+        QString strSecond(baExpected);
+        int32_t max_size = strFirst.length() > strSecond.length() ? strSecond.length() : strFirst.length();
+        quint16 iOffset = 0;
+        while (iOffset < max_size)
+        {
+                if (strFirst.at(iOffset) != strSecond.at(iOffset))
                 {
-                    //Good
-                    remove_size += SizeToTest;
-                    gintSpeedTestReceiveIndex += SizeToTest;
-                    if (gintSpeedTestReceiveIndex >= gintSpeedTestMatchDataLength)
-                    {
-                        ++gintSpeedTestStatSuccess;
-                        ++gintSpeedTestStatPacketsReceived;
-                        gintSpeedTestReceiveIndex = 0;
-                    }
+                        //Found
+                        ++iOffset;
+                        break;
                 }
-                else
-                {
-                    //Bad
-                    ++gintSpeedTestStatErrors;
+                ++iOffset;
+        }
 
-                    if (ui->check_SpeedShowErrors->isChecked())
-                    {
-                        //Show error - find mismatch position
-                        uint16_t new_offset = (i > 5 ? i - 5 : 0);
-                        QString strFirst(gbaSpeedReceivedData.mid(remove_size + new_offset));
-                        QString strSecond(gbaSpeedMatchData.mid(gintSpeedTestReceiveIndex + new_offset));
-                        int32_t max_size = strFirst.length() > strSecond.length() ? strSecond.length() : strFirst.length();
-                        quint16 iOffset = 0;
-                        while (iOffset < max_size)
-                        {
-                                if (strFirst.at(iOffset) != strSecond.at(iOffset))
-                                {
-                                        //Found
-                                        ++iOffset;
-                                        break;
-                                }
-                                ++iOffset;
-                        }
+        if (strFirst.length() > max_size)
+        {
+                strFirst.remove(max_size, strFirst.length() - max_size);
+        }
 
-                        if (strFirst.length() > max_size)
-                        {
-                                strFirst.remove(max_size, strFirst.length() - max_size);
-                        }
+        if (strSecond.length() > max_size)
+        {
+                strSecond.remove(max_size, strSecond.length() - max_size);
+        }
 
-                        if (strSecond.length() > max_size)
-                        {
-                                strSecond.remove(max_size, strSecond.length() - max_size);
-                        }
+        //Add to display
+        gbaSpeedDisplayBuffer.append(QString("\r\nError: Data mismatch.\r\n\tExpected: ").append(strSecond).append("\r\n\tGot     : ").append(strFirst).append("\r\n\tPosition: ").append(QString("-").repeated(iOffset-1).append("^")).append("\r\n\tOccurred: ").append(ui->label_SpeedTime->text()).append(" (").append(QDateTime::currentDateTime().toLocalTime().toString()).append(")\r\n").toUtf8());
+        if (!gtmrSpeedUpdateTimer.isActive())
+        {
+                gtmrSpeedUpdateTimer.start();
+        }
+    }
+}
 
-                        //Add to display
-                        gbaSpeedDisplayBuffer.append(QString("\r\nError: Data mismatch.\r\n\tExpected: ").append(strSecond).append("\r\n\tGot     : ").append(strFirst).append("\r\n\tPosition: ").append(QString("-").repeated(iOffset-1).append("^")).append("\r\n\tOccurred: ").append(ui->label_SpeedTime->text()).append(" (").append(QDateTime::currentDateTime().toLocalTime().toString()).append(")\r\n").toUtf8());
-                        if (!gtmrSpeedUpdateTimer.isActive())
-                        {
-                                gtmrSpeedUpdateTimer.start();
-                        }
-                    }
+void AutMainWindow::OutputSpeedTestErrorPositions()
+{
+    //Outputs the byte offsets in a packet where errors happened most often
+    QList<QPair<quint32, qint32>> positions;
+    qint32 i = 0;
 
-                    //Search for start character (ignoring first character)
-                    int StartChar = gbaSpeedReceivedData.indexOf(gbaSpeedMatchData.at(0), remove_size + 1);
-                    if (StartChar == -1)
-                    {
-                        //Not found, clear whole receive buffer
-                        gbaSpeedReceivedData.clear();
-                    }
-                    else
-                    {
-                        //Found, remove until this character
-                        gbaSpeedReceivedData.remove(0, StartChar);
-                    }
+    const QVector<quint32> &error_positions = gpSpeedTest->get_error_positions();
 
-                    ++gintSpeedTestStatPacketsReceived;
-                    gintSpeedTestReceiveIndex = 0;
-                    remove_size = 0;
-                }
-            }
+    if (gpSpeedTest->get_packets_bad() == 0)
+    {
+        return;
+    }
 
-            if (remove_size > 0)
-            {
-                gbaSpeedReceivedData.remove(0, remove_size);
-            }
+    while (i < error_positions.length())
+    {
+        if (error_positions.at(i) > 0)
+        {
+            positions.append(qMakePair(error_positions.at(i), i));
         }
+        ++i;
+    }
+
+    //Most errors first
+    std::sort(positions.begin(), positions.end(), [](const QPair<quint32, qint32> &first, const QPair<quint32, qint32> &second) {
+        return (first.first > second.first || (first.first == second.first && first.second < second.second));
+    });
+
+    QString strPositions = QString("\r\nError positions (offset in packet: errors):");
+    i = 0;
+    while (i < positions.length() && i < SpeedTestErrorPositionsShown)
+    {
+        strPositions.append("\r\n\t").append(QString::number(positions.at(i).second)).append(": ").append(QString::number(positions.at(i).first));
+        ++i;
+    }
+
+    if (positions.length() > SpeedTestErrorPositionsShown)
+    {
+        strPositions.append("\r\n\t(").append(QString::number(positions.length() - SpeedTestErrorPositionsShown)).append(" other positions)");
+    }
+
+    gbaSpeedDisplayBuffer.append(strPositions.append("\r\n").toUtf8());
+    if (!gtmrSpeedUpdateTimer.isActive())
+    {
+        gtmrSpeedUpdateTimer.start();
     }
 }
 
@@ -4649,7 +4820,7 @@ void AutMainWindow::UpdateSpeedTestValues()
             //Bytes
             ui->edit_SpeedBytesSent->setText(QString::number(gintSpeedBytesSent));
         }
-        ui->edit_SpeedPacketsSent->setText(QString::number(gintSpeedTestStatPacketsSent));
+        ui->edit_SpeedPacketsSent->setText(QString::number(gpSpeedTest->get_packets_sent()));
     }
 
     if ((gchSpeedTestMode & SPEED_MODE_RECEIVE) == SPEED_MODE_RECEIVE)
@@ -4671,13 +4842,13 @@ void AutMainWindow::UpdateSpeedTestValues()
             //Bytes
             ui->edit_SpeedBytesRec->setText(QString::number(gintSpeedBytesReceived));
         }
-        ui->edit_SpeedPacketsRec->setText(QString::number(gintSpeedTestStatPacketsReceived));
-        ui->edit_SpeedPacketsBad->setText(QString::number(gintSpeedTestStatErrors));
-        ui->edit_SpeedPacketsGood->setText(QString::number(gintSpeedTestStatSuccess));
-        if (gintSpeedTestStatErrors > 0)
+        ui->edit_SpeedPacketsRec->setText(QString::number(gpSpeedTest->get_packets_received()));
+        ui->edit_SpeedPacketsBad->setText(QString::number(gpSpeedTest->get_packets_bad()));
+        ui->edit_SpeedPacketsGood->setText(QString::number(gpSpeedTest->get_packets_good()));
+        if (gpSpeedTest->get_packets_bad() > 0)
         {
             //Calculate error rate (up to 2 decimal places and rounding up)
-            ui->edit_SpeedPacketsErrorRate->setText(QString::number(std::ceil((float)gintSpeedTestStatErrors*10000.0/(float)(gintSpeedTestStatSuccess+gintSpeedTestStatErrors))/100.0));
+            ui->edit_SpeedPacketsErrorRate->setText(QString::number(std::ceil((float)gpSpeedTest->get_packets_bad()*10000.0/(float)(gpSpeedTest->get_packets_good()+gpSpeedTest->get_packets_bad()))/100.0));
         }
     }
 }
@@ -4688,7 +4859,7 @@ void AutMainWindow::SpeedTestStartTimer()
     disconnect(gtmrSpeedTestDelayTimer, SIGNAL(timeout()), this, SLOT(SpeedTestStartTimer()));
     delete gtmrSpeedTestDelayTimer;
     gtmrSpeedTestDelayTimer = 0;
-    SendSpeedTestData(ui->edit_speed_test_chunk_append_size->value());
+    gpSpeedTest->send_data(ui->edit_speed_test_chunk_append_size->value());
 }
 
 void AutMainWindow::SpeedTestStopTimer()
@@ -4732,9 +4903,12 @@ void AutMainWindow::SpeedTestStopTimer()
         gtmrSpeedTestStats10s.stop();
     }
 
-    //Clear buffers
-    gbaSpeedMatchData.clear();
-    gbaSpeedReceivedData.clear();
+    //Stop the speed test and show where errors happened
+    if (gpSpeedTest->is_running() == true)
+    {
+        gpSpeedTest->stop();
+        OutputSpeedTestErrorPositions();
+    }
 
     //Show finished message in status bar
     ui->statusBar->showMessage("Speed testing finished.");
@@ -5317,9 +5491,10 @@ void AutMainWindow::on_selector_Tab_currentChanged(int index)
             UpdateReceiveText();
         }
     }
-    else if (gtmrTextUpdateTimer.isActive())
+    else if (gtmrTextUpdateTimer.isActive() || gtmrDisplayBacklogTimer.isActive())
     {
         gtmrTextUpdateTimer.stop();
+        gtmrDisplayBacklogTimer.stop();
         display_update_pending = true;
     }
 }
@@ -5444,6 +5619,23 @@ void AutMainWindow::on_check_reconnect_after_disconnect_toggled(bool checked)
 }
 #endif
 
+qint64 AutMainWindow::transport_write(const QByteArray &data)
+{
+    if (gpCapture->is_open() == true)
+    {
+        gpCapture->add_record(CAPTURE_DIRECTION_TX, &data);
+    }
+
+#ifndef SKIPPLUGINS_TRANSPORT
+    if (plugin_active_transport != nullptr)
+    {
+        return plugin_active_transport->write(data);
+    }
+#endif
+
+    return gspSerialPort.write(data);
+}
+
 #ifndef SKIPPLUGINS_TRANSPORT
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 bool AutMainWindow::transport_open(QIODeviceBase::OpenMode mode)
@@ -5521,16 +5713,6 @@ QSerialPort::Parity AutMainWindow::transport_parity() const
     return plugin_active_transport->parity();
 }
 
-qint64 AutMainWindow::transport_write(const QByteArray &data)
-{
-    if (plugin_active_transport == nullptr)
-    {
-        return gspSerialPort.write(data);
-    }
-
-    return plugin_active_transport->write(data);
-}
-
 qint64 AutMainWindow::transport_bytesAvailable() const
 {
     if (plugin_active_transport == nullptr)
@@ -5571,6 +5753,36 @@ QByteArray AutMainWindow::transport_readAll()
     return plugin_active_transport->readAll();
 }
 
+qint64 AutMainWindow::transport_read_into(char *data, qint64 maxlen)
+{
+    if (plugin_active_transport == nullptr)
+    {
+        return gspSerialPort.read_into(data, maxlen);
+    }
+
+    return plugin_active_transport->read_into(data, maxlen);
+}
+
+const char *AutMainWindow::transport_peek_pointer(qint64 *length)
+{
+    if (plugin_active_transport == nullptr)
+    {
+        return gspSerialPort.peek_pointer(length);
+    }
+
+    return plugin_active_transport->peek_pointer(length);
+}
+
+qint64 AutMainWindow::transport_consume(qint64 length)
+{
+    if (plugin_active_transport == nullptr)
+    {
+        return gspSerialPort.consume(length);
+    }
+
+    return plugin_active_transport->consume(length);
+}
+
 bool AutMainWindow::transport_clear(QSerialPort::Directions directions)
 {
     if (plugin_active_transport == nullptr)
@@ -5748,10 +5960,7 @@ void AutMainWindow::plugin_transport_error(int error)
     if (gbStreamingFile == true)
     {
         //Clear up file stream
-        gtmrStreamTimer.invalidate();
-        gbStreamingFile = false;
-        gpStreamFileHandle->close();
-        delete gpStreamFileHandle;
+        gpFileStream->cancel();
     }
 #ifndef SKIPSPEEDTEST
     else if (gbSpeedTestRunning == true)
@@ -5801,9 +6010,12 @@ void AutMainWindow::plugin_transport_error(int error)
             gtmrSpeedTestStats10s.stop();
         }
 
-        //Clear buffers
-        gbaSpeedMatchData.clear();
-        gbaSpeedReceivedData.clear();
+        //Stop the speed test and show where errors happened
+        if (gpSpeedTest->is_running() == true)
+        {
+            gpSpeedTest->stop();
+            OutputSpeedTestErrorPositions();
+        }
 
         //Show finished message in status bar
         ui->statusBar->showMessage("Speed testing failed due to serial port error.");
@@ -5863,6 +6075,9 @@ void AutMainWindow::plugin_transport_error(int error)
         gpMainLog->CloseLogFile();
     }
 
+    //Close capture file if open
+    gpCapture->close();
+
     //Enable log options
     ui->edit_LogFile->setEnabled(true);
     ui->check_LogEnable->setEnabled(true);
@@ -59,10 +59,18 @@
 #include <QListWidgetItem>
 //Need cmath for std::ceil function
 #include <cmath>
+#include <cstring>
+#include <algorithm>
 #include <QStandardPaths>
+#include <QInputDialog>
 #include "AutScrollEdit.h"
 #include "AutPopup.h"
 #include "AutLogger.h"
+#include "AutCapture.h"
+#include "AutFileStream.h"
+#ifndef SKIPSPEEDTEST
+#include "AutSpeedTest.h"
+#endif
 #ifndef SKIPAUTOMATIONFORM
 #include "AutAutomation.h"
 #endif
@@ -73,6 +81,7 @@
 #include "AutScripting.h"
 #endif
 #include "AutEscape.h"
+#include "AutSerialWorker.h"
 #ifndef SKIPPLUGINS
 #include <QPluginLoader>
 #include "AutPlugin.h"
@@ -114,8 +123,12 @@
 //Constants for version and functions
 const QString UwVersion                         = "0.35a"; //Version string
 //Constants for timeouts and streaming
-const qint16 FileReadBlock                      = 512;     //Number of bytes to read per block when streaming files
 const qint16 StreamProgress                     = 10000;   //Number of bytes between streaming progress updates
+//Constants for display updates
+const qint16 DisplayBacklogFrameInterval        = 10;      //Time in mS between display frames whilst there is received data waiting to be displayed
+const quint32 DisplayInitialBytesPerMs          = 1024;    //Display speed assumed until it has been measured
+const quint32 DisplayMinimumFrameBytes          = 1024;    //Smallest amount of data shown in one display frame
+const quint8 DisplayFloodFrames                 = 8;       //If more than this many frames of data are waiting, data which would be trimmed is skipped
 //Constants for default config values
 const QString DefaultLogFileName                = "AuTerm.log";
 const bool DefaultLogMode                       = 0;
@@ -127,6 +140,16 @@ const bool DefaultAutoDTrimBuffer               = false;
 const quint32 DefaultAutoTrimDBufferThreshold   = 512;
 const quint32 DefaultAutoTrimDBufferSize        = 256;
 const quint16 DefaultScrollbackBufferSize       = 32;    //(Unlisted option)
+const quint16 DefaultDisplayHistorySize         = 16;    //(Unlisted option) MiB
+const quint32 DefaultLogRotateSize              = 0;     //(Unlisted option) MiB, 0 to disable
+const quint32 DefaultLogRotateAge               = 0;     //(Unlisted option) Minutes, 0 to disable
+const bool DefaultLogCompressRotated            = false; //(Unlisted option)
+const QString DefaultCaptureFile                = "";    //(Unlisted option) Empty to disable
+const quint16 DefaultDisplayFrameBudget         = 4;     //(Unlisted option) mS
+const quint8 DefaultStreamMode                  = FILE_STREAM_MODE_FLOW; //(Unlisted option)
+const quint32 DefaultStreamRate                 = 1000;  //(Unlisted option) Bytes per second
+const QString DefaultStreamAck                  = "\\n"; //(Unlisted option) Escaped, empty to send each line once the previous one is written
+const quint32 DefaultStreamAckTimeout           = 5000;  //(Unlisted option) mS, 0 to wait forever
 const bool DefaultSaveSize                      = false;
 const bool DefaultOnlineUpdateCheck             = true;
 const bool DefaultReconnectAfterDisconnect      = false;
@@ -139,6 +162,7 @@ const qint8 BalloonActionShow                   = 1;
 const qint8 BalloonActionExit                   = 2;
 //Constants for speed testing
 const qint16 SpeedTestStatUpdateTime            = 500;  //Time (in ms) between status updates for speed test mode
+const qint32 SpeedTestErrorPositionsShown       = 16;   //Number of error positions to show at the end of a speed test
 const QString WINDOWS_NEWLINE                   = "\r\n";
 const QChar NEWLINE                             = '\n';
 
@@ -150,14 +174,6 @@ namespace Ui
     class AutMainWindow;
 }
 
-//Union used for checking received byte array contents whilst speed testing
-union pointer_buf {
-    uint8_t *p8;
-    uint16_t *p16;
-    uint32_t *p32;
-    uint64_t *p64;
-};
-
 #ifndef SKIPPLUGINS
 //Struct used for holding plugin objects
 struct plugins {
@@ -202,7 +218,8 @@ enum menu_actions {
     MenuActionCopy,
     MenuActionCopyAll,
     MenuActionPaste,
-    MenuActionSelectAll
+    MenuActionSelectAll,
+    MenuActionSearchHistory
 };
 
 //Speed test menu
@@ -251,6 +268,10 @@ public slots:
 #endif
 
 private slots:
+    void history_search_status(qint64 matches, bool finished);
+    void FileStreamTransmit(QByteArray baData);
+    void FileStreamFinished(file_stream_result_t result);
+    void log_error(QString message);
     void on_btn_Connect_clicked();
     void on_btn_TermClose_clicked(bool from_plugin = false);
     void on_btn_Refresh_clicked();
@@ -311,6 +332,8 @@ private slots:
     void on_check_SpeedDTR_stateChanged(int);
     void on_btn_SpeedClear_clicked();
     void on_btn_SpeedClose_clicked();
+    void SpeedTestTransmit(QByteArray baData);
+    void SpeedTestVerifyError(QByteArray baReceived, QByteArray baExpected);
     void on_btn_SpeedStartStop_clicked();
     void OutputSpeedTestStats();
     void on_combo_SpeedDataType_currentIndexChanged(int);
@@ -377,16 +400,16 @@ private:
     void UpdateImages();
     void DoLineEnd();
     void SerialStatus(bool bType);
+    void UpdateIOStatistics();
     void OpenDevice(bool from_plugin = false);
     void LookupErrorCode(unsigned int intErrorCode);
-    void FinishStream(bool bType);
     void LoadSettings();
     void UpdateSettings(int intMajor, int intMinor, QChar qcDelta);
 #ifndef SKIPSPEEDTEST
-    void SendSpeedTestData(int intMaxLength);
     void SpeedTestBytesWritten(qint64 intByteCount);
     void SpeedTestReceive();
     void OutputSpeedTestAvgStats(qint64 lngElapsed);
+    void OutputSpeedTestErrorPositions();
 #endif
     void SetLoopBackMode(bool bNewMode);
 #ifndef SKIPONLINE
@@ -397,6 +420,7 @@ private:
     void update_buffer(QByteArray data, bool apply_formatting);
     void update_buffer(QByteArray *data, bool apply_formatting);
     void update_display_trimming();
+    qint64 transport_write(const QByteArray &data);
 #ifndef SKIPPLUGINS_TRANSPORT
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
     bool transport_open(QIODeviceBase::OpenMode mode);
@@ -409,11 +433,13 @@ private:
     QSerialPort::DataBits transport_dataBits() const;
     AutTransportPlugin::StopBits transport_stopBits() const;
     QSerialPort::Parity transport_parity() const;
-    qint64 transport_write(const QByteArray &data);
     qint64 transport_bytesAvailable() const;
     QByteArray transport_peek(qint64 maxlen);
     QByteArray transport_read(qint64 maxlen);
     QByteArray transport_readAll();
+    qint64 transport_read_into(char *data, qint64 maxlen);
+    const char *transport_peek_pointer(qint64 *length);
+    qint64 transport_consume(qint64 length);
     bool transport_clear(QSerialPort::Directions directions = QSerialPort::AllDirections);
     bool transport_setBreakEnabled(bool set = true);
     bool transport_setRequestToSend(bool set);
@@ -435,7 +461,8 @@ private:
     //Private variables
     bool gbTermBusy; //True when compiling or loading a program or streaming a file (busy)
     bool gbStreamingFile; //True when a file is being streamed
-    QSerialPort gspSerialPort; //Contains the handle for the serial port
+    AutSerialWorker gspSerialPort; //Contains the handle for the serial port (which runs on a dedicated I/O thread)
+    QLabel *label_io_statistics; //Shows receive buffer usage of the serial I/O thread
     OS32_64UINT gintRXBytes; //Number of RX bytes
     OS32_64UINT gintTXBytes; //Number of TX bytes
     OS32_64UINT gintQueuedTXBytes; //Number of TX bytes that have been queued in buffer (not necesserially sent)
@@ -452,6 +479,7 @@ private:
     QPixmap *gpUw16Pixmap; //Pixmap holder for UwTerminal 16x16 icon
     QTimer *gpSignalTimer; //Handle for a timer to update COM port signals
     AutLogger *gpMainLog; //Handle to the main log file (if enabled/used)
+    AutCapture *gpCapture; //Handle to the binary capture file (if enabled/used)
     bool gbMainLogEnabled; //True if opened successfully (and enabled)
     QMenu *gpMenu; //Main menu
     QMenu *gpSMenu4; //Submenu 4
@@ -466,13 +494,18 @@ private:
     bool gbDCDStatus; //True when DCD is asserted
     bool gbDSRStatus; //True when DSR is asserted
     bool gbRIStatus; //True when RI is asserted
-    QFile *gpStreamFileHandle; //Handle for the file to stream data from
-    OS32_64UINT gintStreamBytesSize; //The size of the file to stream in bytes
-    OS32_64UINT gintStreamBytesRead; //The number of bytes read from the stream
+    AutFileStream *gpFileStream; //Sends the file being streamed out
     OS32_64UINT gintStreamBytesProgress; //The number of bytes when the next progress output should be made
     display_buffer_list display_buffers; //List of pending data awaiting terminal display
-    QElapsedTimer gtmrStreamTimer; //Counts how long a stream takes to send
     QTimer gtmrTextUpdateTimer; //Timer for slower updating of display buffer (but less display freezing)
+    QTimer gtmrDisplayBacklogTimer; //Timer for the next display frame whilst data is waiting to be displayed
+    quint32 gintDisplayFrameBudget; //Time in mS that one display frame should take
+    quint64 gintDisplayBytesPerMs; //Measured display speed, used to size display frames
+    quint64 gintDisplayFrames; //Number of display frames shown
+    quint64 gintDisplayFramesSkipped; //Number of display frames where data was only added to the history to catch up
+    qint64 gintDisplayFrameTime; //Time in uS the last display frame took
+    qint64 gintDisplayFrameTimePeak; //Longest time in uS a display frame took
+    quint64 gintDisplayBacklog; //Number of bytes waiting to be displayed after the last display frame
     QSettings *gpTermSettings; //Handle to settings
     QSettings *gpErrorMessages; //Handle to error codes
     QSettings *gpPredefinedDevice; //Handle to predefined devices
@@ -481,6 +514,7 @@ private:
     QNetworkReply *gnmrReply; //Network reply
 #endif
     QString gstrLastFilename[(FilenameIndexOthers+1)]; //Holds the filenames of the last selected files
+    QString gstrHistorySearch; //Last pattern used to search the display history
     bool gbEditFileModified; //True if the file in the editor pane has been modified, otherwise false
     int giEditFileType; //Type of file currently open in the editor
     bool gbErrorsLoaded; //True if error csv file has been loaded
@@ -500,8 +534,7 @@ private:
     unsigned char gchSpeedTestMode; //What mode the speed test is (inactive, receive, send or send & receive)
     QElapsedTimer gtmrSpeedTimer; //Used for timing how long a speed test has been running
     QByteArray gbaSpeedDisplayBuffer; //Buffer of data to display for speed test mode
-    QByteArray gbaSpeedMatchData; //Expected data to match in speed test mode
-    QByteArray gbaSpeedReceivedData; //Received data from device in speed test mode
+    AutSpeedTest *gpSpeedTest; //Sends and checks speed test data and keeps packet statistics
     QTimer gtmrSpeedTestStats; //Timer that runs every 250ms to update stats for speed test
     QTimer gtmrSpeedTestStats10s; //Timer that runs every 10 seconds to output 10s stats for speed test
     QTimer gtmrSpeedUpdateTimer; //Timer for slower updating of speed test buffer (but less display freezing)
@@ -510,13 +543,7 @@ private:
     quint64 gintSpeedBytesReceived10s; //Number of bytes received from device in the past 10 seconds in speed test mode
     quint64 gintSpeedBytesSent; //Number of bytes sent to the device in speed test mode
     quint64 gintSpeedBytesSent10s; //Number of bytes sent to the device in the past 10 seconds in speed test mode
-    qint32 gintSpeedBufferCount; //Number of bytes waiting to be sent to the device (waiting in the buffer) in speed test mode
     qint32 gintSpeedTestMatchDataLength; //Length of MatchData
-    qint32 gintSpeedTestReceiveIndex; //Current index for RecData
-    qint32 gintSpeedTestStatErrors; //Number of errors in packets recieved in speed test mode
-    qint32 gintSpeedTestStatSuccess; //Number of successful packets received in speed test mode
-    qint32 gintSpeedTestStatPacketsSent; //Numbers of packets sent in speed test mode
-    qint32 gintSpeedTestStatPacketsReceived; //Number of packets received in speed test mode
     quint8 gintSpeedTestDataBits; //Number of data bits (per byte) for speed testing
     quint8 gintSpeedTestStartStopParityBits; //Number of bits for start/stop/parity (per byte) for speed testing
     quint8 gintSpeedTestBytesBits; //Holds the current speed test combo selection option
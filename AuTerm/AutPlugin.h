@@ -29,11 +29,13 @@
 #include <QMainWindow>
 #include <QSerialPort>
 #include <QPushButton>
+#include <string.h>
 
 /******************************************************************************/
 // Defines
 /******************************************************************************/
-#define AuTermPluginInterface_iid "org.AuTerm.PluginInterface"
+//Changed when the plugin interfaces change in a way that is not compatible with plugins built against an older version
+#define AuTermPluginInterface_iid "org.AuTerm.PluginInterface/2"
 
 /******************************************************************************/
 // Class definitions
@@ -156,6 +158,26 @@ public:
     }
     /* Returns a string which is the string which should be displayed in the GUI for the active connection (when transport is connected) */
     virtual QString connection_display_name() = 0;
+    /* Functions below were added after the original interface, they are kept at the end so the positions of the earlier functions do not change */
+    /* Called to read data from and remove it from the receive buffer into data, up to length maxlen bytes, returns the number of bytes read (optional, the default uses read()) */
+    virtual qint64 read_into(char *data, qint64 maxlen)
+    {
+        QByteArray buffer = read(maxlen);
+
+        memcpy(data, buffer.constData(), buffer.length());
+        return buffer.length();
+    }
+    /* Called to access data at the start of the receive buffer without copying or removing it, length is set to the number of contiguous bytes at the returned pointer, which is valid until the receive buffer is next changed (optional, return nullptr if not supported) */
+    virtual const char *peek_pointer(qint64 *length)
+    {
+        *length = 0;
+        return nullptr;
+    }
+    /* Called to remove up to length bytes from the start of the receive buffer without reading them, returns the number of bytes removed (optional, the default uses read()) */
+    virtual qint64 consume(qint64 length)
+    {
+        return read(length).length();
+    }
 
 signals:
     /* Transport should emit this when data is waiting in the receive buffer */
@@ -171,6 +193,96 @@ signals:
 
 Q_DECLARE_INTERFACE(AutTransportPlugin, AuTermPluginInterface_iid)
 
+//Receive buffer for transport plugins, data is read from an offset so remaining data is not moved on each read and
+//whole received blocks are passed on without copying, read_into(), peek_pointer() and consume() can be implemented with it
+class AutTransportReceiveBuffer
+{
+public:
+    AutTransportReceiveBuffer()
+    {
+        offset = 0;
+    }
+    qint64 length() const
+    {
+        return buffer.length() - offset;
+    }
+    void append(const QByteArray &data)
+    {
+        if (length() == 0)
+        {
+            //Empty, share the received data
+            buffer = data;
+            offset = 0;
+            return;
+        }
+
+        if (offset >= (buffer.length() / 2))
+        {
+            //Most of the buffer has been read, drop it before it grows
+            buffer.remove(0, (int)offset);
+            offset = 0;
+        }
+
+        buffer.append(data);
+    }
+    const char *peek_pointer(qint64 *contiguous) const
+    {
+        *contiguous = length();
+        return buffer.constData() + offset;
+    }
+    qint64 consume(qint64 maxlen)
+    {
+        if (maxlen > length())
+        {
+            maxlen = length();
+        }
+
+        offset += maxlen;
+
+        if (offset == buffer.length())
+        {
+            clear();
+        }
+
+        return maxlen;
+    }
+    qint64 read_into(char *data, qint64 maxlen)
+    {
+        if (maxlen > length())
+        {
+            maxlen = length();
+        }
+
+        memcpy(data, (buffer.constData() + offset), maxlen);
+        return consume(maxlen);
+    }
+    QByteArray peek(qint64 maxlen) const
+    {
+        //Returns the buffer itself (without a copy) if all of it is wanted
+        return buffer.mid((int)offset, (int)(maxlen > length() ? length() : maxlen));
+    }
+    QByteArray read(qint64 maxlen)
+    {
+        QByteArray data = peek(maxlen);
+
+        consume(data.length());
+        return data;
+    }
+    QByteArray read_all()
+    {
+        return read(length());
+    }
+    void clear()
+    {
+        buffer.clear();
+        offset = 0;
+    }
+
+private:
+    QByteArray buffer;
+    qint64 offset;
+};
+
 //Struct which holds plugin data when a plugin requests details on another plugin
 struct plugin_data {
     const QObject *object;
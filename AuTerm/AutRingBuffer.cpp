@@ -0,0 +1,148 @@
+/******************************************************************************
+** Copyright (C) 2024 Jamie M.
+**
+** Project: AuTerm
+**
+** Module: AutRingBuffer.cpp
+**
+** Notes:
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include "AutRingBuffer.h"
+#include <string.h>
+
+/******************************************************************************/
+// Local Functions or Private Members
+/******************************************************************************/
+AutRingBuffer::AutRingBuffer(quint32 size)
+{
+    quint32 capacity = 1;
+
+    //Round up to a power of 2 so that indexes can be masked
+    while (capacity < size)
+    {
+        capacity <<= 1;
+    }
+
+    buffer = new char[capacity];
+    mask = capacity - 1;
+    head.storeRelease(0);
+    tail.storeRelease(0);
+}
+
+AutRingBuffer::~AutRingBuffer()
+{
+    delete[] buffer;
+}
+
+char *AutRingBuffer::write_pointer(quint32 *contiguous)
+{
+    quint32 current_head = head.loadAcquire();
+    quint32 free_bytes = capacity() - (current_head - tail.loadAcquire());
+    quint32 index = current_head & mask;
+
+    *contiguous = qMin(free_bytes, capacity() - index);
+
+    return &buffer[index];
+}
+
+void AutRingBuffer::commit_write(quint32 length)
+{
+    head.storeRelease(head.loadAcquire() + length);
+}
+
+quint32 AutRingBuffer::write(const char *data, quint32 length)
+{
+    quint32 written = 0;
+
+    while (written < length)
+    {
+        quint32 contiguous;
+        char *destination = write_pointer(&contiguous);
+
+        if (contiguous == 0)
+        {
+            break;
+        }
+
+        contiguous = qMin(contiguous, length - written);
+        memcpy(destination, &data[written], contiguous);
+        commit_write(contiguous);
+        written += contiguous;
+    }
+
+    return written;
+}
+
+const char *AutRingBuffer::read_pointer(quint32 *contiguous) const
+{
+    quint32 current_tail = tail.loadAcquire();
+    quint32 available = head.loadAcquire() - current_tail;
+    quint32 index = current_tail & mask;
+
+    *contiguous = qMin(available, capacity() - index);
+
+    return &buffer[index];
+}
+
+void AutRingBuffer::consume(quint32 length)
+{
+    tail.storeRelease(tail.loadAcquire() + length);
+}
+
+quint32 AutRingBuffer::peek(char *data, quint32 length) const
+{
+    quint32 current_tail = tail.loadAcquire();
+    quint32 available = head.loadAcquire() - current_tail;
+    quint32 copied = 0;
+
+    if (length > available)
+    {
+        length = available;
+    }
+
+    while (copied < length)
+    {
+        quint32 index = (current_tail + copied) & mask;
+        quint32 contiguous = qMin(length - copied, capacity() - index);
+
+        memcpy(&data[copied], &buffer[index], contiguous);
+        copied += contiguous;
+    }
+
+    return copied;
+}
+
+quint32 AutRingBuffer::read(char *data, quint32 length)
+{
+    quint32 copied = peek(data, length);
+
+    consume(copied);
+
+    return copied;
+}
+
+void AutRingBuffer::clear()
+{
+    tail.storeRelease(head.loadAcquire());
+}
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
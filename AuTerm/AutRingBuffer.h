@@ -0,0 +1,77 @@
+/******************************************************************************
+** Copyright (C) 2024 Jamie M.
+**
+** Project: AuTerm
+**
+** Module: AutRingBuffer.h
+**
+** Notes:
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+#ifndef AUTRINGBUFFER_H
+#define AUTRINGBUFFER_H
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include <QtGlobal>
+#include <QAtomicInteger>
+
+/******************************************************************************/
+// Class definitions
+/******************************************************************************/
+//Lock-free byte ring buffer for exactly one producer thread and one consumer thread
+class AutRingBuffer
+{
+public:
+    explicit AutRingBuffer(quint32 size);
+    ~AutRingBuffer();
+    quint32 capacity() const
+    {
+        return mask + 1;
+    }
+    quint32 used() const
+    {
+        return head.loadAcquire() - tail.loadAcquire();
+    }
+    quint32 free_space() const
+    {
+        return capacity() - used();
+    }
+
+    //Producer side
+    char *write_pointer(quint32 *contiguous);
+    void commit_write(quint32 length);
+    quint32 write(const char *data, quint32 length);
+
+    //Consumer side
+    const char *read_pointer(quint32 *contiguous) const;
+    void consume(quint32 length);
+    quint32 peek(char *data, quint32 length) const;
+    quint32 read(char *data, quint32 length);
+    void clear();
+
+private:
+    char *buffer;
+    quint32 mask;
+    QAtomicInteger<quint32> head; //Total bytes written, only changed by the producer
+    QAtomicInteger<quint32> tail; //Total bytes read, only changed by the consumer
+};
+
+#endif // AUTRINGBUFFER_H
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
@@ -26,14 +26,12 @@
 // Include Files
 /******************************************************************************/
 #include "AutScrollEdit.h"
-#include "AutEscape.h"
 #include <QRegularExpression>
 #include <QTimer>
 
 /******************************************************************************/
 // Constants
 /******************************************************************************/
-const QChar unicode_replacement_char = QChar(0xfffd);
 const QColor col_black = QColor(0, 0, 0);
 const QColor col_red = QColor(255, 0, 0);
 const QColor col_green = QColor(0, 255, 0);
@@ -52,6 +50,13 @@ const QColor col_light_magenta = QColor(255, 128, 255);
 const QColor col_light_cyan = QColor(224, 225, 225);
 //Default output buffer size to reduce mallocs (32KiB)
 const uint32_t out_buffer_size_default = 32768;
+//Number of lines loaded from history when scrolling past the top (or bottom, if older lines are shown) of the display
+const quint64 history_page_lines = 1000;
+//Multiple of the trim threshold the display may grow to whilst scrolled up before it is trimmed anyway
+const uint32_t trim_scrolled_multiplier = 4;
+//Limits for VT100 control sequence parameters
+const uint32_t vt100_max_parameter_value = 65535;
+const uint32_t vt100_max_cursor_forward = 512;
 
 /******************************************************************************/
 // Local Functions or Private Members
@@ -78,13 +83,39 @@ AutScrollEdit::AutScrollEdit(QWidget *parent) : QPlainTextEdit(parent)
     had_dat_in_data = false;
     trim_threshold = 0;
     trim_size = 0;
+    display_skip_to_tail = false;
+    document_first_line = 0;
+    document_end_line = 0;
+    vt100_control_mode = VT100_MODE_DECODE;
+    vt100_state = VT100_STATE_GROUND;
+    vt100_parse_reset();
 
     mstrDatIn.reserve(out_buffer_size_default);
 
+    history_snapshot_first = 0;
+    history_hit_index = -1;
+    connect(&history_search, SIGNAL(search_results(quint32,QVector<qint64>)), this, SLOT(history_search_results(quint32,QVector<qint64>)));
+    connect(&history_search, SIGNAL(search_finished(quint32,qint64,bool)), this, SLOT(history_search_finished(quint32,qint64,bool)));
+
+    //When scrolled to the top, older lines which have been trimmed are loaded back from the history, when scrolled to
+    //the bottom of a window of older lines, the newer lines after it are loaded
+    connect(this->verticalScrollBar(), &QScrollBar::valueChanged, this, [this] (int value) {
+        if (value == this->verticalScrollBar()->minimum() && document_first_line > history.first_line())
+        {
+            QTimer::singleShot(1, this, [this] () {
+                this->load_history_page();
+            });
+        }
+        else if (value == this->verticalScrollBar()->maximum() && document_end_line != 0)
+        {
+            QTimer::singleShot(1, this, [this] () {
+                this->load_history_next_page();
+            });
+        }
+    });
+
     default_format = this->textCursor().charFormat();
     last_format = default_format;
-
-    AutEscape::do_setup();
 }
 
 enum VT100_CODES {
@@ -106,6 +137,7 @@ enum VT100_CODES {
     VT100_CODE_FOREGROUND_MAGENTA,
     VT100_CODE_FOREGROUND_CYAN,
     VT100_CODE_FOREGROUND_WHITE,
+    VT100_CODE_FOREGROUND_EXTENDED,
     VT100_CODE_BACKGROUND_BLACK = 40,
     VT100_CODE_BACKGROUND_RED,
     VT100_CODE_BACKGROUND_GREEN,
@@ -114,6 +146,7 @@ enum VT100_CODES {
     VT100_CODE_BACKGROUND_MAGENTA,
     VT100_CODE_BACKGROUND_CYAN,
     VT100_CODE_BACKGROUND_WHITE,
+    VT100_CODE_BACKGROUND_EXTENDED,
     VT100_CODE_FOREGROUND_DARK_GRAY = 90,
     VT100_CODE_FOREGROUND_LIGHT_RED,
     VT100_CODE_FOREGROUND_LIGHT_GREEN,
@@ -319,151 +352,333 @@ void AutScrollEdit::vt100_colour_process(uint32_t code, vt100_format_code *forma
     }
 }
 
-/* Searches for VT100 format codes and extracts them, removing the original
- * formatting codes and adding the formatting codes to a list. Returns true if
- * full input buffer was process, returns false if it could not be fully
- * checked due to insufficient data, in which case `checked_pos` will be
- * updated with the length of the data (after removals) that has been checked
+/* Parses received data with a VT100 state machine, based upon the DEC/ECMA-48
+ * escape sequence grammar. Printable text is appended to `text` (with
+ * unprintable characters escaped) and format changes are added to `formats`
+ * with their start offset in `text`. The input is not modified and partial
+ * escape sequences are held in the parser state until the next call
  */
-bool AutScrollEdit::vt100_process(QString *buffer, QList<vt100_format_code> *formats, int32_t *checked_pos)
+void AutScrollEdit::vt100_parse(const QByteArray *data, QByteArray *text, QList<vt100_format_code> *formats)
 {
-    int32_t start = 0;
-    int32_t l = buffer->length();
-    vt100_format_code tmp_format;
-    int32_t prev_pos = -1;
+    const uint8_t *current = (const uint8_t *)data->constData();
+    const uint8_t *end = current + data->length();
+
+    text->reserve(text->length() + data->length());
 
-    while (start < l)
+    while (current < end)
     {
-        if (buffer->at(start) == (QChar)0x1b)
-        {
-            int32_t pos = start + 1;
+        uint8_t byte = *current;
 
-            if (pos >= l)
+        switch (vt100_state)
+        {
+            case VT100_STATE_GROUND:
             {
-                //Not enough bytes to check
-                *checked_pos = start;
-                return false;
-            }
+                const uint8_t *start = current;
 
-            if (buffer->at(pos) == '[')
-            {
-                bool found_digit = false;
-                uint32_t format = 0;
+                //Copy runs of printable characters in one go
+                while (current < end && (*current >= 0x20 || *current == 0x08 || *current == 0x09 || *current == 0x0a || *current == 0x0d))
+                {
+                    ++current;
+                }
 
-                tmp_format.start = 0;
-                tmp_format.background_color = col_black;
-                tmp_format.background_color_set = false;
-                tmp_format.foreground_color = col_black;
-                tmp_format.foreground_color_set = false;
-                tmp_format.weight = FORMAT_DUAL_UNSET;
-                tmp_format.italic = FORMAT_UNSET;
-                tmp_format.underline = FORMAT_UNSET;
-                tmp_format.strikethrough = FORMAT_UNSET;
-                tmp_format.clear_formatting = false;
-                tmp_format.options = 0;
-                tmp_format.temp = FORMAT_UNSET;
-                ++pos;
+                if (current > start)
+                {
+                    text->append((const char *)start, (current - start));
+                    continue;
+                }
 
-                while (pos < l && (buffer->at(pos) == ';' || (buffer->at(pos) >= '0' && buffer->at(pos) <= '9')))
+                if (byte == 0x1b && vt100_control_mode != VT100_MODE_IGNORE)
                 {
-                    if (buffer->at(pos) == ';')
-                    {
-                        if (found_digit == true)
-                        {
-                            vt100_colour_process(format, &tmp_format);
-                            format = 0;
-                            found_digit = false;
-                        }
-                        else
-                        {
-                            buffer->remove(start, 1);
-                            --l;
-                            break;
-                        }
-                    }
-                    else
+                    vt100_state = VT100_STATE_ESCAPE;
+                }
+                else
+                {
+                    //Replace unprintable character with escape code
+                    text->append('\\');
+
+                    if (byte < 0x10)
                     {
-                        found_digit = true;
-                        format = (format * 10) + (uint32_t)(buffer->at(pos).toLatin1() - '0');
+                        text->append('0');
                     }
 
-                    ++pos;
+                    text->append(QByteArray::number(byte, 16));
                 }
 
-                if ((pos - start) > 10)
+                break;
+            }
+            case VT100_STATE_ESCAPE:
+            {
+                if (byte == '[')
+                {
+                    vt100_parse_reset();
+                    vt100_state = VT100_STATE_CSI_PARAMETER;
+                }
+                else if (byte == ']' || byte == 'P' || byte == 'X' || byte == '^' || byte == '_')
                 {
-                    //Too long, probably garbage
-                    buffer->remove(start, 1);
-                    --l;
+                    //Operating system command or device control string, ignored up until the string terminator
+                    vt100_state = VT100_STATE_STRING;
+                }
+                else if (byte >= 0x20 && byte <= 0x2f)
+                {
+                    vt100_state = VT100_STATE_ESCAPE_INTERMEDIATE;
+                }
+                else if (byte >= 0x30 && byte <= 0x7e)
+                {
+                    //Single character escape sequence, none of which affect the display
+                    vt100_state = VT100_STATE_GROUND;
+                }
+                else if (byte != 0x1b)
+                {
+                    //Invalid sequence, abandon it and display the character
+                    vt100_state = VT100_STATE_GROUND;
                     continue;
                 }
-                else if (pos >= buffer->length())
+
+                break;
+            }
+            case VT100_STATE_ESCAPE_INTERMEDIATE:
+            {
+                if (byte >= 0x30 && byte <= 0x7e)
+                {
+                    //Character set selection or similar, not used
+                    vt100_state = VT100_STATE_GROUND;
+                }
+                else if (byte < 0x20 || byte > 0x2f)
                 {
-                    //Not enough bytes to check
-                    *checked_pos = start;
-                    return false;
+                    vt100_state = VT100_STATE_GROUND;
+                    continue;
                 }
-                else if (buffer->at(pos) == 'm')
+
+                break;
+            }
+            case VT100_STATE_CSI_PARAMETER:
+            case VT100_STATE_CSI_INTERMEDIATE:
+            case VT100_STATE_CSI_IGNORE:
+            {
+                if (byte >= 0x40 && byte <= 0x7e)
                 {
-                    if (found_digit == false)
+                    if (vt100_state != VT100_STATE_CSI_IGNORE)
                     {
-                        //assume that no data means clear formatting?
-                        format = 0;
+                        vt100_csi_dispatch(byte, text, formats);
                     }
-                    else if (prev_pos == start)
+
+                    vt100_state = VT100_STATE_GROUND;
+                }
+                else if (byte >= 0x20 && byte <= 0x2f)
+                {
+                    if (vt100_state == VT100_STATE_CSI_PARAMETER)
                     {
-                        //Append to existing one by merging the two
-                        vt100_format_combine(&tmp_format, &formats->last());
-                        formats->pop_back();
+                        vt100_state = VT100_STATE_CSI_INTERMEDIATE;
                     }
 
-                    vt100_colour_process(format, &tmp_format);
-
-                    tmp_format.start = start;
-                    formats->append(tmp_format);
-                    buffer->remove(start, (pos - start + 1));
-                    l -= (pos - start + 1);
-                    prev_pos = start;
-                    continue;
+                    vt100_private_sequence = true;
                 }
-                else if (buffer->at(pos) == 'C')
+                else if (byte >= 0x30 && byte <= 0x3f)
                 {
-                    //Replace with spaces
-                    if (found_digit == true)
+                    if (vt100_state == VT100_STATE_CSI_INTERMEDIATE)
                     {
-                        int32_t changes = (pos - start + 1) - format;
-
-                        buffer->replace(start, (pos - start + 1), QString(" ").repeated(format));
-                        l -= changes;
-                        start -= changes;
-                        continue;
+                        //Parameters cannot follow intermediate bytes
+                        vt100_state = VT100_STATE_CSI_IGNORE;
                     }
-                    else
+                    else if (vt100_state == VT100_STATE_CSI_PARAMETER)
                     {
-                        //todo?
+                        if (vt100_parameter_count == 0)
+                        {
+                            vt100_parameter_count = 1;
+                        }
+
+                        if (byte >= '0' && byte <= '9')
+                        {
+                            uint32_t *parameter = &vt100_parameters[vt100_parameter_count - 1];
+
+                            *parameter = (*parameter * 10) + (byte - '0');
+
+                            if (*parameter > vt100_max_parameter_value)
+                            {
+                                *parameter = vt100_max_parameter_value;
+                            }
+                        }
+                        else if (byte == ';' || byte == ':')
+                        {
+                            if (vt100_parameter_count >= vt100_max_parameters)
+                            {
+                                vt100_state = VT100_STATE_CSI_IGNORE;
+                            }
+                            else
+                            {
+                                vt100_parameters[vt100_parameter_count] = 0;
+                                ++vt100_parameter_count;
+                            }
+                        }
+                        else
+                        {
+                            //Private marker
+                            vt100_private_sequence = true;
+                        }
                     }
                 }
+                else if (byte == 0x1b)
+                {
+                    vt100_state = VT100_STATE_ESCAPE;
+                }
+                else if (byte < 0x20)
+                {
+                    //Control characters cancel the sequence and are displayed
+                    vt100_state = VT100_STATE_GROUND;
+                    continue;
+                }
+
+                break;
+            }
+            case VT100_STATE_STRING:
+            {
+                if (byte == 0x07)
+                {
+                    vt100_state = VT100_STATE_GROUND;
+                }
+                else if (byte == 0x1b)
+                {
+                    vt100_state = VT100_STATE_STRING_ESCAPE;
+                }
+
+                break;
+            }
+            case VT100_STATE_STRING_ESCAPE:
+            {
+                if (byte == '\\')
+                {
+                    vt100_state = VT100_STATE_GROUND;
+                }
                 else
                 {
-                    buffer->remove(start, 1);
-                    --l;
+                    //Not a string terminator, treat as the start of a new escape sequence
+                    vt100_state = VT100_STATE_ESCAPE;
                     continue;
                 }
 
-                start = pos;
+                break;
             }
-            else
+        };
+
+        ++current;
+    }
+}
+
+void AutScrollEdit::vt100_parse_reset()
+{
+    vt100_parameters[0] = 0;
+    vt100_parameter_count = 0;
+    vt100_private_sequence = false;
+}
+
+void AutScrollEdit::vt100_csi_dispatch(uint8_t final_byte, QByteArray *text, QList<vt100_format_code> *formats)
+{
+    if (vt100_private_sequence == true)
+    {
+        //Private modes (e.g. cursor visibility) do not affect the display
+        return;
+    }
+
+    switch (final_byte)
+    {
+        case 'm':
+        {
+            //Select graphic rendition
+            if (vt100_control_mode == VT100_MODE_DECODE)
             {
-                buffer->remove(start, 1);
-                --l;
-                continue;
+                vt100_sgr_process(text->length(), formats);
             }
+
+            break;
+        }
+        case 'C':
+        {
+            //Cursor forward, replace with spaces
+            if (vt100_control_mode == VT100_MODE_DECODE)
+            {
+                uint32_t count = (vt100_parameter_count == 0 || vt100_parameters[0] == 0 ? 1 : vt100_parameters[0]);
+
+                if (count > vt100_max_cursor_forward)
+                {
+                    count = vt100_max_cursor_forward;
+                }
+
+                text->append(count, ' ');
+            }
+
+            break;
         }
+        case 'A':
+        case 'B':
+        case 'D':
+        case 'E':
+        case 'F':
+        case 'G':
+        case 'H':
+        case 'f':
+        case 'J':
+        case 'K':
+        default:
+        {
+            //Cursor movement, erase and other sequences cannot be applied to the scrollback, they are consumed
+            break;
+        }
+    };
+}
 
-        ++start;
+void AutScrollEdit::vt100_sgr_process(int32_t position, QList<vt100_format_code> *formats)
+{
+    vt100_format_code tmp_format;
+    uint8_t i = 0;
+
+    tmp_format.start = position;
+    tmp_format.background_color = col_black;
+    tmp_format.background_color_set = false;
+    tmp_format.foreground_color = col_black;
+    tmp_format.foreground_color_set = false;
+    tmp_format.weight = FORMAT_DUAL_UNSET;
+    tmp_format.italic = FORMAT_UNSET;
+    tmp_format.underline = FORMAT_UNSET;
+    tmp_format.strikethrough = FORMAT_UNSET;
+    tmp_format.clear_formatting = false;
+    tmp_format.options = 0;
+    tmp_format.temp = FORMAT_UNSET;
+
+    if (vt100_parameter_count == 0)
+    {
+        //No parameters is the same as clear formatting
+        vt100_parameter_count = 1;
     }
 
-    return true;
+    while (i < vt100_parameter_count)
+    {
+        uint32_t code = vt100_parameters[i];
+
+        if (code == VT100_CODE_CLEAR_FORMATTING)
+        {
+            //Discard anything earlier in the same sequence
+            tmp_format.background_color_set = false;
+            tmp_format.foreground_color_set = false;
+            tmp_format.weight = FORMAT_DUAL_UNSET;
+            tmp_format.italic = FORMAT_UNSET;
+            tmp_format.underline = FORMAT_UNSET;
+            tmp_format.strikethrough = FORMAT_UNSET;
+            tmp_format.clear_formatting = true;
+        }
+        else if ((code == VT100_CODE_FOREGROUND_EXTENDED || code == VT100_CODE_BACKGROUND_EXTENDED) && (i + 1) < vt100_parameter_count)
+        {
+            //256 colour and RGB colours are not supported, skip their arguments
+            i += (vt100_parameters[i + 1] == 5 ? 2 : (vt100_parameters[i + 1] == 2 ? 4 : 1));
+        }
+        else
+        {
+            vt100_colour_process(code, &tmp_format);
+        }
+
+        ++i;
+    }
+
+    formats->append(tmp_format);
 }
 
 AutScrollEdit::~AutScrollEdit()
@@ -513,6 +728,13 @@ bool AutScrollEdit::eventFilter(QObject *target, QEvent *event)
     {
         //Key has been pressed...
         QKeyEvent *keyEvent = static_cast<QKeyEvent*>(event);
+        if (keyEvent->key() == Qt::Key_F3 && history_hits.isEmpty() == false)
+        {
+            //Move between history search matches
+            this->search_history_next((keyEvent->modifiers() & Qt::ShiftModifier) == Qt::ShiftModifier);
+            return true;
+        }
+
         if ((keyEvent->modifiers() & Qt::ControlModifier) == Qt::ControlModifier)
         {
             //Check if this is a shortcut for cut
@@ -827,9 +1049,9 @@ void AutScrollEdit::set_line_mode(bool bNewLineMode)
     this->update_display();
 }
 
-void AutScrollEdit::add_display_data(display_buffer_list *buffers)
+void AutScrollEdit::add_display_data(display_buffer_list *buffers, bool skip_to_tail)
 {
-    //Adds data to the display buffer
+    //Adds data to the display buffer, if skip_to_tail is set then data which would be trimmed straight away is only added to the history
     uint32_t i = 0;
     uint32_t l = buffers->length();
 
@@ -882,9 +1104,16 @@ void AutScrollEdit::add_display_data(display_buffer_list *buffers)
     }
 
     had_dat_in_data = true;
+    display_skip_to_tail = skip_to_tail;
     this->update_display();
 }
 
+bool AutScrollEdit::can_skip_to_tail()
+{
+    //Data can only be skipped if it would be trimmed anyway and the user is not looking at or selecting older output
+    return (trim_size > 0 && this->verticalScrollBar()->isSliderDown() == false && mbContextMenuOpen == false && this->verticalScrollBar()->sliderPosition() == this->verticalScrollBar()->maximum() && this->textCursor().hasSelection() == false);
+}
+
 void AutScrollEdit::add_dat_in_text(QByteArray data)
 {
     //Adds data to the DatOut buffer
@@ -919,6 +1148,15 @@ void AutScrollEdit::clear_dat_in()
 {
     //Clears the DatIn buffer
     mstrDatIn.clear();
+    dat_in_pending.clear();
+    vt100_state = VT100_STATE_GROUND;
+    history_search.cancel();
+    history_snapshot.clear();
+    history_hits.clear();
+    history_hit_index = -1;
+    history.clear();
+    document_first_line = 0;
+    document_end_line = 0;
     mintPrevTextSize = 0;
     dat_in_new_len = 0;
     last_format = default_format;
@@ -1002,6 +1240,10 @@ void AutScrollEdit::insertFromMimeData(const QMimeData *mdSrc)
 void AutScrollEdit::update_display()
 {
     //Updates the receive text buffer, faster
+    bool skip_to_tail = display_skip_to_tail;
+
+    display_skip_to_tail = false;
+
     if (this->verticalScrollBar()->isSliderDown() != true && mbContextMenuOpen == false)
     {
         //Variables for text selection storage
@@ -1012,8 +1254,6 @@ void AutScrollEdit::update_display()
         bool bShiftEnd = false;
         unsigned int uiCurrentSize = 0;
         uint32_t removed_size = 0;
-        int32_t cannot_parse_bytes = 0;
-        int32_t i;
         unsigned int Pos;
 
         if (this->textCursor().anchor() != this->textCursor().position())
@@ -1050,140 +1290,145 @@ void AutScrollEdit::update_display()
 
         this->setUpdatesEnabled(false);
 
-        if (vt100_control_mode == VT100_MODE_STRIP)
-        {
-            AutEscape::strip_vt100_formatting(&mstrDatIn, 0);
-        }
-        else if (vt100_control_mode == VT100_MODE_DECODE)
+        if (mstrDatIn.length() > 0)
         {
-            AutEscape::strip_vt100_non_formatting(&mstrDatIn, 0);
-        }
-
-//TODO: deal with partial VT100 escape codes
+            QByteArray text = dat_in_pending;
+            QList<vt100_format_code> format;
+            int32_t text_length;
+            int32_t l = 0;
+            int32_t next_entry = 0;
+            int32_t skip_length = 0;
 
-        //Replace unprintable characters with escape codes
-        i = mstrDatIn.length() - 1;
+            //Incomplete escape sequences are kept in the parser state until the rest is received
+            vt100_parse(&mstrDatIn, &text, &format);
+            mstrDatIn.clear();
+            dat_in_pending.clear();
 
-        while (i >= 0)
-        {
-            uint8_t current = (uint8_t)mstrDatIn.at(i);
+            //Hold back an incomplete UTF-8 character at the end until the next chunk
+            text_length = text.length();
+            l = text_length - 1;
 
-            if (current < 0x08 || (current >= 0x0b && current <= 0x0c) || (current >= 0x0e && current <= 0x0f))
+            while (l >= 0 && l >= (text_length - 3))
             {
-                mstrDatIn.replace(i, 1, QString("\\0").append(QString::number(current, 16)).toUtf8());
-            }
-            else if ((current >= 0x10 && current <= 0x1a) || (current >= 0x1c && current <= 0x1f) || (current == 0x1b && vt100_control_mode != VT100_MODE_DECODE))
-            {
-                mstrDatIn.replace(i, 1, QString("\\").append(QString::number(current, 16)).toUtf8());
-            }
+                uint8_t current = (uint8_t)text.at(l);
 
-            --i;
-        }
+                if ((current & 0xc0) != 0x80)
+                {
+                    if (current >= 0xc0 && (text_length - l) < (current >= 0xf0 ? 4 : (current >= 0xe0 ? 3 : 2)) && (format.length() == 0 || format.last().start <= l))
+                    {
+                        dat_in_pending = text.mid(l);
+                        text_length = l;
+                    }
 
-        if (mstrDatIn.length() > 0)
-        {
-            QString append_data = mstrDatIn;
-            QList<vt100_format_code> format;
-            int32_t end = 0;
+                    break;
+                }
 
-            //Check if we have unicode replacement characters, if so, wait for next chunk
-            i = append_data.length() - 1;
-            while (i >= 0 && append_data[i] == unicode_replacement_char && end < 3)
-            {
-                ++end;
-                --i;
+                --l;
             }
 
-            if (end > 0)
+            if (document_end_line != 0)
             {
-                cannot_parse_bytes += end;
-                append_data.remove((append_data.length() - end), end);
+                //A window of older lines is shown, received data only goes to the history until the display is scrolled
+                //down to it
+                skip_length = text_length;
             }
-
-            if (vt100_control_mode == VT100_MODE_DECODE && vt100_process(&append_data, &format, &end) == false)
+            else if (skip_to_tail == true && (uint32_t)text_length > trim_size)
             {
-                cannot_parse_bytes += append_data.length() - end;
-                append_data.remove(end, (append_data.length() - end));
+                //Only the part which would be left after trimming is shown, starting at a new line so the display can be
+                //extended from the history again, everything before it only goes to the history
+                skip_length = text.indexOf('\n', (text_length - (int32_t)trim_size - 1)) + 1;
+
+                if (skip_length >= text_length)
+                {
+                    skip_length = 0;
+                }
             }
 
-            if (append_data.length() > 0)
-            {
-                dat_in_new_len = append_data.length();
-                int32_t l = 0;
-                int32_t next_entry = -1;
-                int32_t next_entry_pos_check = 0;
-                bool first = true;
+            l = 0;
+            tcTmpCur = this->textCursor();
+            tcTmpCur.setPosition(mintPrevTextSize);
 
-                tcTmpCur = this->textCursor();
+            if (vt100_control_mode == VT100_MODE_DECODE)
+            {
+                tcTmpCur.setCharFormat(last_format);
+            }
+            else
+            {
+                tcTmpCur.setCharFormat(default_format);
+            }
 
-                if (format.length() > 0 && format[0].start == 0)
-                {
-                    next_entry = 0;
-                }
+            while (l < text_length || next_entry < format.length())
+            {
+                int32_t next = text_length;
 
-                while (l < dat_in_new_len)
+                if (next_entry < format.length())
                 {
-                    int32_t next = dat_in_new_len;
-
-                    while (next_entry_pos_check < format.length())
+                    if (format[next_entry].start <= l)
                     {
-                        if (l < format[next_entry_pos_check].start)
-                        {
-                            next = format[next_entry_pos_check].start;
-                            break;
-                        }
-
-                        ++next_entry_pos_check;
+                        //Apply all formats which start at this position before the text following them
+                        vt100_format_apply(&tcTmpCur, &format[next_entry]);
+                        ++next_entry;
+                        continue;
                     }
 
-                    tcTmpCur.setPosition(mintPrevTextSize + l);
+                    next = format[next_entry].start;
+                }
 
-                    if (first == true)
+                if (l < skip_length)
+                {
+                    //Skipped, only added to the history
+                    if (next > skip_length)
                     {
-                        if (vt100_control_mode == VT100_MODE_DECODE)
-                        {
-                            tcTmpCur.setCharFormat(last_format);
-                        }
-                        else
-                        {
-                            tcTmpCur.setCharFormat(default_format);
-                        }
-
-                        first = false;
+                        next = skip_length;
                     }
 
-                    if (next_entry != -1 && next_entry < format.length())
+                    history.append(QString::fromUtf8(text.constData() + l, (next - l)), tcTmpCur.charFormat());
+                    l = next;
+
+                    if (l == skip_length && document_end_line == 0)
                     {
-                        vt100_format_apply(&tcTmpCur, &format[next_entry]);
+                        //Remove the received data already in the document, it is all older than the data being shown
+                        QTextCharFormat current_format = tcTmpCur.charFormat();
+
+                        tcTmpCur.setPosition(0);
+                        tcTmpCur.setPosition(dat_in_new_len, QTextCursor::KeepAnchor);
+                        tcTmpCur.removeSelectedText();
+                        tcTmpCur.setCharFormat(current_format);
+                        removed_size = (uint32_t)dat_in_new_len;
+                        dat_in_new_len = 0;
+                        document_first_line = (history.end_line() > 0 ? history.end_line() - 1 : 0);
                     }
 
-                    this->setTextCursor(tcTmpCur);
-                    tcTmpCur.insertText(append_data.mid(l, (next - l)));
-                    l = next;
-                    next_entry = next_entry_pos_check;
-                }
-
-                //Reset style if final character was for style
-                if (next_entry < format.length())
-                {
-                    tcTmpCur.setPosition(format[next_entry].start);
-                    vt100_format_apply(&tcTmpCur, &format[next_entry]);
-                    this->setTextCursor(tcTmpCur);
+                    continue;
                 }
 
-                dat_in_new_len += mintPrevTextSize;
+                QString run_text = QString::fromUtf8(text.constData() + l, (next - l));
+                tcTmpCur.insertText(run_text);
+                history.append(run_text, tcTmpCur.charFormat());
+                dat_in_new_len += run_text.length();
+                l = next;
             }
 
+            this->setTextCursor(tcTmpCur);
             last_format = tcTmpCur.charFormat();
         }
 
-        if (trim_size > 0 && (uint32_t)dat_in_new_len >= trim_threshold)
+        if (trim_size > 0 && (uint32_t)dat_in_new_len >= trim_threshold && (Pos == 65535 || (uint32_t)dat_in_new_len >= (trim_threshold * trim_scrolled_multiplier)))
         {
-            //Trim buffer down to requested size
+            //Trim buffer down to requested size, this is held off whilst scrolled up (up to a limit) so that history which has been loaded back in stays visible
 //TODO: this can be improved by doing it before the append above, i.e. if old length + new lengh > threshold, remove from one or both buffers
             removed_size = (uint32_t)dat_in_new_len - trim_size;
 
             tcTmpCur = this->textCursor();
+            tcTmpCur.setPosition(removed_size);
+
+            //Remove whole lines where possible so the display can be extended from the history again
+            if (tcTmpCur.movePosition(QTextCursor::NextBlock) == true && (uint32_t)tcTmpCur.position() < (uint32_t)dat_in_new_len)
+            {
+                removed_size = tcTmpCur.position();
+                document_first_line += tcTmpCur.blockNumber();
+            }
+
             tcTmpCur.movePosition(QTextCursor::Start, QTextCursor::MoveAnchor, 1);
             tcTmpCur.movePosition(QTextCursor::Right, QTextCursor::KeepAnchor, removed_size);
             tcTmpCur.removeSelectedText();
@@ -1208,7 +1453,6 @@ void AutScrollEdit::update_display()
 
         //Update previous text size variables
         mintPrevTextSize = dat_in_new_len;
-        mstrDatIn.remove(0, (mstrDatIn.length() - cannot_parse_bytes));
 
         //Update the cursor position
         this->update_cursor();
@@ -1316,6 +1560,248 @@ void AutScrollEdit::set_trim_settings(uint32_t threshold, uint32_t size)
 void AutScrollEdit::set_vt100_mode(vt100_mode mode)
 {
     vt100_control_mode = mode;
+    vt100_state = VT100_STATE_GROUND;
+}
+
+void AutScrollEdit::set_history_size(quint32 size)
+{
+    //Changing the size discards the existing history, so this should be set before any data is displayed
+    history.set_size(size);
+    document_first_line = 0;
+    document_end_line = 0;
+}
+
+const AutScrollback *AutScrollEdit::get_history()
+{
+    return &history;
+}
+
+void AutScrollEdit::load_history_page()
+{
+    //Renders a page of older lines from the history at the top of the display
+    if (this->verticalScrollBar()->isSliderDown() == true || mbContextMenuOpen == true || this->verticalScrollBar()->value() != this->verticalScrollBar()->minimum() || document_first_line <= history.first_line())
+    {
+        return;
+    }
+
+    load_history_lines(history_page_lines);
+}
+
+void AutScrollEdit::load_history_lines(quint64 count)
+{
+    //Renders up to count lines before the first line in the display from the history
+    QTextCursor tcTmpCur;
+    quint64 first;
+    int32_t added_size;
+    int scroll_position;
+
+    if (document_first_line <= history.first_line())
+    {
+        return;
+    }
+
+    first = ((document_first_line - history.first_line()) > count ? (document_first_line - count) : history.first_line());
+    added_size = this->document()->characterCount();
+    scroll_position = this->verticalScrollBar()->value();
+
+    this->setUpdatesEnabled(false);
+    tcTmpCur = QTextCursor(this->document());
+    tcTmpCur.movePosition(QTextCursor::Start, QTextCursor::MoveAnchor, 1);
+    history.render(first, (document_first_line - first), &tcTmpCur);
+    this->setUpdatesEnabled(true);
+
+    //Positions of received and typed data have moved along by the inserted text
+    added_size = this->document()->characterCount() - added_size;
+    mintPrevTextSize += added_size;
+    dat_in_new_len += added_size;
+    this->verticalScrollBar()->setValue(scroll_position + (int)(document_first_line - first));
+    document_first_line = first;
+}
+
+void AutScrollEdit::load_history_next_page()
+{
+    //Renders a page of newer lines from the history at the bottom of a window of older lines, once the newest line is
+    //reached the display is updated with received data again
+    QTextCursor tcTmpCur;
+    quint64 end;
+    int32_t added_size;
+    int scroll_position;
+
+    if (this->verticalScrollBar()->isSliderDown() == true || mbContextMenuOpen == true || this->verticalScrollBar()->value() != this->verticalScrollBar()->maximum() || document_end_line == 0)
+    {
+        return;
+    }
+
+    if (document_end_line < history.first_line())
+    {
+        //Lines after the window have been removed from the history, show the newest lines instead
+        show_history_window(history.end_line() - 1);
+        return;
+    }
+
+    end = ((history.end_line() - document_end_line) > history_page_lines ? (document_end_line + history_page_lines) : history.end_line());
+    added_size = this->document()->characterCount();
+    scroll_position = this->verticalScrollBar()->value();
+
+    this->setUpdatesEnabled(false);
+    tcTmpCur = QTextCursor(this->document());
+    tcTmpCur.setPosition(dat_in_new_len);
+    history.render(document_end_line, (end - document_end_line), &tcTmpCur);
+
+    if (end == history.end_line())
+    {
+        //The newest line is still being received so is not ended
+        tcTmpCur.deletePreviousChar();
+    }
+
+    this->setUpdatesEnabled(true);
+
+    added_size = this->document()->characterCount() - added_size;
+    mintPrevTextSize += added_size;
+    dat_in_new_len += added_size;
+    this->verticalScrollBar()->setValue(scroll_position);
+    document_end_line = (end == history.end_line() ? 0 : end);
+}
+
+void AutScrollEdit::show_history_window(quint64 line)
+{
+    //Replaces the received data in the display with a page of lines around a line from the history, so that jumping
+    //to an old line does not render every line between it and the display. Newer lines are loaded when scrolling down
+    QTextCursor tcTmpCur;
+    quint64 first;
+    quint64 end;
+    int32_t added_size;
+
+    first = ((line - history.first_line()) > (history_page_lines / 2) ? (line - (history_page_lines / 2)) : history.first_line());
+    end = ((history.end_line() - line) > (history_page_lines / 2) ? (line + (history_page_lines / 2)) : history.end_line());
+
+    this->setUpdatesEnabled(false);
+    tcTmpCur = QTextCursor(this->document());
+    tcTmpCur.setPosition(0);
+    tcTmpCur.setPosition(dat_in_new_len, QTextCursor::KeepAnchor);
+    tcTmpCur.removeSelectedText();
+    added_size = this->document()->characterCount();
+    history.render(first, (end - first), &tcTmpCur);
+
+    if (end == history.end_line())
+    {
+        //The newest line is still being received so is not ended
+        tcTmpCur.deletePreviousChar();
+    }
+
+    this->setUpdatesEnabled(true);
+
+    //Positions of typed data have moved by the difference in the size of the received data
+    added_size = this->document()->characterCount() - added_size;
+    mintPrevTextSize = mintPrevTextSize - (uint32_t)dat_in_new_len + (uint32_t)added_size;
+    dat_in_new_len = added_size;
+    document_first_line = first;
+    document_end_line = (end == history.end_line() ? 0 : end);
+}
+
+bool AutScrollEdit::search_history(QString pattern, bool regex, bool case_sensitive)
+{
+    //Searches all received data in the history in the background, a copy is taken so more data can be received whilst searching
+    history_search.cancel();
+    history_hits.clear();
+    history_hit_index = -1;
+    history.snapshot(history_snapshot.get_data(), history_snapshot.get_line_starts());
+    history_snapshot_first = history.first_line();
+
+    return history_search.start_search(&history_snapshot, pattern, regex, case_sensitive);
+}
+
+bool AutScrollEdit::search_history_next(bool backwards)
+{
+    //Moves to the next (newer) or previous (older) match
+    if (history_hits.isEmpty() == true)
+    {
+        return false;
+    }
+
+    if (backwards == true)
+    {
+        history_hit_index = (history_hit_index <= 0 ? (history_hits.length() - 1) : (history_hit_index - 1));
+    }
+    else
+    {
+        history_hit_index = ((history_hit_index + 1) >= history_hits.length() ? 0 : (history_hit_index + 1));
+    }
+
+    return jump_to_history_line(history_hits.at(history_hit_index));
+}
+
+bool AutScrollEdit::jump_to_history_line(quint64 line)
+{
+    //Selects a line from the history, loading older lines into the display if needed
+    QTextCursor tcTmpCur;
+    QTextBlock block;
+
+    if (line < history.first_line() || line >= history.end_line())
+    {
+        return false;
+    }
+
+    if (line < document_first_line && (document_first_line - line) <= history_page_lines)
+    {
+        //Close to the display, extend it so that it stays continuous
+        load_history_lines(document_first_line - line);
+    }
+    else if (line < document_first_line || (document_end_line != 0 && line >= document_end_line))
+    {
+        show_history_window(line);
+    }
+
+    block = this->document()->findBlockByNumber((int)(line - document_first_line));
+
+    if (block.isValid() == false)
+    {
+        return false;
+    }
+
+    tcTmpCur = QTextCursor(block);
+    tcTmpCur.movePosition(QTextCursor::EndOfBlock, QTextCursor::KeepAnchor, 1);
+    this->setTextCursor(tcTmpCur);
+    this->centerCursor();
+
+    return true;
+}
+
+void AutScrollEdit::history_search_results(quint32 id, QVector<qint64> lines)
+{
+    qint32 i = 0;
+
+    if (id != history_search.get_search_id())
+    {
+        return;
+    }
+
+    while (i < lines.length())
+    {
+        history_hits.append(history_snapshot_first + (quint64)lines.at(i));
+        ++i;
+    }
+
+    emit history_search_status(history_hits.length(), false);
+}
+
+void AutScrollEdit::history_search_finished(quint32 id, qint64 matches, bool cancelled)
+{
+    if (id != history_search.get_search_id() || cancelled == true)
+    {
+        return;
+    }
+
+    //Snapshot is no longer needed
+    history_snapshot.clear();
+    emit history_search_status(matches, true);
+
+    if (history_hits.isEmpty() == false)
+    {
+        //Start at the most recent match
+        history_hit_index = history_hits.length() - 1;
+        jump_to_history_line(history_hits.at(history_hit_index));
+    }
 }
 
 void AutScrollEdit::vt100_format_apply(QTextCursor *cursor, vt100_format_code *format)
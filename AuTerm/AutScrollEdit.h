@@ -37,6 +37,8 @@
 #include <QTextCursor>
 #include <QTextDocumentFragment>
 #include <QClipboard>
+#include "AutScrollback.h"
+#include "AutSearch.h"
 
 /******************************************************************************/
 // Enum typedefs
@@ -60,6 +62,23 @@ enum vt100_dual_format_type {
     FORMAT_DUAL_DOUBLE,
 };
 
+//State of the VT100 parser, based upon the DEC/ECMA-48 escape sequence grammar
+enum vt100_parse_state {
+    VT100_STATE_GROUND = 0,
+    VT100_STATE_ESCAPE,
+    VT100_STATE_ESCAPE_INTERMEDIATE,
+    VT100_STATE_CSI_PARAMETER,
+    VT100_STATE_CSI_INTERMEDIATE,
+    VT100_STATE_CSI_IGNORE,
+    VT100_STATE_STRING,
+    VT100_STATE_STRING_ESCAPE,
+};
+
+/******************************************************************************/
+// Constants
+/******************************************************************************/
+const uint8_t vt100_max_parameters = 16;
+
 /******************************************************************************/
 // Forward declaration of Class, Struct & Unions
 /******************************************************************************/
@@ -102,7 +121,8 @@ public:
     void set_line_mode(bool bNewLineMode);
     void insertFromMimeData(const QMimeData *mdSrc);
     void update_display();
-    void add_display_data(display_buffer_list *buffers);
+    void add_display_data(display_buffer_list *buffers, bool skip_to_tail = false);
+    bool can_skip_to_tail();
     void add_dat_in_text(QByteArray data);
     void add_dat_out_text(const QString strDat);
     void clear_dat_in();
@@ -112,13 +132,25 @@ public:
     void set_serial_open(bool SerialOpen);
     void set_trim_settings(uint32_t threshold, uint32_t size);
     void set_vt100_mode(vt100_mode mode);
+    void set_history_size(quint32 size);
+    const AutScrollback *get_history();
+    bool search_history(QString pattern, bool regex, bool case_sensitive);
+    bool search_history_next(bool backwards);
+    bool jump_to_history_line(quint64 line);
 
 protected:
     bool eventFilter(QObject *target, QEvent *event);
-    bool vt100_process(QString *buffer, QList<vt100_format_code> *format, int32_t *checked_pos);
+    void vt100_parse(const QByteArray *data, QByteArray *text, QList<vt100_format_code> *formats);
+    void vt100_parse_reset();
+    void vt100_csi_dispatch(uint8_t final_byte, QByteArray *text, QList<vt100_format_code> *formats);
+    void vt100_sgr_process(int32_t position, QList<vt100_format_code> *formats);
     void vt100_colour_process(uint32_t code, vt100_format_code *format);
     void vt100_format_apply(QTextCursor *cursor, vt100_format_code *format);
     void vt100_format_combine(vt100_format_code *original, vt100_format_code *merge);
+    void load_history_page();
+    void load_history_lines(quint64 count);
+    void load_history_next_page();
+    void show_history_window(quint64 line);
 
 signals:
     void enter_pressed();
@@ -126,6 +158,11 @@ signals:
     void vt100_send(QByteArray code);
     void file_dropped(QString strFilename);
     void scrollbar_drag_released();
+    void history_search_status(qint64 matches, bool finished);
+
+private slots:
+    void history_search_results(quint32 id, QVector<qint64> lines);
+    void history_search_finished(quint32 id, qint64 matches, bool cancelled);
 
 private:
     QString *mstrItemArray; //Item text
@@ -148,6 +185,20 @@ private:
     QTextCharFormat pre_dat_in_format_backup; //Backup of text format prior to dat in text being added
     uint32_t trim_threshold;
     uint32_t trim_size;
+    bool display_skip_to_tail; //True if the next display update should only show the data which would be left after trimming
+    vt100_parse_state vt100_state; //Parser state, kept between chunks of received data
+    uint32_t vt100_parameters[vt100_max_parameters]; //Numeric parameters of the control sequence being parsed
+    uint8_t vt100_parameter_count; //Number of parameters in vt100_parameters
+    bool vt100_private_sequence; //True if the control sequence has a private marker or intermediate bytes
+    QByteArray dat_in_pending; //Incomplete UTF-8 character at the end of the parsed received data
+    AutScrollback history; //All received output, the document only holds the most recent part of it
+    quint64 document_first_line; //History line number of the first line in the document
+    quint64 document_end_line; //History line number after the last line in the document if a window of older lines is shown, 0 if the document runs up to the newest data
+    AutSearch history_search; //Background search of the history
+    AutSearchSnapshot history_snapshot; //Copy of the history being searched
+    quint64 history_snapshot_first; //History line number of the first line in the snapshot
+    QVector<quint64> history_hits; //History line numbers of matches from the last search
+    qint32 history_hit_index; //Index of the currently selected match
 
 public:
     bool mbLocalEcho; //True if local echo is enabled
@@ -0,0 +1,350 @@
+/******************************************************************************
+** Copyright (C) 2024 Jamie M.
+**
+** Project: AuTerm
+**
+** Module: AutScrollback.cpp
+**
+** Notes:
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include "AutScrollback.h"
+#include <string.h>
+
+/******************************************************************************/
+// Constants
+/******************************************************************************/
+//Default amount of memory used for history (16MiB)
+const quint32 scrollback_size_default = 16 * 1024 * 1024;
+//Portion of the memory given to text, the remainder is split between line and run entries
+const quint32 scrollback_text_share = 2;
+//Maximum number of distinct formats, once reached further new formats use the default
+const quint16 scrollback_max_formats = 4096;
+
+/******************************************************************************/
+// Local Functions or Private Members
+/******************************************************************************/
+AutScrollback::AutScrollback()
+{
+    text = nullptr;
+    lines = nullptr;
+    runs = nullptr;
+    set_size(scrollback_size_default);
+}
+
+AutScrollback::~AutScrollback()
+{
+    delete[] text;
+    delete[] lines;
+    delete[] runs;
+}
+
+void AutScrollback::set_size(quint32 size)
+{
+    //Half of the memory is used for text, a quarter each for lines and runs
+    delete[] text;
+    delete[] lines;
+    delete[] runs;
+
+    text_capacity = size / scrollback_text_share;
+    line_capacity = (size - text_capacity) / 2 / sizeof(scrollback_line_t);
+    run_capacity = (size - text_capacity) / 2 / sizeof(scrollback_run_t);
+
+    if (text_capacity < 1024)
+    {
+        text_capacity = 1024;
+    }
+
+    if (line_capacity < 16)
+    {
+        line_capacity = 16;
+    }
+
+    if (run_capacity < 16)
+    {
+        run_capacity = 16;
+    }
+
+    text = new char[text_capacity];
+    lines = new scrollback_line_t[line_capacity];
+    runs = new scrollback_run_t[run_capacity];
+    clear();
+}
+
+void AutScrollback::clear()
+{
+    text_head = 0;
+    run_head = 0;
+    line_first = 0;
+    line_end = 0;
+    formats.clear();
+    formats.append(QTextCharFormat());
+    last_format = 0;
+    new_line();
+}
+
+quint16 AutScrollback::format_index(const QTextCharFormat &format)
+{
+    //Formats change rarely, so check the last used one before searching the palette
+    if (formats.at(last_format) == format)
+    {
+        return last_format;
+    }
+
+    int index = formats.indexOf(format);
+
+    if (index == -1)
+    {
+        if (formats.length() >= scrollback_max_formats)
+        {
+            return 0;
+        }
+
+        formats.append(format);
+        index = formats.length() - 1;
+    }
+
+    last_format = (quint16)index;
+
+    return last_format;
+}
+
+void AutScrollback::evict_line()
+{
+    //Oldest line is dropped, its text and runs are reclaimed as the head moves past them
+    ++line_first;
+}
+
+void AutScrollback::new_line()
+{
+    scrollback_line_t *entry;
+
+    if ((line_end - line_first) >= line_capacity)
+    {
+        evict_line();
+    }
+
+    entry = line(line_end);
+    entry->text_start = text_head;
+    entry->text_length = 0;
+    entry->run_start = run_head;
+    entry->run_count = 0;
+    ++line_end;
+}
+
+void AutScrollback::append_bytes(const char *data, quint32 length, quint16 format)
+{
+    while (length > 0)
+    {
+        scrollback_line_t *current = line(line_end - 1);
+        quint32 chunk = length;
+        quint32 index;
+        quint32 contiguous;
+
+        //A single line is never allowed to take more than half of a ring, split it instead
+        if ((current->text_length + chunk) > (text_capacity / 2))
+        {
+            if (current->text_length > 0)
+            {
+                new_line();
+                continue;
+            }
+
+            chunk = text_capacity / 2;
+        }
+
+        if (current->run_count >= (run_capacity / 2))
+        {
+            new_line();
+            continue;
+        }
+
+        //Drop the oldest lines until there is space for the new data
+        while (line_first < (line_end - 1) && (text_head + chunk - line(line_first)->text_start) > text_capacity)
+        {
+            evict_line();
+        }
+
+        if (current->run_count == 0 || runs[(current->run_start + current->run_count - 1) % run_capacity].format != format)
+        {
+            while (line_first < (line_end - 1) && (run_head + 1 - line(line_first)->run_start) > run_capacity)
+            {
+                evict_line();
+            }
+
+            runs[run_head % run_capacity].length = 0;
+            runs[run_head % run_capacity].format = format;
+            ++run_head;
+            ++current->run_count;
+        }
+
+        runs[(current->run_start + current->run_count - 1) % run_capacity].length += chunk;
+        current->text_length += chunk;
+        length -= chunk;
+
+        while (chunk > 0)
+        {
+            index = text_head % text_capacity;
+            contiguous = qMin(chunk, text_capacity - index);
+            memcpy(&text[index], data, contiguous);
+            text_head += contiguous;
+            data += contiguous;
+            chunk -= contiguous;
+        }
+    }
+}
+
+void AutScrollback::append(const QString &data, const QTextCharFormat &format)
+{
+    //Newlines end the current line, they are not stored
+    QByteArray utf8 = data.toUtf8();
+    quint16 index = format_index(format);
+    const char *start = utf8.constData();
+    const char *end = start + utf8.length();
+
+    while (start < end)
+    {
+        const char *newline = (const char *)memchr(start, '\n', (end - start));
+
+        if (newline == nullptr)
+        {
+            append_bytes(start, (end - start), index);
+            break;
+        }
+
+        append_bytes(start, (newline - start), index);
+        new_line();
+        start = newline + 1;
+    }
+}
+
+void AutScrollback::copy_text(quint64 start, quint32 length, char *destination) const
+{
+    while (length > 0)
+    {
+        quint32 index = start % text_capacity;
+        quint32 contiguous = qMin(length, text_capacity - index);
+
+        memcpy(destination, &text[index], contiguous);
+        destination += contiguous;
+        start += contiguous;
+        length -= contiguous;
+    }
+}
+
+QString AutScrollback::line_text(quint64 line_number) const
+{
+    const scrollback_line_t *entry;
+    QByteArray data;
+
+    if (line_number < line_first || line_number >= line_end)
+    {
+        return QString();
+    }
+
+    entry = line(line_number);
+    data.resize(entry->text_length);
+    copy_text(entry->text_start, entry->text_length, data.data());
+
+    return QString::fromUtf8(data);
+}
+
+void AutScrollback::render(quint64 first, quint64 count, QTextCursor *cursor) const
+{
+    //Inserts lines, with their formats, at the cursor. Each line is followed by a newline
+    QByteArray data;
+
+    if (first < line_first)
+    {
+        count -= qMin(count, (line_first - first));
+        first = line_first;
+    }
+
+    if (first >= line_end)
+    {
+        return;
+    }
+
+    if ((first + count) > line_end)
+    {
+        count = line_end - first;
+    }
+
+    while (count > 0)
+    {
+        const scrollback_line_t *entry = line(first);
+        quint64 position = entry->text_start;
+        quint32 i = 0;
+
+        while (i < entry->run_count)
+        {
+            const scrollback_run_t *run = &runs[(entry->run_start + i) % run_capacity];
+
+            data.resize(run->length);
+            copy_text(position, run->length, data.data());
+            cursor->insertText(QString::fromUtf8(data), formats.at(run->format));
+            position += run->length;
+            ++i;
+        }
+
+        cursor->insertText("\n", formats.at(0));
+        ++first;
+        --count;
+    }
+}
+
+void AutScrollback::snapshot(QByteArray *data, QVector<qint64> *line_starts) const
+{
+    //Copies the text of all lines, line_starts is given the start offset of each line followed by the end offset
+    quint64 current = line_first;
+    qint64 size = 0;
+
+    line_starts->clear();
+
+    if (line_first == line_end)
+    {
+        data->clear();
+        line_starts->append(0);
+        return;
+    }
+
+    data->resize((int)qMin(text_head - line(line_first)->text_start, (quint64)text_capacity));
+    line_starts->reserve((int)(line_end - line_first + 1));
+
+    while (current < line_end)
+    {
+        const scrollback_line_t *entry = line(current);
+
+        line_starts->append(size);
+        copy_text(entry->text_start, entry->text_length, data->data() + size);
+        size += entry->text_length;
+        ++current;
+    }
+
+    line_starts->append(size);
+}
+
+quint64 AutScrollback::memory_usage() const
+{
+    return (quint64)text_capacity + (quint64)line_capacity * sizeof(scrollback_line_t) + (quint64)run_capacity * sizeof(scrollback_run_t);
+}
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
@@ -0,0 +1,107 @@
+/******************************************************************************
+** Copyright (C) 2024 Jamie M.
+**
+** Project: AuTerm
+**
+** Module: AutScrollback.h
+**
+** Notes:   Compact store of terminal output history, text is held in a byte
+**          ring with run-length encoded formats per line
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+#ifndef AUTSCROLLBACK_H
+#define AUTSCROLLBACK_H
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include <QString>
+#include <QVector>
+#include <QTextCharFormat>
+#include <QTextCursor>
+
+/******************************************************************************/
+// Forward declaration of Class, Struct & Unions
+/******************************************************************************/
+struct scrollback_line_t {
+    quint64 text_start; //Absolute offset of the first byte in the text ring
+    quint64 run_start; //Absolute index of the first run in the run ring
+    quint32 text_length;
+    quint32 run_count;
+};
+
+struct scrollback_run_t {
+    quint32 length; //Number of (UTF-8) bytes this format applies to
+    quint16 format; //Index into the format palette
+};
+
+/******************************************************************************/
+// Class definitions
+/******************************************************************************/
+class AutScrollback
+{
+public:
+    AutScrollback();
+    ~AutScrollback();
+    void set_size(quint32 size);
+    void clear();
+    void append(const QString &text, const QTextCharFormat &format);
+    quint64 first_line() const
+    {
+        return line_first;
+    }
+    quint64 end_line() const
+    {
+        return line_end;
+    }
+    QString line_text(quint64 line) const;
+    void render(quint64 first, quint64 count, QTextCursor *cursor) const;
+    void snapshot(QByteArray *data, QVector<qint64> *line_starts) const;
+    quint64 memory_usage() const;
+
+private:
+    void append_bytes(const char *data, quint32 length, quint16 format);
+    void new_line();
+    void evict_line();
+    quint16 format_index(const QTextCharFormat &format);
+    void copy_text(quint64 start, quint32 length, char *destination) const;
+    scrollback_line_t *line(quint64 line)
+    {
+        return &lines[line % line_capacity];
+    }
+    const scrollback_line_t *line(quint64 line) const
+    {
+        return &lines[line % line_capacity];
+    }
+
+    char *text;
+    quint32 text_capacity;
+    quint64 text_head;
+    scrollback_line_t *lines;
+    quint32 line_capacity;
+    quint64 line_first;
+    quint64 line_end;
+    scrollback_run_t *runs;
+    quint32 run_capacity;
+    quint64 run_head;
+    QVector<QTextCharFormat> formats;
+    quint16 last_format;
+};
+
+#endif // AUTSCROLLBACK_H
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
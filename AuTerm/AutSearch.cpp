@@ -0,0 +1,212 @@
+/******************************************************************************
+** Copyright (C) 2024 Jamie M.
+**
+** Project: AuTerm
+**
+** Module: AutSearch.cpp
+**
+** Notes:
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include "AutSearch.h"
+#include <QElapsedTimer>
+
+/******************************************************************************/
+// Constants
+/******************************************************************************/
+//Matches are sent in batches, once this many have been found or the interval has passed
+const qint32 search_batch_matches = 4096;
+const qint64 search_batch_interval_ms = 200;
+//Time to wait for more lines when the source is still being built
+const unsigned long search_source_wait_ms = 20;
+//The search stops once this many lines have matched
+const qint64 search_max_matches = 10000000;
+
+/******************************************************************************/
+// Local Functions or Private Members
+/******************************************************************************/
+AutSearchSnapshot::AutSearchSnapshot()
+{
+    line_starts.append(0);
+}
+
+void AutSearchSnapshot::clear()
+{
+    data.clear();
+    line_starts.clear();
+    line_starts.append(0);
+}
+
+QByteArray *AutSearchSnapshot::get_data()
+{
+    return &data;
+}
+
+QVector<qint64> *AutSearchSnapshot::get_line_starts()
+{
+    return &line_starts;
+}
+
+qint64 AutSearchSnapshot::search_line_count(bool *complete)
+{
+    *complete = true;
+    return line_starts.length() - 1;
+}
+
+QByteArray AutSearchSnapshot::search_line_data(qint64 line)
+{
+    return QByteArray::fromRawData(data.constData() + line_starts.at(line), (line_starts.at(line + 1) - line_starts.at(line)));
+}
+
+AutSearch::AutSearch(QObject *parent) : QThread(parent)
+{
+    search_source = nullptr;
+    use_expression = false;
+    search_id = 0;
+    cancelling.storeRelease(0);
+    qRegisterMetaType<QVector<qint64>>("QVector<qint64>");
+}
+
+AutSearch::~AutSearch()
+{
+    cancel();
+}
+
+bool AutSearch::start_search(AutSearchSource *source, QString pattern, bool regex, bool case_sensitive)
+{
+    //Starts a new search, any existing search is cancelled first. Returns false if the pattern is not valid
+    cancel();
+
+    if (pattern.isEmpty() == true)
+    {
+        return false;
+    }
+
+    if (regex == false && case_sensitive == true)
+    {
+        //Plain text can be matched on the raw bytes without converting each line
+        literal_matcher.setPattern(pattern.toUtf8());
+        use_expression = false;
+    }
+    else
+    {
+        expression.setPattern(regex == true ? pattern : QRegularExpression::escape(pattern));
+        expression.setPatternOptions(case_sensitive == true ? QRegularExpression::NoPatternOption : QRegularExpression::CaseInsensitiveOption);
+
+        if (expression.isValid() == false)
+        {
+            return false;
+        }
+
+        use_expression = true;
+    }
+
+    search_source = source;
+    ++search_id;
+    cancelling.storeRelease(0);
+    this->start(QThread::LowPriority);
+
+    return true;
+}
+
+void AutSearch::cancel()
+{
+    //Stops the search and waits for the thread to exit
+    if (this->isRunning() == true)
+    {
+        cancelling.storeRelease(1);
+        this->wait();
+    }
+}
+
+quint32 AutSearch::get_search_id()
+{
+    return search_id;
+}
+
+void AutSearch::run()
+{
+    QVector<qint64> batch;
+    QElapsedTimer batch_timer;
+    qint64 line = 0;
+    qint64 matches = 0;
+    qint64 count;
+    bool complete = false;
+
+    batch.reserve(search_batch_matches);
+    batch_timer.start();
+
+    while (cancelling.loadAcquire() == 0 && matches < search_max_matches)
+    {
+        count = search_source->search_line_count(&complete);
+
+        if (line >= count)
+        {
+            if (complete == true)
+            {
+                break;
+            }
+
+            //Source is still being built, wait for more lines
+            QThread::msleep(search_source_wait_ms);
+            continue;
+        }
+
+        while (line < count && cancelling.loadAcquire() == 0)
+        {
+            QByteArray line_data = search_source->search_line_data(line);
+            bool matched;
+
+            if (use_expression == true)
+            {
+                matched = expression.match(QString::fromUtf8(line_data)).hasMatch();
+            }
+            else
+            {
+                matched = (literal_matcher.indexIn(line_data) != -1);
+            }
+
+            if (matched == true)
+            {
+                batch.append(line);
+                ++matches;
+            }
+
+            ++line;
+
+            if (batch.length() >= search_batch_matches || (batch.isEmpty() == false && batch_timer.elapsed() >= search_batch_interval_ms))
+            {
+                //Report progress
+                emit search_results(search_id, batch);
+                batch.clear();
+                batch_timer.restart();
+            }
+        }
+    }
+
+    if (batch.isEmpty() == false)
+    {
+        emit search_results(search_id, batch);
+    }
+
+    emit search_finished(search_id, matches, (cancelling.loadAcquire() != 0));
+}
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
@@ -0,0 +1,99 @@
+/******************************************************************************
+** Copyright (C) 2024 Jamie M.
+**
+** Project: AuTerm
+**
+** Module: AutSearch.h
+**
+** Notes:
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+#ifndef AUTSEARCH_H
+#define AUTSEARCH_H
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include <QThread>
+#include <QByteArray>
+#include <QByteArrayMatcher>
+#include <QRegularExpression>
+#include <QVector>
+#include <QAtomicInteger>
+
+/******************************************************************************/
+// Class definitions
+/******************************************************************************/
+//Source of lines to search, the functions are called from the search thread
+class AutSearchSource
+{
+public:
+    virtual ~AutSearchSource()
+    {
+    }
+    //Returns the number of lines available, complete is set to false if more lines are still being added
+    virtual qint64 search_line_count(bool *complete) = 0;
+    virtual QByteArray search_line_data(qint64 line) = 0;
+};
+
+//Copy of lines which can be searched in the background whilst the original keeps changing
+class AutSearchSnapshot : public AutSearchSource
+{
+public:
+    AutSearchSnapshot();
+    void clear();
+    QByteArray *get_data();
+    QVector<qint64> *get_line_starts();
+    qint64 search_line_count(bool *complete) override;
+    QByteArray search_line_data(qint64 line) override;
+
+private:
+    QByteArray data; //Text of all lines, without line endings
+    QVector<qint64> line_starts; //Offset of the start of each line in data, followed by the end offset
+};
+
+//Searches a source line by line in a background thread, reporting matching lines as they are found
+class AutSearch : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit AutSearch(QObject *parent = nullptr);
+    ~AutSearch();
+    bool start_search(AutSearchSource *source, QString pattern, bool regex, bool case_sensitive);
+    void cancel();
+    quint32 get_search_id();
+
+signals:
+    void search_results(quint32 id, QVector<qint64> lines);
+    void search_finished(quint32 id, qint64 matches, bool cancelled);
+
+protected:
+    void run() override;
+
+private:
+    AutSearchSource *search_source; //Lines being searched
+    QByteArrayMatcher literal_matcher; //Used for case sensitive plain text searches
+    QRegularExpression expression; //Used for regular expression and case insensitive searches
+    bool use_expression; //True if expression is used instead of literal_matcher
+    QAtomicInteger<int> cancelling; //Set to stop the search
+    quint32 search_id; //Increased for each search, so results from a cancelled search which are still queued can be ignored
+};
+
+#endif // AUTSEARCH_H
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
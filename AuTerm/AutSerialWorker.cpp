@@ -0,0 +1,465 @@
+/******************************************************************************
+** Copyright (C) 2024 Jamie M.
+**
+** Project: AuTerm
+**
+** Module: AutSerialWorker.cpp
+**
+** Notes:
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include "AutSerialWorker.h"
+
+/******************************************************************************/
+// Constants
+/******************************************************************************/
+//Size of the buffer between the I/O thread and the GUI thread
+const quint32 ReceiveBufferSize = 4 * 1024 * 1024;
+//Limit of data held inside QSerialPort, once reached the OS buffer (and flow control, if enabled) holds off the sender
+const qint64 PortReadBufferSize = 64 * 1024;
+
+/******************************************************************************/
+// Local Functions or Private Members
+/******************************************************************************/
+AutSerialWorker::AutSerialWorker(QObject *parent) : QObject(parent), receive_buffer(ReceiveBufferSize)
+{
+    port_open.storeRelease(0);
+    notify_pending.storeRelease(0);
+    reading_stalled.storeRelease(0);
+    high_water.storeRelease(0);
+    stalls.storeRelease(0);
+    stalled_bytes.storeRelease(0);
+    receive_capture = nullptr;
+    port_baud_rate = 0;
+    port_data_bits = QSerialPort::Data8;
+    port_stop_bits = QSerialPort::OneStop;
+    port_parity = QSerialPort::NoParity;
+
+    qRegisterMetaType<QSerialPort::SerialPortError>("QSerialPort::SerialPortError");
+
+    port = new QSerialPort();
+    port->setReadBufferSize(PortReadBufferSize);
+    port->moveToThread(&io_thread);
+
+    //Reading is done in the I/O thread, other signals are passed on to the GUI thread
+    connect(port, &QSerialPort::readyRead, port, [this]() { read_port(); });
+    connect(port, &QSerialPort::errorOccurred, this, &AutSerialWorker::errorOccurred);
+    connect(port, &QSerialPort::bytesWritten, this, &AutSerialWorker::bytesWritten);
+    connect(port, &QSerialPort::aboutToClose, this, &AutSerialWorker::aboutToClose);
+
+    io_thread.setObjectName("AutSerialWorker");
+    io_thread.start();
+}
+
+AutSerialWorker::~AutSerialWorker()
+{
+    if (port_open.loadAcquire() != 0)
+    {
+        close();
+    }
+
+    io_thread.quit();
+    io_thread.wait();
+
+    //Thread has finished so the port can be deleted from here
+    delete port;
+}
+
+void AutSerialWorker::read_port()
+{
+    //Runs in the I/O thread, moves as much data as will fit from the port into the ring buffer
+    while (port->bytesAvailable() > 0)
+    {
+        quint32 contiguous;
+        char *destination = receive_buffer.write_pointer(&contiguous);
+        qint64 read_size;
+
+        if (contiguous == 0)
+        {
+            //Buffer is full, stop reading until the GUI thread has caught up
+            if (reading_stalled.testAndSetOrdered(0, 1) == true)
+            {
+                ++stalls;
+            }
+
+            stalled_bytes.storeRelease(port->bytesAvailable());
+
+            //The GUI thread may have drained the buffer (and found nothing to resume) before the flag was set
+            receive_buffer.write_pointer(&contiguous);
+
+            if (contiguous > 0)
+            {
+                reading_stalled.testAndSetOrdered(1, 0);
+                stalled_bytes.storeRelease(0);
+                continue;
+            }
+
+            break;
+        }
+
+        read_size = port->read(destination, qMin((qint64)contiguous, port->bytesAvailable()));
+
+        if (read_size <= 0)
+        {
+            break;
+        }
+
+        if (receive_capture != nullptr && receive_capture->is_open() == true)
+        {
+            receive_capture->add_record(CAPTURE_DIRECTION_RX, destination, (qint32)read_size);
+        }
+
+        receive_buffer.commit_write((quint32)read_size);
+    }
+
+    quint32 used = receive_buffer.used();
+
+    if (used > high_water.loadAcquire())
+    {
+        high_water.storeRelease(used);
+    }
+
+    //Only one notification is outstanding at any time, the GUI thread drains everything when it runs
+    if (used > 0 && notify_pending.testAndSetOrdered(0, 1) == true)
+    {
+        emit readyRead();
+    }
+}
+
+void AutSerialWorker::resume_reading()
+{
+    //Called from the GUI thread after reading, restarts the I/O thread if it stopped because the buffer was full
+    if (reading_stalled.testAndSetOrdered(1, 0) == true)
+    {
+        stalled_bytes.storeRelease(0);
+        QMetaObject::invokeMethod(port, [this]() { read_port(); }, Qt::QueuedConnection);
+    }
+}
+
+void AutSerialWorker::set_capture(AutCapture *capture)
+{
+    //Received data is captured when it is read from the port, rather than when the GUI thread gets to it. Once
+    //this returns, the previous capture object is no longer used
+    run_on_io_thread([this, capture]() { receive_capture = capture; });
+}
+
+void AutSerialWorker::setPortName(const QString &name)
+{
+    port_name = name;
+    run_on_io_thread([this, name]() { port->setPortName(name); });
+}
+
+QString AutSerialWorker::portName() const
+{
+    return port_name;
+}
+
+bool AutSerialWorker::setBaudRate(qint32 baud_rate)
+{
+    bool result = false;
+
+    port_baud_rate = baud_rate;
+    run_on_io_thread([&]() { result = port->setBaudRate(baud_rate); });
+
+    return result;
+}
+
+qint32 AutSerialWorker::baudRate() const
+{
+    return port_baud_rate;
+}
+
+bool AutSerialWorker::setDataBits(QSerialPort::DataBits data_bits)
+{
+    bool result = false;
+
+    port_data_bits = data_bits;
+    run_on_io_thread([&]() { result = port->setDataBits(data_bits); });
+
+    return result;
+}
+
+QSerialPort::DataBits AutSerialWorker::dataBits() const
+{
+    return port_data_bits;
+}
+
+bool AutSerialWorker::setStopBits(QSerialPort::StopBits stop_bits)
+{
+    bool result = false;
+
+    port_stop_bits = stop_bits;
+    run_on_io_thread([&]() { result = port->setStopBits(stop_bits); });
+
+    return result;
+}
+
+QSerialPort::StopBits AutSerialWorker::stopBits() const
+{
+    return port_stop_bits;
+}
+
+bool AutSerialWorker::setParity(QSerialPort::Parity parity)
+{
+    bool result = false;
+
+    port_parity = parity;
+    run_on_io_thread([&]() { result = port->setParity(parity); });
+
+    return result;
+}
+
+QSerialPort::Parity AutSerialWorker::parity() const
+{
+    return port_parity;
+}
+
+bool AutSerialWorker::setFlowControl(QSerialPort::FlowControl flow_control)
+{
+    bool result = false;
+
+    run_on_io_thread([&]() { result = port->setFlowControl(flow_control); });
+
+    return result;
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+bool AutSerialWorker::open(QIODeviceBase::OpenMode mode)
+#else
+bool AutSerialWorker::open(QIODevice::OpenMode mode)
+#endif
+{
+    bool result = false;
+
+    //Discard anything left over from a previous connection
+    receive_buffer.clear();
+    notify_pending.storeRelease(0);
+    reading_stalled.storeRelease(0);
+    high_water.storeRelease(0);
+    stalls.storeRelease(0);
+    stalled_bytes.storeRelease(0);
+
+    run_on_io_thread([&]() { result = port->open(mode); });
+    port_open.storeRelease(result == true ? 1 : 0);
+
+    return result;
+}
+
+void AutSerialWorker::close()
+{
+    run_on_io_thread([&]() { port->close(); });
+    port_open.storeRelease(0);
+}
+
+bool AutSerialWorker::isOpen() const
+{
+    return (port_open.loadAcquire() != 0);
+}
+
+QString AutSerialWorker::errorString()
+{
+    QString result;
+
+    run_on_io_thread([&]() { result = port->errorString(); });
+
+    return result;
+}
+
+qint64 AutSerialWorker::write(const QByteArray &data)
+{
+    if (port_open.loadAcquire() == 0)
+    {
+        return -1;
+    }
+
+    //Writes are queued to the I/O thread in order, completion is reported by bytesWritten()
+    QMetaObject::invokeMethod(port, [this, data]() { port->write(data); }, Qt::QueuedConnection);
+
+    return data.size();
+}
+
+qint64 AutSerialWorker::bytesAvailable() const
+{
+    return receive_buffer.used();
+}
+
+QByteArray AutSerialWorker::peek(qint64 maxlen)
+{
+    QByteArray data;
+    qint64 available = receive_buffer.used();
+
+    if (maxlen > available)
+    {
+        maxlen = available;
+    }
+
+    data.resize((int)maxlen);
+    data.resize((int)receive_buffer.peek(data.data(), (quint32)maxlen));
+
+    return data;
+}
+
+QByteArray AutSerialWorker::read(qint64 maxlen)
+{
+    QByteArray data;
+    qint64 available;
+
+    //Clear before reading so that data which arrives during the read raises a new notification
+    notify_pending.storeRelease(0);
+    available = receive_buffer.used();
+
+    if (maxlen > available)
+    {
+        maxlen = available;
+    }
+
+    data.resize((int)maxlen);
+    data.resize((int)receive_buffer.read(data.data(), (quint32)maxlen));
+    resume_reading();
+
+    return data;
+}
+
+QByteArray AutSerialWorker::readAll()
+{
+    return read(receive_buffer.capacity());
+}
+
+qint64 AutSerialWorker::read_into(char *data, qint64 maxlen)
+{
+    //Same as read() but into a buffer owned by the caller
+    qint64 length;
+
+    notify_pending.storeRelease(0);
+    length = receive_buffer.read(data, (quint32)qMin(maxlen, (qint64)receive_buffer.capacity()));
+    resume_reading();
+
+    return length;
+}
+
+const char *AutSerialWorker::peek_pointer(qint64 *length)
+{
+    //Returns received data in place in the ring buffer, which is only valid until consume() is called. The data may wrap
+    //around the end of the ring buffer, so fewer bytes than bytesAvailable() can be returned
+    quint32 contiguous;
+    const char *data = receive_buffer.read_pointer(&contiguous);
+
+    *length = contiguous;
+    return data;
+}
+
+qint64 AutSerialWorker::consume(qint64 length)
+{
+    //Removes data which has been accessed with peek_pointer()
+    qint64 available;
+
+    notify_pending.storeRelease(0);
+    available = receive_buffer.used();
+
+    if (length > available)
+    {
+        length = available;
+    }
+
+    receive_buffer.consume((quint32)length);
+    resume_reading();
+
+    return length;
+}
+
+bool AutSerialWorker::clear(QSerialPort::Directions directions)
+{
+    bool result = false;
+
+    run_on_io_thread([&]() { result = port->clear(directions); });
+
+    if (directions & QSerialPort::Input)
+    {
+        receive_buffer.clear();
+        notify_pending.storeRelease(0);
+        resume_reading();
+    }
+
+    return result;
+}
+
+bool AutSerialWorker::setBreakEnabled(bool set)
+{
+    bool result = false;
+
+    run_on_io_thread([&]() { result = port->setBreakEnabled(set); });
+
+    return result;
+}
+
+bool AutSerialWorker::setRequestToSend(bool set)
+{
+    bool result = false;
+
+    run_on_io_thread([&]() { result = port->setRequestToSend(set); });
+
+    return result;
+}
+
+bool AutSerialWorker::setDataTerminalReady(bool set)
+{
+    bool result = false;
+
+    run_on_io_thread([&]() { result = port->setDataTerminalReady(set); });
+
+    return result;
+}
+
+QSerialPort::PinoutSignals AutSerialWorker::pinoutSignals()
+{
+    QSerialPort::PinoutSignals result = QSerialPort::NoSignal;
+
+    run_on_io_thread([&]() { result = port->pinoutSignals(); });
+
+    return result;
+}
+
+quint32 AutSerialWorker::buffer_size() const
+{
+    return receive_buffer.capacity();
+}
+
+quint32 AutSerialWorker::buffered_bytes() const
+{
+    return receive_buffer.used();
+}
+
+quint32 AutSerialWorker::buffer_high_water() const
+{
+    return high_water.loadAcquire();
+}
+
+quint64 AutSerialWorker::buffer_stalls() const
+{
+    return stalls.loadAcquire();
+}
+
+quint64 AutSerialWorker::buffer_stalled_bytes() const
+{
+    return stalled_bytes.loadAcquire();
+}
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
@@ -0,0 +1,134 @@
+/******************************************************************************
+** Copyright (C) 2024 Jamie M.
+**
+** Project: AuTerm
+**
+** Module: AutSerialWorker.h
+**
+** Notes:   Owns the serial port on a dedicated I/O thread, received data is
+**          passed to the GUI thread through a lock-free ring buffer
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+#ifndef AUTSERIALWORKER_H
+#define AUTSERIALWORKER_H
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include <QObject>
+#include <QThread>
+#include <QSerialPort>
+#include <QAtomicInteger>
+#include "AutRingBuffer.h"
+#include "AutCapture.h"
+
+/******************************************************************************/
+// Class definitions
+/******************************************************************************/
+//Provides the subset of the QSerialPort interface used by the main window, calls which need the
+//port itself are run on the I/O thread, received data is read from the ring buffer directly
+class AutSerialWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AutSerialWorker(QObject *parent = nullptr);
+    ~AutSerialWorker();
+    void setPortName(const QString &name);
+    QString portName() const;
+    bool setBaudRate(qint32 baud_rate);
+    qint32 baudRate() const;
+    bool setDataBits(QSerialPort::DataBits data_bits);
+    QSerialPort::DataBits dataBits() const;
+    bool setStopBits(QSerialPort::StopBits stop_bits);
+    QSerialPort::StopBits stopBits() const;
+    bool setParity(QSerialPort::Parity parity);
+    QSerialPort::Parity parity() const;
+    bool setFlowControl(QSerialPort::FlowControl flow_control);
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    bool open(QIODeviceBase::OpenMode mode);
+#else
+    bool open(QIODevice::OpenMode mode);
+#endif
+    void close();
+    bool isOpen() const;
+    QString errorString();
+    qint64 write(const QByteArray &data);
+    qint64 bytesAvailable() const;
+    QByteArray peek(qint64 maxlen);
+    QByteArray read(qint64 maxlen);
+    QByteArray readAll();
+    qint64 read_into(char *data, qint64 maxlen);
+    const char *peek_pointer(qint64 *length);
+    qint64 consume(qint64 length);
+    bool clear(QSerialPort::Directions directions = QSerialPort::AllDirections);
+    bool setBreakEnabled(bool set = true);
+    bool setRequestToSend(bool set);
+    bool setDataTerminalReady(bool set);
+    QSerialPort::PinoutSignals pinoutSignals();
+    void set_capture(AutCapture *capture);
+
+    //Receive buffer statistics
+    quint32 buffer_size() const;
+    quint32 buffered_bytes() const;
+    quint32 buffer_high_water() const;
+    quint64 buffer_stalls() const;
+    quint64 buffer_stalled_bytes() const;
+
+signals:
+    void readyRead();
+    void errorOccurred(QSerialPort::SerialPortError error);
+    void bytesWritten(qint64 bytes);
+    void aboutToClose();
+
+private:
+    void read_port();
+    void resume_reading();
+    template <typename T> void run_on_io_thread(T function)
+    {
+        if (QThread::currentThread() == &io_thread)
+        {
+            function();
+        }
+        else
+        {
+            QMetaObject::invokeMethod(port, function, Qt::BlockingQueuedConnection);
+        }
+    }
+
+    QThread io_thread;
+    QSerialPort *port;
+    AutRingBuffer receive_buffer;
+    QAtomicInt port_open;
+    QAtomicInt notify_pending;
+    QAtomicInt reading_stalled;
+    QAtomicInteger<quint32> high_water;
+    QAtomicInteger<quint64> stalls;
+    QAtomicInteger<quint64> stalled_bytes;
+    AutCapture *receive_capture; //Received data is added to this as it is read, only used on the I/O thread
+
+    //Settings are only changed from the GUI thread, copies are kept so reading them does not block
+    QString port_name;
+    qint32 port_baud_rate;
+    QSerialPort::DataBits port_data_bits;
+    QSerialPort::StopBits port_stop_bits;
+    QSerialPort::Parity port_parity;
+};
+
+#endif // AUTSERIALWORKER_H
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
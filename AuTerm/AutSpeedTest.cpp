@@ -0,0 +1,684 @@
+/******************************************************************************
+** Copyright (C) 2024 Jamie M.
+**
+** Project: AuTerm
+**
+** Module: AutSpeedTest.cpp
+**
+** Notes:
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include "AutSpeedTest.h"
+#include <QCommandLineParser>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QFile>
+#include <QtAlgorithms>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+/******************************************************************************/
+// Constants
+/******************************************************************************/
+//Minimum size (in bytes) of the repeated packet data used to check received data
+const qint32 speed_test_pattern_size = 65536;
+//Size (in bytes) of the blocks received data is compared in
+const qint32 speed_test_compare_block_size = 64;
+//Default time between throughput samples
+const qint32 speed_test_sample_interval_default = 1000;
+//Sent data is not tracked for latency once this much is outstanding (e.g. if nothing is being echoed back)
+const qint32 speed_test_max_sent_marks = 65536;
+//Latency values up to this are stored exactly, above it each power of two is split into latency_sub_buckets buckets
+const qint32 latency_exact_buckets = 32;
+const qint32 latency_sub_bucket_bits = 4;
+const qint32 latency_sub_buckets = (1 << latency_sub_bucket_bits);
+//Number of bytes of data shown before a mismatch in verify_error()
+const qint32 speed_test_error_context = 5;
+//Defaults for the command line speed test, which match the speed test tab defaults
+const QString headless_pattern_default = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ1234567890";
+const qint32 headless_duration_default = 10;
+const qint32 headless_minimum_buffer_default = 384;
+const qint32 headless_chunk_size_default = 512;
+const qint32 headless_pattern_minimum_length = 4;
+
+/******************************************************************************/
+// Local Functions or Private Members
+/******************************************************************************/
+AutSpeedTest::AutSpeedTest(QObject *parent) : QObject(parent)
+{
+    receive_index = 0;
+    minimum_buffer = headless_minimum_buffer_default;
+    chunk_size = headless_chunk_size_default;
+    buffer_count = 0;
+    report_errors = false;
+    running = false;
+    measure_latency = false;
+    stopped_ms = 0;
+    bytes_sent = 0;
+    bytes_received = 0;
+    packets_sent = 0;
+    packets_received = 0;
+    packets_good = 0;
+    packets_bad = 0;
+    latency_count = 0;
+    latency_max_us = 0;
+
+    sample_timer.setInterval(speed_test_sample_interval_default);
+    connect(&sample_timer, SIGNAL(timeout()), this, SLOT(take_sample()));
+}
+
+void AutSpeedTest::set_pattern(const QByteArray &pattern)
+{
+    //Sets the packet data, or no data for a throughput-only test
+    match_data = pattern;
+    match_pattern.clear();
+
+    if (match_data.isEmpty() == false)
+    {
+        //Repeat the packet data so that several packets can be checked with one compare
+        match_pattern = match_data.repeated(qMax(2, (speed_test_pattern_size / match_data.length()) + 1));
+    }
+}
+
+const QByteArray &AutSpeedTest::get_pattern()
+{
+    return match_data;
+}
+
+void AutSpeedTest::set_buffer_sizes(qint32 minimum_buffer_size, qint32 send_chunk_size)
+{
+    minimum_buffer = minimum_buffer_size;
+    chunk_size = send_chunk_size;
+}
+
+void AutSpeedTest::set_sample_interval(qint32 interval_ms)
+{
+    sample_timer.setInterval(interval_ms);
+}
+
+void AutSpeedTest::set_report_errors(bool enabled)
+{
+    report_errors = enabled;
+}
+
+void AutSpeedTest::start(bool round_trip)
+{
+    //Resets all statistics and starts timing, round_trip should be set if sent data will be received back
+    receive_index = 0;
+    buffer_count = 0;
+    bytes_sent = 0;
+    bytes_received = 0;
+    packets_sent = 0;
+    packets_received = 0;
+    packets_good = 0;
+    packets_bad = 0;
+    stopped_ms = 0;
+    error_positions.fill(0, match_data.length());
+    sent_marks.clear();
+    latency_buckets.clear();
+    latency_count = 0;
+    latency_max_us = 0;
+    samples.clear();
+    measure_latency = round_trip;
+    running = true;
+    elapsed.start();
+    sample_timer.start();
+}
+
+void AutSpeedTest::stop()
+{
+    if (running == false)
+    {
+        return;
+    }
+
+    sample_timer.stop();
+    take_sample();
+    stopped_ms = elapsed.elapsed();
+    sent_marks.clear();
+    running = false;
+}
+
+bool AutSpeedTest::is_running()
+{
+    return running;
+}
+
+void AutSpeedTest::send_data(qint32 max_length)
+{
+    //Sends whole packets. It's OK to send less than the maximum length but not more, unless none fit
+    qint32 send_times = 1;
+
+    if (running == false || match_data.isEmpty() == true)
+    {
+        return;
+    }
+
+    if (max_length > match_data.length())
+    {
+        send_times = (max_length / match_data.length());
+    }
+
+    buffer_count += (qint64)send_times * match_data.length();
+    packets_sent += send_times;
+
+    if (measure_latency == true && sent_marks.length() < speed_test_max_sent_marks)
+    {
+        //Latency is measured from when this data is sent until the last byte of it is received
+        speed_test_sent_mark_t mark;
+        mark.offset = bytes_sent + (quint64)buffer_count;
+        mark.elapsed_ns = elapsed.nsecsElapsed();
+        sent_marks.enqueue(mark);
+    }
+
+    emit transmit(send_times == 1 ? match_data : match_data.repeated(send_times));
+}
+
+void AutSpeedTest::data_written(qint64 length)
+{
+    //Transport has written data, send more if the buffer is running low
+    bytes_sent += length;
+    buffer_count -= length;
+
+    if (buffer_count <= minimum_buffer)
+    {
+        send_data(chunk_size);
+    }
+}
+
+void AutSpeedTest::data_received(const QByteArray &data)
+{
+    //Checks received data in place against the repeated packet data, data is not kept after returning so it can be
+    //a QByteArray::fromRawData() wrapper around the transport receive buffer
+    qint32 position = 0;
+    qint32 length = data.length();
+    const char *received = data.constData();
+
+    bytes_received += length;
+
+    while (sent_marks.isEmpty() == false && sent_marks.head().offset <= bytes_received)
+    {
+        add_latency((quint64)(elapsed.nsecsElapsed() - sent_marks.dequeue().elapsed_ns) / 1000ULL);
+    }
+
+    if (match_data.isEmpty() == true)
+    {
+        return;
+    }
+
+    while (position < length)
+    {
+        //Data to check, up to the end of the repeated packet data
+        qint32 size_to_test = match_pattern.length() - receive_index;
+        qint32 mismatch;
+        qint32 completed;
+
+        if (size_to_test > (length - position))
+        {
+            size_to_test = length - position;
+        }
+
+        mismatch = find_mismatch((received + position), (match_pattern.constData() + receive_index), size_to_test);
+        completed = (receive_index + mismatch) / match_data.length();
+
+        //All packets before a mismatch are good
+        packets_good += completed;
+        packets_received += completed;
+
+        if (mismatch == size_to_test)
+        {
+            //Good
+            position += size_to_test;
+            receive_index = (receive_index + size_to_test) % match_data.length();
+        }
+        else
+        {
+            //Bad, find where the failed packet starts in the received data
+            qint32 packet_start = position;
+            qint32 packet_index = receive_index;
+            qint32 packet_offset;
+            qint32 next_start;
+
+            if (completed > 0)
+            {
+                packet_start += (completed * match_data.length()) - receive_index;
+                packet_index = 0;
+            }
+
+            packet_offset = position + mismatch - packet_start;
+            ++packets_bad;
+            ++packets_received;
+            ++error_positions[packet_index + packet_offset];
+
+            if (report_errors == true)
+            {
+                qint32 context = (packet_offset > speed_test_error_context ? packet_offset - speed_test_error_context : 0);
+                //Received data is copied as it may be in place in the transport receive buffer
+                emit verify_error(QByteArray((received + packet_start + context), (length - packet_start - context)), match_data.mid(packet_index + context));
+            }
+
+            //Search for start character (ignoring first character)
+            next_start = data.indexOf(match_data.at(0), packet_start + 1);
+            position = (next_start == -1 ? length : next_start);
+            receive_index = 0;
+        }
+    }
+}
+
+qint32 AutSpeedTest::find_mismatch(const char *received, const char *expected, qint32 length)
+{
+    //Returns the offset of the first byte which differs, or length if all bytes match. Blocks are
+    //compared with memcmp (which uses vector instructions where available), then only a failing
+    //block is checked byte by byte
+    qint32 offset = 0;
+
+    while ((length - offset) >= speed_test_compare_block_size && memcmp((received + offset), (expected + offset), speed_test_compare_block_size) == 0)
+    {
+        offset += speed_test_compare_block_size;
+    }
+
+    while (offset < length && received[offset] == expected[offset])
+    {
+        ++offset;
+    }
+
+    return offset;
+}
+
+qint64 AutSpeedTest::get_elapsed_ms()
+{
+    return (running == true ? elapsed.elapsed() : stopped_ms);
+}
+
+quint64 AutSpeedTest::get_bytes_sent()
+{
+    return bytes_sent;
+}
+
+quint64 AutSpeedTest::get_bytes_received()
+{
+    return bytes_received;
+}
+
+quint64 AutSpeedTest::get_packets_sent()
+{
+    return packets_sent;
+}
+
+quint64 AutSpeedTest::get_packets_received()
+{
+    return packets_received;
+}
+
+quint64 AutSpeedTest::get_packets_good()
+{
+    return packets_good;
+}
+
+quint64 AutSpeedTest::get_packets_bad()
+{
+    return packets_bad;
+}
+
+const QVector<quint32> &AutSpeedTest::get_error_positions()
+{
+    return error_positions;
+}
+
+const QVector<speed_test_sample_t> &AutSpeedTest::get_samples()
+{
+    return samples;
+}
+
+void AutSpeedTest::take_sample()
+{
+    speed_test_sample_t sample;
+
+    sample.elapsed_ms = elapsed.elapsed();
+    sample.bytes_sent = bytes_sent;
+    sample.bytes_received = bytes_received;
+    sample.packets_good = packets_good;
+    sample.packets_bad = packets_bad;
+    samples.append(sample);
+}
+
+qint32 AutSpeedTest::latency_bucket(quint64 latency_us)
+{
+    //Log-linear bucket, accurate to within 1/latency_sub_buckets of the value
+    qint32 shift;
+
+    if (latency_us < (quint64)latency_exact_buckets)
+    {
+        return (qint32)latency_us;
+    }
+
+    shift = (63 - (qint32)qCountLeadingZeroBits(latency_us)) - latency_sub_bucket_bits;
+
+    return ((shift + 1) * latency_sub_buckets) + (qint32)((latency_us >> shift) - latency_sub_buckets);
+}
+
+quint64 AutSpeedTest::latency_bucket_value(qint32 bucket)
+{
+    //Returns the highest value which is put in a bucket
+    qint32 shift;
+
+    if (bucket < latency_exact_buckets)
+    {
+        return (quint64)bucket;
+    }
+
+    shift = (bucket / latency_sub_buckets) - 1;
+
+    return ((((quint64)(bucket % latency_sub_buckets) + latency_sub_buckets + 1) << shift) - 1);
+}
+
+void AutSpeedTest::add_latency(quint64 latency_us)
+{
+    qint32 bucket = latency_bucket(latency_us);
+
+    if (bucket >= latency_buckets.length())
+    {
+        latency_buckets.resize(bucket + 1);
+    }
+
+    ++latency_buckets[bucket];
+    ++latency_count;
+
+    if (latency_us > latency_max_us)
+    {
+        latency_max_us = latency_us;
+    }
+}
+
+quint64 AutSpeedTest::get_latency_count()
+{
+    return latency_count;
+}
+
+quint64 AutSpeedTest::get_latency_percentile(double percentile)
+{
+    //Returns the round-trip latency (in us) which the given percentage of measurements are at or below
+    quint64 target;
+    quint64 total = 0;
+    qint32 i = 0;
+
+    if (latency_count == 0)
+    {
+        return 0;
+    }
+
+    target = (quint64)ceil((percentile / 100.0) * (double)latency_count);
+
+    if (target == 0)
+    {
+        target = 1;
+    }
+
+    while (i < latency_buckets.length())
+    {
+        total += latency_buckets.at(i);
+
+        if (total >= target)
+        {
+            return qMin(latency_bucket_value(i), latency_max_us);
+        }
+
+        ++i;
+    }
+
+    return latency_max_us;
+}
+
+QByteArray AutSpeedTest::results_json()
+{
+    //Summary, latency, error positions and throughput series
+    QJsonObject results;
+    QJsonObject latency;
+    QJsonArray positions;
+    QJsonArray series;
+    qint64 duration = get_elapsed_ms();
+    qint32 i = 0;
+    quint64 previous_sent = 0;
+    quint64 previous_received = 0;
+    qint64 previous_ms = 0;
+
+    results.insert("duration_ms", duration);
+    results.insert("packet_size", match_data.length());
+    results.insert("bytes_sent", (qint64)bytes_sent);
+    results.insert("bytes_received", (qint64)bytes_received);
+    results.insert("packets_sent", (qint64)packets_sent);
+    results.insert("packets_received", (qint64)packets_received);
+    results.insert("packets_good", (qint64)packets_good);
+    results.insert("packets_bad", (qint64)packets_bad);
+    results.insert("tx_bytes_per_second", (duration > 0 ? (double)bytes_sent * 1000.0 / (double)duration : 0.0));
+    results.insert("rx_bytes_per_second", (duration > 0 ? (double)bytes_received * 1000.0 / (double)duration : 0.0));
+
+    latency.insert("count", (qint64)latency_count);
+    latency.insert("p50", (qint64)get_latency_percentile(50.0));
+    latency.insert("p99", (qint64)get_latency_percentile(99.0));
+    latency.insert("p99.9", (qint64)get_latency_percentile(99.9));
+    latency.insert("max", (qint64)latency_max_us);
+    results.insert("latency_us", latency);
+
+    while (i < error_positions.length())
+    {
+        if (error_positions.at(i) > 0)
+        {
+            QJsonObject position;
+            position.insert("offset", i);
+            position.insert("errors", (qint64)error_positions.at(i));
+            positions.append(position);
+        }
+        ++i;
+    }
+    results.insert("error_positions", positions);
+
+    i = 0;
+    while (i < samples.length())
+    {
+        const speed_test_sample_t &sample = samples.at(i);
+        qint64 interval = sample.elapsed_ms - previous_ms;
+        QJsonObject entry;
+
+        entry.insert("elapsed_ms", sample.elapsed_ms);
+        entry.insert("bytes_sent", (qint64)sample.bytes_sent);
+        entry.insert("bytes_received", (qint64)sample.bytes_received);
+        entry.insert("tx_bytes_per_second", (interval > 0 ? (double)(sample.bytes_sent - previous_sent) * 1000.0 / (double)interval : 0.0));
+        entry.insert("rx_bytes_per_second", (interval > 0 ? (double)(sample.bytes_received - previous_received) * 1000.0 / (double)interval : 0.0));
+        entry.insert("packets_good", (qint64)sample.packets_good);
+        entry.insert("packets_bad", (qint64)sample.packets_bad);
+        series.append(entry);
+
+        previous_ms = sample.elapsed_ms;
+        previous_sent = sample.bytes_sent;
+        previous_received = sample.bytes_received;
+        ++i;
+    }
+    results.insert("series", series);
+
+    return QJsonDocument(results).toJson();
+}
+
+QByteArray AutSpeedTest::results_csv()
+{
+    //Throughput series, one row per sample. The summary and latency are included on every row so the file is a single table
+    QByteArray output("elapsed_ms,bytes_sent,bytes_received,tx_bytes_per_second,rx_bytes_per_second,packets_good,packets_bad,latency_p50_us,latency_p99_us,latency_p99.9_us\n");
+    QByteArray latency = QByteArray(",").append(QByteArray::number(get_latency_percentile(50.0))).append(',').append(QByteArray::number(get_latency_percentile(99.0))).append(',').append(QByteArray::number(get_latency_percentile(99.9))).append('\n');
+    qint32 i = 0;
+    quint64 previous_sent = 0;
+    quint64 previous_received = 0;
+    qint64 previous_ms = 0;
+
+    while (i < samples.length())
+    {
+        const speed_test_sample_t &sample = samples.at(i);
+        qint64 interval = sample.elapsed_ms - previous_ms;
+
+        output.append(QByteArray::number(sample.elapsed_ms)).append(',');
+        output.append(QByteArray::number(sample.bytes_sent)).append(',');
+        output.append(QByteArray::number(sample.bytes_received)).append(',');
+        output.append(QByteArray::number(interval > 0 ? (sample.bytes_sent - previous_sent) * 1000ULL / (quint64)interval : 0ULL)).append(',');
+        output.append(QByteArray::number(interval > 0 ? (sample.bytes_received - previous_received) * 1000ULL / (quint64)interval : 0ULL)).append(',');
+        output.append(QByteArray::number(sample.packets_good)).append(',');
+        output.append(QByteArray::number(sample.packets_bad));
+        output.append(latency);
+
+        previous_ms = sample.elapsed_ms;
+        previous_sent = sample.bytes_sent;
+        previous_received = sample.bytes_received;
+        ++i;
+    }
+
+    return output;
+}
+
+AutSpeedTestEcho::AutSpeedTestEcho(AutSpeedTest *test) : QObject(test)
+{
+    speed_test = test;
+    connect(speed_test, SIGNAL(transmit(QByteArray)), this, SLOT(transmit(QByteArray)));
+}
+
+void AutSpeedTestEcho::transmit(QByteArray data)
+{
+    //Data is returned from the event loop, as a transport would, so sending more data does not recurse
+    if (send_buffer.isEmpty() == true)
+    {
+        QTimer::singleShot(0, this, SLOT(deliver()));
+    }
+
+    send_buffer.append(data);
+}
+
+void AutSpeedTestEcho::deliver()
+{
+    QByteArray data = send_buffer;
+
+    send_buffer.clear();
+    speed_test->data_written(data.length());
+    speed_test->data_received(data);
+}
+
+bool AutSpeedTestHeadless::requested(int argc, char *argv[])
+{
+    //Checked before the application object is created, so that no windows are needed
+    int i = 1;
+
+    while (i < argc)
+    {
+        if (strcmp(argv[i], "--speed-test") == 0)
+        {
+            return true;
+        }
+        ++i;
+    }
+
+    return false;
+}
+
+int AutSpeedTestHeadless::run(QCoreApplication *application)
+{
+    QCommandLineParser parser;
+    QCommandLineOption option_speed_test("speed-test", "Run a speed test against the echo loopback and output the results, without showing any windows.");
+    QCommandLineOption option_duration("duration", "Test length in seconds (default " + QString::number(headless_duration_default) + ").", "seconds", QString::number(headless_duration_default));
+    QCommandLineOption option_pattern("pattern", "Packet data to send.", "data", headless_pattern_default);
+    QCommandLineOption option_buffer("buffer", "Minimum transmit buffer size in bytes (default " + QString::number(headless_minimum_buffer_default) + ").", "bytes", QString::number(headless_minimum_buffer_default));
+    QCommandLineOption option_chunk("chunk", "Maximum bytes to send at once (default " + QString::number(headless_chunk_size_default) + ").", "bytes", QString::number(headless_chunk_size_default));
+    QCommandLineOption option_interval("interval", "Time between throughput samples in ms (default " + QString::number(speed_test_sample_interval_default) + ").", "ms", QString::number(speed_test_sample_interval_default));
+    QCommandLineOption option_format("format", "Output format, json or csv (default json).", "format", "json");
+    QCommandLineOption option_output("output", "File to write the results to (default standard output).", "file");
+    qint32 duration;
+
+    parser.setApplicationDescription("AuTerm speed test");
+    parser.addHelpOption();
+    parser.addOption(option_speed_test);
+    parser.addOption(option_duration);
+    parser.addOption(option_pattern);
+    parser.addOption(option_buffer);
+    parser.addOption(option_chunk);
+    parser.addOption(option_interval);
+    parser.addOption(option_format);
+    parser.addOption(option_output);
+    parser.process(*application);
+
+    duration = parser.value(option_duration).toInt();
+
+    if (duration <= 0 || parser.value(option_pattern).toUtf8().length() < headless_pattern_minimum_length || (parser.value(option_format) != "json" && parser.value(option_format) != "csv"))
+    {
+        fprintf(stderr, "Error: duration must be at least 1 second, pattern must be at least %d bytes and format must be json or csv.\n", headless_pattern_minimum_length);
+        return 1;
+    }
+
+    output_file = parser.value(option_output);
+    output_csv = (parser.value(option_format) == "csv");
+    exit_code = 0;
+
+    speed_test = new AutSpeedTest(this);
+    new AutSpeedTestEcho(speed_test);
+    speed_test->set_pattern(parser.value(option_pattern).toUtf8());
+    speed_test->set_buffer_sizes(qMax(1, parser.value(option_buffer).toInt()), qMax(1, parser.value(option_chunk).toInt()));
+    speed_test->set_sample_interval(qMax(1, parser.value(option_interval).toInt()));
+    speed_test->start(true);
+    speed_test->send_data(qMax(1, parser.value(option_chunk).toInt()));
+
+    QTimer::singleShot(duration * 1000, this, SLOT(finish()));
+
+    application->exec();
+
+    return exit_code;
+}
+
+void AutSpeedTestHeadless::finish()
+{
+    //Outputs the results, the exit code is non-zero if any packets were bad so it can be used in scripts
+    QByteArray results;
+    QFile output;
+    bool opened;
+
+    speed_test->stop();
+    results = (output_csv == true ? speed_test->results_csv() : speed_test->results_json());
+
+    if (output_file.isEmpty() == true)
+    {
+        opened = output.open(stdout, QIODevice::WriteOnly);
+    }
+    else
+    {
+        output.setFileName(output_file);
+        opened = output.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    }
+
+    if (opened == false || output.write(results) != results.length())
+    {
+        fprintf(stderr, "Error: unable to write results.\n");
+        exit_code = 1;
+    }
+    else if (speed_test->get_packets_bad() > 0 || speed_test->get_packets_good() == 0)
+    {
+        exit_code = 1;
+    }
+
+    output.close();
+    QCoreApplication::exit(exit_code);
+}
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
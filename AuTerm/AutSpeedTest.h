@@ -0,0 +1,172 @@
+/******************************************************************************
+** Copyright (C) 2024 Jamie M.
+**
+** Project: AuTerm
+**
+** Module: AutSpeedTest.h
+**
+** Notes:
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+#ifndef AUTSPEEDTEST_H
+#define AUTSPEEDTEST_H
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include <QObject>
+#include <QByteArray>
+#include <QVector>
+#include <QQueue>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QCoreApplication>
+
+/******************************************************************************/
+// Forward declaration of Class, Struct & Unions
+/******************************************************************************/
+//Totals at a point during a speed test, used for the throughput over time series
+struct speed_test_sample_t {
+    qint64 elapsed_ms;
+    quint64 bytes_sent;
+    quint64 bytes_received;
+    quint64 packets_good;
+    quint64 packets_bad;
+};
+
+//Marks the time at which the end of a block of sent data was written, for round-trip latency
+struct speed_test_sent_mark_t {
+    quint64 offset;
+    qint64 elapsed_ns;
+};
+
+/******************************************************************************/
+// Class definitions
+/******************************************************************************/
+//Speed test engine, with no user interface. Data to send is emitted with transmit() and the owner passes
+//back written byte counts and received data, so it can be driven by any transport
+class AutSpeedTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AutSpeedTest(QObject *parent = nullptr);
+    void set_pattern(const QByteArray &pattern);
+    const QByteArray &get_pattern();
+    void set_buffer_sizes(qint32 minimum_buffer_size, qint32 send_chunk_size);
+    void set_sample_interval(qint32 interval_ms);
+    void set_report_errors(bool enabled);
+    void start(bool round_trip);
+    void stop();
+    bool is_running();
+    void send_data(qint32 max_length);
+    void data_written(qint64 length);
+    void data_received(const QByteArray &data);
+    qint64 get_elapsed_ms();
+    quint64 get_bytes_sent();
+    quint64 get_bytes_received();
+    quint64 get_packets_sent();
+    quint64 get_packets_received();
+    quint64 get_packets_good();
+    quint64 get_packets_bad();
+    const QVector<quint32> &get_error_positions();
+    quint64 get_latency_count();
+    quint64 get_latency_percentile(double percentile);
+    const QVector<speed_test_sample_t> &get_samples();
+    QByteArray results_json();
+    QByteArray results_csv();
+    static qint32 find_mismatch(const char *received, const char *expected, qint32 length);
+
+signals:
+    //Data which should be written to the transport
+    void transmit(QByteArray data);
+    //Emitted for each mismatch when error reporting is enabled, with the data from just before the mismatch onwards
+    void verify_error(QByteArray received, QByteArray expected);
+
+private slots:
+    void take_sample();
+
+private:
+    void add_latency(quint64 latency_us);
+    static qint32 latency_bucket(quint64 latency_us);
+    static quint64 latency_bucket_value(qint32 bucket);
+
+    QByteArray match_data; //Packet data, empty for a throughput-only test
+    QByteArray match_pattern; //Packet data repeated, so many packets can be checked with one compare
+    qint32 receive_index; //Offset in the packet of the next byte expected
+    qint32 minimum_buffer; //Data is sent when the transmit buffer has fewer than this many bytes
+    qint32 chunk_size; //Maximum number of bytes to send at once
+    qint64 buffer_count; //Number of bytes sent which have not been written yet
+    bool report_errors; //True if verify_error() should be emitted
+    bool running; //True between start() and stop()
+    bool measure_latency; //True if sent data is expected to come back
+    QElapsedTimer elapsed; //Time since the test started
+    qint64 stopped_ms; //Length of the test once stopped
+    quint64 bytes_sent;
+    quint64 bytes_received;
+    quint64 packets_sent;
+    quint64 packets_received;
+    quint64 packets_good;
+    quint64 packets_bad;
+    QVector<quint32> error_positions; //Number of errors at each offset in the packet
+    QQueue<speed_test_sent_mark_t> sent_marks; //Sent data which has not come back yet
+    QVector<quint64> latency_buckets; //Round-trip latency histogram
+    quint64 latency_count; //Number of latency measurements
+    quint64 latency_max_us; //Largest latency measured
+    QVector<speed_test_sample_t> samples; //Throughput over time
+    QTimer sample_timer; //Adds to samples
+};
+
+//Loopback used for running the speed test without a device, behaves the same as the echo transport plugin
+class AutSpeedTestEcho : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AutSpeedTestEcho(AutSpeedTest *test);
+
+private slots:
+    void transmit(QByteArray data);
+    void deliver();
+
+private:
+    AutSpeedTest *speed_test;
+    QByteArray send_buffer;
+};
+
+//Runs a speed test from the command line and writes the results as JSON or CSV
+class AutSpeedTestHeadless : public QObject
+{
+    Q_OBJECT
+
+public:
+    static bool requested(int argc, char *argv[]);
+    int run(QCoreApplication *application);
+
+private slots:
+    void finish();
+
+private:
+    AutSpeedTest *speed_test;
+    QString output_file;
+    bool output_csv;
+    int exit_code;
+};
+
+#endif // AUTSPEEDTEST_H
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
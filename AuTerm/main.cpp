@@ -28,12 +28,45 @@
 #include "AutMainWindow.h"
 #include <QApplication>
 #include <QCommandLineParser>
+#include <stdio.h>
+#include <string.h>
 #if TARGET_OS_MAC
 #include <QStyleFactory>
 #endif
 
 int main(int argc, char *argv[])
 {
+    if (argc > 1 && strcmp(argv[1], "--convert-capture") == 0)
+    {
+        //Convert a binary capture file to text from the command line without any windows
+        QCoreApplication convert_application(argc, argv);
+
+        if (argc != 4)
+        {
+            fprintf(stderr, "Usage: AuTerm --convert-capture <capture file> <output text file>\n");
+            return 1;
+        }
+
+        if (AutCaptureReader::convert_to_text(QString::fromLocal8Bit(argv[2]), QString::fromLocal8Bit(argv[3])) == false)
+        {
+            fprintf(stderr, "Error: unable to read capture file or write output file.\n");
+            return 1;
+        }
+
+        return 0;
+    }
+
+#ifndef SKIPSPEEDTEST
+    if (AutSpeedTestHeadless::requested(argc, argv) == true)
+    {
+        //Run a speed test from the command line without any windows
+        QCoreApplication headless_application(argc, argv);
+        AutSpeedTestHeadless headless;
+
+        return headless.run(&headless_application);
+    }
+#endif
+
     QApplication a(argc, argv);
 #if TARGET_OS_MAC
     //Fix for Mac to stop bad styling
@@ -0,0 +1,221 @@
+/******************************************************************************
+** Copyright (C) 2024 Jamie M.
+**
+** Project: AuTerm
+**
+** Module:  test_autescape.cpp
+**
+** Notes:
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include <QtTest>
+#include "AutEscape.h"
+
+/******************************************************************************/
+// Constants
+/******************************************************************************/
+//Number of times all byte values are repeated in the buffer tests
+const int test_repeats = 16;
+
+/******************************************************************************/
+// Class definitions
+/******************************************************************************/
+class test_autescape : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void replace_unprintable_single_bytes_data();
+    void replace_unprintable_single_bytes();
+    void replace_unprintable_all_bytes_data();
+    void replace_unprintable_all_bytes();
+    void replace_unprintable_keeps_1b();
+    void to_hex_single_bytes();
+    void to_hex_all_bytes();
+    void to_hex_lowercase();
+
+private:
+    static void previous_replace_unprintable(QByteArray *data, bool include_1b);
+    static void previous_to_hex(QByteArray *data);
+    static QByteArray all_bytes(int repeats);
+};
+
+/******************************************************************************/
+// Local Functions or Private Members
+/******************************************************************************/
+void test_autescape::previous_replace_unprintable(QByteArray *data, bool include_1b)
+{
+    //Previous implementation of AutEscape::replace_unprintable(), the output of the current one must match it exactly
+    int32_t i = data->length() - 1;
+
+    while (i >= 0)
+    {
+        uint8_t current = (uint8_t)data->at(i);
+
+        if (current < 0x08 || (current >= 0x0b && current <= 0x0c) || (current >= 0x0e && current <= 0x0f))
+        {
+            data->replace(i, 1, QString("\\0").append(QString::number(current, 16)).toUtf8());
+        }
+        else if ((current >= 0x10 && current <= 0x1a) || (current >= 0x1c && current <= 0x1f && (include_1b == true || current != 0x1b)))
+        {
+            data->replace(i, 1, QString("\\").append(QString::number(current, 16)).toUtf8());
+        }
+
+        --i;
+    }
+}
+
+void test_autescape::previous_to_hex(QByteArray *data)
+{
+    //Previous implementation of AutEscape::to_hex(), the output of the current one must match it exactly
+    int32_t i = data->length() - 1;
+
+    while (i >= 0)
+    {
+        uint8_t current = (uint8_t)data->at(i);
+
+        if (current <= 0x0f)
+        {
+            data->replace(i, 1, QString("0").append(QString::number(current, 16)).toUtf8());
+        }
+        else
+        {
+            data->replace(i, 1, QString::number(current, 16).toUtf8());
+        }
+
+        --i;
+    }
+}
+
+QByteArray test_autescape::all_bytes(int repeats)
+{
+    //Returns every byte value from 0x00 to 0xff, repeated the given number of times
+    QByteArray data;
+    int i = 0;
+
+    data.reserve(repeats * 256);
+
+    while (i < (repeats * 256))
+    {
+        data.append((char)(i & 0xff));
+        ++i;
+    }
+
+    return data;
+}
+
+void test_autescape::replace_unprintable_single_bytes_data()
+{
+    QTest::addColumn<bool>("include_1b");
+
+    QTest::newRow("without 0x1b") << false;
+    QTest::newRow("with 0x1b") << true;
+}
+
+void test_autescape::replace_unprintable_single_bytes()
+{
+    QFETCH(bool, include_1b);
+    int i = 0;
+
+    while (i <= 0xff)
+    {
+        QByteArray expected(1, (char)i);
+        QByteArray data(1, (char)i);
+
+        previous_replace_unprintable(&expected, include_1b);
+        AutEscape::replace_unprintable(&data, include_1b);
+        QVERIFY2(data == expected, qPrintable(QString("Byte 0x%1").arg(i, 2, 16, QChar('0'))));
+        ++i;
+    }
+}
+
+void test_autescape::replace_unprintable_all_bytes_data()
+{
+    QTest::addColumn<bool>("include_1b");
+
+    QTest::newRow("without 0x1b") << false;
+    QTest::newRow("with 0x1b") << true;
+}
+
+void test_autescape::replace_unprintable_all_bytes()
+{
+    //Escaped and printable bytes next to each other, the output is filled in place so this checks nothing is overwritten
+    QFETCH(bool, include_1b);
+    QByteArray expected = all_bytes(test_repeats);
+    QByteArray data = expected;
+
+    previous_replace_unprintable(&expected, include_1b);
+    AutEscape::replace_unprintable(&data, include_1b);
+    QCOMPARE(data, expected);
+}
+
+void test_autescape::replace_unprintable_keeps_1b()
+{
+    //0x1b is the start of terminal escape sequences, it has never been escaped, even with include_1b set
+    QByteArray data("\x1b[0m\x01");
+
+    AutEscape::replace_unprintable(&data, false);
+    QCOMPARE(data, QByteArray("\x1b[0m\\01"));
+
+    data = QByteArray("\x1b[0m\x01");
+    AutEscape::replace_unprintable(&data, true);
+    QCOMPARE(data, QByteArray("\x1b[0m\\01"));
+}
+
+void test_autescape::to_hex_single_bytes()
+{
+    int i = 0;
+
+    while (i <= 0xff)
+    {
+        QByteArray expected(1, (char)i);
+        QByteArray data(1, (char)i);
+
+        previous_to_hex(&expected);
+        AutEscape::to_hex(&data);
+        QVERIFY2(data == expected, qPrintable(QString("Byte 0x%1").arg(i, 2, 16, QChar('0'))));
+        ++i;
+    }
+}
+
+void test_autescape::to_hex_all_bytes()
+{
+    QByteArray expected = all_bytes(test_repeats);
+    QByteArray data = expected;
+
+    previous_to_hex(&expected);
+    AutEscape::to_hex(&data);
+    QCOMPARE(data, expected);
+}
+
+void test_autescape::to_hex_lowercase()
+{
+    QByteArray data("\x00\x0a\xab\xff", 4);
+
+    AutEscape::to_hex(&data);
+    QCOMPARE(data, QByteArray("000aabff"));
+}
+
+QTEST_APPLESS_MAIN(test_autescape)
+
+#include "test_autescape.moc"
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
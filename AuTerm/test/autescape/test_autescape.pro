@@ -0,0 +1,23 @@
+# Test that the AutEscape output matches the previous implementation, run with: qmake && make check
+
+include(../../../AuTerm-includes.pri)
+
+QT += core testlib
+QT -= gui
+
+TEMPLATE = app
+TARGET = test_autescape
+
+CONFIG += c++17
+CONFIG += console
+CONFIG += testcase
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+    ../../AutEscape.cpp \
+    test_autescape.cpp
+
+HEADERS += \
+    ../../AutEscape.h
@@ -0,0 +1,6 @@
+# AuTerm tests, run with: qmake && make check
+
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    autescape
@@ -109,23 +109,32 @@ qint64 plugin_echo_transport::bytesAvailable() const
 
 QByteArray plugin_echo_transport::peek(qint64 maxlen)
 {
-    return send_buffer.left(maxlen);
+    return send_buffer.peek(maxlen);
 }
 
 QByteArray plugin_echo_transport::read(qint64 maxlen)
 {
-    QByteArray data = send_buffer.left(maxlen);
-
-    send_buffer.remove(0, maxlen);
-    return data;
+    return send_buffer.read(maxlen);
 }
 
 QByteArray plugin_echo_transport::readAll()
 {
-    QByteArray data = send_buffer;
+    return send_buffer.read_all();
+}
 
-    send_buffer.clear();
-    return data;
+qint64 plugin_echo_transport::read_into(char *data, qint64 maxlen)
+{
+    return send_buffer.read_into(data, maxlen);
+}
+
+const char *plugin_echo_transport::peek_pointer(qint64 *length)
+{
+    return send_buffer.peek_pointer(length);
+}
+
+qint64 plugin_echo_transport::consume(qint64 length)
+{
+    return send_buffer.consume(length);
 }
 
 bool plugin_echo_transport::clear(QSerialPort::Directions directions)
@@ -60,6 +60,9 @@ public:
     QByteArray peek(qint64 maxlen) override;
     QByteArray read(qint64 maxlen) override;
     QByteArray readAll() override;
+    qint64 read_into(char *data, qint64 maxlen) override;
+    const char *peek_pointer(qint64 *length) override;
+    qint64 consume(qint64 length) override;
     bool clear(QSerialPort::Directions directions = QSerialPort::AllDirections) override;
     QSerialPort::PinoutSignals pinoutSignals() override;
     QString to_error_string(int error) override;
@@ -75,7 +78,7 @@ signals:
 private:
     QMainWindow *parent_window;
     bool device_connected;
-    QByteArray send_buffer;
+    AutTransportReceiveBuffer send_buffer;
 };
 
 #endif // PLUGIN_ECHO_TRANSPORT_H
@@ -22,11 +22,53 @@
 *******************************************************************************/
 #include "crc16.h"
 
-uint16_t crc16(const QByteArray *src, size_t i, size_t len, uint16_t polynomial,
-               uint16_t initial_value, bool pad)
+/* Polynomial which has lookup tables generated at compile time */
+#define CRC16_TABLE_POLYNOMIAL 0x1021U
+
+/* Number of bytes processed per iteration by the slice-by-8 loop */
+#define CRC16_SLICE_SIZE 8
+
+struct crc16_tables_t {
+    uint16_t table[CRC16_SLICE_SIZE][256];
+};
+
+/*
+ * table[0][n] is the CRC of byte n, table[k][n] is the CRC of byte n followed
+ * by k zero bytes, which allows 8 input bytes to be folded in at once.
+ */
+static constexpr crc16_tables_t crc16_generate_tables(uint16_t polynomial)
+{
+    crc16_tables_t tables = {};
+
+    for (size_t n = 0; n < 256; n++) {
+        uint16_t crc = (uint16_t)(n << 8);
+
+        for (size_t b = 0; b < 8; b++) {
+            crc = (crc & 0x8000U) ? (uint16_t)((crc << 1U) ^ polynomial) : (uint16_t)(crc << 1U);
+        }
+
+        tables.table[0][n] = crc;
+    }
+
+    for (size_t k = 1; k < CRC16_SLICE_SIZE; k++) {
+        for (size_t n = 0; n < 256; n++) {
+            uint16_t previous = tables.table[k - 1][n];
+
+            tables.table[k][n] = (uint16_t)(previous << 8) ^ tables.table[0][previous >> 8];
+        }
+    }
+
+    return tables;
+}
+
+static constexpr crc16_tables_t crc16_tables = crc16_generate_tables(CRC16_TABLE_POLYNOMIAL);
+
+static uint16_t crc16_bitwise(const uint8_t *src, size_t len, uint16_t polynomial,
+                              uint16_t initial_value, bool pad)
 {
     uint16_t crc = initial_value;
     size_t padding = pad ? sizeof(crc) : 0;
+    size_t i = 0;
     size_t b;
 
     /* src length + padding (if required) */
@@ -39,7 +81,7 @@ uint16_t crc16(const QByteArray *src, size_t i, size_t len, uint16_t polynomial,
 
             /* choose input bytes or implicit trailing zeros */
             if (i < len) {
-                crc |= !!(src->at(i) & (0x80U >> b));
+                crc |= !!(src[i] & (0x80U >> b));
             }
 
             if (divide != 0U) {
@@ -51,3 +93,66 @@ uint16_t crc16(const QByteArray *src, size_t i, size_t len, uint16_t polynomial,
 
     return crc;
 }
+
+uint16_t crc16(const uint8_t *src, size_t len, uint16_t polynomial,
+               uint16_t initial_value, bool pad)
+{
+    const uint16_t (*table)[256] = crc16_tables.table;
+    uint16_t crc = initial_value;
+    size_t i = 0;
+
+    if (polynomial != CRC16_TABLE_POLYNOMIAL) {
+        return crc16_bitwise(src, len, polynomial, initial_value, pad);
+    }
+
+    if (pad == false) {
+        /*
+         * Without padding the last 16 bits of input are not shifted through
+         * the register, feed the data in byte by byte and let each byte
+         * reduce the one 2 bytes before it.
+         */
+        for (i = 0; i < len; i++) {
+            crc = (uint16_t)((crc << 8) | src[i]) ^ table[0][crc >> 8];
+        }
+
+        return crc;
+    }
+
+    /*
+     * With 2 bytes of zero padding the result is identical to the
+     * conventional (non-augmented) CRC of the input, provided the initial
+     * value is first shifted through the register as the padding would be.
+     * This allows the slice-by-8 form to be used.
+     */
+    crc = table[0][crc >> 8];
+    crc = (uint16_t)(crc << 8) ^ table[0][(crc >> 8) ^ (initial_value & 0xffU)];
+
+    while ((len - i) >= CRC16_SLICE_SIZE) {
+        crc = table[7][src[i] ^ (crc >> 8)] ^
+              table[6][src[i + 1] ^ (crc & 0xffU)] ^
+              table[5][src[i + 2]] ^
+              table[4][src[i + 3]] ^
+              table[3][src[i + 4]] ^
+              table[2][src[i + 5]] ^
+              table[1][src[i + 6]] ^
+              table[0][src[i + 7]];
+        i += CRC16_SLICE_SIZE;
+    }
+
+    while (i < len) {
+        crc = (uint16_t)(crc << 8) ^ table[0][(crc >> 8) ^ src[i]];
+        ++i;
+    }
+
+    return crc;
+}
+
+uint16_t crc16(const QByteArray *src, size_t i, size_t len, uint16_t polynomial,
+               uint16_t initial_value, bool pad)
+{
+    if (i >= len) {
+        return crc16((const uint8_t *)nullptr, 0, polynomial, initial_value, pad);
+    }
+
+    return crc16((const uint8_t *)src->constData() + i, len - i, polynomial, initial_value, pad);
+}
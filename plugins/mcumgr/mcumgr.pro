@@ -23,6 +23,7 @@ SOURCES += \
     plugin_mcumgr.cpp \
     smp_error.cpp \
     smp_group_enum_mgmt.cpp \
+    smp_fs_sync.cpp \
     smp_group_fs_mgmt.cpp \
     smp_group_os_mgmt.cpp \
     smp_group_settings_mgmt.cpp \
@@ -46,6 +47,7 @@ HEADERS += \
     smp_error.h \
     smp_group_array.h \
     smp_group_enum_mgmt.h \
+    smp_fs_sync.h \
     smp_group_fs_mgmt.h \
     smp_group_os_mgmt.h \
     smp_group_settings_mgmt.h \
@@ -22,6 +22,7 @@
 **
 *******************************************************************************/
 #include <QFileDialog>
+#include <QDir>
 #include <QStandardItemModel>
 #include <QRegularExpression>
 #include <QClipboard>
@@ -70,6 +71,7 @@ void plugin_mcumgr::setup(QMainWindow *main_window)
     smp_groups.stat_mgmt = new smp_group_stat_mgmt(processor);
     smp_groups.zephyr_mgmt = new smp_group_zephyr_mgmt(processor);
     smp_groups.enum_mgmt = new smp_group_enum_mgmt(processor);
+    fs_sync = new smp_fs_sync(smp_groups.fs_mgmt, this);
     error_lookup_form = new error_lookup(parent_window, &smp_groups);
 
     processor->set_json(log_json);
@@ -81,6 +83,7 @@ void plugin_mcumgr::setup(QMainWindow *main_window)
 
     //Set defaults
     mode = ACTION_IDLE;
+    device_window_size = 0;
     uart_transport_locked = false;
     parent_row = -1;
     parent_column = -1;
@@ -296,6 +299,27 @@ void plugin_mcumgr::setup(QMainWindow *main_window)
 
     horizontalLayout_4->addWidget(radio_IMG_Confirm);
 
+    line_10 = new QFrame(tab_IMG_Upload);
+    line_10->setObjectName("line_10");
+    line_10->setFrameShape(QFrame::Shape::VLine);
+    line_10->setFrameShadow(QFrame::Shadow::Sunken);
+
+    horizontalLayout_4->addWidget(line_10);
+
+    label_44 = new QLabel(tab_IMG_Upload);
+    label_44->setObjectName("label_44");
+
+    horizontalLayout_4->addWidget(label_44);
+
+    edit_IMG_Window = new QSpinBox(tab_IMG_Upload);
+    edit_IMG_Window->setObjectName("edit_IMG_Window");
+    edit_IMG_Window->setMaximumSize(QSize(60, 16777215));
+    edit_IMG_Window->setMinimum(1);
+    edit_IMG_Window->setMaximum(32);
+    edit_IMG_Window->setValue(1);
+
+    horizontalLayout_4->addWidget(edit_IMG_Window);
+
 
     gridLayout_4->addLayout(horizontalLayout_4, 1, 1, 1, 1);
 
@@ -499,6 +523,11 @@ void plugin_mcumgr::setup(QMainWindow *main_window)
 
     horizontalLayout->addWidget(radio_FS_Download);
 
+    radio_FS_Sync = new QRadioButton(tab_FS);
+    radio_FS_Sync->setObjectName("radio_FS_Sync");
+
+    horizontalLayout->addWidget(radio_FS_Sync);
+
     radio_FS_Size = new QRadioButton(tab_FS);
     radio_FS_Size->setObjectName("radio_FS_Size");
 
@@ -514,6 +543,33 @@ void plugin_mcumgr::setup(QMainWindow *main_window)
 
     horizontalLayout->addWidget(radio_FS_Hash_Checksum_Types);
 
+    line_11 = new QFrame(tab_FS);
+    line_11->setObjectName("line_11");
+    line_11->setFrameShape(QFrame::Shape::VLine);
+    line_11->setFrameShadow(QFrame::Shadow::Sunken);
+
+    horizontalLayout->addWidget(line_11);
+
+    label_45 = new QLabel(tab_FS);
+    label_45->setObjectName("label_45");
+
+    horizontalLayout->addWidget(label_45);
+
+    edit_FS_Window = new QSpinBox(tab_FS);
+    edit_FS_Window->setObjectName("edit_FS_Window");
+    edit_FS_Window->setMaximumSize(QSize(60, 16777215));
+    edit_FS_Window->setMinimum(1);
+    edit_FS_Window->setMaximum(32);
+    edit_FS_Window->setValue(1);
+
+    horizontalLayout->addWidget(edit_FS_Window);
+
+    check_FS_Verify = new QCheckBox(tab_FS);
+    check_FS_Verify->setObjectName("check_FS_Verify");
+    check_FS_Verify->setChecked(false);
+
+    horizontalLayout->addWidget(check_FS_Verify);
+
 
     gridLayout_2->addLayout(horizontalLayout, 5, 0, 1, 3);
 
@@ -1767,7 +1823,8 @@ void plugin_mcumgr::setup(QMainWindow *main_window)
     QWidget::setTabOrder(edit_IMG_Image, radio_IMG_No_Action);
     QWidget::setTabOrder(radio_IMG_No_Action, radio_IMG_Test);
     QWidget::setTabOrder(radio_IMG_Test, radio_IMG_Confirm);
-    QWidget::setTabOrder(radio_IMG_Confirm, check_IMG_Reset);
+    QWidget::setTabOrder(radio_IMG_Confirm, edit_IMG_Window);
+    QWidget::setTabOrder(edit_IMG_Window, check_IMG_Reset);
     QWidget::setTabOrder(check_IMG_Reset, colview_IMG_Images);
 //    QWidget::setTabOrder(colview_IMG_Images, edit_IMG_Preview_Hash);
     QWidget::setTabOrder(edit_IMG_Preview_Hash, edit_IMG_Preview_Version);
@@ -1792,10 +1849,13 @@ void plugin_mcumgr::setup(QMainWindow *main_window)
     QWidget::setTabOrder(edit_FS_Result, edit_FS_Size);
     QWidget::setTabOrder(edit_FS_Size, radio_FS_Upload);
     QWidget::setTabOrder(radio_FS_Upload, radio_FS_Download);
-    QWidget::setTabOrder(radio_FS_Download, radio_FS_Size);
+    QWidget::setTabOrder(radio_FS_Download, radio_FS_Sync);
+    QWidget::setTabOrder(radio_FS_Sync, radio_FS_Size);
     QWidget::setTabOrder(radio_FS_Size, radio_FS_HashChecksum);
     QWidget::setTabOrder(radio_FS_HashChecksum, radio_FS_Hash_Checksum_Types);
-    QWidget::setTabOrder(radio_FS_Hash_Checksum_Types, btn_FS_Go);
+    QWidget::setTabOrder(radio_FS_Hash_Checksum_Types, edit_FS_Window);
+    QWidget::setTabOrder(edit_FS_Window, check_FS_Verify);
+    QWidget::setTabOrder(check_FS_Verify, btn_FS_Go);
     QWidget::setTabOrder(btn_FS_Go, selector_OS);
     QWidget::setTabOrder(selector_OS, edit_OS_Echo_Input);
     QWidget::setTabOrder(edit_OS_Echo_Input, edit_OS_Echo_Output);
@@ -1899,6 +1959,10 @@ void plugin_mcumgr::setup(QMainWindow *main_window)
     radio_IMG_No_Action->setText(QCoreApplication::translate("Form", "No action", nullptr));
     radio_IMG_Test->setText(QCoreApplication::translate("Form", "Test", nullptr));
     radio_IMG_Confirm->setText(QCoreApplication::translate("Form", "Confirm", nullptr));
+    label_44->setText(QCoreApplication::translate("Form", "Window:", nullptr));
+#if QT_CONFIG(tooltip)
+    edit_IMG_Window->setToolTip(QCoreApplication::translate("Form", "Maximum number of upload chunks to have outstanding at once (limited by the device buffer count if it has been queried)", nullptr));
+#endif // QT_CONFIG(tooltip)
     selector_img->setTabText(selector_img->indexOf(tab_IMG_Upload), QCoreApplication::translate("Form", "Upload", nullptr));
     label_5->setText(QCoreApplication::translate("Form", "State:", nullptr));
     radio_IMG_Get->setText(QCoreApplication::translate("Form", "Get", nullptr));
@@ -1923,9 +1987,21 @@ void plugin_mcumgr::setup(QMainWindow *main_window)
     label_3->setText(QCoreApplication::translate("Form", "Device file:", nullptr));
     radio_FS_Upload->setText(QCoreApplication::translate("Form", "Upload", nullptr));
     radio_FS_Download->setText(QCoreApplication::translate("Form", "Download", nullptr));
+    radio_FS_Sync->setText(QCoreApplication::translate("Form", "Sync", nullptr));
+#if QT_CONFIG(tooltip)
+    radio_FS_Sync->setToolTip(QCoreApplication::translate("Form", "Upload all files in the local directory (and subdirectories) to the device directory, skipping files which are already on the device", nullptr));
+#endif // QT_CONFIG(tooltip)
     radio_FS_Size->setText(QCoreApplication::translate("Form", "Size", nullptr));
     radio_FS_HashChecksum->setText(QCoreApplication::translate("Form", "Hash/checksum", nullptr));
     radio_FS_Hash_Checksum_Types->setText(QCoreApplication::translate("Form", "Types", nullptr));
+    label_45->setText(QCoreApplication::translate("Form", "Window:", nullptr));
+#if QT_CONFIG(tooltip)
+    edit_FS_Window->setToolTip(QCoreApplication::translate("Form", "Maximum number of download reads to have outstanding at once (limited by the device buffer count if it has been queried)", nullptr));
+#endif // QT_CONFIG(tooltip)
+    check_FS_Verify->setText(QCoreApplication::translate("Form", "Verify", nullptr));
+#if QT_CONFIG(tooltip)
+    check_FS_Verify->setToolTip(QCoreApplication::translate("Form", "Check downloaded files against the SHA256 hash of the file on the device. When syncing, compare the SHA256 hash of files which are the same size on the device", nullptr));
+#endif // QT_CONFIG(tooltip)
     label_19->setText(QCoreApplication::translate("Form", "Type:", nullptr));
     btn_FS_Go->setText(QCoreApplication::translate("Form", "Go", nullptr));
     selector_group->setTabText(selector_group->indexOf(tab_FS), QCoreApplication::translate("Form", "FS", nullptr));
@@ -2109,6 +2185,9 @@ void plugin_mcumgr::setup(QMainWindow *main_window)
 
     connect(smp_groups.fs_mgmt, SIGNAL(status(uint8_t,group_status,QString)), this, SLOT(status(uint8_t,group_status,QString)));
     connect(smp_groups.fs_mgmt, SIGNAL(progress(uint8_t,uint8_t)), this, SLOT(progress(uint8_t,uint8_t)));
+    connect(fs_sync, SIGNAL(sync_status(QString)), lbl_FS_Status, SLOT(setText(QString)));
+    connect(fs_sync, SIGNAL(sync_progress(int)), progress_FS_Complete, SLOT(setValue(int)));
+    connect(fs_sync, SIGNAL(sync_finished(group_status,QString)), this, SLOT(fs_sync_finished(group_status,QString)));
     connect(smp_groups.img_mgmt, SIGNAL(status(uint8_t,group_status,QString)), this, SLOT(status(uint8_t,group_status,QString)));
     connect(smp_groups.img_mgmt, SIGNAL(progress(uint8_t,uint8_t)), this, SLOT(progress(uint8_t,uint8_t)));
     connect(smp_groups.img_mgmt, SIGNAL(plugin_to_hex(QByteArray*)), this, SLOT(group_to_hex(QByteArray*)));
@@ -2132,6 +2211,7 @@ void plugin_mcumgr::setup(QMainWindow *main_window)
     connect(btn_FS_Go, SIGNAL(clicked()), this, SLOT(on_btn_FS_Go_clicked()));
     connect(radio_FS_Upload, SIGNAL(toggled(bool)), this, SLOT(on_radio_FS_Upload_toggled(bool)));
     connect(radio_FS_Download, SIGNAL(toggled(bool)), this, SLOT(on_radio_FS_Download_toggled(bool)));
+    connect(radio_FS_Sync, SIGNAL(toggled(bool)), this, SLOT(on_radio_FS_Sync_toggled(bool)));
     connect(radio_FS_Size, SIGNAL(toggled(bool)), this, SLOT(on_radio_FS_Size_toggled(bool)));
     connect(radio_FS_HashChecksum, SIGNAL(toggled(bool)), this, SLOT(on_radio_FS_HashChecksum_toggled(bool)));
     connect(radio_FS_Hash_Checksum_Types, SIGNAL(toggled(bool)), this, SLOT(on_radio_FS_Hash_Checksum_Types_toggled(bool)));
@@ -2301,6 +2381,7 @@ plugin_mcumgr::~plugin_mcumgr()
 
     disconnect(this, SLOT(status(uint8_t,group_status,QString)));
     disconnect(this, SLOT(progress(uint8_t,uint8_t)));
+    disconnect(this, SLOT(fs_sync_finished(group_status,QString)));
     disconnect(this, SIGNAL(custom_log(bool,QString*)));
 
     disconnect(this, SLOT(custom_message_callback(custom_message_callback_t,smp_error_t*)));
@@ -2310,6 +2391,7 @@ plugin_mcumgr::~plugin_mcumgr()
     disconnect(this, SLOT(on_btn_FS_Go_clicked()));
     disconnect(this, SLOT(on_radio_FS_Upload_toggled(bool)));
     disconnect(this, SLOT(on_radio_FS_Download_toggled(bool)));
+    disconnect(this, SLOT(on_radio_FS_Sync_toggled(bool)));
     disconnect(this, SLOT(on_radio_FS_Size_toggled(bool)));
     disconnect(this, SLOT(on_radio_FS_HashChecksum_toggled(bool)));
     disconnect(this, SLOT(on_radio_FS_Hash_Checksum_Types_toggled(bool)));
@@ -2386,6 +2468,7 @@ plugin_mcumgr::~plugin_mcumgr()
 #endif
 
     delete error_lookup_form;
+    delete fs_sync;
     delete smp_groups.enum_mgmt;
     delete smp_groups.zephyr_mgmt;
     delete smp_groups.stat_mgmt;
@@ -2397,6 +2480,7 @@ plugin_mcumgr::~plugin_mcumgr()
     delete processor;
     delete log_json;
     delete uart_transport;
+    smp_message::free_pool();
 
 #ifndef SKIPPLUGIN_LOGGER
     delete logger;
@@ -2480,6 +2564,9 @@ void plugin_mcumgr::serial_closed()
     }
 #endif
 
+    //Buffer count of the device is not known until it is queried again, it may be a different device
+    device_window_size = 0;
+
     switch (mode)
     {
         case ACTION_IMG_UPLOAD:
@@ -2531,6 +2618,12 @@ void plugin_mcumgr::serial_closed()
             break;
         }
 
+        case ACTION_FS_SYNC:
+        {
+            fs_sync->cancel();
+            break;
+        }
+
         case ACTION_SETTINGS_READ:
         case ACTION_SETTINGS_WRITE:
         case ACTION_SETTINGS_DELETE:
@@ -2578,6 +2671,11 @@ void plugin_mcumgr::on_btn_FS_Local_clicked()
         //TODO: load path
         filename = QFileDialog::getOpenFileName(parent_window, "Select source file for transfer", "", "All Files (*)");
     }
+    else if (radio_FS_Sync->isChecked())
+    {
+        //TODO: load path
+        filename = QFileDialog::getExistingDirectory(parent_window, "Select source directory to sync", "");
+    }
     else
     {
         //TODO: load path
@@ -2641,6 +2739,9 @@ void plugin_mcumgr::on_btn_FS_Go_clicked()
             mode = ACTION_FS_DOWNLOAD;
             processor->set_transport(active_transport());
             set_group_transport_settings(smp_groups.fs_mgmt);
+            set_processor_window(edit_FS_Window->value());
+            smp_groups.fs_mgmt->set_download_window(processor->get_window_size());
+            smp_groups.fs_mgmt->set_download_verify(check_FS_Verify->isChecked());
             started = smp_groups.fs_mgmt->start_download(edit_FS_Remote->text(), edit_FS_Local->text());
 
             if (started == true)
@@ -2649,6 +2750,33 @@ void plugin_mcumgr::on_btn_FS_Go_clicked()
             }
         }
     }
+    else if (radio_FS_Sync->isChecked())
+    {
+        if (edit_FS_Local->text().isEmpty())
+        {
+            lbl_FS_Status->setText("Error: Local directory is required");
+        }
+        else if (edit_FS_Remote->text().isEmpty())
+        {
+            lbl_FS_Status->setText("Error: Device directory is required");
+        }
+        else if (!QDir(edit_FS_Local->text()).exists())
+        {
+            lbl_FS_Status->setText("Error: Local directory must exist");
+        }
+        else
+        {
+            mode = ACTION_FS_SYNC;
+            processor->set_transport(active_transport());
+            set_group_transport_settings(smp_groups.fs_mgmt);
+            started = fs_sync->start(edit_FS_Local->text(), edit_FS_Remote->text(), check_FS_Verify->isChecked());
+
+            if (started == false)
+            {
+                lbl_FS_Status->setText("Error: Local directory has no files");
+            }
+        }
+    }
     else if (radio_FS_Size->isChecked())
     {
         if (edit_FS_Remote->text().isEmpty())
@@ -2741,6 +2869,19 @@ void plugin_mcumgr::on_radio_FS_Download_toggled(bool checked)
     }
 }
 
+void plugin_mcumgr::on_radio_FS_Sync_toggled(bool checked)
+{
+    if (checked == true)
+    {
+        edit_FS_Local->setEnabled(true);
+        btn_FS_Local->setEnabled(true);
+        edit_FS_Remote->setEnabled(true);
+        combo_FS_type->setEnabled(false);
+        edit_FS_Result->setEnabled(false);
+        edit_FS_Size->setEnabled(false);
+    }
+}
+
 void plugin_mcumgr::on_radio_FS_Size_toggled(bool checked)
 {
     if (checked == true)
@@ -2815,6 +2956,8 @@ void plugin_mcumgr::on_btn_IMG_Go_clicked()
             mode = ACTION_IMG_UPLOAD;
             processor->set_transport(active_transport());
             set_group_transport_settings(smp_groups.img_mgmt);
+            set_processor_window(edit_IMG_Window->value());
+            smp_groups.img_mgmt->set_upload_window(processor->get_window_size());
             started = smp_groups.img_mgmt->start_firmware_update(edit_IMG_Image->value(), edit_IMG_Local->text(), false, &upload_hash);
 
             if (started == true)
@@ -3473,6 +3616,10 @@ void plugin_mcumgr::status(uint8_t user_data, group_status status, QString error
             {
                 edit_OS_Info_Output->clear();
                 edit_OS_Info_Output->appendPlainText(QString::number(os_buffer_count) % " buffers of " % QString::number(os_buffer_size) % " bytes each");
+
+                //Limit outstanding requests to what the device has buffers to receive
+                device_window_size = smp_processor::window_size_from_buffer_count(os_buffer_count);
+                edit_OS_Info_Output->appendPlainText(QString("Up to ") % QString::number(device_window_size) % " outstanding request(s) will be used");
                 error_string = nullptr;
             }
             else if (user_data == ACTION_OS_OS_APPLICATION_INFO)
@@ -3637,6 +3784,13 @@ void plugin_mcumgr::status(uint8_t user_data, group_status status, QString error
     else if (sender() == smp_groups.fs_mgmt)
     {
         log_debug() << "fs sender";
+
+        if (user_data == ACTION_FS_SYNC)
+        {
+            //Each file of a sync is handled by fs_sync, which reports once the whole sync has finished
+            return;
+        }
+
         label_status = lbl_FS_Status;
 
         if (status == STATUS_COMPLETE)
@@ -3843,8 +3997,6 @@ void plugin_mcumgr::status(uint8_t user_data, group_status status, QString error
 
 void plugin_mcumgr::progress(uint8_t user_data, uint8_t percent)
 {
-    Q_UNUSED(user_data);
-
     log_debug() << "Progress " << percent << " from " << this->sender();
 
     if (this->sender() == smp_groups.img_mgmt)
@@ -3852,13 +4004,23 @@ void plugin_mcumgr::progress(uint8_t user_data, uint8_t percent)
         log_debug() << "img sender";
         progress_IMG_Complete->setValue(percent);
     }
-    else if (this->sender() == smp_groups.fs_mgmt)
+    else if (this->sender() == smp_groups.fs_mgmt && user_data != ACTION_FS_SYNC)
     {
         log_debug() << "fs sender";
         progress_FS_Complete->setValue(percent);
     }
 }
 
+void plugin_mcumgr::fs_sync_finished(group_status status, QString summary)
+{
+    log_debug() << "fs sync finished: " << status;
+
+    mode = ACTION_IDLE;
+    relase_transport();
+    btn_cancel->setEnabled(false);
+    lbl_FS_Status->setText(summary);
+}
+
 void plugin_mcumgr::group_to_hex(QByteArray *data)
 {
     emit plugin_to_hex(data);
@@ -3939,6 +4101,7 @@ void plugin_mcumgr::on_radio_transport_uart_toggled(bool checked)
     if (checked == true)
     {
         close_transport_windows();
+        device_window_size = 0;
         show_transport_open_status();
     }
 }
@@ -3949,6 +4112,7 @@ void plugin_mcumgr::on_radio_transport_udp_toggled(bool checked)
     if (checked == true)
     {
         close_transport_windows();
+        device_window_size = 0;
         show_transport_open_status();
         udp_transport->open_connect_dialog();
     }
@@ -3961,6 +4125,7 @@ void plugin_mcumgr::on_radio_transport_bluetooth_toggled(bool checked)
     if (checked == true)
     {
         close_transport_windows();
+        device_window_size = 0;
         show_transport_open_status();
         bluetooth_transport->open_connect_dialog();
     }
@@ -3973,6 +4138,7 @@ void plugin_mcumgr::on_radio_transport_lora_toggled(bool checked)
     if (checked == true)
     {
         close_transport_windows();
+        device_window_size = 0;
         show_transport_open_status();
         lora_transport->open_connect_dialog();
     }
@@ -4781,7 +4947,7 @@ void plugin_mcumgr::on_btn_custom_go_clicked()
 
     lbl_custom_status->setText("Custom...");
 
-    tmp_message = new smp_message();
+    tmp_message = smp_message::acquire();
 
     if (radio_custom_json->isChecked())
     {
@@ -4866,6 +5032,17 @@ void plugin_mcumgr::set_group_transport_settings(smp_group *group, uint32_t time
     group->set_parameters((check_V2_Protocol->isChecked() ? 1 : 0), edit_MTU->value(), transport->get_retries(), (timeout >= transport->get_timeout() ? timeout : transport->get_timeout()), mode);
 }
 
+void plugin_mcumgr::set_processor_window(uint8_t window)
+{
+    //Device buffer count is only known if it has been queried
+    if (device_window_size != 0 && window > device_window_size)
+    {
+        window = device_window_size;
+    }
+
+    processor->set_window_size(window);
+}
+
 void plugin_mcumgr::on_btn_error_lookup_clicked()
 {
     error_lookup_form->show();
@@ -4874,6 +5051,12 @@ void plugin_mcumgr::on_btn_error_lookup_clicked()
 void plugin_mcumgr::on_btn_cancel_clicked()
 {
     processor->cancel();
+
+    if (fs_sync->is_running() == true)
+    {
+        //A sync can be between files, with nothing outstanding for the processor to cancel
+        fs_sync->cancel();
+    }
 }
 
 AutPlugin::PluginType plugin_mcumgr::plugin_type()
@@ -38,6 +38,7 @@
 #include "smp_group.h"
 #include "smp_uart_auterm.h"
 #include "smp_group_fs_mgmt.h"
+#include "smp_fs_sync.h"
 #include "smp_group_img_mgmt.h"
 #include "smp_group_os_mgmt.h"
 #include "smp_group_settings_mgmt.h"
@@ -127,6 +128,7 @@ enum mcumgr_action_t {
     ACTION_FS_STATUS,
     ACTION_FS_HASH_CHECKSUM,
     ACTION_FS_SUPPORTED_HASHES_CHECKSUMS,
+    ACTION_FS_SYNC,
 
     ACTION_SETTINGS_READ,
     ACTION_SETTINGS_WRITE,
@@ -181,6 +183,7 @@ private slots:
 
     void status(uint8_t user_data, group_status status, QString error_string);
     void progress(uint8_t user_data, uint8_t percent);
+    void fs_sync_finished(group_status status, QString summary);
 
     void enter_pressed();
 
@@ -192,6 +195,7 @@ private slots:
     void on_btn_FS_Go_clicked();
     void on_radio_FS_Upload_toggled(bool checked);
     void on_radio_FS_Download_toggled(bool checked);
+    void on_radio_FS_Sync_toggled(bool checked);
     void on_radio_FS_Size_toggled(bool checked);
     void on_radio_FS_HashChecksum_toggled(bool checked);
     void on_radio_FS_Hash_Checksum_Types_toggled(bool checked);
@@ -264,6 +268,7 @@ private:
     void set_group_transport_settings(smp_group *group);
     void set_group_transport_settings(smp_group *group, uint32_t timeout);
     void update_img_state_table();
+    void set_processor_window(uint8_t window);
 
     //Form items
 ///AUTOGEN_START_OBJECTS
@@ -307,6 +312,9 @@ private:
     QRadioButton *radio_IMG_No_Action;
     QRadioButton *radio_IMG_Test;
     QRadioButton *radio_IMG_Confirm;
+    QFrame *line_10;
+    QLabel *label_44;
+    QSpinBox *edit_IMG_Window;
     QSpacerItem *verticalSpacer_4;
     QWidget *tab_IMG_Images;
     QGridLayout *gridLayout_5;
@@ -346,9 +354,14 @@ private:
     QHBoxLayout *horizontalLayout;
     QRadioButton *radio_FS_Upload;
     QRadioButton *radio_FS_Download;
+    QRadioButton *radio_FS_Sync;
     QRadioButton *radio_FS_Size;
     QRadioButton *radio_FS_HashChecksum;
     QRadioButton *radio_FS_Hash_Checksum_Types;
+    QFrame *line_11;
+    QLabel *label_45;
+    QSpinBox *edit_FS_Window;
+    QCheckBox *check_FS_Verify;
     QLabel *label_19;
     QLineEdit *edit_FS_Remote;
     QHBoxLayout *horizontalLayout_2;
@@ -616,6 +629,7 @@ private:
     QByteArray settings_read_response;
     QByteArray fs_hash_checksum_response;
     uint32_t fs_size_response;
+    smp_fs_sync *fs_sync;
 #ifndef SKIPPLUGIN_LOGGER
     debug_logger *logger;
 #endif
@@ -624,6 +638,7 @@ private:
     smp_json *log_json;
     uint32_t os_buffer_size;
     uint32_t os_buffer_count;
+    uint8_t device_window_size;
 };
 
 #endif // PLUGIN_MCUMGR_H
@@ -53,6 +53,7 @@ enum smp_bluetooth_error_t {
     SMP_BLUETOOTH_ERROR_CONTROLLER_CONNECTION_ERROR,
     SMP_BLUETOOTH_ERROR_CONTROLLER_REMOTE_HOST_CLOSED_ERROR,
     SMP_BLUETOOTH_ERROR_CONTROLLER_AUTHORISATION_ERROR,
+    SMP_BLUETOOTH_ERROR_SERVICE_CHARACTERISTIC_WRITE_ERROR,
 
     SMP_BLUETOOTH_ERROR_COUNT
 };
@@ -86,6 +87,7 @@ smp_bluetooth::smp_bluetooth(QObject *parent)
 #endif
 
     mtu_max_worked = 0;
+    send_offset = 0;
     ready_to_send = false;
     bluetooth_config_set = false;
     bluetooth_config_connection_in_progress = false;
@@ -201,6 +203,8 @@ void smp_bluetooth::bluetooth_disconnected()
     mtu_max_worked = 0;
     ready_to_send = false;
     bluetooth_config_connection_in_progress = false;
+    send_queue.clear();
+    send_offset = 0;
 
     if (bluetooth_service_mcumgr != nullptr)
     {
@@ -323,15 +327,18 @@ void smp_bluetooth::mcumgr_service_characteristic_written(QLowEnergyCharacterist
 
     retry_count = 0;
 
-    if (send_buffer.length() > 0)
+    if (bluetooth_write_mode == QLowEnergyService::WriteWithResponse && send_queue.isEmpty() == false)
     {
-        send_buffer.remove(0, baData.length());
+        send_offset += baData.length();
 
-        if (send_buffer.length() > 0)
+        if (send_offset >= send_queue.first().length())
         {
-            bluetooth_service_mcumgr->writeCharacteristic(bluetooth_characteristic_transmit, send_buffer.left(mtu), bluetooth_write_mode);
-            log_debug() << "Bluetooth service characteristic write of " << (send_buffer.length() > mtu ? mtu : send_buffer.length()) << " bytes";
+            //Message fully written, the next one starts on a new write
+            send_queue.removeFirst();
+            send_offset = 0;
         }
+
+        write_queued_data();
     }
 }
 
@@ -341,26 +348,8 @@ void smp_bluetooth::mcumgr_service_descriptor_written(const QLowEnergyDescriptor
     {
         ready_to_send = true;
 
-        if (send_buffer.length() > 0)
-        {
-            //Send out pre-buffered data to device
-            if (bluetooth_write_mode == QLowEnergyService::WriteWithResponse)
-            {
-                bluetooth_service_mcumgr->writeCharacteristic(bluetooth_characteristic_transmit, send_buffer.left(mtu));
-                log_debug() << "Bluetooth service characteristic write with response of " << (send_buffer.length() > mtu ? mtu : send_buffer.length()) << " bytes";
-            }
-            else
-            {
-                while (send_buffer.length() > 0)
-                {
-                    uint16_t send_size = mtu > send_buffer.length() ? send_buffer.length() : mtu;
-
-                    bluetooth_service_mcumgr->writeCharacteristic(bluetooth_characteristic_transmit, send_buffer.left(send_size), QLowEnergyService::WriteWithoutResponse);
-                    send_buffer.remove(0, send_size);
-                    log_debug() << "Bluetooth service characteristic write without response of " << send_size << " bytes";
-                }
-            }
-        }
+        //Send out pre-buffered data to device
+        write_queued_data();
 
         emit connected();
     }
@@ -531,37 +520,58 @@ smp_transport_error_t smp_bluetooth::send(smp_message *message)
         return SMP_TRANSPORT_ERROR_NOT_CONNECTED;
     }
 
+    //With multiple outstanding requests, a write with response may still be in progress, this message is then written
+    //once the ones queued before it have been
+    bool write_in_progress = (ready_to_send == true && bluetooth_write_mode == QLowEnergyService::WriteWithResponse && send_queue.isEmpty() == false);
+
     retry_count = 0;
-    send_buffer.clear();
 
     if (mtu < mtu_max_worked)
     {
         mtu = mtu_max_worked;
     }
 
-    send_buffer.append(*message->data());
+    send_queue.append(*message->data());
+
+    if (ready_to_send == true && write_in_progress == false)
+    {
+        write_queued_data();
+    }
+
+    return SMP_TRANSPORT_ERROR_OK;
+}
 
-    if (ready_to_send == true)
+void smp_bluetooth::write_queued_data()
+{
+    //Writes queued messages, each message starts on a new write as the device reassembles each message from the writes
+    //which make it up. With response, only the next write is made and the rest follow as each one is acknowledged
+    if (bluetooth_write_mode == QLowEnergyService::WriteWithResponse)
     {
-        if (bluetooth_write_mode == QLowEnergyService::WriteWithResponse)
+        if (send_queue.isEmpty() == false)
         {
-            bluetooth_service_mcumgr->writeCharacteristic(bluetooth_characteristic_transmit, send_buffer.left(mtu));
-            log_debug() << "Bluetooth service characteristic write with response of " << (send_buffer.length() > mtu ? mtu : send_buffer.length()) << " bytes";
+            QByteArray data = send_queue.first().mid(send_offset, mtu);
+
+            bluetooth_service_mcumgr->writeCharacteristic(bluetooth_characteristic_transmit, data);
+            log_debug() << "Bluetooth service characteristic write with response of " << data.length() << " bytes";
         }
-        else
+
+        return;
+    }
+
+    while (send_queue.isEmpty() == false)
+    {
+        while (send_offset < send_queue.first().length())
         {
-            while (send_buffer.length() > 0)
-            {
-                uint16_t send_size = mtu > send_buffer.length() ? send_buffer.length() : mtu;
+            QByteArray data = send_queue.first().mid(send_offset, mtu);
 
-                bluetooth_service_mcumgr->writeCharacteristic(bluetooth_characteristic_transmit, send_buffer.left(send_size), QLowEnergyService::WriteWithoutResponse);
-                send_buffer.remove(0, send_size);
-                log_debug() << "Bluetooth service characteristic write without response of " << send_size << " bytes";
-            }
+            bluetooth_service_mcumgr->writeCharacteristic(bluetooth_characteristic_transmit, data, QLowEnergyService::WriteWithoutResponse);
+            send_offset += data.length();
+            log_debug() << "Bluetooth service characteristic write without response of " << data.length() << " bytes";
         }
-    }
 
-    return SMP_TRANSPORT_ERROR_OK;
+        send_queue.removeFirst();
+        send_offset = 0;
+    }
 }
 
 void smp_bluetooth::mcumgr_service_error(QLowEnergyService::ServiceError error)
@@ -585,15 +595,20 @@ void smp_bluetooth::mcumgr_service_error(QLowEnergyService::ServiceError error)
                 mtu -= 16;
             }
 
-            bluetooth_service_mcumgr->writeCharacteristic(bluetooth_characteristic_transmit, send_buffer.left(mtu));
+            //Nothing of the failed write was accepted, so it is retried from the same offset in the message
+            write_queued_data();
         }
         else
         {
-            send_buffer.clear();
             log_error() << "Unable to write Bluetooth characteristic with minimal MTU size, this connection is unusable";
 #if defined(GUI_PRESENT)
             bluetooth_window->set_status_text("Minimal MTU write failed, connection is unusable");
 #endif
+
+            //Queued messages will never be sent, the error fails the requests waiting for them
+            send_queue.clear();
+            send_offset = 0;
+            emit smp_transport::error(SMP_BLUETOOTH_ERROR_SERVICE_CHARACTERISTIC_WRITE_ERROR);
         }
     }
     else if (error == QLowEnergyService::OperationError || error == QLowEnergyService::DescriptorWriteError || error == QLowEnergyService::UnknownError || error == QLowEnergyService::CharacteristicReadError || error == QLowEnergyService::DescriptorReadError)
@@ -899,6 +914,10 @@ QString smp_bluetooth::to_error_string(int error_code)
         {
             return "Bluetooth controller authorisation error";
         }
+        case SMP_BLUETOOTH_ERROR_SERVICE_CHARACTERISTIC_WRITE_ERROR:
+        {
+            return "Bluetooth service characteristic write error";
+        }
         default:
         {
             return "";
@@ -129,6 +129,7 @@ signals:
 
 private:
     void form_min_params();
+    void write_queued_data();
 
 #if defined(GUI_PRESENT)
     QMainWindow *main_window;
@@ -149,7 +150,8 @@ private:
     QLowEnergyDescriptor bluetooth_descriptor_receive_cccd;
     uint16_t mtu;
     uint16_t mtu_max_worked;
-    QByteArray send_buffer;
+    QList<QByteArray> send_queue; //Messages waiting to be written, each message starts on a new write
+    int32_t send_offset; //Number of bytes of the first message in send_queue which have been written
     int retry_count;
     QLowEnergyService::WriteMode bluetooth_write_mode;
 #if !(QT_VERSION >= QT_VERSION_CHECK(6, 2, 0))
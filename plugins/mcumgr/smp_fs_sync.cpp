@@ -0,0 +1,399 @@
+/******************************************************************************
+** Copyright (C) 2024 Jamie M.
+**
+** Project: AuTerm
+**
+** Module:  smp_fs_sync.cpp
+**
+** Notes:
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include "smp_fs_sync.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QCryptographicHash>
+#include <QTimer>
+#include <algorithm>
+
+/******************************************************************************/
+// Constants
+/******************************************************************************/
+//Hash used to compare files which are the same size, the same as used to verify downloads
+static const QString fs_sync_hash_type = "sha256";
+
+/******************************************************************************/
+// Local Functions or Private Members
+/******************************************************************************/
+smp_fs_sync::smp_fs_sync(smp_group_fs_mgmt *fs_group, QObject *parent) : QObject(parent)
+{
+    fs_mgmt = fs_group;
+    stage = FS_SYNC_STAGE_IDLE;
+    waiting = false;
+    use_hash = false;
+    last_status = STATUS_COMPLETE;
+    file_index = 0;
+    device_file_size = 0;
+    files_uploaded = 0;
+    files_skipped = 0;
+    files_failed = 0;
+    transfer_total = 0;
+    bytes_uploaded = 0;
+    upload_percent = 0;
+    stopped_ms = 0;
+    transfer_ms = 0;
+
+    connect(fs_mgmt, SIGNAL(status(uint8_t,group_status,QString)), this, SLOT(status(uint8_t,group_status,QString)));
+    connect(fs_mgmt, SIGNAL(progress(uint8_t,uint8_t)), this, SLOT(progress(uint8_t,uint8_t)));
+}
+
+bool smp_fs_sync::start(QString local_directory, QString device_directory, bool compare_hash)
+{
+    //Returns false if a sync is running or there are no files to sync
+    QDir local_dir(local_directory);
+
+    if (stage != FS_SYNC_STAGE_IDLE || local_dir.exists() == false)
+    {
+        return false;
+    }
+
+    files.clear();
+    transfer_queue.clear();
+
+    while (device_directory.endsWith('/') == true)
+    {
+        device_directory.chop(1);
+    }
+
+    QDirIterator local_files(local_dir.absolutePath(), QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+
+    while (local_files.hasNext() == true)
+    {
+        fs_sync_file_t file;
+
+        file.local_name = local_files.next();
+        file.device_name = device_directory % "/" % local_dir.relativeFilePath(file.local_name);
+        file.size = (uint32_t)local_files.fileInfo().size();
+        files.append(file);
+    }
+
+    if (files.isEmpty() == true)
+    {
+        return false;
+    }
+
+    //Sync in a fixed order so repeated runs can be compared
+    std::sort(files.begin(), files.end(), [](const fs_sync_file_t &first, const fs_sync_file_t &second) {
+        return first.device_name < second.device_name;
+    });
+
+    use_hash = compare_hash;
+    last_error.clear();
+    file_index = 0;
+    files_uploaded = 0;
+    files_skipped = 0;
+    files_failed = 0;
+    transfer_total = 0;
+    bytes_uploaded = 0;
+    upload_percent = 0;
+    stopped_ms = 0;
+    transfer_ms = 0;
+    transfer_elapsed.invalidate();
+    elapsed.start();
+
+    check_next_file();
+
+    return true;
+}
+
+void smp_fs_sync::cancel()
+{
+    if (stage == FS_SYNC_STAGE_IDLE)
+    {
+        return;
+    }
+
+    if (waiting == true)
+    {
+        //Status from cancelling the group is not needed
+        waiting = false;
+        fs_mgmt->cancel();
+    }
+
+    finish(STATUS_CANCELLED, "Cancelled");
+}
+
+bool smp_fs_sync::is_running()
+{
+    return (stage != FS_SYNC_STAGE_IDLE);
+}
+
+uint32_t smp_fs_sync::get_files_total()
+{
+    return files.length();
+}
+
+uint32_t smp_fs_sync::get_files_uploaded()
+{
+    return files_uploaded;
+}
+
+uint32_t smp_fs_sync::get_files_skipped()
+{
+    return files_skipped;
+}
+
+uint32_t smp_fs_sync::get_files_failed()
+{
+    return files_failed;
+}
+
+quint64 smp_fs_sync::get_bytes_uploaded()
+{
+    return bytes_uploaded;
+}
+
+qint64 smp_fs_sync::get_elapsed_ms()
+{
+    return (stage != FS_SYNC_STAGE_IDLE ? elapsed.elapsed() : stopped_ms);
+}
+
+quint64 smp_fs_sync::get_average_rate()
+{
+    //Bytes per second of completed uploads, over the time spent uploading
+    qint64 upload_ms = (stage != FS_SYNC_STAGE_IDLE && transfer_elapsed.isValid() ? transfer_elapsed.elapsed() : transfer_ms);
+
+    if (upload_ms <= 0)
+    {
+        return 0;
+    }
+
+    return bytes_uploaded * 1000 / upload_ms;
+}
+
+void smp_fs_sync::status(uint8_t user_data, group_status status, QString error_string)
+{
+    Q_UNUSED(user_data);
+
+    if (waiting == false)
+    {
+        return;
+    }
+
+    waiting = false;
+    last_status = status;
+    last_error = error_string;
+
+    //The group can still be cleaning up after emitting a status, so the next operation is started once it has returned
+    QTimer::singleShot(0, this, SLOT(next_step()));
+}
+
+void smp_fs_sync::progress(uint8_t user_data, uint8_t percent)
+{
+    Q_UNUSED(user_data);
+
+    if (waiting == false || stage != FS_SYNC_STAGE_UPLOAD || transfer_total == 0)
+    {
+        return;
+    }
+
+    upload_percent = percent;
+    emit sync_progress((bytes_uploaded + (quint64)transfer_queue.at(file_index).size * upload_percent / 100) * 100 / transfer_total);
+}
+
+void smp_fs_sync::next_step()
+{
+    if (stage == FS_SYNC_STAGE_IDLE || waiting == true)
+    {
+        return;
+    }
+
+    if (last_status == STATUS_TIMEOUT || last_status == STATUS_CANCELLED || last_status == STATUS_PROCESSOR_TRANSPORT_ERROR || last_status == STATUS_TRANSPORT_DISCONNECTED)
+    {
+        //Problem with the connection rather than the file, the other files would fail the same way
+        finish(last_status, (last_error.isEmpty() ? "Sync stopped" : last_error));
+        return;
+    }
+
+    if (stage == FS_SYNC_STAGE_STATUS)
+    {
+        const fs_sync_file_t &file = files.at(file_index);
+
+        if (last_status != STATUS_COMPLETE || device_file_size != file.size)
+        {
+            //File is not on the device (or could not be read) or is a different size
+            transfer_queue.append(file);
+            transfer_total += file.size;
+        }
+        else if (use_hash == true)
+        {
+            start_stage(FS_SYNC_STAGE_HASH);
+            return;
+        }
+        else
+        {
+            ++files_skipped;
+        }
+
+        ++file_index;
+        check_next_file();
+    }
+    else if (stage == FS_SYNC_STAGE_HASH)
+    {
+        const fs_sync_file_t &file = files.at(file_index);
+
+        if (last_status == STATUS_COMPLETE && device_file_size == file.size && local_hash_matches() == true)
+        {
+            ++files_skipped;
+        }
+        else
+        {
+            if (last_status == STATUS_UNSUPPORTED)
+            {
+                //Device cannot hash files, upload any which match on size alone as they cannot be compared
+                use_hash = false;
+            }
+
+            transfer_queue.append(file);
+            transfer_total += file.size;
+        }
+
+        ++file_index;
+        check_next_file();
+    }
+    else if (stage == FS_SYNC_STAGE_UPLOAD)
+    {
+        if (last_status == STATUS_COMPLETE)
+        {
+            ++files_uploaded;
+            bytes_uploaded += transfer_queue.at(file_index).size;
+        }
+        else
+        {
+            //Other files can still be uploaded, e.g. if the directory for this one does not exist on the device
+            ++files_failed;
+        }
+
+        ++file_index;
+        upload_next_file();
+    }
+}
+
+bool smp_fs_sync::start_stage(fs_sync_stage_t new_stage)
+{
+    bool started = false;
+
+    stage = new_stage;
+    waiting = true;
+
+    if (stage == FS_SYNC_STAGE_STATUS)
+    {
+        emit sync_status(QString("Checking %1/%2: %3").arg(QString::number(file_index + 1), QString::number(files.length()), files.at(file_index).device_name));
+        started = fs_mgmt->start_status(files.at(file_index).device_name, &device_file_size);
+    }
+    else if (stage == FS_SYNC_STAGE_HASH)
+    {
+        emit sync_status(QString("Hashing %1/%2: %3").arg(QString::number(file_index + 1), QString::number(files.length()), files.at(file_index).device_name));
+        started = fs_mgmt->start_hash_checksum(files.at(file_index).device_name, fs_sync_hash_type, &device_file_hash, &device_file_size);
+    }
+    else if (stage == FS_SYNC_STAGE_UPLOAD)
+    {
+        upload_percent = 0;
+        emit sync_status(QString("Uploading %1/%2: %3").arg(QString::number(file_index + 1), QString::number(transfer_queue.length()), transfer_queue.at(file_index).device_name));
+        started = fs_mgmt->start_upload(transfer_queue.at(file_index).local_name, transfer_queue.at(file_index).device_name);
+    }
+
+    if (started == false && waiting == true)
+    {
+        //Failed without the group emitting a status
+        waiting = false;
+        last_status = STATUS_ERROR;
+        last_error.clear();
+        QTimer::singleShot(0, this, SLOT(next_step()));
+    }
+
+    return started;
+}
+
+bool smp_fs_sync::local_hash_matches()
+{
+    QFile local_file(files.at(file_index).local_name);
+    QCryptographicHash local_hash(QCryptographicHash::Sha256);
+
+    if (local_file.open(QFile::ReadOnly) == false || local_hash.addData(&local_file) == false)
+    {
+        return false;
+    }
+
+    return (local_hash.result() == device_file_hash);
+}
+
+void smp_fs_sync::check_next_file()
+{
+    if (file_index < files.length())
+    {
+        emit sync_progress(file_index * 100 / files.length());
+        start_stage(FS_SYNC_STAGE_STATUS);
+        return;
+    }
+
+    //All files checked, upload the ones which differ
+    file_index = 0;
+    emit sync_progress(0);
+    transfer_elapsed.start();
+    upload_next_file();
+}
+
+void smp_fs_sync::upload_next_file()
+{
+    if (file_index < transfer_queue.length())
+    {
+        start_stage(FS_SYNC_STAGE_UPLOAD);
+        return;
+    }
+
+    finish((files_failed > 0 ? STATUS_ERROR : STATUS_COMPLETE), nullptr);
+}
+
+void smp_fs_sync::finish(group_status status, QString error_string)
+{
+    QString summary;
+
+    stopped_ms = elapsed.elapsed();
+    transfer_ms = (transfer_elapsed.isValid() ? transfer_elapsed.elapsed() : 0);
+    stage = FS_SYNC_STAGE_IDLE;
+    waiting = false;
+
+    summary = QString("%1 files: %2 uploaded, %3 unchanged, %4 failed. %5 bytes in %6s (%7 B/s)").arg(QString::number(files.length()), QString::number(files_uploaded), QString::number(files_skipped), QString::number(files_failed), QString::number(bytes_uploaded), QString::number((double)stopped_ms / 1000.0, 'f', 1), QString::number(get_average_rate()));
+
+    if (error_string.isEmpty() == false)
+    {
+        summary = error_string % ". " % summary;
+    }
+    else if (status == STATUS_COMPLETE)
+    {
+        emit sync_progress(100);
+    }
+
+    emit sync_finished(status, summary);
+}
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
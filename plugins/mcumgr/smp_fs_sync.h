@@ -0,0 +1,125 @@
+/******************************************************************************
+** Copyright (C) 2024 Jamie M.
+**
+** Project: AuTerm
+**
+** Module:  smp_fs_sync.h
+**
+** Notes:
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+#ifndef SMP_FS_SYNC_H
+#define SMP_FS_SYNC_H
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include <QObject>
+#include <QList>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include "smp_group_fs_mgmt.h"
+
+/******************************************************************************/
+// Enum typedefs
+/******************************************************************************/
+enum fs_sync_stage_t {
+    FS_SYNC_STAGE_IDLE = 0,
+    FS_SYNC_STAGE_STATUS, //Getting the size of the device file
+    FS_SYNC_STAGE_HASH, //Getting the hash of the device file, only when the sizes match
+    FS_SYNC_STAGE_UPLOAD //Uploading files which differ
+};
+
+/******************************************************************************/
+// Forward declaration of Class, Struct & Unions
+/******************************************************************************/
+struct fs_sync_file_t {
+    QString local_name;
+    QString device_name;
+    uint32_t size;
+};
+
+/******************************************************************************/
+// Class definitions
+/******************************************************************************/
+//Uploads the files in a local directory (and its subdirectories) to a directory on the device, files which
+//are already on the device with the same size (and SHA256 hash, if enabled) are skipped. All files are checked
+//first, then the ones which differ are uploaded one after another. The fs mgmt group parameters (and the
+//transport) must be set up by the owner before starting, and its status signals are ignored by the owner
+//whilst a sync is running
+class smp_fs_sync : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit smp_fs_sync(smp_group_fs_mgmt *fs_group, QObject *parent = nullptr);
+    bool start(QString local_directory, QString device_directory, bool compare_hash);
+    void cancel();
+    bool is_running();
+    uint32_t get_files_total();
+    uint32_t get_files_uploaded();
+    uint32_t get_files_skipped();
+    uint32_t get_files_failed();
+    quint64 get_bytes_uploaded();
+    qint64 get_elapsed_ms();
+    quint64 get_average_rate();
+
+signals:
+    //Current stage and file, for display
+    void sync_status(QString text);
+    void sync_progress(int percent);
+    //Emitted once when the sync stops for any reason, summary includes the totals and throughput
+    void sync_finished(group_status status, QString summary);
+
+private slots:
+    void status(uint8_t user_data, group_status status, QString error_string);
+    void progress(uint8_t user_data, uint8_t percent);
+    void next_step();
+
+private:
+    bool start_stage(fs_sync_stage_t stage);
+    bool local_hash_matches();
+    void check_next_file();
+    void upload_next_file();
+    void finish(group_status status, QString error_string);
+
+    smp_group_fs_mgmt *fs_mgmt;
+    fs_sync_stage_t stage;
+    bool waiting; //True whilst an fs mgmt operation is outstanding
+    bool use_hash; //Compare hashes of files which are the same size, cleared if the device does not support it
+    group_status last_status; //Result of the last fs mgmt operation
+    QString last_error;
+    QList<fs_sync_file_t> files; //All local files
+    QList<fs_sync_file_t> transfer_queue; //Files which differ from the device
+    int32_t file_index; //Index of the file being checked or uploaded
+    uint32_t device_file_size;
+    QByteArray device_file_hash;
+    uint32_t files_uploaded;
+    uint32_t files_skipped;
+    uint32_t files_failed;
+    quint64 transfer_total; //Bytes in transfer_queue
+    quint64 bytes_uploaded; //Bytes of completed uploads
+    uint8_t upload_percent; //Progress of the current upload
+    QElapsedTimer elapsed; //Time since the sync started
+    QElapsedTimer transfer_elapsed; //Time since the first upload started
+    qint64 stopped_ms;
+    qint64 transfer_ms; //Time spent uploading, once stopped
+};
+
+#endif // SMP_FS_SYNC_H
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
@@ -114,7 +114,7 @@ public:
             //Message is larger than the transport provides
             QString response = QString("Message too large for transport, ") % QString::number(tmp_message->data()->length()) % " vs " % QString::number(processor->max_message_data_size(smp_mtu)) % " bytes";
 
-            delete tmp_message;
+            smp_message::release(tmp_message);
             cleanup();
             emit status(smp_user_data, STATUS_MESSAGE_TOO_LARGE, response);
             return false;
@@ -199,7 +199,7 @@ public:
     }
 #endif
 
-    virtual void receive_ok(uint8_t version, uint8_t op, uint16_t group, uint8_t command, QByteArray data) = 0;
+    virtual void receive_ok(uint8_t version, uint8_t op, uint16_t group, uint8_t command, smp_response_view *response) = 0;
     virtual void receive_error(uint8_t version, uint8_t op, uint16_t group, uint8_t command, smp_error_t error) = 0;
     virtual void cancel() = 0;
 
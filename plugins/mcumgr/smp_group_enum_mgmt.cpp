@@ -441,11 +441,11 @@ bool smp_group_enum_mgmt::parse_details_response(QCborStreamReader &reader, uint
     return true;
 }
 
-void smp_group_enum_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group, uint8_t command, QByteArray data)
+void smp_group_enum_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group, uint8_t command, smp_response_view *response)
 {
     Q_UNUSED(op);
 
-//    qDebug() << "Got ok: " << version << ", " << op << ", " << group << ", "  << command << ", " << data;
+//    qDebug() << "Got ok: " << version << ", " << op << ", " << group << ", "  << command << ", " << response->data();
 
     if (mode == MODE_IDLE)
     {
@@ -469,7 +469,7 @@ void smp_group_enum_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group
         if (mode == MODE_COUNT && command == COMMAND_COUNT)
         {
             //Response to count command groups
-            QCborStreamReader cbor_reader(data);
+            QCborStreamReader cbor_reader(response->data());
             bool count_found = false;
             bool good = parse_count_response(cbor_reader, groups_count, &count_found);
 
@@ -494,7 +494,7 @@ void smp_group_enum_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group
         else if (mode == MODE_LIST && command == COMMAND_LIST)
         {
             //Response to list command groups
-            QCborStreamReader cbor_reader(data);
+            QCborStreamReader cbor_reader(response->data());
             bool groups_found = false;
             bool good = parse_list_response(cbor_reader, nullptr, groups_list, &groups_found);
 
@@ -519,7 +519,7 @@ void smp_group_enum_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group
         else if (mode == MODE_SINGLE && command == COMMAND_SINGLE)
         {
             //Response to fetch command group ID
-            QCborStreamReader cbor_reader(data);
+            QCborStreamReader cbor_reader(response->data());
             bool group_found = false;
             bool good = parse_single_response(cbor_reader, group_single_id, group_single_end, &group_found);
 
@@ -544,7 +544,7 @@ void smp_group_enum_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group
         else if (mode == MODE_DETAILS && command == COMMAND_DETAILS)
         {
             //Response to get command group details
-            QCborStreamReader cbor_reader(data);
+            QCborStreamReader cbor_reader(response->data());
             bool groups_found = false;
             bool good = parse_details_response(cbor_reader, 0, groups_details, &groups_found, groups_details_fields_present);
 
@@ -627,7 +627,7 @@ void smp_group_enum_mgmt::cancel()
 
 bool smp_group_enum_mgmt::start_enum_count(uint16_t *count)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_READ, smp_version, SMP_GROUP_ID_ENUM, COMMAND_COUNT, 0);
     tmp_message->end_message();
 
@@ -647,7 +647,7 @@ bool smp_group_enum_mgmt::start_enum_count(uint16_t *count)
 
 bool smp_group_enum_mgmt::start_enum_list(QList<uint16_t> *groups)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_READ, smp_version, SMP_GROUP_ID_ENUM, COMMAND_LIST, 0);
     tmp_message->end_message();
 
@@ -667,7 +667,7 @@ bool smp_group_enum_mgmt::start_enum_list(QList<uint16_t> *groups)
 
 bool smp_group_enum_mgmt::start_enum_single(uint16_t index, uint16_t *id, bool *end)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_READ, smp_version, SMP_GROUP_ID_ENUM, COMMAND_SINGLE, (index > 0 ? 1 : 0));
 
     if (index > 0)
@@ -696,7 +696,7 @@ bool smp_group_enum_mgmt::start_enum_single(uint16_t index, uint16_t *id, bool *
 
 bool smp_group_enum_mgmt::start_enum_details(QList<enum_details_t> *groups, enum_fields_present_t *fields_present)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_READ, smp_version, SMP_GROUP_ID_ENUM, COMMAND_DETAILS, 0);
     tmp_message->end_message();
 
@@ -58,7 +58,7 @@ class smp_group_enum_mgmt : public smp_group
 
 public:
     smp_group_enum_mgmt(smp_processor *parent);
-    void receive_ok(uint8_t version, uint8_t op, uint16_t group, uint8_t command, QByteArray data) override;
+    void receive_ok(uint8_t version, uint8_t op, uint16_t group, uint8_t command, smp_response_view *response) override;
     void receive_error(uint8_t version, uint8_t op, uint16_t group, uint8_t command, smp_error_t error) override;
     void cancel() override;
     bool start_enum_count(uint16_t *count);
@@ -36,7 +36,8 @@ enum modes : uint8_t {
     MODE_STATUS,
     MODE_HASH_CHECKSUM,
     MODE_SUPPORTED_HASHES_CHECKSUMS,
-    MODE_FILE_CLOSE
+    MODE_FILE_CLOSE,
+    MODE_DOWNLOAD_VERIFY
 };
 
 enum fs_mgmt_commands : uint8_t {
@@ -112,200 +113,11 @@ static const QStringList smp_error_values = QStringList() <<
 smp_group_fs_mgmt::smp_group_fs_mgmt(smp_processor *parent) : smp_group(parent, "FS", SMP_GROUP_ID_FS, error_lookup, error_define_lookup)
 {
     mode = MODE_IDLE;
-}
-
-bool smp_group_fs_mgmt::parse_upload_response(QCborStreamReader &reader, uint32_t *off, bool *off_found)
-{
-    //    qDebug() << reader.lastError() << reader.hasNext();
-
-    QString key = "";
-    bool keyset = true;
-
-    while (!reader.lastError() && reader.hasNext())
-    {
-        if (keyset == false && !key.isEmpty())
-        {
-            key.clear();
-        }
-
-        keyset = false;
-
-        switch (reader.type())
-        {
-            case QCborStreamReader::UnsignedInteger:
-            {
-                if (key == "off")
-                {
-                    *off = (uint32_t)reader.toUnsignedInteger();
-                    *off_found = true;
-                }
-
-                reader.next();
-                break;
-            }
-            case QCborStreamReader::String:
-            {
-                QString data;
-                auto r = reader.readString();
-                while (r.status == QCborStreamReader::Ok)
-                {
-                    data.append(r.data);
-                    r = reader.readString();
-                }
-
-                if (r.status == QCborStreamReader::Error)
-                {
-                    data.clear();
-                    log_error() << "Error decoding string";
-                }
-                else
-                {
-                    if (key.isEmpty())
-                    {
-                        key = data;
-                        keyset = true;
-                    }
-                }
-
-                break;
-            }
-            case QCborStreamReader::Array:
-            case QCborStreamReader::Map:
-            {
-                reader.enterContainer();
-
-                while (reader.lastError() == QCborError::NoError && reader.hasNext())
-                {
-                    parse_upload_response(reader, off, off_found);
-                }
-
-                if (reader.lastError() == QCborError::NoError)
-                {
-                    reader.leaveContainer();
-                }
-
-                break;
-            }
-            default:
-            {
-                reader.next();
-                continue;
-            }
-        };
-    }
-
-    return true;
-}
-
-bool smp_group_fs_mgmt::parse_download_response(QCborStreamReader &reader, uint32_t *off, uint32_t *len, QByteArray *file_data)
-{
-    //    qDebug() << reader.lastError() << reader.hasNext();
-
-    QString key = "";
-    bool keyset = true;
-
-    while (!reader.lastError() && reader.hasNext())
-    {
-        if (keyset == false && !key.isEmpty())
-        {
-            key.clear();
-        }
-
-        keyset = false;
-
-        switch (reader.type())
-        {
-            case QCborStreamReader::UnsignedInteger:
-            {
-                if (key == "off")
-                {
-                    *off = (uint32_t)reader.toUnsignedInteger();
-                }
-                else if (key == "len")
-                {
-                    *len = (uint32_t)reader.toUnsignedInteger();
-                }
-
-                reader.next();
-                break;
-            }
-            case QCborStreamReader::String:
-            {
-                QString data;
-                auto r = reader.readString();
-                while (r.status == QCborStreamReader::Ok)
-                {
-                    data.append(r.data);
-                    r = reader.readString();
-                }
-
-                if (r.status == QCborStreamReader::Error)
-                {
-                    data.clear();
-                    log_error() << "Error decoding string";
-                }
-                else
-                {
-                    if (key.isEmpty())
-                    {
-                        key = data;
-                        keyset = true;
-                    }
-                }
-
-                break;
-            }
-            case QCborStreamReader::ByteArray:
-            {
-                QByteArray data;
-                auto r = reader.readByteArray();
-                while (r.status == QCborStreamReader::Ok)
-                {
-                    data.append(r.data);
-                    r = reader.readByteArray();
-                }
-
-                if (r.status == QCborStreamReader::Error)
-                {
-                    data.clear();
-                    log_error() << "Error decoding byte array";
-                }
-                else
-                {
-                    if (key == "data")
-                    {
-                        *file_data = data;
-                    }
-                }
-
-                break;
-            }
-            case QCborStreamReader::Array:
-            case QCborStreamReader::Map:
-            {
-                reader.enterContainer();
-
-                while (reader.lastError() == QCborError::NoError && reader.hasNext())
-                {
-                    parse_download_response(reader, off, len, file_data);
-                }
-
-                if (reader.lastError() == QCborError::NoError)
-                {
-                    reader.leaveContainer();
-                }
-
-                break;
-            }
-            default:
-            {
-                reader.next();
-                continue;
-            }
-        };
-    }
-
-    return true;
+    download_window = 1;
+    download_verify = false;
+    download_next_offset = 0;
+    download_chunk_size = 0;
+    download_received = 0;
 }
 
 bool smp_group_fs_mgmt::parse_status_response(QCborStreamReader &reader, uint32_t *len)
@@ -612,11 +424,11 @@ bool smp_group_fs_mgmt::parse_supported_hashes_checksums_response(QCborStreamRea
     return true;
 }
 
-void smp_group_fs_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group, uint8_t command, QByteArray data)
+void smp_group_fs_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group, uint8_t command, smp_response_view *response)
 {
     Q_UNUSED(op);
 
-    //    qDebug() << "Got ok: " << version << ", " << op << ", " << group << ", "  << command << ", " << data;
+    //    qDebug() << "Got ok: " << version << ", " << op << ", " << group << ", "  << command << ", " << response->data();
 
     if (mode == MODE_IDLE)
     {
@@ -643,13 +455,12 @@ void smp_group_fs_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group,
         if (mode == MODE_UPLOAD && command == COMMAND_UPLOAD_DOWNLOAD)
         {
             //Response to upload
-            bool off_found = false;
-            QCborStreamReader cbor_reader(data);
-            bool good = parse_upload_response(cbor_reader, &file_upload_area, &off_found);
+            int64_t off;
 
-            //todo
-            if (off_found == true)
+            if (response->get_integer("off", &off) == true)
             {
+                file_upload_area = (uint32_t)off;
+
                 if (file_upload_area < local_file_size)
                 {
                     //Upload next chunk
@@ -672,47 +483,122 @@ void smp_group_fs_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group,
         }
         else if (mode == MODE_DOWNLOAD && command == COMMAND_UPLOAD_DOWNLOAD)
         {
-            //Response to download
-            uint32_t off;
-            uint32_t len = 0;
-            QByteArray file_data;
-            QCborStreamReader cbor_reader(data);
-            bool good = parse_download_response(cbor_reader, &off, &len, &file_data);
+            //Response to download, these can arrive in any order when several reads are outstanding
+            int64_t off = -1;
+            int64_t len = 0;
+            const char *file_data = nullptr;
+            uint32_t file_data_length = 0;
+            fs_download_request_t request;
+            int i = 0;
+
+            response->get_integer("off", &off);
+            response->get_integer("len", &len);
+            response->get_data("data", &file_data, &file_data_length);
+
+            while (i < download_outstanding.length() && download_outstanding.at(i).offset != off)
+            {
+                ++i;
+            }
+
+            if (i == download_outstanding.length())
+            {
+                //Repeated response to a read which has already been answered
+                log_error() << "Unexpected download offset " << off << ", ignoring";
+                return;
+            }
+
+            request = download_outstanding.takeAt(i);
 
             if (len > 0)
             {
-                local_file_size = len;
+                local_file_size = (uint32_t)len;
             }
 
-            if (file_upload_area != off)
+            if (download_chunk_size == 0)
             {
-                log_error() << "Error: mismatch!";
+                //First response, the amount of data the device returns decides how far apart the read-ahead requests are
+                download_chunk_size = file_data_length;
+                request.end = request.offset + file_data_length;
+                download_next_offset = request.end;
             }
 
-            if (file_data.isEmpty() == false)
+            if (file_data_length > (request.end - request.offset))
             {
-                local_file.write(file_data);
+                file_data_length = request.end - request.offset;
             }
 
-            file_upload_area += file_data.length();
+            if (file_data_length == 0 && request.offset < local_file_size)
+            {
+                cleanup();
+                emit status(smp_user_data, STATUS_ERROR, "Device returned no data");
+                return;
+            }
 
-            if (file_upload_area < local_file_size)
+            if (file_data_length > 0)
             {
-                //Download next chunk
-                download_chunk();
-                emit progress(smp_user_data, file_upload_area * 100 / local_file_size);
+                //Written directly from the received message, at the position it belongs
+                if (local_file.pos() != request.offset)
+                {
+                    local_file.seek(request.offset);
+                }
+
+                local_file.write(file_data, file_data_length);
+                download_received += file_data_length;
+            }
+
+            if ((request.offset + file_data_length) < request.end)
+            {
+                //Short response, the rest of the range is requested again
+                request.offset += file_data_length;
+                download_missing.append(request);
+            }
+
+            file_upload_area = download_received;
+
+            if (file_upload_area < local_file_size || !download_outstanding.isEmpty())
+            {
+                if (download_fill() == true)
+                {
+                    emit progress(smp_user_data, (qint64)file_upload_area * 100 / local_file_size);
+                }
             }
             else
             {
-                //Download complete
+                download_complete();
+            }
+        }
+        else if (mode == MODE_DOWNLOAD_VERIFY && command == COMMAND_HASH_CHECKSUM)
+        {
+            //Device hash of the file which has been downloaded
+            const char *output = nullptr;
+            uint32_t output_length = 0;
+            QFile verify_file(local_file.fileName());
+            QCryptographicHash local_hash(QCryptographicHash::Sha256);
+
+            if (response->get_data("output", &output, &output_length) == false)
+            {
+                cleanup();
+                emit status(smp_user_data, STATUS_COMPLETE, "Download complete (not verified, no hash returned)");
+            }
+            else if (verify_file.open(QFile::ReadOnly) == false || local_hash.addData(&verify_file) == false)
+            {
                 cleanup();
-                emit progress(smp_user_data, 100);
-                emit status(smp_user_data, STATUS_COMPLETE, "Download complete");
+                emit status(smp_user_data, STATUS_ERROR, "Downloaded file could not be read for verification");
+            }
+            else if (local_hash.result() != QByteArray::fromRawData(output, output_length))
+            {
+                cleanup();
+                emit status(smp_user_data, STATUS_ERROR, "Download verification failed, hash does not match device");
+            }
+            else
+            {
+                cleanup();
+                emit status(smp_user_data, STATUS_COMPLETE, "Download complete and verified");
             }
         }
         else if (mode == MODE_STATUS && command == COMMAND_STATUS)
         {
-            QCborStreamReader cbor_reader(data);
+            QCborStreamReader cbor_reader(response->data());
             bool good = parse_status_response(cbor_reader, file_size_object);
 
             log_debug() << "status done";
@@ -724,7 +610,7 @@ void smp_group_fs_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group,
         else if (mode == MODE_HASH_CHECKSUM && command == COMMAND_HASH_CHECKSUM)
         {
             QString type;
-            QCborStreamReader cbor_reader(data);
+            QCborStreamReader cbor_reader(response->data());
 
             bool good = parse_hash_checksum_response(cbor_reader, &type, hash_checksum_result_object, file_size_object);
             cleanup();
@@ -733,7 +619,7 @@ void smp_group_fs_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group,
         else if (mode == MODE_SUPPORTED_HASHES_CHECKSUMS && command == COMMAND_SUPPORTED_HASHES_CHECKSUMS)
         {
             hash_checksum_t temp_item;
-            QCborStreamReader cbor_reader(data);
+            QCborStreamReader cbor_reader(response->data());
             hash_checksum_object->clear();
             bool good = parse_supported_hashes_checksums_response(cbor_reader, false, nullptr, &temp_item);
 
@@ -781,6 +667,11 @@ void smp_group_fs_mgmt::receive_error(uint8_t version, uint8_t op, uint16_t grou
         //TODO
         emit status(smp_user_data, status_error_return(error), smp_error::error_lookup_string(&error));
     }
+    else if (command == COMMAND_HASH_CHECKSUM && mode == MODE_DOWNLOAD_VERIFY)
+    {
+        //The file was downloaded, the device just cannot provide a hash to check it against (e.g. hash support is not enabled)
+        emit status(smp_user_data, STATUS_COMPLETE, QString("Download complete (not verified: %1)").arg(smp_error::error_lookup_string(&error)));
+    }
     else if (command == COMMAND_STATUS && mode == MODE_STATUS)
     {
         //TODO
@@ -826,7 +717,7 @@ bool smp_group_fs_mgmt::upload_chunk()
 {
     uint max_size = processor->max_message_data_size(smp_mtu);
     uint remaining_file_size;
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
 
     tmp_message->start_message(SMP_OP_WRITE, smp_version, SMP_GROUP_ID_FS, COMMAND_UPLOAD_DOWNLOAD, (file_upload_area == 0 ? 4 : 3));
 
@@ -865,24 +756,19 @@ bool smp_group_fs_mgmt::upload_chunk()
         return false;
     }
 
-    return handle_transport_error(processor->send(tmp_message, smp_timeout, smp_retries, true));
+    return handle_transport_error(processor->send(tmp_message, smp_timeout, smp_retries, true, SMP_PRIORITY_BULK));
 }
 
-bool smp_group_fs_mgmt::download_chunk()
+bool smp_group_fs_mgmt::download_chunk(uint32_t offset)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_READ, smp_version, SMP_GROUP_ID_FS, COMMAND_UPLOAD_DOWNLOAD, 2);
 
-/*    if (local_file.pos() != file_upload_area)
-    {
-        local_file.seek(file_upload_area);
-    }*/
-
     //TODO: Deal with size
     tmp_message->writer()->append("name");
     tmp_message->writer()->append(device_file_name);
     tmp_message->writer()->append("off");
-    tmp_message->writer()->append(file_upload_area);
+    tmp_message->writer()->append(offset);
     tmp_message->end_message();
 
     if (check_message_before_send(tmp_message) == false)
@@ -890,6 +776,88 @@ bool smp_group_fs_mgmt::download_chunk()
         return false;
     }
 
+    return handle_transport_error(processor->send(tmp_message, smp_timeout, smp_retries, true, SMP_PRIORITY_BULK));
+}
+
+bool smp_group_fs_mgmt::download_fill()
+{
+    //Keeps up to the download window of reads outstanding, the rest of short responses is requested before new data.
+    //One read is always sent if none are outstanding, as there would be no response to continue from otherwise
+    if (download_chunk_size == 0)
+    {
+        //Waiting for the response to the first read
+        return true;
+    }
+
+    while (download_outstanding.isEmpty() || (download_outstanding.length() < download_window && processor->can_send()))
+    {
+        fs_download_request_t request;
+
+        if (!download_missing.isEmpty())
+        {
+            request = download_missing.takeFirst();
+        }
+        else if (download_next_offset < local_file_size)
+        {
+            request.offset = download_next_offset;
+            request.end = request.offset + download_chunk_size;
+
+            if (request.end > local_file_size)
+            {
+                request.end = local_file_size;
+            }
+
+            download_next_offset = request.end;
+        }
+        else
+        {
+            break;
+        }
+
+        download_outstanding.append(request);
+
+        if (download_chunk(request.offset) == false)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void smp_group_fs_mgmt::download_complete()
+{
+    emit progress(smp_user_data, 100);
+
+    if (download_verify == true)
+    {
+        start_download_verify();
+        return;
+    }
+
+    cleanup();
+    emit status(smp_user_data, STATUS_COMPLETE, "Download complete");
+}
+
+bool smp_group_fs_mgmt::start_download_verify()
+{
+    //Asks the device for the SHA256 of the file, to compare with the downloaded data
+    smp_message *tmp_message = smp_message::acquire();
+    tmp_message->start_message(SMP_OP_READ, smp_version, SMP_GROUP_ID_FS, COMMAND_HASH_CHECKSUM, 2);
+    tmp_message->writer()->append("name");
+    tmp_message->writer()->append(device_file_name);
+    tmp_message->writer()->append("type");
+    tmp_message->writer()->append("sha256");
+    tmp_message->end_message();
+
+    local_file.close();
+    mode = MODE_DOWNLOAD_VERIFY;
+
+    if (check_message_before_send(tmp_message) == false)
+    {
+        return false;
+    }
+
     return handle_transport_error(processor->send(tmp_message, smp_timeout, smp_retries, true));
 }
 
@@ -927,27 +895,34 @@ bool smp_group_fs_mgmt::start_download(QString file_name, QString destination_na
     mode = MODE_DOWNLOAD;
     device_file_name = file_name;
     file_upload_area = 0;
+    local_file_size = 0;
+    download_next_offset = 0;
+    download_chunk_size = 0;
+    download_received = 0;
+    download_outstanding.clear();
+    download_missing.clear();
     upload_tmr.start();
 
-    //	    qDebug() << "len: " << message.length();
+    //The first read is sent on its own, its response gives the file size and the device's chunk size
+    download_outstanding.append(fs_download_request_t{0, UINT32_MAX});
 
-    return download_chunk();
+    return download_chunk(0);
 }
 
 //TODO
 bool smp_group_fs_mgmt::start_status(QString file_name, uint32_t *file_size)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_READ, smp_version, SMP_GROUP_ID_FS, COMMAND_STATUS, 1);
     tmp_message->writer()->append("name");
     tmp_message->writer()->append(file_name);
     tmp_message->end_message();
 
-    if (tmp_message->contents().length() > processor->max_message_data_size(smp_mtu))
+    if (tmp_message->data_size() > processor->max_message_data_size(smp_mtu))
     {
-        QString response = QString("Message is too large to send: ") % QString::number(tmp_message->contents().length()) % " vs " % QString::number(processor->max_message_data_size(smp_mtu)) % " maximum";
+        QString response = QString("Message is too large to send: ") % QString::number(tmp_message->data_size()) % " vs " % QString::number(processor->max_message_data_size(smp_mtu)) % " maximum";
 
-        delete tmp_message;
+        smp_message::release(tmp_message);
         emit status(smp_user_data, STATUS_ERROR, response);
         return false;
     }
@@ -966,7 +941,7 @@ bool smp_group_fs_mgmt::start_status(QString file_name, uint32_t *file_size)
 
 bool smp_group_fs_mgmt::start_hash_checksum(QString file_name, QString hash_checksum, QByteArray *result, uint32_t *file_size)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_READ, smp_version, SMP_GROUP_ID_FS, COMMAND_HASH_CHECKSUM, 2);
     tmp_message->writer()->append("name");
     tmp_message->writer()->append(file_name);
@@ -990,7 +965,7 @@ bool smp_group_fs_mgmt::start_hash_checksum(QString file_name, QString hash_chec
 
 bool smp_group_fs_mgmt::start_supported_hashes_checksums(QList<hash_checksum_t> *hash_checksum_list)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_READ, smp_version, SMP_GROUP_ID_FS, COMMAND_SUPPORTED_HASHES_CHECKSUMS, 0);
     tmp_message->end_message();
 
@@ -1007,7 +982,7 @@ bool smp_group_fs_mgmt::start_supported_hashes_checksums(QList<hash_checksum_t>
 
 bool smp_group_fs_mgmt::start_file_close()
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_WRITE, smp_version, SMP_GROUP_ID_FS, COMMAND_FILE_CLOSE, 0);
     tmp_message->end_message();
 
@@ -1039,6 +1014,8 @@ QString smp_group_fs_mgmt::mode_to_string(uint8_t mode)
         return "Supported hashes/checksums";
     case MODE_FILE_CLOSE:
         return "Closing file";
+    case MODE_DOWNLOAD_VERIFY:
+        return "Verifying download";
     default:
         return "Invalid";
     }
@@ -1089,6 +1066,16 @@ bool smp_group_fs_mgmt::error_define_lookup(int32_t rc, QString *error)
     return false;
 }
 
+void smp_group_fs_mgmt::set_download_window(uint8_t window)
+{
+    download_window = (window == 0 ? 1 : window);
+}
+
+void smp_group_fs_mgmt::set_download_verify(bool enabled)
+{
+    download_verify = enabled;
+}
+
 void smp_group_fs_mgmt::flip_endian(uint8_t *data, uint8_t size)
 {
     uint8_t i = 0;
@@ -1122,6 +1109,11 @@ void smp_group_fs_mgmt::cleanup()
     }
 
     device_file_name.clear();
+    download_next_offset = 0;
+    download_chunk_size = 0;
+    download_received = 0;
+    download_outstanding.clear();
+    download_missing.clear();
     hash_checksum_object = nullptr;
     hash_checksum_result_object = nullptr;
     file_size_object = nullptr;
@@ -34,6 +34,7 @@
 #include <QCborMap>
 #include <QCborValue>
 #include <QFile>
+#include <QCryptographicHash>
 
 /******************************************************************************/
 // Forward declaration of Class, Struct & Unions
@@ -44,6 +45,12 @@ struct hash_checksum_t {
     uint16_t size;
 };
 
+//Range of a file requested by one download read, the device may return less than this
+struct fs_download_request_t {
+    uint32_t offset;
+    uint32_t end;
+};
+
 /******************************************************************************/
 // Class definitions
 /******************************************************************************/
@@ -53,7 +60,7 @@ class smp_group_fs_mgmt : public smp_group
 
 public:
     smp_group_fs_mgmt(smp_processor *parent);
-    void receive_ok(uint8_t version, uint8_t op, uint16_t group, uint8_t command, QByteArray data) override;
+    void receive_ok(uint8_t version, uint8_t op, uint16_t group, uint8_t command, smp_response_view *response) override;
     void receive_error(uint8_t version, uint8_t op, uint16_t group, uint8_t command, smp_error_t error) override;
     void cancel() override;
     bool start_upload(QString file_name, QString destination_name);
@@ -62,6 +69,8 @@ public:
     bool start_hash_checksum(QString file_name, QString hash_checksum, QByteArray *result, uint32_t *file_size);
     bool start_supported_hashes_checksums(QList<hash_checksum_t> *hash_checksum_list);
     bool start_file_close();
+    void set_download_window(uint8_t window);
+    void set_download_verify(bool enabled);
 
 protected:
     void cleanup() override;
@@ -71,14 +80,15 @@ protected:
 private:
     static bool error_lookup(int32_t rc, QString *error);
     static bool error_define_lookup(int32_t rc, QString *error);
-    bool parse_upload_response(QCborStreamReader &reader, uint32_t *off, bool *off_found);
-    bool parse_download_response(QCborStreamReader &reader, uint32_t *off, uint32_t *len, QByteArray *file_data);
     bool parse_status_response(QCborStreamReader &reader, uint32_t *len);
     bool parse_hash_checksum_response(QCborStreamReader &reader, QString *type, QByteArray *hash_checksum, uint32_t *file_size);
     bool parse_supported_hashes_checksums_response(QCborStreamReader &reader, bool in_data, QString *key_name, hash_checksum_t *current_item);
 //    bool parse_file_close_response(QCborStreamReader &reader, int32_t *ret, QString *response);
     bool upload_chunk();
-    bool download_chunk();
+    bool download_chunk(uint32_t offset);
+    bool download_fill();
+    void download_complete();
+    bool start_download_verify();
     void flip_endian(uint8_t *data, uint8_t size);
 
     //
@@ -90,6 +100,13 @@ private:
     QList<hash_checksum_t> *hash_checksum_object;
     QByteArray *hash_checksum_result_object;
     uint32_t *file_size_object;
+    uint8_t download_window; //Number of download reads to have outstanding at once
+    bool download_verify; //Compare the hash of downloaded files with the device's
+    uint32_t download_next_offset; //Start of the file which has not been requested yet
+    uint32_t download_chunk_size; //Data size of the first response, used to space the read-ahead requests
+    uint32_t download_received; //Bytes written to the local file
+    QList<fs_download_request_t> download_outstanding; //Reads which have not been answered yet
+    QList<fs_download_request_t> download_missing; //Parts of short responses, requested before new data
 };
 
 #endif // SMP_GROUP_FS_MGMT_H
@@ -75,6 +75,9 @@ static const uint8_t ih_hdr_size_offs = 8;
 static const uint8_t ih_protected_tlv_size_offs = 10;
 static const uint8_t ih_img_size_offs = 12;
 
+//Size of blocks the image is fed into the session hash in
+static const qint64 session_hash_block_size = 1024 * 1024;
+
 static const QStringList smp_error_defines = QStringList() <<
     //Error index starts from 2 (no error and unknown error are common and handled in the base code)
     "FLASH_CONFIG_QUERY_FAIL" <<
@@ -148,21 +151,46 @@ static const QStringList smp_error_values = QStringList() <<
 /******************************************************************************/
 // Local Functions or Private Members
 /******************************************************************************/
+static uint16_t image_read_uint16(const uchar *data, bool little_endian)
+{
+    if (little_endian == true)
+    {
+        return (uint16_t)data[0] | ((uint16_t)data[1] << 8);
+    }
+
+    return (uint16_t)data[1] | ((uint16_t)data[0] << 8);
+}
+
+static uint32_t image_read_uint32(const uchar *data, bool little_endian)
+{
+    if (little_endian == true)
+    {
+        return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+    }
+
+    return (uint32_t)data[3] | ((uint32_t)data[2] << 8) | ((uint32_t)data[1] << 16) | ((uint32_t)data[0] << 24);
+}
+
 smp_group_img_mgmt::smp_group_img_mgmt(smp_processor *parent) : smp_group(parent, "IMG", SMP_GROUP_ID_IMG, error_lookup, error_define_lookup)
 {
     mode = MODE_IDLE;
+    upload_window = 1;
+    upload_next_offset = 0;
+    upload_rewinding = false;
+    upload_data = nullptr;
+    upload_data_size = 0;
 }
 
-bool smp_group_img_mgmt::extract_header(QByteArray *file_data, image_endian_t *endian)
+bool smp_group_img_mgmt::extract_header(const uchar *file_data, qint64 file_size, image_endian_t *endian)
 {
     uint8_t mcuboot_magic[sizeof(ih_magic_none)];
 
-    if (file_data->length() < (int)sizeof(mcuboot_magic))
+    if (file_size < (qint64)(ih_img_size_offs + sizeof(uint32_t)))
     {
         return false;
     }
 
-    memcpy(mcuboot_magic, file_data->data(), sizeof(mcuboot_magic));
+    memcpy(mcuboot_magic, file_data, sizeof(mcuboot_magic));
 
     if (memcmp(mcuboot_magic, ih_magic_v2, sizeof(mcuboot_magic)) == 0 || memcmp(mcuboot_magic, ih_magic_v1, sizeof(mcuboot_magic)) == 0)
     {
@@ -194,7 +222,7 @@ bool smp_group_img_mgmt::extract_header(QByteArray *file_data, image_endian_t *e
     return true;
 }
 
-bool smp_group_img_mgmt::extract_hash(QByteArray *file_data, QByteArray *hash)
+bool smp_group_img_mgmt::extract_hash(const uchar *file_data, qint64 file_size, QByteArray *hash)
 {
     bool found = false;
     bool hash_found = false;
@@ -204,64 +232,35 @@ bool smp_group_img_mgmt::extract_hash(QByteArray *file_data, QByteArray *hash)
     uint32_t img_size;
 
 #if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
-    if (upload_endian != ENDIAN_BIG)
+    bool little_endian = (upload_endian != ENDIAN_BIG);
 #else
-    if (upload_endian != ENDIAN_LITTLE)
+    bool little_endian = (upload_endian != ENDIAN_LITTLE);
 #endif
-    {
-        hdr_size = (uint8_t)file_data->at(ih_hdr_size_offs);
-        hdr_size |= (uint16_t)((uint8_t)file_data->at(ih_hdr_size_offs + 1)) << 8;
-
-        protected_tlv_size = (uint8_t)file_data->at(ih_protected_tlv_size_offs);
-        protected_tlv_size |= (uint16_t)((uint8_t)file_data->at(ih_protected_tlv_size_offs + 1)) << 8;
+    const char *tlv_magic = (upload_endian != ENDIAN_BIG ? image_tlv_magic.constData() : image_tlv_magic_reverse_endian.constData());
 
-        img_size = (uint8_t)file_data->at(ih_img_size_offs);
-        img_size |= (uint32_t)((uint8_t)file_data->at(ih_img_size_offs + 1)) << 8;
-        img_size |= (uint32_t)((uint8_t)file_data->at(ih_img_size_offs + 2)) << 16;
-        img_size |= (uint32_t)((uint8_t)file_data->at(ih_img_size_offs + 3)) << 24;
-    }
-    else
+    if (file_size < (qint64)(ih_img_size_offs + sizeof(uint32_t)))
     {
-        hdr_size = (uint8_t)file_data->at(ih_hdr_size_offs + 1);
-        hdr_size |= (uint16_t)((uint8_t)file_data->at(ih_hdr_size_offs)) << 8;
-
-        protected_tlv_size = (uint8_t)file_data->at(ih_protected_tlv_size_offs + 1);
-        protected_tlv_size |= (uint16_t)((uint8_t)file_data->at(ih_protected_tlv_size_offs)) << 8;
-
-        img_size = (uint8_t)file_data->at(ih_img_size_offs + 3);
-        img_size |= (uint32_t)((uint8_t)file_data->at(ih_img_size_offs + 2)) << 8;
-        img_size |= (uint32_t)((uint8_t)file_data->at(ih_img_size_offs + 1)) << 16;
-        img_size |= (uint32_t)((uint8_t)file_data->at(ih_img_size_offs)) << 24;
+        return false;
     }
 
+    hdr_size = image_read_uint16(&file_data[ih_hdr_size_offs], little_endian);
+    protected_tlv_size = image_read_uint16(&file_data[ih_protected_tlv_size_offs], little_endian);
+    img_size = image_read_uint32(&file_data[ih_img_size_offs], little_endian);
+
     if (img_size >= INT32_MAX)
     {
         log_error() << "Decoded image size is not valid: " << img_size;
         return false;
     }
 
-    int32_t pos = hdr_size + protected_tlv_size + img_size;
+    qint64 pos = (qint64)hdr_size + protected_tlv_size + img_size;
     uint16_t tlv_area_length;
 
-    while ((pos + image_tlv_magic_size) < file_data->length())
+    while ((pos + image_tlv_header_size) <= file_size)
     {
-        if ((upload_endian != ENDIAN_BIG && file_data->mid(pos, image_tlv_magic_size) == image_tlv_magic) || (upload_endian == ENDIAN_BIG && file_data->mid(pos, image_tlv_magic_size) == image_tlv_magic_reverse_endian))
+        if (memcmp(&file_data[pos], tlv_magic, image_tlv_magic_size) == 0)
         {
-#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
-            if (upload_endian != ENDIAN_BIG)
-#else
-            if (upload_endian != ENDIAN_LITTLE)
-#endif
-            {
-                tlv_area_length = (uint8_t)file_data->at(pos + image_tlv_legnth_offset_1);
-                tlv_area_length |= (uint16_t)((uint8_t)file_data->at(pos + image_tlv_legnth_offset_2)) << 8;
-            }
-            else
-            {
-                tlv_area_length = (uint8_t)file_data->at(pos + image_tlv_legnth_offset_2);
-                tlv_area_length |= (uint16_t)((uint8_t)file_data->at(pos + image_tlv_legnth_offset_1)) << 8;
-            }
-
+            tlv_area_length = image_read_uint16(&file_data[pos + image_tlv_legnth_offset_1], little_endian);
             found = true;
             // qDebug() << "Found magic tlv, size:" << tlv_area_length;
             break;
@@ -272,28 +271,13 @@ bool smp_group_img_mgmt::extract_hash(QByteArray *file_data, QByteArray *hash)
 
     if (found == true)
     {
-        int32_t new_pos = pos + image_tlv_header_size;
+        qint64 new_pos = pos + image_tlv_header_size;
 
-        while (new_pos < pos + tlv_area_length)
+        while (new_pos < pos + tlv_area_length && (new_pos + image_tlv_data_header_size) <= file_size)
         {
             //TODO: TLVs are > 8-bit
-            uint8_t type = file_data->at(new_pos);
-            uint16_t local_length;
-
-#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
-            if (upload_endian != ENDIAN_BIG)
-#else
-            if (upload_endian != ENDIAN_LITTLE)
-#endif
-            {
-                local_length = (uint8_t)file_data->at(new_pos + image_tlv_legnth_offset_1);
-                local_length |= (uint16_t)((uint8_t)file_data->at(new_pos + image_tlv_legnth_offset_2)) << 8;
-            }
-            else
-            {
-                local_length = (uint8_t)file_data->at(new_pos + image_tlv_legnth_offset_2);
-                local_length |= (uint16_t)((uint8_t)file_data->at(new_pos + image_tlv_legnth_offset_1)) << 8;
-            }
+            uint8_t type = file_data[new_pos];
+            uint16_t local_length = image_read_uint16(&file_data[new_pos + image_tlv_legnth_offset_1], little_endian);
 
             //		    qDebug() << "Type " << type << ", length " << local_length;
 
@@ -308,10 +292,10 @@ bool smp_group_img_mgmt::extract_hash(QByteArray *file_data, QByteArray *hash)
                     return false;
                 }
 
-                if (local_length == hash_size)
+                if (local_length == hash_size && (new_pos + image_tlv_data_header_size + local_length) <= file_size)
                 {
-                    //We have the hash we wanted
-                    *hash = file_data->mid((new_pos + 4), local_length);
+                    //We have the hash we wanted, copy it as the file data will not outlive the upload
+                    *hash = QByteArray((const char *)&file_data[new_pos + image_tlv_data_header_size], local_length);
                     hash_found = true;
                 }
                 else
@@ -321,128 +305,13 @@ bool smp_group_img_mgmt::extract_hash(QByteArray *file_data, QByteArray *hash)
                 }
             }
 
-            new_pos += local_length + 4;
+            new_pos += local_length + image_tlv_data_header_size;
         }
     }
 
     return hash_found;
 }
 
-bool smp_group_img_mgmt::parse_upload_response(QCborStreamReader &reader, int64_t *new_off, img_mgmt_upload_match *match)
-{
-    QString key = "";
-    bool keyset = true;
-
-    while (!reader.lastError() && reader.hasNext())
-    {
-        if (keyset == false && !key.isEmpty())
-        {
-            key.clear();
-        }
-
-        keyset = false;
-
-        //	    qDebug() << "Key: " << key;
-        //	    qDebug() << "Type: " << reader.type();
-        switch (reader.type())
-        {
-            case QCborStreamReader::SimpleType:
-            {
-                if (key == "match")
-                {
-                    bool match_value = reader.toBool();
-
-                    if (match_value == true)
-                    {
-                        *match = MATCH_FAILED;
-                    }
-                    else
-                    {
-                        *match = MATCH_PASSED;
-                    }
-                }
-
-                reader.next();
-                break;
-            }
-
-            case QCborStreamReader::UnsignedInteger:
-            case QCborStreamReader::NegativeInteger:
-            {
-                if (key == "off")
-                {
-                    //			    qDebug() << "found off";
-                    *new_off = reader.toInteger();
-                }
-
-                reader.next();
-                break;
-            }
-
-            case QCborStreamReader::ByteArray:
-            {
-                auto r = reader.readByteArray();
-
-                while (r.status == QCborStreamReader::Ok)
-                {
-                    r = reader.readByteArray();
-                }
-
-                break;
-            }
-
-            case QCborStreamReader::String:
-            {
-                QString data;
-                auto r = reader.readString();
-                while (r.status == QCborStreamReader::Ok)
-                {
-                    data.append(r.data);
-                    r = reader.readString();
-                }
-
-                if (r.status == QCborStreamReader::Error)
-                {
-                    data.clear();
-                    log_error() << "Error decoding string";
-                }
-                else
-                {
-                    if (key.isEmpty())
-                    {
-                        key = data;
-                        keyset = true;
-                    }
-                }
-
-                break;
-            }
-
-            case QCborStreamReader::Array:
-            case QCborStreamReader::Map:
-            {
-                reader.enterContainer();
-                while (reader.lastError() == QCborError::NoError && reader.hasNext())
-                {
-                    parse_upload_response(reader, new_off, match);
-                }
-                if (reader.lastError() == QCborError::NoError)
-                {
-                    reader.leaveContainer();
-                }
-                break;
-            }
-
-            default:
-            {
-                reader.next();
-            }
-        }
-    }
-
-    return true;
-}
-
 bool smp_group_img_mgmt::parse_state_response(QCborStreamReader &reader, QString array_name)
 {
     QString array_name_dupe = array_name;
@@ -827,74 +696,103 @@ bool smp_group_img_mgmt::parse_slot_info_response(QCborStreamReader &reader, QLi
     return (reader.lastError() ? false : true);
 }
 
-void smp_group_img_mgmt::file_upload(QByteArray *message)
+void smp_group_img_mgmt::file_upload(smp_response_view *response)
 {
     int64_t off = -1;
     bool good = true;
 
-    if (message != nullptr)
+    if (response != nullptr)
     {
-        img_mgmt_upload_match match = MATCH_NOT_PRESENT;
-        QCborStreamReader cbor_reader(*message);
-        good = parse_upload_response(cbor_reader, &off, &match);
+        response->get_integer("off", &off);
 
     //    qDebug() << "rc = " << rc << ", off = " << off;
 
         if (off != -1 /*&& rc != 9*/)
         {
-            if (off < this->file_upload_area)
+            int outstanding_index = upload_outstanding.indexOf((uint32_t)off);
+
+            if (outstanding_index != -1)
             {
-                ++upload_repeated_parts;
+                //Chunk was accepted, the device is now expecting the data after it
+                upload_outstanding.removeAt(outstanding_index);
+                upload_repeated_parts = 0;
+            }
+            else if (!upload_outstanding.isEmpty())
+            {
+                //Device rejected a chunk (lost or duplicated), chunks sent after it will also be rejected so stop sending and rewind once they have all been answered
+                if (upload_rewinding == false)
+                {
+                    log_debug() << "Upload offset mismatch, device expects " << off << ", rewinding";
+                }
+
+                upload_outstanding.removeFirst();
+                upload_rewinding = true;
 
-                if (upload_repeated_parts > 3)
+                if (off < this->file_upload_area)
                 {
-                    //Repeated lower offset 3 times, going in loop uploading the same thing over and over
-//TODO:
-log_error() << "Going in circles...";
+                    ++upload_repeated_parts;
+
+                    if (upload_repeated_parts > 3)
+                    {
+                        //Device keeps asking for data before what it has already accepted, it has lost the upload so continue from where it is
+                        log_error() << "Going in circles...";
+                        this->file_upload_area = off;
+                    }
                 }
             }
-            else
+
+            //Responses can arrive out of order when several chunks are outstanding, an older response does not move the upload back
+            if (off > this->file_upload_area)
             {
-                upload_repeated_parts = 0;
+                this->file_upload_area = off;
             }
-
-            this->file_upload_area = off;
         }
         else
         {
+            if (!upload_outstanding.isEmpty())
+            {
+                upload_outstanding.removeFirst();
+            }
+
             upload_repeated_parts = 0;
         }
         //    qDebug() << "good is " << good;
 
+        if (upload_outstanding.isEmpty())
+        {
+            //Nothing in flight, continue from wherever the device says it is
+            upload_next_offset = this->file_upload_area;
+            upload_rewinding = false;
+        }
+
         if (this->file_upload_area != 0)
         {
-            emit progress(smp_user_data, this->file_upload_area * 100 / this->file_upload_data.length());
-            //progress_IMG_Complete->setValue(this->file_upload_area * 100 / this->file_upload_data.length());
+            emit progress(smp_user_data, (qint64)this->file_upload_area * 100 / this->upload_data_size);
+            //progress_IMG_Complete->setValue(this->file_upload_area * 100 / this->upload_data_size);
         }
     }
 
     if (good == true)
     {
-        //Upload next chunk
-        uint max_size = processor->max_message_data_size(smp_mtu);
-
-        if (this->file_upload_area >= (uint32_t)this->file_upload_data.length())
+        if (this->file_upload_area >= this->upload_data_size && upload_outstanding.isEmpty())
         {
             double upload_speed = NAN;
+            double bytes_per_second = NAN;
             uint8_t prefix = 0;
             QString speed_string;
 
             if (this->upload_tmr.isValid() == true)
             {
-                upload_speed = (double)(this->upload_tmr.elapsed() / 1000);
+                qint64 elapsed_ms = this->upload_tmr.elapsed();
 
-                //If upload was completed in under a second, change to use time of 1 second (estimated speed is inaccurate anyway)
-                if (upload_speed < 1.0)
+                //Avoid division by zero for very small uploads (estimated speed is inaccurate anyway)
+                if (elapsed_ms < 1)
                 {
-                    upload_speed = 1.0;
+                    elapsed_ms = 1;
                 }
 
-                upload_speed = (double)this->file_upload_data.length() / upload_speed;
+                bytes_per_second = (double)this->upload_data_size * 1000.0 / (double)elapsed_ms;
+                upload_speed = bytes_per_second;
 
                 while (upload_speed >= 1024.0 && prefix < 3)
                 {
@@ -926,7 +824,7 @@ log_error() << "Going in circles...";
                         speed_string = "GiB";
                     }
 
-                    speed_string = QString("~").append(QString::number(upload_speed)).append(speed_string).append("ps throughput");
+                    speed_string = QString("~").append(QString::number(upload_speed, 'f', 1)).append(speed_string).append("ps throughput (").append(QString::number((qint64)bytes_per_second)).append(" bytes/second in ").append(QString::number(elapsed_ms)).append("ms, window of ").append(QString::number(upload_window)).append(")");
                 }
             }
 
@@ -937,10 +835,11 @@ log_error() << "Going in circles...";
 
             mode = MODE_IDLE;
             this->upload_image = 0;
-            this->file_upload_data.clear();
+            release_upload_data();
             this->upload_tmr.invalidate();
             this->upload_hash.clear();
             this->file_upload_area = 0;
+            this->upload_next_offset = 0;
             this->upgrade_only = false;
 //                emit plugin_set_status(false, false);
 //                lbl_IMG_Status->setText("Finished.");
@@ -950,65 +849,104 @@ log_error() << "Going in circles...";
             return;
         }
 
-        smp_message *tmp_message = new smp_message();
-        tmp_message->start_message(SMP_OP_WRITE, smp_version, SMP_GROUP_ID_IMG, COMMAND_UPLOAD, 2 + (this->file_upload_area == 0 ? ((this->upload_image != 0 ? 1 : 0) + 2 + (this->upgrade_only == true ? 1 : 0)): 0));
-
-        if (this->file_upload_area == 0)
+        //Keep up to the window size of chunks outstanding, limited by how many requests the processor can have in flight.
+        //One chunk is always sent if none are outstanding, as there would be no response to continue from otherwise
+        while (upload_rewinding == false && upload_next_offset < this->upload_data_size && (upload_outstanding.isEmpty() || (upload_outstanding.length() < upload_window && processor->can_send())))
         {
-            //Initial packet, extra data is needed: generate upload hash
-            QByteArray session_hash = QCryptographicHash::hash(this->file_upload_data, QCryptographicHash::Sha256);
+            bool initial_chunk = (upload_next_offset == 0);
 
-            if (this->upload_image != 0)
+            if (upload_chunk() == false)
             {
-                tmp_message->writer()->append("image");
-                tmp_message->writer()->append(this->upload_image);
+                return;
             }
 
-            tmp_message->writer()->append("len");
-            tmp_message->writer()->append(this->file_upload_data.length());
-            tmp_message->writer()->append("sha");
-            tmp_message->writer()->append(session_hash);
-
-            if (this->upgrade_only == true)
+            if (initial_chunk == true)
             {
-                tmp_message->writer()->append("upgrade");
-                tmp_message->writer()->append(true);
+                //Initial chunk carries the image details and version check, wait for it to be accepted before pipelining
+                break;
             }
         }
+    }
+    else
+    {
+        cleanup();
+    }
+}
 
-        tmp_message->writer()->append("off");
-        tmp_message->writer()->append(this->file_upload_area);
-        tmp_message->writer()->append("data");
-
-        //CBOR element header is 2 bytes with 1 byte end token for byte string data, have to include 1 byte header and 4 bytes data for 'data' element too
-        max_size = max_size - tmp_message->size() - 3 - 5;
-
-        tmp_message->writer()->append(this->file_upload_data.mid(this->file_upload_area, max_size));
+bool smp_group_img_mgmt::upload_chunk()
+{
+    uint max_size = processor->max_message_data_size(smp_mtu);
+    uint32_t chunk_offset = upload_next_offset;
+    uint32_t chunk_size;
 
-        //	    qDebug() << "off: " << this->file_upload_area << ", left: " << this->file_upload_data.length();
+    smp_message *tmp_message = smp_message::acquire();
+    tmp_message->start_message(SMP_OP_WRITE, smp_version, SMP_GROUP_ID_IMG, COMMAND_UPLOAD, 2 + (chunk_offset == 0 ? ((this->upload_image != 0 ? 1 : 0) + 2 + (this->upgrade_only == true ? 1 : 0)): 0));
 
-        tmp_message->end_message();
+    if (chunk_offset == 0)
+    {
+        //Initial packet, extra data is needed: upload hash
+        if (this->upload_image != 0)
+        {
+            tmp_message->writer()->append("image");
+            tmp_message->writer()->append(this->upload_image);
+        }
 
-        //      qDebug() << "len: " << tmp_message->data()->length();
+        tmp_message->writer()->append("len");
+        tmp_message->writer()->append((quint64)this->upload_data_size);
+        tmp_message->writer()->append("sha");
+        tmp_message->writer()->append(this->upload_session_hash);
 
-        if (check_message_before_send(tmp_message) == false)
+        if (this->upgrade_only == true)
         {
-            return;
+            tmp_message->writer()->append("upgrade");
+            tmp_message->writer()->append(true);
         }
+    }
+
+    tmp_message->writer()->append("off");
+    tmp_message->writer()->append(chunk_offset);
+    tmp_message->writer()->append("data");
+
+    //CBOR element header is 2 bytes with 1 byte end token for byte string data, have to include 1 byte header and 4 bytes data for 'data' element too
+    max_size = max_size - tmp_message->size() - 3 - 5;
+    chunk_size = (uint32_t)(this->upload_data_size - chunk_offset);
 
-        handle_transport_error(processor->send(tmp_message, smp_timeout, smp_retries, (this->file_upload_area == 0 ? true : false)));
+    if (chunk_size > max_size)
+    {
+        chunk_size = max_size;
     }
-    else
+
+    //Non-owning view of the file data, avoids copying the chunk before it is encoded
+    tmp_message->writer()->append(QByteArray::fromRawData((const char *)&this->upload_data[chunk_offset], chunk_size));
+
+    //	    qDebug() << "off: " << chunk_offset << ", left: " << this->upload_data_size;
+
+    tmp_message->end_message();
+
+    //      qDebug() << "len: " << tmp_message->data()->length();
+
+    if (check_message_before_send(tmp_message) == false)
     {
-        cleanup();
+        return false;
     }
+
+    if (handle_transport_error(processor->send(tmp_message, smp_timeout, smp_retries, (chunk_offset == 0 ? true : false), SMP_PRIORITY_BULK)) == false)
+    {
+        return false;
+    }
+
+    //Device responds with the offset after this chunk once it has been written
+    upload_outstanding.append(chunk_offset + chunk_size);
+    upload_next_offset = chunk_offset + chunk_size;
+
+    return true;
 }
 
-void smp_group_img_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group, uint8_t command, QByteArray data)
+void smp_group_img_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group, uint8_t command, smp_response_view *response)
 {
     Q_UNUSED(op);
 
-//    qDebug() << "Got ok: " << version << ", " << op << ", " << group << ", "  << command << ", " << data;
+//    qDebug() << "Got ok: " << version << ", " << op << ", " << group << ", "  << command << ", " << response->data();
 
     if (mode == MODE_IDLE)
     {
@@ -1050,7 +988,7 @@ void smp_group_img_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group,
                 emit plugin_set_status(false, false);
             }
 #endif
-            file_upload(&data);
+            file_upload(response);
         }
         else if (mode == MODE_SET_IMAGE && command == COMMAND_STATE)
         {
@@ -1062,7 +1000,7 @@ void smp_group_img_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group,
                 host_images->clear();
             }
 
-            QCborStreamReader cbor_reader(data);
+            QCborStreamReader cbor_reader(response->data());
             bool good = parse_state_response(cbor_reader, "");
             //		    qDebug() << "Got " << good << ", " << rc;
 
@@ -1079,7 +1017,7 @@ void smp_group_img_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group,
 //TODO:
             //Response to set image state
             //            message.remove(0, 8);
-            QCborStreamReader cbor_reader(data);
+            QCborStreamReader cbor_reader(response->data());
             bool good = parse_state_response(cbor_reader, "");
             //		    qDebug() << "Got " << good << ", " << rc;
 
@@ -1100,7 +1038,7 @@ void smp_group_img_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group,
         else if (mode == MODE_SLOT_INFO && command == COMMAND_SLOT_INFO)
         {
             //Response to slot info
-            QCborStreamReader cbor_reader(data);
+            QCborStreamReader cbor_reader(response->data());
             bool good = parse_slot_info_response(cbor_reader, host_slots, NULL, NULL);
             cleanup();
             emit status(smp_user_data, STATUS_COMPLETE, nullptr);
@@ -1178,7 +1116,7 @@ bool smp_group_img_mgmt::start_image_get(QList<image_state_t> *images)
 //    model_image_state.clear();
     host_images->clear();
 
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_READ, smp_version, SMP_GROUP_ID_IMG, COMMAND_STATE, 0);
     tmp_message->end_message();
 
@@ -1198,7 +1136,7 @@ bool smp_group_img_mgmt::start_image_set(QByteArray *hash, bool confirm, QList<i
 {
     host_images = images;
 
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_WRITE, smp_version, SMP_GROUP_ID_IMG, COMMAND_STATE, (confirm == true ? 2 : 1));
 
     tmp_message->writer()->append("hash");
@@ -1228,36 +1166,71 @@ bool smp_group_img_mgmt::start_image_set(QByteArray *hash, bool confirm, QList<i
 bool smp_group_img_mgmt::start_firmware_update(uint8_t image, QString filename, bool upgrade, QByteArray *image_hash)
 {
     //Upload
-    QFile file(filename);
+    release_upload_data();
+    upload_file.setFileName(filename);
 
-    if (!file.open(QFile::ReadOnly))
+    if (!upload_file.open(QFile::ReadOnly))
     {
         emit status(smp_user_data, STATUS_ERROR, "File open failed");
         return false;
     }
 
-    this->file_upload_data.clear();
-    this->file_upload_data.append(file.readAll());
+    //Map the file rather than reading it all into memory, chunks are then encoded directly from the mapping
+    upload_data_size = upload_file.size();
+    upload_data = (upload_data_size > 0 ? upload_file.map(0, upload_data_size) : nullptr);
 
-    file.close();
+    if (upload_data == nullptr)
+    {
+        //Not all files can be mapped (e.g. on some network filesystems), fall back to reading it into memory
+        file_upload_data = upload_file.readAll();
+        upload_file.close();
+        upload_data = (const uchar *)file_upload_data.constData();
+        upload_data_size = file_upload_data.length();
+    }
 
-    if (extract_header(&this->file_upload_data, &upload_endian) == false)
+    if (extract_header(upload_data, upload_data_size, &upload_endian) == false)
     {
-        this->file_upload_data.clear();
+        release_upload_data();
         emit status(smp_user_data, STATUS_ERROR, "MCUboot header was not found");
         return false;
     }
-    else if (extract_hash(&this->file_upload_data, &this->upload_hash) == false)
+    else if (extract_hash(upload_data, upload_data_size, &this->upload_hash) == false)
     {
-        this->file_upload_data.clear();
+        release_upload_data();
         emit status(smp_user_data, STATUS_ERROR, "Hash was not found");
         return false;
     }
 
+    //Generate the session hash once in fixed size blocks, it is needed again if the device rewinds the upload to the start
+    QCryptographicHash session_hash(QCryptographicHash::Sha256);
+    qint64 hash_pos = 0;
+
+    while (hash_pos < upload_data_size)
+    {
+        qint64 hash_block = upload_data_size - hash_pos;
+
+        if (hash_block > session_hash_block_size)
+        {
+            hash_block = session_hash_block_size;
+        }
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+        session_hash.addData(QByteArrayView(&upload_data[hash_pos], hash_block));
+#else
+        session_hash.addData((const char *)&upload_data[hash_pos], hash_block);
+#endif
+        hash_pos += hash_block;
+    }
+
+    upload_session_hash = session_hash.result();
+
     //Send start
     mode = MODE_UPLOAD_FIRMWARE;
     this->upload_image = image;
     this->file_upload_area = 0;
+    this->upload_next_offset = 0;
+    this->upload_outstanding.clear();
+    this->upload_rewinding = false;
     this->upgrade_only = upgrade;
     this->upload_tmr.start();
 
@@ -1273,7 +1246,7 @@ bool smp_group_img_mgmt::start_firmware_update(uint8_t image, QString filename,
 
 bool smp_group_img_mgmt::start_image_erase(uint8_t slot)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_WRITE, smp_version, SMP_GROUP_ID_IMG, COMMAND_ERASE, 1);
 
     tmp_message->writer()->append("slot");
@@ -1295,7 +1268,7 @@ bool smp_group_img_mgmt::start_image_erase(uint8_t slot)
 
 bool smp_group_img_mgmt::start_image_slot_info(QList<slot_info_t> *images)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_READ, smp_version, SMP_GROUP_ID_IMG, COMMAND_SLOT_INFO, 0);
 
     //			    qDebug() << message;
@@ -1314,6 +1287,29 @@ bool smp_group_img_mgmt::start_image_slot_info(QList<slot_info_t> *images)
     return handle_transport_error(processor->send(tmp_message, smp_timeout, smp_retries, true));
 }
 
+void smp_group_img_mgmt::release_upload_data()
+{
+    if (upload_file.isOpen())
+    {
+        if (upload_data != nullptr && file_upload_data.isEmpty())
+        {
+            upload_file.unmap((uchar *)upload_data);
+        }
+
+        upload_file.close();
+    }
+
+    upload_data = nullptr;
+    upload_data_size = 0;
+    file_upload_data.clear();
+    upload_session_hash.clear();
+}
+
+void smp_group_img_mgmt::set_upload_window(uint8_t window)
+{
+    upload_window = (window == 0 ? 1 : window);
+}
+
 QString smp_group_img_mgmt::mode_to_string(uint8_t mode)
 {
     switch (mode)
@@ -1382,8 +1378,11 @@ void smp_group_img_mgmt::cleanup()
 {
     mode = MODE_IDLE;
     upload_image = 0;
-    file_upload_data.clear();
+    release_upload_data();
     file_upload_area = 0;
+    upload_next_offset = 0;
+    upload_outstanding.clear();
+    upload_rewinding = false;
 
     if (upload_tmr.isValid())
     {
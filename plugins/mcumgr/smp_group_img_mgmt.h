@@ -33,6 +33,7 @@
 #include <QCborArray>
 #include <QCborMap>
 #include <QCborValue>
+#include <QFile>
 
 /******************************************************************************/
 // Forward declaration of Class, Struct & Unions
@@ -95,7 +96,7 @@ class smp_group_img_mgmt : public smp_group
 
 public:
     smp_group_img_mgmt(smp_processor *parent);
-    void receive_ok(uint8_t version, uint8_t op, uint16_t group, uint8_t command, QByteArray data) override;
+    void receive_ok(uint8_t version, uint8_t op, uint16_t group, uint8_t command, smp_response_view *response) override;
     void receive_error(uint8_t version, uint8_t op, uint16_t group, uint8_t command, smp_error_t error) override;
     void cancel() override;
     bool start_image_get(QList<image_state_t> *images);
@@ -103,6 +104,7 @@ public:
     bool start_firmware_update(uint8_t image, QString filename, bool upgrade, QByteArray *image_hash);
     bool start_image_erase(uint8_t slot);
     bool start_image_slot_info(QList<slot_info_t> *images);
+    void set_upload_window(uint8_t window);
 
 protected:
     void cleanup() override;
@@ -115,17 +117,26 @@ signals:
 private:
     static bool error_lookup(int32_t rc, QString *error);
     static bool error_define_lookup(int32_t rc, QString *error);
-    bool extract_header(QByteArray *file_data, image_endian_t *endian);
-    bool extract_hash(QByteArray *file_data, QByteArray *hash);
-    bool parse_upload_response(QCborStreamReader &reader, int64_t *new_off, img_mgmt_upload_match *match);
+    bool extract_header(const uchar *file_data, qint64 file_size, image_endian_t *endian);
+    bool extract_hash(const uchar *file_data, qint64 file_size, QByteArray *hash);
+    void release_upload_data();
     bool parse_state_response(QCborStreamReader &reader, QString array_name);
     bool parse_slot_info_response(QCborStreamReader &reader, QList<slot_info_t> *images, struct slot_info_t *image_data, struct slot_info_slots_t *slot_data);
-    void file_upload(QByteArray *message);
+    void file_upload(smp_response_view *response);
+    bool upload_chunk();
 
     //
     uint8_t upload_image;
+    QFile upload_file;
+    const uchar *upload_data;
+    qint64 upload_data_size;
     QByteArray file_upload_data;
+    QByteArray upload_session_hash;
     uint32_t file_upload_area;
+    uint32_t upload_next_offset;
+    QList<uint32_t> upload_outstanding;
+    bool upload_rewinding;
+    uint8_t upload_window;
     QElapsedTimer upload_tmr;
     QByteArray upload_hash;
     image_endian_t upload_endian;
@@ -782,10 +782,10 @@ bool smp_group_os_mgmt::parse_date_time_response(QCborStreamReader &reader, QDat
     return true;
 }
 
-void smp_group_os_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group, uint8_t command, QByteArray data)
+void smp_group_os_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group, uint8_t command, smp_response_view *response)
 {
     Q_UNUSED(op);
-//    qDebug() << "Got ok: " << version << ", " << op << ", " << group << ", "  << command << ", " << data;
+//    qDebug() << "Got ok: " << version << ", " << op << ", " << group << ", "  << command << ", " << response->data();
 
     if (mode == MODE_IDLE)
     {
@@ -813,7 +813,7 @@ void smp_group_os_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group,
         {
             //Response to echo
             QString response;
-            QCborStreamReader cbor_reader(data);
+            QCborStreamReader cbor_reader(response->data());
             bool good = parse_echo_response(cbor_reader, &response);
 
             cleanup();
@@ -822,7 +822,7 @@ void smp_group_os_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group,
         else if (finished_mode == MODE_TASK_STATS && command == COMMAND_TASK_STATS)
         {
             //Response to get task stats
-            QCborStreamReader cbor_reader(data);
+            QCborStreamReader cbor_reader(response->data());
             bool in_tasks = false;
             task_list_t current_task;
             bool good = parse_task_stats_response(cbor_reader, &in_tasks, &current_task, task_list);
@@ -833,7 +833,7 @@ void smp_group_os_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group,
         else if (finished_mode == MODE_MEMORY_POOL && command == COMMAND_MEMORY_POOL)
         {
             //Response to get memory pool stats
-            QCborStreamReader cbor_reader(data);
+            QCborStreamReader cbor_reader(response->data());
             memory_pool_t current_memory;
             bool good = parse_memory_pool_response(cbor_reader, &current_memory, memory_list);
 
@@ -843,7 +843,7 @@ void smp_group_os_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group,
         else if (finished_mode == MODE_DATE_TIME_GET && command == COMMAND_DATE_TIME)
         {
             //Response to get date time
-            QCborStreamReader cbor_reader(data);
+            QCborStreamReader cbor_reader(response->data());
             bool good = parse_date_time_response(cbor_reader, rtc_get_date_time);
 
             cleanup();
@@ -864,7 +864,7 @@ void smp_group_os_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group,
         else if (finished_mode == MODE_MCUMGR_PARAMETERS && command == COMMAND_MCUMGR_PARAMETERS)
         {
             //Response to MCUmgr buffer parameters
-            QCborStreamReader cbor_reader(data);
+            QCborStreamReader cbor_reader(response->data());
             bool good = parse_mcumgr_parameters_response(cbor_reader, mcumgr_parameters_buffer_size, mcumgr_parameters_buffer_count);
             log_debug() << "buffer size: " << *mcumgr_parameters_buffer_size << ", buffer count: " << *mcumgr_parameters_buffer_count;
 
@@ -874,7 +874,7 @@ void smp_group_os_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group,
         else if (finished_mode == MODE_OS_APPLICATION_INFO && command == COMMAND_OS_APPLICATION_INFO)
         {
             //Response to OS/application info
-            QCborStreamReader cbor_reader(data);
+            QCborStreamReader cbor_reader(response->data());
             bool good = parse_os_application_info_response(cbor_reader, os_application_info_response);
 
             log_debug() << *os_application_info_response;
@@ -885,7 +885,7 @@ void smp_group_os_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group,
         else if (finished_mode == MODE_BOOTLOADER_INFO && command == COMMAND_BOOTLOADER_INFO)
         {
             //Response to bootloader info
-            QCborStreamReader cbor_reader(data);
+            QCborStreamReader cbor_reader(response->data());
             bool good = parse_bootloader_info_response(cbor_reader, bootloader_info_response);
 
             cleanup();
@@ -977,7 +977,7 @@ void smp_group_os_mgmt::cancel()
 
 bool smp_group_os_mgmt::start_echo(QString data)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_WRITE, smp_version, SMP_GROUP_ID_OS, COMMAND_ECHO, 1);
     tmp_message->writer()->append("d");
     tmp_message->writer()->append(data);
@@ -997,7 +997,7 @@ bool smp_group_os_mgmt::start_echo(QString data)
 
 bool smp_group_os_mgmt::start_task_stats(QList<task_list_t> *tasks)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_READ, smp_version, SMP_GROUP_ID_OS, COMMAND_TASK_STATS, 0);
     tmp_message->end_message();
 
@@ -1017,7 +1017,7 @@ bool smp_group_os_mgmt::start_task_stats(QList<task_list_t> *tasks)
 
 bool smp_group_os_mgmt::start_memory_pool(QList<memory_pool_t> *memory)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_READ, smp_version, SMP_GROUP_ID_OS, COMMAND_MEMORY_POOL, 0);
     tmp_message->end_message();
 
@@ -1037,7 +1037,7 @@ bool smp_group_os_mgmt::start_memory_pool(QList<memory_pool_t> *memory)
 
 bool smp_group_os_mgmt::start_reset(bool force)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_WRITE, smp_version, SMP_GROUP_ID_OS, COMMAND_RESET, (force == true ? 1 : 0));
 
     if (force == true)
@@ -1061,7 +1061,7 @@ bool smp_group_os_mgmt::start_reset(bool force)
 
 bool smp_group_os_mgmt::start_mcumgr_parameters(uint32_t *buffer_size, uint32_t *buffer_count)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_READ, smp_version, SMP_GROUP_ID_OS, COMMAND_MCUMGR_PARAMETERS, 0);
     tmp_message->end_message();
 
@@ -1081,7 +1081,7 @@ bool smp_group_os_mgmt::start_mcumgr_parameters(uint32_t *buffer_size, uint32_t
 
 bool smp_group_os_mgmt::start_os_application_info(QString format, QString *response)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_READ, smp_version, SMP_GROUP_ID_OS, COMMAND_OS_APPLICATION_INFO, (format.isEmpty() == false ? 1 : 0));
 
     if (format.isEmpty() == false)
@@ -1107,7 +1107,7 @@ bool smp_group_os_mgmt::start_os_application_info(QString format, QString *respo
 
 bool smp_group_os_mgmt::start_date_time_get(QDateTime *date_time)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_READ, smp_version, SMP_GROUP_ID_OS, COMMAND_DATE_TIME, 0);
     tmp_message->end_message();
 
@@ -1126,7 +1126,7 @@ bool smp_group_os_mgmt::start_date_time_get(QDateTime *date_time)
 
 bool smp_group_os_mgmt::start_date_time_set(QDateTime date_time)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_WRITE, smp_version, SMP_GROUP_ID_OS, COMMAND_DATE_TIME, 1);
     tmp_message->writer()->append("datetime");
     tmp_message->writer()->append(date_time.toString(Qt::ISODate));
@@ -1146,7 +1146,7 @@ bool smp_group_os_mgmt::start_date_time_set(QDateTime date_time)
 
 bool smp_group_os_mgmt::start_bootloader_info(QString query, QVariant *response)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_READ, smp_version, SMP_GROUP_ID_OS, COMMAND_BOOTLOADER_INFO, (query.isEmpty() == false ? 1 : 0));
 
     if (query.isEmpty() == false)
@@ -182,10 +182,10 @@ bool smp_group_settings_mgmt::parse_read_response(QCborStreamReader &reader, QBy
     return true;
 }
 
-void smp_group_settings_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group, uint8_t command, QByteArray data)
+void smp_group_settings_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group, uint8_t command, smp_response_view *response)
 {
     Q_UNUSED(op);
-    //    qDebug() << "Got ok: " << version << ", " << op << ", " << group << ", "  << command << ", " << data;
+    //    qDebug() << "Got ok: " << version << ", " << op << ", " << group << ", "  << command << ", " << response->data();
 
     if (mode == MODE_IDLE)
     {
@@ -212,7 +212,7 @@ void smp_group_settings_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t g
         if (finished_mode == MODE_READ && command == COMMAND_READ_WRITE)
         {
             //Response to read
-            QCborStreamReader cbor_reader(data);
+            QCborStreamReader cbor_reader(response->data());
             bool good = parse_read_response(cbor_reader, return_value);
 
             emit status(smp_user_data, STATUS_COMPLETE, nullptr);
@@ -312,7 +312,7 @@ void smp_group_settings_mgmt::cancel()
 
 bool smp_group_settings_mgmt::start_read(QString name, uint32_t max_length, QByteArray *value)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_READ, smp_version, SMP_GROUP_ID_SETTINGS, COMMAND_READ_WRITE, (max_length > 0 ? 2 : 1));
     tmp_message->writer()->append("name");
     tmp_message->writer()->append(name);
@@ -340,7 +340,7 @@ bool smp_group_settings_mgmt::start_read(QString name, uint32_t max_length, QByt
 
 bool smp_group_settings_mgmt::start_write(QString name, QByteArray value)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_WRITE, smp_version, SMP_GROUP_ID_SETTINGS, COMMAND_READ_WRITE, 2);
     tmp_message->writer()->append("name");
     tmp_message->writer()->append(name);
@@ -362,7 +362,7 @@ bool smp_group_settings_mgmt::start_write(QString name, QByteArray value)
 
 bool smp_group_settings_mgmt::start_delete(QString name)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_WRITE, smp_version, SMP_GROUP_ID_SETTINGS, COMMAND_DELETE, 1);
     tmp_message->writer()->append("name");
     tmp_message->writer()->append(name);
@@ -382,7 +382,7 @@ bool smp_group_settings_mgmt::start_delete(QString name)
 
 bool smp_group_settings_mgmt::start_commit(void)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_WRITE, smp_version, SMP_GROUP_ID_SETTINGS, COMMAND_COMMIT, 0);
     tmp_message->end_message();
 
@@ -400,7 +400,7 @@ bool smp_group_settings_mgmt::start_commit(void)
 
 bool smp_group_settings_mgmt::start_load(void)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_READ, smp_version, SMP_GROUP_ID_SETTINGS, COMMAND_LOAD_SAVE, 0);
     tmp_message->end_message();
 
@@ -418,7 +418,7 @@ bool smp_group_settings_mgmt::start_load(void)
 
 bool smp_group_settings_mgmt::start_save(void)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_WRITE, smp_version, SMP_GROUP_ID_SETTINGS, COMMAND_LOAD_SAVE, 0);
     tmp_message->end_message();
 
@@ -43,7 +43,7 @@ class smp_group_settings_mgmt : public smp_group
 
 public:
     smp_group_settings_mgmt(smp_processor *parent);
-    void receive_ok(uint8_t version, uint8_t op, uint16_t group, uint8_t command, QByteArray data) override;
+    void receive_ok(uint8_t version, uint8_t op, uint16_t group, uint8_t command, smp_response_view *response) override;
     void receive_error(uint8_t version, uint8_t op, uint16_t group, uint8_t command, smp_error_t error) override;
     void cancel() override;
     bool start_read(QString name, uint32_t max_length, QByteArray *value);
@@ -158,10 +158,10 @@ bool smp_group_shell_mgmt::parse_execute_response(QCborStreamReader &reader, int
     return true;
 }
 
-void smp_group_shell_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group, uint8_t command, QByteArray data)
+void smp_group_shell_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group, uint8_t command, smp_response_view *response)
 {
     Q_UNUSED(op);
-    //    qDebug() << "Got ok: " << version << ", " << op << ", " << group << ", "  << command << ", " << data;
+    //    qDebug() << "Got ok: " << version << ", " << op << ", " << group << ", "  << command << ", " << response->data();
 
     if (mode == MODE_IDLE)
     {
@@ -189,7 +189,7 @@ void smp_group_shell_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t grou
         {
             //Response to execute
             QString response;
-            QCborStreamReader cbor_reader(data);
+            QCborStreamReader cbor_reader(response->data());
             bool good = parse_execute_response(cbor_reader, return_ret, &response);
 
             emit status(smp_user_data, STATUS_COMPLETE, response);
@@ -240,7 +240,7 @@ void smp_group_shell_mgmt::cancel()
 
 bool smp_group_shell_mgmt::start_execute(QStringList *arguments, int32_t *ret)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_WRITE, smp_version, SMP_GROUP_ID_SHELL, COMMAND_EXECUTE, 1);
     tmp_message->writer()->append("argv");
     tmp_message->writer()->startArray(arguments->length());
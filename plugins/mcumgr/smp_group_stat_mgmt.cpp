@@ -240,11 +240,11 @@ bool smp_group_stat_mgmt::parse_list_groups_response(QCborStreamReader &reader,
     return true;
 }
 
-void smp_group_stat_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group, uint8_t command, QByteArray data)
+void smp_group_stat_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group, uint8_t command, smp_response_view *response)
 {
     Q_UNUSED(op);
 
-    //    qDebug() << "Got ok: " << version << ", " << op << ", " << group << ", "  << command << ", " << data;
+    //    qDebug() << "Got ok: " << version << ", " << op << ", " << group << ", "  << command << ", " << response->data();
 
     if (mode == MODE_IDLE)
     {
@@ -271,7 +271,7 @@ void smp_group_stat_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group
         if (finished_mode == MODE_GROUP_DATA && command == COMMAND_GROUP_DATA)
         {
             //Response to execute
-            QCborStreamReader cbor_reader(data);
+            QCborStreamReader cbor_reader(response->data());
             stat_object->clear();
             bool good = parse_group_data_response(cbor_reader, nullptr, stat_object);
 
@@ -280,7 +280,7 @@ void smp_group_stat_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group
         else if (finished_mode == MODE_LIST_GROUPS && command == COMMAND_LIST_GROUPS)
         {
             //Response to execute
-            QCborStreamReader cbor_reader(data);
+            QCborStreamReader cbor_reader(response->data());
             group_object->clear();
             bool good = parse_list_groups_response(cbor_reader, nullptr, group_object);
 
@@ -337,7 +337,7 @@ void smp_group_stat_mgmt::cancel()
 
 bool smp_group_stat_mgmt::start_group_data(QString name, QList<stat_value_t> *stats)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_READ, smp_version, SMP_GROUP_ID_STATS, COMMAND_GROUP_DATA, 1);
     tmp_message->writer()->append("name");
     tmp_message->writer()->append(name);
@@ -358,7 +358,7 @@ bool smp_group_stat_mgmt::start_group_data(QString name, QList<stat_value_t> *st
 
 bool smp_group_stat_mgmt::start_list_groups(QStringList *groups)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_READ, smp_version, SMP_GROUP_ID_STATS, COMMAND_LIST_GROUPS, 0);
     tmp_message->end_message();
 
@@ -61,10 +61,10 @@ smp_group_zephyr_mgmt::smp_group_zephyr_mgmt(smp_processor *parent) : smp_group(
     mode = MODE_IDLE;
 }
 
-void smp_group_zephyr_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group, uint8_t command, QByteArray data)
+void smp_group_zephyr_mgmt::receive_ok(uint8_t version, uint8_t op, uint16_t group, uint8_t command, smp_response_view *response)
 {
     Q_UNUSED(op);
-    //    qDebug() << "Got ok: " << version << ", " << op << ", " << group << ", "  << command << ", " << data;
+    //    qDebug() << "Got ok: " << version << ", " << op << ", " << group << ", "  << command << ", " << response->data();
 
     if (mode == MODE_IDLE)
     {
@@ -139,7 +139,7 @@ void smp_group_zephyr_mgmt::cancel()
 
 bool smp_group_zephyr_mgmt::start_storage_erase(void)
 {
-    smp_message *tmp_message = new smp_message();
+    smp_message *tmp_message = smp_message::acquire();
     tmp_message->start_message(SMP_OP_WRITE, smp_version, SMP_GROUP_ID_ZEPHYR, COMMAND_STORAGE_ERASE, 0);
     tmp_message->end_message();
 
@@ -22,13 +22,64 @@
 *******************************************************************************/
 #include "smp_message.h"
 #include <QIODevice>
+#include <string.h>
 
 const uint8_t SMP_VERSION_1_HEADER = 0x00;
 const uint8_t SMP_VERSION_2_HEADER = 0x08;
 
+//Number of unused messages kept for reuse, enough for a full processor window plus messages being built
+const int smp_message_pool_size = 36;
+
+static QList<smp_message *> message_pool;
+static uint32_t message_allocations = 0;
+
 smp_message::smp_message()
 {
     this->header_added = false;
+    this->reserved_capacity = 0;
+}
+
+smp_message *smp_message::acquire()
+{
+    if (!message_pool.isEmpty())
+    {
+        return message_pool.takeLast();
+    }
+
+    ++message_allocations;
+    return new smp_message();
+}
+
+void smp_message::release(smp_message *message)
+{
+    if (message == nullptr)
+    {
+        return;
+    }
+
+    if (message_pool.length() >= smp_message_pool_size)
+    {
+        delete message;
+        return;
+    }
+
+    message->clear();
+    message_pool.append(message);
+}
+
+void smp_message::free_pool()
+{
+    while (!message_pool.isEmpty())
+    {
+        delete message_pool.takeLast();
+    }
+}
+
+uint32_t smp_message::allocations()
+{
+    //Number of messages and message buffer growths allocated, does not change once transfers reach a steady state.
+    //Allocations made by transports are not included
+    return message_allocations;
 }
 
 void smp_message::start_message(smp_op_t op, uint8_t version, uint16_t group, uint8_t id)
@@ -81,8 +132,17 @@ void smp_message::append(const QByteArray *data)
 
 void smp_message::clear()
 {
-    this->buffer.clear();
+    //The allocated buffer is kept (and marked as reserved so Qt does not free it when resized) for the next message
+    if (this->buffer.capacity() > this->reserved_capacity)
+    {
+        ++message_allocations;
+        this->reserved_capacity = this->buffer.capacity();
+        this->buffer.reserve(this->reserved_capacity);
+    }
+
+    this->buffer.resize(0);
     this->header_added = false;
+    cbor_writer.device()->seek(0);
 }
 
 smp_hdr *smp_message::get_header(void)
@@ -193,7 +253,18 @@ QByteArray *smp_message::data(void)
 
 QByteArray smp_message::contents(void)
 {
-    return this->buffer.mid(sizeof(smp_hdr));
+    //Payload without a copy, only valid until the message is next changed
+    if (this->buffer.size() <= (int)sizeof(smp_hdr))
+    {
+        return QByteArray();
+    }
+
+    return QByteArray::fromRawData(payload(), data_size());
+}
+
+const char *smp_message::payload(void)
+{
+    return this->buffer.constData() + sizeof(smp_hdr);
 }
 
 smp_op_t smp_message::response_op(smp_op_t op)
@@ -256,3 +327,284 @@ QCborStreamWriter *smp_message::writer()
 {
     return &cbor_writer;
 }
+
+//Size of the head of a definite length CBOR item, from the additional information in its initial byte
+static uint32_t cbor_head_size(uint8_t initial_byte)
+{
+    uint8_t additional = initial_byte & 0x1f;
+
+    if (additional < 24)
+    {
+        return 1;
+    }
+
+    return 1 + (1 << (additional - 24));
+}
+
+smp_response_view::smp_response_view()
+{
+    this->payload = nullptr;
+    this->payload_size = 0;
+    this->response_error.type = SMP_ERROR_NONE;
+    this->response_error.rc = 0;
+    this->response_error.group = 0;
+}
+
+bool smp_response_view::decode(smp_message *message, uint8_t version)
+{
+    this->message_data = *message->data();
+    this->payload = this->message_data.constData() + sizeof(smp_hdr);
+    this->payload_size = message->data_size();
+    this->response_error.type = SMP_ERROR_NONE;
+    this->response_error.rc = 0;
+    this->response_error.group = 0;
+    this->entries.clear();
+
+    if (this->payload_size == 0)
+    {
+        return true;
+    }
+
+    QCborStreamReader reader(this->payload, this->payload_size);
+
+    if (!reader.isMap())
+    {
+        //Responses are maps, there is nothing to index
+        reader.next();
+        return (reader.lastError() == QCborError::NoError);
+    }
+
+    reader.enterContainer();
+
+    while (reader.lastError() == QCborError::NoError && reader.hasNext())
+    {
+        smp_response_entry_t entry;
+
+        if (!read_key(reader, &entry.key_offset, &entry.key_length))
+        {
+            //Only definite length text keys are indexed, skip the value
+            if (reader.lastError() == QCborError::NoError && reader.hasNext())
+            {
+                reader.next();
+            }
+
+            continue;
+        }
+
+        if (reader.lastError() != QCborError::NoError || !reader.hasNext())
+        {
+            break;
+        }
+
+        entry.type = reader.type();
+        entry.integer = 0;
+        entry.value_offset = (uint32_t)reader.currentOffset();
+        entry.value_data_offset = 0;
+        entry.value_data_length = 0;
+
+        switch (entry.type)
+        {
+            case QCborStreamReader::UnsignedInteger:
+            case QCborStreamReader::NegativeInteger:
+            {
+                entry.integer = reader.toInteger();
+
+                if (key_is(entry.key_offset, entry.key_length, "rc"))
+                {
+                    //Legacy (SMP version 1) error
+                    this->response_error.rc = (int32_t)entry.integer;
+                    this->response_error.type = SMP_ERROR_RC;
+                }
+
+                reader.next();
+                break;
+            }
+            case QCborStreamReader::SimpleType:
+            {
+                entry.integer = (reader.isBool() ? reader.toBool() : -1);
+                reader.next();
+                break;
+            }
+            case QCborStreamReader::ByteArray:
+            case QCborStreamReader::String:
+            {
+                if (reader.isLengthKnown())
+                {
+                    entry.value_data_offset = entry.value_offset + cbor_head_size((uint8_t)this->payload[entry.value_offset]);
+                    entry.value_data_length = (uint32_t)reader.length();
+                }
+
+                reader.next();
+                break;
+            }
+            case QCborStreamReader::Map:
+            {
+                if (version == 1 && key_is(entry.key_offset, entry.key_length, "err"))
+                {
+                    read_error_map(reader);
+                }
+                else
+                {
+                    reader.next();
+                }
+
+                break;
+            }
+            default:
+            {
+                reader.next();
+                break;
+            }
+        }
+
+        this->entries.append(entry);
+    }
+
+    if (reader.lastError() == QCborError::NoError)
+    {
+        reader.leaveContainer();
+    }
+
+    if (reader.lastError() != QCborError::NoError)
+    {
+        return false;
+    }
+
+    //Check if an error was received with value 0, which is not an error and is a success code
+    if (this->response_error.type != SMP_ERROR_NONE && this->response_error.rc == 0)
+    {
+        this->response_error.type = SMP_ERROR_NONE;
+    }
+
+    return true;
+}
+
+const smp_error_t *smp_response_view::error() const
+{
+    return &this->response_error;
+}
+
+QByteArray smp_response_view::data() const
+{
+    //Payload without a copy, only valid for the life of the view
+    return QByteArray::fromRawData(this->payload, this->payload_size);
+}
+
+const smp_response_entry_t *smp_response_view::find(const char *key) const
+{
+    int i = 0;
+
+    while (i < this->entries.length())
+    {
+        if (key_is(this->entries.at(i).key_offset, this->entries.at(i).key_length, key))
+        {
+            return &this->entries.at(i);
+        }
+
+        ++i;
+    }
+
+    return nullptr;
+}
+
+bool smp_response_view::get_integer(const char *key, int64_t *value) const
+{
+    const smp_response_entry_t *entry = find(key);
+
+    if (entry == nullptr || (entry->type != QCborStreamReader::UnsignedInteger && entry->type != QCborStreamReader::NegativeInteger))
+    {
+        return false;
+    }
+
+    *value = entry->integer;
+    return true;
+}
+
+bool smp_response_view::get_bool(const char *key, bool *value) const
+{
+    const smp_response_entry_t *entry = find(key);
+
+    if (entry == nullptr || entry->type != QCborStreamReader::SimpleType || entry->integer == -1)
+    {
+        return false;
+    }
+
+    *value = (entry->integer != 0);
+    return true;
+}
+
+bool smp_response_view::get_data(const char *key, const char **value, uint32_t *length) const
+{
+    //Contents of a byte or text string, pointing into the message data
+    const smp_response_entry_t *entry = find(key);
+
+    if (entry == nullptr || (entry->type != QCborStreamReader::ByteArray && entry->type != QCborStreamReader::String) || entry->value_data_offset == 0)
+    {
+        return false;
+    }
+
+    *value = this->payload + entry->value_data_offset;
+    *length = entry->value_data_length;
+    return true;
+}
+
+bool smp_response_view::read_key(QCborStreamReader &reader, uint32_t *offset, uint32_t *length)
+{
+    //Records where the contents of a key are and moves to its value, without decoding it
+    bool valid = (reader.isString() && reader.isLengthKnown());
+
+    if (valid)
+    {
+        uint32_t key_offset = (uint32_t)reader.currentOffset();
+
+        *offset = key_offset + cbor_head_size((uint8_t)this->payload[key_offset]);
+        *length = (uint32_t)reader.length();
+    }
+
+    reader.next();
+    return valid;
+}
+
+bool smp_response_view::key_is(uint32_t offset, uint32_t length, const char *key) const
+{
+    return (length == strlen(key) && memcmp((this->payload + offset), key, length) == 0);
+}
+
+void smp_response_view::read_error_map(QCborStreamReader &reader)
+{
+    //SMP version 2 error, a map with the group and group-specific return code
+    reader.enterContainer();
+
+    while (reader.lastError() == QCborError::NoError && reader.hasNext())
+    {
+        uint32_t key_offset;
+        uint32_t key_length;
+        bool valid = read_key(reader, &key_offset, &key_length);
+
+        if (reader.lastError() != QCborError::NoError || !reader.hasNext())
+        {
+            break;
+        }
+
+        if (valid && reader.isUnsignedInteger())
+        {
+            if (key_is(key_offset, key_length, "rc"))
+            {
+                this->response_error.rc = (int32_t)reader.toUnsignedInteger();
+                this->response_error.type = SMP_ERROR_RET;
+            }
+            else if (key_is(key_offset, key_length, "group"))
+            {
+                this->response_error.group = (uint16_t)reader.toUnsignedInteger();
+                this->response_error.type = SMP_ERROR_RET;
+            }
+        }
+
+        reader.next();
+    }
+
+    if (reader.lastError() == QCborError::NoError)
+    {
+        reader.leaveContainer();
+    }
+}
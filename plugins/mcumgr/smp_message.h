@@ -25,6 +25,8 @@
 
 #include <QByteArray>
 #include <QCborStreamWriter>
+#include <QCborStreamReader>
+#include <QVarLengthArray>
 #include "smp_error.h"
 
 /******************************************************************************/
@@ -57,10 +59,28 @@ struct smp_hdr {
 //Ensure header size is correct
 static_assert(sizeof(smp_hdr) == 8);
 
+//Top-level entry of a response map, offsets are from the start of the response payload
+struct smp_response_entry_t {
+    uint32_t key_offset;
+    uint32_t key_length;
+    QCborStreamReader::Type type;
+    int64_t integer;                //Value of an integer or boolean
+    uint32_t value_offset;          //Start of the value item
+    uint32_t value_data_offset;     //Contents of a definite length byte or text string
+    uint32_t value_data_length;
+};
+
+//Messages are not copied, ownership is passed by pointer. Messages taken from the pool with acquire() are given
+//back with release(), which keeps their buffers allocated so steady-state messages do not allocate. Transports
+//have their own buffers for encoding, which they must also reuse
 class smp_message
 {
 public:
     smp_message();
+    static smp_message *acquire();
+    static void release(smp_message *message);
+    static void free_pool();
+    static uint32_t allocations();
     void start_message(smp_op_t op, uint8_t version, uint16_t group, uint8_t id);
     void start_message(smp_op_t op, uint8_t version, uint16_t group, uint8_t id, uint16_t map_length);
     void start_message_no_start_map(smp_op_t op, uint8_t version, uint16_t group, uint8_t id);
@@ -77,6 +97,7 @@ public:
     void set_header(const smp_op_t operation, const uint8_t version, const uint8_t flags, const uint16_t length, const uint16_t group, const uint8_t sequence, const uint8_t command);
     QByteArray *data(void);
     QByteArray contents(void);
+    const char *payload(void);
     static smp_op_t response_op(smp_op_t op);
     void end_message();
     void end_custom_message(QByteArray data);
@@ -84,9 +105,39 @@ public:
     QCborStreamWriter *writer();
 
 private:
+    Q_DISABLE_COPY(smp_message)
+
     QByteArray buffer;
     bool header_added;
+    int reserved_capacity; //Largest buffer allocation so far, kept when the message is cleared
     QCborStreamWriter cbor_writer = QCborStreamWriter(&buffer);
 };
 
+//Typed view of a received response, built in a single pass which finds the error information and indexes the
+//top-level keys. The message data is shared rather than copied and keys are compared as bytes, values which are
+//not looked up (or containers) are skipped without being decoded
+class smp_response_view
+{
+public:
+    smp_response_view();
+    bool decode(smp_message *message, uint8_t version);
+    const smp_error_t *error() const;
+    QByteArray data() const;
+    const smp_response_entry_t *find(const char *key) const;
+    bool get_integer(const char *key, int64_t *value) const;
+    bool get_bool(const char *key, bool *value) const;
+    bool get_data(const char *key, const char **value, uint32_t *length) const;
+
+private:
+    bool read_key(QCborStreamReader &reader, uint32_t *offset, uint32_t *length);
+    bool key_is(uint32_t offset, uint32_t length, const char *key) const;
+    void read_error_map(QCborStreamReader &reader);
+
+    QByteArray message_data; //Shares the received message buffer, keeps it alive if the transport reuses its own
+    const char *payload;
+    uint32_t payload_size;
+    smp_error_t response_error;
+    QVarLengthArray<smp_response_entry_t, 16> entries;
+};
+
 #endif // SMP_MESSAGE_H
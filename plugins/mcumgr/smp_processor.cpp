@@ -29,10 +29,8 @@ smp_processor::smp_processor(QObject *parent)
     Q_UNUSED(parent);
 
     sequence = 0;
-    last_message = nullptr;
-    last_message_header = nullptr;
-    repeat_times = 0;
-    busy = false;
+    window_size = 1;
+    last_sent_group = 0;
 #if defined(PLUGIN_MCUMGR_JSON)
     json_object = nullptr;
 #endif
@@ -41,6 +39,7 @@ smp_processor::smp_processor(QObject *parent)
 
     connect(&repeat_timer, SIGNAL(timeout()), this, SLOT(message_timeout()));
     repeat_timer.setSingleShot(true);
+    timeout_clock.start();
 }
 
 smp_processor::~smp_processor()
@@ -48,14 +47,6 @@ smp_processor::~smp_processor()
     cleanup();
     disconnect(this, SLOT(message_timeout()));
     group_handlers.clear();
-
-    //Ensure object is deleted if it was part-way through creation
-    if (last_message != nullptr)
-    {
-        delete last_message;
-        last_message = nullptr;
-        last_message_header = nullptr;
-    }
 }
 
 #ifndef SKIPPLUGIN_LOGGER
@@ -65,59 +56,222 @@ void smp_processor::set_logger(debug_logger *object)
 }
 #endif
 
-smp_transport_error_t smp_processor::send(smp_message *message, uint32_t timeout_ms, uint8_t repeats, bool allow_version_check)
+smp_transport_error_t smp_processor::send(smp_message *message, uint32_t timeout_ms, uint8_t repeats, bool allow_version_check, smp_priority_t priority)
 {
     smp_transport_error_t transport_error = SMP_TRANSPORT_ERROR_OK;
 
-    if (busy)
+    if (transport->is_connected() == 0)
+    {
+        transport_error = SMP_TRANSPORT_ERROR_NOT_CONNECTED;
+    }
+    else if (can_send() == false && queued_messages.length() >= SMP_PROCESSOR_MAX_QUEUE_SIZE)
     {
         transport_error = SMP_TRANSPORT_ERROR_PROCESSOR_BUSY;
     }
-    else if (transport->is_connected() == 0)
+
+    if (transport_error == SMP_TRANSPORT_ERROR_OK)
     {
-        transport_error = SMP_TRANSPORT_ERROR_NOT_CONNECTED;
+        smp_pending_message_t entry;
+
+        entry.message = message;
+        entry.header = message->get_header();
+        entry.version_check = allow_version_check;
+        entry.version = entry.header->nh_version;
+        entry.repeats = repeats;
+        entry.timeout_ms = timeout_ms;
+        entry.deadline = 0;
+        entry.custom = custom_message;
+        entry.priority = priority;
+        custom_message = false;
+
+        if (can_send() == false)
+        {
+            //Window is full or other messages are waiting, this is sent when its turn comes
+            queued_messages.append(entry);
+            return SMP_TRANSPORT_ERROR_OK;
+        }
+
+        transport_error = transmit(entry);
+    }
+
+    if (transport_error != SMP_TRANSPORT_ERROR_OK)
+    {
+        //Processor takes ownership of the message, other outstanding messages are unaffected
+        smp_message::release(message);
+    }
+
+    return transport_error;
+}
+
+smp_transport_error_t smp_processor::transmit(smp_pending_message_t entry)
+{
+    smp_transport_error_t transport_error;
+    uint8_t message_sequence;
+
+    //Set message sequence, responses are matched to requests by this so messages from different groups can be outstanding at once
+    if (next_sequence(&message_sequence) == false)
+    {
+        log_error() << "No free sequence number, all are used by outstanding requests";
+        return SMP_TRANSPORT_ERROR_PROCESSOR_BUSY;
     }
 
+    entry.header->nh_seq = message_sequence;
+    transport_error = transport->send(entry.message);
+
     if (transport_error == SMP_TRANSPORT_ERROR_OK)
     {
-        last_message = message;
-        last_message_header = message->get_header();
+        entry.deadline = timeout_clock.elapsed() + entry.timeout_ms;
+        pending_messages.append(entry);
+        last_sent_group = entry.header->nh_group;
+        restart_timer();
+        ++sequence;
+
+#if defined(PLUGIN_MCUMGR_JSON)
+        if (json_object != nullptr && message_logging == true)
+        {
+            json_object->append_data(true, entry.message);
+        }
+#endif
+    }
+
+    return transport_error;
+}
+
+bool smp_processor::next_sequence(uint8_t *next)
+{
+    //Finds the next sequence number which is not used by an outstanding request, a long running request can still be
+    //outstanding when the sequence number wraps around and its response must not be matched to a newer request
+    uint16_t attempts = 0;
+
+    while (attempts < 256)
+    {
+        int i = 0;
 
-        //Set message sequence
-        last_message_header->nh_seq = sequence;
-        last_message_version_check = allow_version_check;
-        last_message_version = last_message_header->nh_version;
-        repeat_timer.setInterval(timeout_ms);
-        repeat_times = repeats;
-        busy = true;
+        while (i < pending_messages.length() && pending_messages[i].header->nh_seq != sequence)
+        {
+            ++i;
+        }
+
+        if (i == pending_messages.length())
+        {
+            *next = sequence;
+            return true;
+        }
+
+        ++sequence;
+        ++attempts;
+    }
+
+    return false;
+}
 
-        transport_error = transport->send(last_message);
+void smp_processor::dispatch_queued()
+{
+    //Sends queued messages while there is space in the window
+    while (!queued_messages.isEmpty() && pending_messages.length() < window_size)
+    {
+        smp_pending_message_t entry = queued_messages.takeAt(next_queued());
+        smp_transport_error_t transport_error = transmit(entry);
 
-        if (transport_error == SMP_TRANSPORT_ERROR_OK)
+        if (transport_error != SMP_TRANSPORT_ERROR_OK)
         {
-            repeat_timer.start();
-            ++sequence;
+            //The caller has already been told the message was accepted, so fail it the same way as a lost transport
+            fail_message(entry, CUSTOM_MESSAGE_CALLBACK_TRANSPORT_DISCONNECTED, transport_error);
+        }
+    }
+}
 
-#if defined(PLUGIN_MCUMGR_JSON)
-            if (json_object != nullptr && message_logging == true)
+int smp_processor::next_queued()
+{
+    //Control messages go before bulk transfer data. Within a priority, the oldest message from a different group to
+    //the last one sent is picked so one group's transfer cannot hold up the others, messages of a group stay in order
+    smp_priority_t priority = SMP_PRIORITY_COUNT;
+    int first = -1;
+    int i = 0;
+
+    while (i < queued_messages.length())
+    {
+        if (queued_messages[i].priority < priority)
+        {
+            priority = queued_messages[i].priority;
+        }
+
+        ++i;
+    }
+
+    i = 0;
+
+    while (i < queued_messages.length())
+    {
+        if (queued_messages[i].priority == priority)
+        {
+            if (queued_messages[i].header->nh_group != last_sent_group)
             {
-                json_object->append_data(true, message);
+                return i;
+            }
+
+            if (first == -1)
+            {
+                first = i;
             }
-#endif
         }
+
+        ++i;
     }
 
-    if (transport_error != SMP_TRANSPORT_ERROR_OK)
+    return first;
+}
+
+bool smp_processor::is_busy()
+{
+    return (!pending_messages.isEmpty() || !queued_messages.isEmpty());
+}
+
+bool smp_processor::can_send()
+{
+    //True if a message would be sent straight away rather than queued. This is false whilst any group has messages
+    //queued, so groups which keep a window of requests outstanding must still send one request when they have none
+    //outstanding (it is queued and sent in turn), otherwise no response arrives to continue from
+    return (pending_messages.length() < window_size && queued_messages.isEmpty());
+}
+
+uint8_t smp_processor::outstanding_messages()
+{
+    return pending_messages.length();
+}
+
+void smp_processor::set_window_size(uint8_t size)
+{
+    if (size == 0)
+    {
+        size = 1;
+    }
+    else if (size > SMP_PROCESSOR_MAX_WINDOW_SIZE)
     {
-        cleanup();
+        size = SMP_PROCESSOR_MAX_WINDOW_SIZE;
     }
 
-    return transport_error;
+    window_size = size;
 }
 
-bool smp_processor::is_busy()
+uint8_t smp_processor::get_window_size()
+{
+    return window_size;
+}
+
+uint8_t smp_processor::window_size_from_buffer_count(uint32_t buffer_count)
 {
-    return busy;
+    //The device allocates responses from the same buffer pool as requests, so one buffer must be left free for the response
+    if (buffer_count <= 2)
+    {
+        return 1;
+    }
+    else if (buffer_count > SMP_PROCESSOR_MAX_WINDOW_SIZE)
+    {
+        return SMP_PROCESSOR_MAX_WINDOW_SIZE;
+    }
+
+    return buffer_count - 1;
 }
 
 void smp_processor::register_handler(uint16_t group, smp_group *handler)
@@ -140,112 +294,205 @@ void smp_processor::unregister_handler(uint16_t group)
     }
 }
 
-void smp_processor::cleanup()
+smp_group *smp_processor::find_handler(uint16_t group)
 {
-    if (!busy)
+    uint8_t i = 0;
+
+    while (i < group_handlers.length())
     {
-        return;
+        if (group_handlers[i].group == group)
+        {
+            return group_handlers[i].handler;
+        }
+
+        ++i;
     }
 
+    return nullptr;
+}
+
+uint16_t smp_processor::header_group(const smp_hdr *header)
+{
+    uint16_t group = header->nh_group;
+
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    group = ((group & 0xff) << 8) | ((group & 0xff00) >> 8);
+#endif
+
+    return group;
+}
+
+void smp_processor::cleanup()
+{
     repeat_timer.stop();
 
-    if (last_message != nullptr)
+    while (!pending_messages.isEmpty())
     {
-        delete last_message;
-        last_message = nullptr;
-        last_message_header = nullptr;
+        smp_message::release(pending_messages.takeFirst().message);
     }
 
-    repeat_times = 0;
-    busy = false;
+    while (!queued_messages.isEmpty())
+    {
+        smp_message::release(queued_messages.takeFirst().message);
+    }
 }
 
-void smp_processor::message_timeout()
+void smp_processor::drop_pending_group(uint16_t nh_group, bool custom)
 {
-    if (!busy)
+    //Removes the outstanding and queued requests of one group operation, other groups are unaffected
+    int i = 0;
+
+    while (i < pending_messages.length())
     {
-        //No longer busy
-        return;
+        if (pending_messages[i].header->nh_group == nh_group && pending_messages[i].custom == custom)
+        {
+            smp_message::release(pending_messages.takeAt(i).message);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    i = 0;
+
+    while (i < queued_messages.length())
+    {
+        if (queued_messages[i].header->nh_group == nh_group && queued_messages[i].custom == custom)
+        {
+            smp_message::release(queued_messages.takeAt(i).message);
+        }
+        else
+        {
+            ++i;
+        }
     }
 
-    if (repeat_times == 0)
+    restart_timer();
+}
+
+void smp_processor::restart_timer()
+{
+    qint64 earliest_deadline;
+    qint64 now;
+    int i = 1;
+
+    if (pending_messages.isEmpty())
     {
-        uint16_t group = last_message_header->nh_group;
-        uint8_t i = 0;
+        repeat_timer.stop();
+        return;
+    }
 
-#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
-        group = ((group & 0xff) << 8) | ((group & 0xff00) >> 8);
-#endif
+    earliest_deadline = pending_messages[0].deadline;
 
-        if (!custom_message)
+    while (i < pending_messages.length())
+    {
+        if (pending_messages[i].deadline < earliest_deadline)
         {
-            //Search for the handler for this group
-            while (i < group_handlers.length())
-            {
-                if (group_handlers[i].group == group)
-                {
-                    break;
-                }
+            earliest_deadline = pending_messages[i].deadline;
+        }
 
-                ++i;
-            }
+        ++i;
+    }
 
-            if (i == group_handlers.length())
-            {
-                //There is no registered handler for this group
-                log_error() << "No registered handler for group " << group << ", cannot send timeout message.";
-                cleanup();
-            }
-            else
-            {
-                //Keep message pointer valid but cleanup so callback can send a message
-                smp_message *backup_message = last_message;
-                last_message = nullptr;
-                last_message_header = nullptr;
+    now = timeout_clock.elapsed();
+    repeat_timer.start(earliest_deadline > now ? (int)(earliest_deadline - now) : 0);
+}
 
-                cleanup();
-                group_handlers[i].handler->timeout(backup_message);
+void smp_processor::fail_message(smp_pending_message_t entry, enum custom_message_callback_t reason, int error_code)
+{
+    uint16_t group = header_group(entry.header);
 
-                //Delete backup pointer
-                delete backup_message;
-            }
+    //The failure aborts the whole operation of the group, so any other outstanding requests it has are no longer wanted
+    drop_pending_group(entry.header->nh_group, entry.custom);
+
+    if (!entry.custom)
+    {
+        smp_group *handler = find_handler(group);
+
+        if (handler == nullptr)
+        {
+            //There is no registered handler for this group
+            log_error() << "No registered handler for group " << group << ", cannot send failure (" << reason << ") message.";
+        }
+        else if (reason == CUSTOM_MESSAGE_CALLBACK_TIMEOUT)
+        {
+            handler->timeout(entry.message);
+        }
+        else if (reason == CUSTOM_MESSAGE_CALLBACK_TRANSPORT_DISCONNECTED)
+        {
+            handler->transport_disconnected(entry.message, transport, error_code);
         }
         else
         {
-            emit custom_message_callback(CUSTOM_MESSAGE_CALLBACK_TIMEOUT, nullptr);
-
-            custom_message = false;
+            handler->cancelled(entry.message);
         }
-
-        return;
     }
+    else
+    {
+        emit custom_message_callback(reason, nullptr);
+    }
+
+    smp_message::release(entry.message);
+}
 
-    //If this is a version 2 message, try sending a version 1 packet to see if version 2 is unsupported by the server
-    if (last_message_version_check == true && last_message_version == 1)
+void smp_processor::message_timeout()
+{
+    qint64 now = timeout_clock.elapsed();
+    int i = 0;
+
+    while (i < pending_messages.length())
     {
-        if (last_message_header->nh_version == last_message_version)
+        smp_pending_message_t *entry = &pending_messages[i];
+
+        if (entry->deadline > now)
         {
-            last_message_header->nh_version = 0;
+            ++i;
+            continue;
         }
-        else
+
+        if (entry->repeats == 0)
+        {
+            //Callback may send or cancel messages, so restart the scan afterwards
+            fail_message(pending_messages.takeAt(i), CUSTOM_MESSAGE_CALLBACK_TIMEOUT, 0);
+            now = timeout_clock.elapsed();
+            i = 0;
+            continue;
+        }
+
+        //If this is a version 2 message, try sending a version 1 packet to see if version 2 is unsupported by the server
+        if (entry->version_check == true && entry->version == 1)
         {
-            last_message_header->nh_version = 1;
+            if (entry->header->nh_version == entry->version)
+            {
+                entry->header->nh_version = 0;
+            }
+            else
+            {
+                entry->header->nh_version = 1;
+            }
         }
+
+        //Resend message with the same sequence number
+        --entry->repeats;
+        entry->deadline = now + entry->timeout_ms;
+        transport->send(entry->message);
+        ++i;
     }
 
-    //Resend message
-    --repeat_times;
-    repeat_timer.start();
-    transport->send(last_message);
+    restart_timer();
+    dispatch_queued();
 }
 
 void smp_processor::message_received(smp_message *response)
 {
     const smp_hdr *response_header = nullptr;
+    smp_pending_message_t entry;
+    int i = 0;
 
     log_debug() << "got message";
 
-    if (!busy)
+    if (pending_messages.isEmpty())
     {
         //Not busy so this message probably isn't wanted anymore
         log_error() << "Received message when not awaiting for a repsonse";
@@ -259,206 +506,125 @@ void smp_processor::message_received(smp_message *response)
     {
         //Cannot do anything without a header
         log_error() << "Invalid response header";
+        return;
+    }
+
+    while (i < pending_messages.length())
+    {
+        if (pending_messages[i].header->nh_seq == response_header->nh_seq)
+        {
+            break;
+        }
+
+        ++i;
     }
-    else if (response_header->nh_group != last_message_header->nh_group)
+
+    if (i == pending_messages.length())
     {
-        log_error() << "Invalid group, expected " << last_message_header->nh_group << " got " << response_header->nh_group;
+        log_error() << "Invalid sequence, no outstanding request with sequence " << response_header->nh_seq;
+        return;
     }
-    else if (response_header->nh_id != last_message_header->nh_id)
+
+    entry = pending_messages[i];
+
+    if (response_header->nh_group != entry.header->nh_group)
     {
-        log_error() << "Invalid command, expected " << last_message_header->nh_id << " got " << response_header->nh_id;
+        log_error() << "Invalid group, expected " << entry.header->nh_group << " got " << response_header->nh_group;
     }
-    else if (response_header->nh_seq != last_message_header->nh_seq)
+    else if (response_header->nh_id != entry.header->nh_id)
     {
-        log_error() << "Invalid sequence, expected " << last_message_header->nh_seq << " got " << response_header->nh_seq;
+        log_error() << "Invalid command, expected " << entry.header->nh_id << " got " << response_header->nh_id;
     }
-    else if (response_header->nh_op != smp_message::response_op(last_message_header->nh_op))
+    else if (response_header->nh_op != smp_message::response_op(entry.header->nh_op))
     {
-        log_error() << "Invalid op, expected " << smp_message::response_op(last_message_header->nh_op) << " got " << response_header->nh_op;
+        log_error() << "Invalid op, expected " << smp_message::response_op(entry.header->nh_op) << " got " << response_header->nh_op;
     }
     else
     {
         //Headers look valid
         uint8_t version = response_header->nh_version;
         uint8_t op = response_header->nh_op;
-        uint16_t group = response_header->nh_group;
+        uint16_t group = header_group(response_header);
         uint8_t command = response_header->nh_id;
-        uint8_t i = 0;
+        smp_group *handler = nullptr;
 
-#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
-        group = ((group & 0xff) << 8) | ((group & 0xff00) >> 8);
-#endif
-
-        if (!custom_message)
+        if (!entry.custom)
         {
-            //Search for the handler for this group
-            while (i < group_handlers.length())
-            {
-                if (group_handlers[i].group == group)
-                {
-                    break;
-                }
+            handler = find_handler(group);
 
-                ++i;
-            }
-
-            if (i == group_handlers.length())
+            if (handler == nullptr)
             {
                 //There is no registered handler for this group, clean up
                 log_error() << "No registered handler for group " << group << ", dropping response.";
-                this->cleanup();
+                pending_messages.removeAt(i);
+                smp_message::release(entry.message);
+                restart_timer();
+                dispatch_queued();
                 return;
             }
         }
 
-        QCborStreamReader cbor_reader(response->contents());
+        //Single pass over the response which finds any error and indexes the keys for the handler
+        smp_response_view view;
         smp_error_t error;
-        error.type = SMP_ERROR_NONE;
-        bool parsed = decode_message(cbor_reader, version, 0, nullptr, &error);
 
-        if (!parsed)
+        if (!view.decode(response, version))
         {
-            log_error() << "parse failed";
+            log_error() << "Failed to parse CBOR message";
             return;
         }
 
+        error = *view.error();
+
         //Clean up before triggering callback
-        this->cleanup();
+        pending_messages.removeAt(i);
+        smp_message::release(entry.message);
 
-        if (!custom_message)
+        if (error.type != SMP_ERROR_NONE)
         {
-            if (error.type != SMP_ERROR_NONE)
-            {
-                //Received either "rc" (legacy/SMP version 1) error or "err" error (SMP version 2)
-                group_handlers[i].handler->receive_error(version, op, group, command, error);
-            }
-            else
-            {
-                //No error, good response
-                group_handlers[i].handler->receive_ok(version, op, group, command, response->contents());
-            }
+            //Error responses abort the operation, remaining requests from the group are not needed
+            drop_pending_group(response_header->nh_group, entry.custom);
         }
         else
         {
-            if (error.type != SMP_ERROR_NONE)
-            {
-                emit custom_message_callback(CUSTOM_MESSAGE_CALLBACK_ERROR, &error);
-            }
-            else
-            {
-                emit custom_message_callback(CUSTOM_MESSAGE_CALLBACK_OK, nullptr);
-            }
+            restart_timer();
         }
 
+        //Queued messages (from this or other groups) take the free space in the window before the handler sends more
+        dispatch_queued();
+
 #if defined(PLUGIN_MCUMGR_JSON)
-        if (json_object != nullptr && (message_logging || custom_message))
+        if (json_object != nullptr && (message_logging || entry.custom))
         {
             json_object->append_data(false, response);
         }
 #endif
-    }
-
-    custom_message = false;
-}
-
-bool smp_processor::decode_message(QCborStreamReader &reader, uint8_t version, uint16_t level, QString *parent, smp_error_t *error)
-{
-    QString key = "";
-    bool keyset = true;
-
-    while (!reader.lastError() && reader.hasNext())
-    {
-        if (keyset == false && !key.isEmpty())
-        {
-            key = "";
-        }
 
-        keyset = false;
-
-        switch (reader.type())
+        if (!entry.custom)
         {
-            case QCborStreamReader::UnsignedInteger:
-            case QCborStreamReader::NegativeInteger:
+            if (error.type != SMP_ERROR_NONE)
             {
-                if (key == "rc" && version == 1 && level == 2 && parent != nullptr && *parent == "err")
-                {
-                    error->rc = reader.toUnsignedInteger();
-                    error->type = SMP_ERROR_RET;
-                }
-                else if (key == "group" && version == 1 && level == 2 && parent != nullptr && *parent == "err")
-                {
-                    error->group = reader.toUnsignedInteger();
-                    error->type = SMP_ERROR_RET;
-                }
-                else if (key == "rc" && level == 1)
-                {
-                    error->rc = reader.toInteger();
-                    error->type = SMP_ERROR_RC;
-                }
-
-                reader.next();
-                break;
+                //Received either "rc" (legacy/SMP version 1) error or "err" error (SMP version 2)
+                handler->receive_error(version, op, group, command, error);
             }
-            case QCborStreamReader::String:
+            else
             {
-                QString data;
-                auto r = reader.readString();
-                while (r.status == QCborStreamReader::Ok)
-                {
-                    data.append(r.data);
-                    r = reader.readString();
-                }
-
-                if (r.status == QCborStreamReader::Error)
-                {
-                    data.clear();
-                    log_error() << "Error decoding string";
-                }
-                else
-                {
-                    if (key.isEmpty())
-                    {
-                        key = data;
-                        keyset = true;
-                    }
-                }
-                break;
+                //No error, good response
+                handler->receive_ok(version, op, group, command, &view);
             }
-            case QCborStreamReader::Array:
-            case QCborStreamReader::Map:
+        }
+        else
+        {
+            if (error.type != SMP_ERROR_NONE)
             {
-                reader.enterContainer();
-                while (reader.lastError() == QCborError::NoError && reader.hasNext())
-                {
-                    decode_message(reader, version, (level + 1), &key, error);
-                }
-                if (reader.lastError() == QCborError::NoError)
-                {
-                    reader.leaveContainer();
-                }
-                break;
+                emit custom_message_callback(CUSTOM_MESSAGE_CALLBACK_ERROR, &error);
             }
-            default:
+            else
             {
-                reader.next();
-                break;
+                emit custom_message_callback(CUSTOM_MESSAGE_CALLBACK_OK, nullptr);
             }
         }
     }
-
-    if (reader.lastError())
-    {
-        log_error() << "Failed to parse CBOR message: " << reader.lastError().toString();
-        return false;
-    }
-
-    //Check if an error was received with value 0, which is not an error and is a success code
-    if (level == 0 && error->type != SMP_ERROR_NONE && error->rc == 0)
-    {
-        error->type = SMP_ERROR_NONE;
-    }
-
-    return true;
 }
 
 void smp_processor::set_transport(smp_transport *transport_object)
@@ -490,122 +656,37 @@ void smp_processor::set_custom_message(bool enabled)
 
 void smp_processor::transport_disconnect(int error_code)
 {
-    uint16_t group;
-    uint8_t i = 0;
-
     if (sender() != transport)
     {
         log_error() << "Non-active transport emitted error: " << sender() << ", code: " << error_code;
         return;
     }
 
-    if (!busy)
+    //Each group is notified once, its other outstanding messages are dropped with it
+    while (!pending_messages.isEmpty())
     {
-        //No longer busy
-        return;
+        fail_message(pending_messages.takeFirst(), CUSTOM_MESSAGE_CALLBACK_TRANSPORT_DISCONNECTED, error_code);
     }
 
-    group = last_message_header->nh_group;
-
-#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
-    group = ((group & 0xff) << 8) | ((group & 0xff00) >> 8);
-#endif
-
-    if (!custom_message)
+    while (!queued_messages.isEmpty())
     {
-        //Search for the handler for this group
-        while (i < group_handlers.length())
-        {
-            if (group_handlers[i].group == group)
-            {
-                break;
-            }
-
-            ++i;
-        }
-
-        if (i == group_handlers.length())
-        {
-            //There is no registered handler for this group
-            log_error() << "No registered handler for group " << group << ", cannot send transport disconnected message.";
-            cleanup();
-        }
-        else
-        {
-            //Keep message pointer valid but cleanup so callback can send a message
-            smp_message *backup_message = last_message;
-            last_message = nullptr;
-            last_message_header = nullptr;
-
-            cleanup();
-            group_handlers[i].handler->transport_disconnected(backup_message, transport, error_code);
-
-            //Delete backup pointer
-            delete backup_message;
-        }
+        fail_message(queued_messages.takeFirst(), CUSTOM_MESSAGE_CALLBACK_TRANSPORT_DISCONNECTED, error_code);
     }
-    else
-    {
-        emit custom_message_callback(CUSTOM_MESSAGE_CALLBACK_TRANSPORT_DISCONNECTED, nullptr);
 
-        custom_message = false;
-    }
+    repeat_timer.stop();
 }
 
 void smp_processor::cancel()
 {
-    uint16_t group;
-    uint8_t i = 0;
-
-    if (!busy)
+    while (!pending_messages.isEmpty())
     {
-        //No longer busy
-        return;
+        fail_message(pending_messages.takeFirst(), CUSTOM_MESSAGE_CALLBACK_CANCELLED, 0);
     }
 
-    group = last_message_header->nh_group;
-
-#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
-    group = ((group & 0xff) << 8) | ((group & 0xff00) >> 8);
-#endif
-
-    if (!custom_message)
+    while (!queued_messages.isEmpty())
     {
-        //Search for the handler for this group
-        while (i < group_handlers.length())
-        {
-            if (group_handlers[i].group == group)
-            {
-                break;
-            }
-
-            ++i;
-        }
-
-        if (i == group_handlers.length())
-        {
-            //There is no registered handler for this group
-            log_error() << "No registered handler for group " << group << ", cannot send cancelled message.";
-            cleanup();
-        }
-        else
-        {
-            //Keep message pointer valid but cleanup so callback can send a message
-            smp_message *backup_message = last_message;
-            last_message = nullptr;
-            last_message_header = nullptr;
-
-            cleanup();
-            group_handlers[i].handler->cancelled(backup_message);
-
-            //Delete backup pointer
-            delete backup_message;
-        }
+        fail_message(queued_messages.takeFirst(), CUSTOM_MESSAGE_CALLBACK_CANCELLED, 0);
     }
-    else
-    {
-        emit custom_message_callback(CUSTOM_MESSAGE_CALLBACK_CANCELLED, nullptr);
 
-        custom_message = false;
-    }
+    repeat_timer.stop();
 }
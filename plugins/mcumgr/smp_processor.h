@@ -47,6 +47,14 @@ enum custom_message_callback_t {
     CUSTOM_MESSAGE_CALLBACK_COUNT
 };
 
+//Order in which queued messages are sent when several groups share the transport
+enum smp_priority_t {
+    SMP_PRIORITY_CONTROL = 0,   //Short commands, sent ahead of queued transfer data
+    SMP_PRIORITY_BULK,          //File and image transfer chunks
+
+    SMP_PRIORITY_COUNT
+};
+
 //Forward declaration due to reverse dependency
 class smp_group;
 
@@ -55,6 +63,23 @@ struct smp_group_match_t {
     smp_group *handler;
 };
 
+struct smp_pending_message_t {
+    smp_message *message;
+    smp_hdr *header;
+    bool version_check;
+    uint8_t version;
+    uint8_t repeats;
+    uint32_t timeout_ms;
+    qint64 deadline;
+    bool custom;                //Response goes to custom_message_callback instead of the group handler
+    smp_priority_t priority;
+};
+
+//Maximum number of requests which can be outstanding at once, must be well below the 8-bit sequence number range
+#define SMP_PROCESSOR_MAX_WINDOW_SIZE 32
+//Maximum number of requests waiting for space in the window
+#define SMP_PROCESSOR_MAX_QUEUE_SIZE 64
+
 class smp_processor : public QObject
 {
     Q_OBJECT
@@ -65,8 +90,13 @@ public:
 #ifndef SKIPPLUGIN_LOGGER
     void set_logger(debug_logger *object);
 #endif
-    smp_transport_error_t send(smp_message *message, uint32_t timeout_ms, uint8_t repeats, bool allow_version_check);
+    smp_transport_error_t send(smp_message *message, uint32_t timeout_ms, uint8_t repeats, bool allow_version_check, smp_priority_t priority = SMP_PRIORITY_CONTROL);
     bool is_busy();
+    bool can_send();
+    uint8_t outstanding_messages();
+    void set_window_size(uint8_t size);
+    uint8_t get_window_size();
+    static uint8_t window_size_from_buffer_count(uint32_t buffer_count);
     void register_handler(uint16_t group, smp_group *handler);
     void unregister_handler(uint16_t group);
     void set_transport(smp_transport *transport_object);
@@ -80,7 +110,15 @@ public:
 
 private:
     void cleanup();
-    bool decode_message(QCborStreamReader &reader, uint8_t version, uint16_t level, QString *parent, smp_error_t *error);
+    smp_group *find_handler(uint16_t group);
+    static uint16_t header_group(const smp_hdr *header);
+    void drop_pending_group(uint16_t nh_group, bool custom);
+    smp_transport_error_t transmit(smp_pending_message_t entry);
+    bool next_sequence(uint8_t *next);
+    void dispatch_queued();
+    int next_queued();
+    void fail_message(smp_pending_message_t entry, enum custom_message_callback_t reason, int error_code);
+    void restart_timer();
 
 public slots:
     void message_timeout();
@@ -93,13 +131,12 @@ signals:
 private:
     uint8_t sequence;
     smp_transport *transport;
-    smp_message *last_message;
-    smp_hdr *last_message_header;
-    bool last_message_version_check;
-    uint8_t last_message_version;
+    QList<smp_pending_message_t> pending_messages;
+    QList<smp_pending_message_t> queued_messages; //Waiting for space in the window, in the order they were sent
+    uint16_t last_sent_group; //Header group of the last message sent, used to take turns between groups
     QTimer repeat_timer;
-    uint8_t repeat_times;
-    bool busy;
+    QElapsedTimer timeout_clock;
+    uint8_t window_size;
     QList<smp_group_match_t> group_handlers;
 #if defined(PLUGIN_MCUMGR_JSON)
     smp_json *json_object;
@@ -24,9 +24,114 @@
 #include "crc16.h"
 #include <math.h>
 
+/******************************************************************************/
+// Constants
+/******************************************************************************/
+static const uint8_t smp_header_first_byte = 0x06;
+static const uint8_t smp_header_continuation_byte = 0x04;
+static const uint8_t smp_line_end = 0x0a;
+static const uint8_t smp_frame_length_size = 2;
+static const uint8_t smp_crc_size = 2;
+//Lines are no more than 127 bytes, anything far longer than that is not a valid SMP line
+static const uint16_t smp_max_line_length = 4096;
+//Largest possible frame: length, 64KiB of data and CRC
+static const int32_t smp_max_frame_size = 65535 + 4;
+//Maximum number of (unencoded) bytes in a single line
+static const uint8_t smp_max_line_data = 93;
+static const uint8_t base64_invalid = 0xff;
+static const uint8_t base64_padding = 0xfe;
+static const char base64_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+struct base64_decode_table_t {
+    uint8_t value[256];
+};
+
+static constexpr base64_decode_table_t base64_generate_decode_table()
+{
+    base64_decode_table_t table = {};
+
+    for (uint16_t i = 0; i < 256; ++i)
+    {
+        if (i >= 'A' && i <= 'Z')
+        {
+            table.value[i] = (uint8_t)(i - 'A');
+        }
+        else if (i >= 'a' && i <= 'z')
+        {
+            table.value[i] = (uint8_t)(i - 'a' + 26);
+        }
+        else if (i >= '0' && i <= '9')
+        {
+            table.value[i] = (uint8_t)(i - '0' + 52);
+        }
+        else if (i == '+')
+        {
+            table.value[i] = 62;
+        }
+        else if (i == '/')
+        {
+            table.value[i] = 63;
+        }
+        else if (i == '=')
+        {
+            table.value[i] = base64_padding;
+        }
+        else
+        {
+            table.value[i] = base64_invalid;
+        }
+    }
+
+    return table;
+}
+
+static constexpr base64_decode_table_t base64_decode_table = base64_generate_decode_table();
+
+/******************************************************************************/
+// Local Functions or Private Members
+/******************************************************************************/
+//Returns the end of the line of frame data which starts at pos, the CRC is never split over lines
+static int32_t smp_line_data_end(int32_t pos, int32_t crc_start, int32_t raw_size)
+{
+    int32_t line_end = pos + smp_max_line_data;
+
+    if (line_end >= raw_size)
+    {
+        return raw_size;
+    }
+
+    if (line_end > crc_start)
+    {
+        return crc_start;
+    }
+
+    return line_end;
+}
+
+//Returns a byte of the frame (length, message data then CRC) without it needing to be in one buffer
+static inline uint8_t smp_raw_byte(int32_t pos, const uint8_t *prefix, const uint8_t *message_data, int32_t message_size, const uint8_t *suffix)
+{
+    if (pos < smp_frame_length_size)
+    {
+        return prefix[pos];
+    }
+
+    pos -= smp_frame_length_size;
+
+    if (pos < message_size)
+    {
+        return message_data[pos];
+    }
+
+    return suffix[pos - message_size];
+}
+
 smp_uart_auterm::smp_uart_auterm(QObject *parent)
 {
     Q_UNUSED(parent);
+
+    //Reserve once so that frames are decoded without reallocating
+    frame_data.reserve(smp_max_frame_size);
 }
 
 smp_uart_auterm::~smp_uart_auterm()
@@ -35,215 +140,359 @@ smp_uart_auterm::~smp_uart_auterm()
 
 void smp_uart_auterm::data_received(QByteArray *message)
 {
-    smp_message full_message;
-    full_message.append(message);
+    received_message.append(message);
 
-    if (full_message.is_valid())
+    if (received_message.is_valid())
     {
-        emit receive_waiting(&full_message);
-        full_message.clear();
+        emit receive_waiting(&received_message);
     }
+
+    received_message.clear();
 }
 
 void smp_uart_auterm::serial_read(QByteArray *rec_data)
 {
-    SerialData.append(*rec_data);
-
-    //Search for SMP packets
-    int32_t pos = SerialData.indexOf(smp_first_header);
-    int32_t pos_other = SerialData.indexOf(smp_continuation_header);
-    int32_t posA = SerialData.indexOf(0x0a, pos + 2);
-    int32_t posA_other = SerialData.indexOf(0x0a, pos_other + 2);
+    const uint8_t *data = (const uint8_t *)rec_data->constData();
+    int32_t length = rec_data->length();
+    int32_t i = 0;
 
-    while ((pos != -1 && posA != -1) || (pos_other != -1 && posA_other != -1))
-//        while (pos != -1 && posA != -1 /*&& SMPWaitingForContinuation == false*/)
+    while (i < length)
     {
-        if (pos >= 0 && (pos_other == -1 || pos < pos_other))
+        uint8_t current = data[i];
+
+        switch (decode_state)
         {
-            //Start
-            //Check this header
-            SMPBuffer.clear();
-#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
-            SMPBuffer = QByteArray::fromBase64(SerialData.mid((pos + 2), (posA - pos - 2)), QByteArray::AbortOnBase64DecodingErrors);
-#else
-            SMPBuffer = QByteArray::fromBase64(SerialData.mid((pos + 2), (posA - pos - 2)));
-#endif
-
-            if (SMPBuffer.length() == 0)
-            {
-                log_error() << "Failed decoding base64";
-            }
-            else if (SMPBuffer.length() > 2)
+            case DECODE_STATE_IDLE:
             {
-                //Check length
-                waiting_packet_length = ((uint16_t)SMPBuffer[0]) << 8;
-                waiting_packet_length |= ((uint16_t)SMPBuffer[1] & 0xff);
-                SMPBuffer.remove(0, 2);
-                if (SMPBuffer.length() >= (waiting_packet_length))
+                if (current == smp_header_first_byte || current == smp_header_continuation_byte)
                 {
-                    //We have a full packet, check the checksum
-                    uint16_t crc = crc16(&SMPBuffer, 0, SMPBuffer.length() - 2, 0x1021, 0, true);
-                    uint16_t message_crc = ((uint16_t)SMPBuffer[(SMPBuffer.length() - 2)]) << 8;
-                    message_crc |= SMPBuffer[(SMPBuffer.length() - 1)] & 0xff;
-
-                    if (crc == message_crc)
-                    {
-                        //Good to parse message after removing CRC
-                        SMPBuffer.remove((SMPBuffer.length() - 2), 2);
-                        data_received(&SMPBuffer);
-                    }
-                    else
-                    {
-                        //CRC failure
-                        log_error() << "CRC failure, expected " << message_crc << " but got " << crc;
-                    }
+                    decode_header = current;
+                    decode_state = DECODE_STATE_HEADER;
                 }
                 else
                 {
-                    //More data expected in another packet
-                    SMPWaitingForContinuation = true;
-                    SMPBufferActualData = SMPBuffer;
+                    ++decode_garbage;
                 }
-            }
 
-            SerialData.remove(pos, (posA - pos + 1));
+                ++i;
+                break;
+            }
 
-            pos = SerialData.indexOf(smp_first_header);
-            posA = SerialData.indexOf(0x0a, pos + 2);
-            pos_other = SerialData.indexOf(smp_continuation_header);
-            posA_other = SerialData.indexOf(0x0a, pos_other + 2);
-        }
-        else if (SMPWaitingForContinuation == true)
-        {
-            //Continuation
-            //Check this header
-            SMPBuffer.clear();
-#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
-            SMPBuffer = QByteArray::fromBase64(SerialData.mid((pos_other + 2), (posA_other - pos_other - 2)), QByteArray::AbortOnBase64DecodingErrors);
-#else
-            SMPBuffer = QByteArray::fromBase64(SerialData.mid((pos_other + 2), (posA_other - pos_other - 2)));
-#endif
-
-            if (SMPBuffer.length() == 0)
+            case DECODE_STATE_HEADER:
             {
-                log_error() << "Failed decoding base64";
+                if ((decode_header == smp_header_first_byte && current == (uint8_t)smp_first_header.at(1)) || (decode_header == smp_header_continuation_byte && current == (uint8_t)smp_continuation_header.at(1)))
+                {
+                    decode_line_start(decode_header == smp_header_first_byte);
+                    decode_state = DECODE_STATE_BODY;
+                    ++i;
+                }
+                else
+                {
+                    //Not a header, check if this byte is the start of one instead
+                    decode_garbage += 1;
+                    decode_state = DECODE_STATE_IDLE;
+                }
+
+                break;
             }
-            else if (SMPBuffer.length() > 0)
+
+            case DECODE_STATE_BODY:
             {
-                //Check length
-                SMPBufferActualData.append(SMPBuffer);
-                if (SMPBufferActualData.length() >= (waiting_packet_length /*+ 2*/))
+                if (current == smp_line_end)
+                {
+                    decode_line_end();
+                    decode_state = DECODE_STATE_IDLE;
+                    ++i;
+                }
+                else if (current == smp_header_first_byte || current == smp_header_continuation_byte)
                 {
-                    //We have a full packet, check the checksum
-                    uint16_t crc = crc16(&SMPBufferActualData, 0, SMPBufferActualData.length() - 2, 0x1021, 0, true);
-                    uint16_t message_crc = ((uint16_t)SMPBufferActualData[(SMPBufferActualData.length() - 2)]) << 8;
-                    message_crc |= SMPBufferActualData[(SMPBufferActualData.length() - 1)] & 0xff;
-
-                    if (crc == message_crc)
-                    {
-                        //Good to parse message after removing CRC
-                        SMPBufferActualData.remove((SMPBufferActualData.length() - 2), 2);
-                        data_received(&SMPBufferActualData);
-                    }
-                    else
-                    {
-                        //CRC failure
-                        log_error() << "CRC failure, expected " << message_crc << " but got " << crc;
-                    }
-
-                    SMPBufferActualData.clear();
-                    SMPWaitingForContinuation = false;
+                    //Start of a new line before the previous one finished, discard the partial line
+                    log_error() << "Incomplete SMP line discarded";
+                    frame_data.truncate(frame_line_start);
+                    decode_state = DECODE_STATE_IDLE;
                 }
                 else
                 {
-                    //More data expected in another packet
-                    SMPWaitingForContinuation = true;
+                    decode_base64_byte(current);
+                    ++i;
                 }
+
+                break;
             }
+        }
+    }
 
-            SerialData.remove(pos_other, (posA_other - pos_other + 1));
+    if (decode_garbage > 10)
+    {
+        log_error() << "Cleared garbage data in UART SMP transport buffer";
+        decode_garbage = 0;
+    }
+}
 
-            pos = SerialData.indexOf(smp_first_header);
-            if (pos == -1)
-            {
-                posA = -1;
-            }
-            else
-            {
-                posA = SerialData.indexOf(0x0a, pos + 2);
-            }
-            pos_other = SerialData.indexOf(smp_continuation_header);
-            if (pos_other == -1)
-            {
-                posA_other = -1;
-            }
-            else
+void smp_uart_auterm::decode_line_start(bool first_line)
+{
+    decode_first_line = first_line;
+    decode_line_error = false;
+    decode_line_length = 0;
+    decode_quantum = 0;
+    decode_quantum_count = 0;
+    decode_padding = 0;
+    decode_garbage = 0;
+
+    if (first_line == true)
+    {
+        //A new message always restarts the frame, truncate keeps the reserved capacity
+        frame_data.truncate(0);
+        frame_waiting = false;
+    }
+
+    frame_line_start = frame_data.length();
+}
+
+void smp_uart_auterm::decode_base64_byte(uint8_t data)
+{
+    uint8_t value;
+
+    if (decode_line_error == true)
+    {
+        return;
+    }
+
+    ++decode_line_length;
+
+    if (decode_line_length > smp_max_line_length)
+    {
+        decode_line_error = true;
+        return;
+    }
+
+    value = base64_decode_table.value[data];
+
+    if (value == base64_invalid)
+    {
+        decode_line_error = true;
+        return;
+    }
+    else if (value == base64_padding)
+    {
+        if (decode_quantum_count < 2)
+        {
+            decode_line_error = true;
+            return;
+        }
+
+        ++decode_padding;
+        decode_quantum <<= 6;
+    }
+    else if (decode_padding > 0)
+    {
+        //Data is not allowed after padding
+        decode_line_error = true;
+        return;
+    }
+    else
+    {
+        decode_quantum = (decode_quantum << 6) | value;
+    }
+
+    ++decode_quantum_count;
+
+    if (decode_quantum_count == 4)
+    {
+        frame_data.append((char)(decode_quantum >> 16));
+
+        if (decode_padding < 2)
+        {
+            frame_data.append((char)(decode_quantum >> 8));
+        }
+
+        if (decode_padding < 1)
+        {
+            frame_data.append((char)decode_quantum);
+        }
+
+        decode_quantum = 0;
+        decode_quantum_count = 0;
+    }
+}
+
+void smp_uart_auterm::decode_line_end()
+{
+    if (decode_first_line == false && frame_waiting == false)
+    {
+        //Continuation without a start of message, nothing to add it to
+        log_error() << "Unexpected continuation packet discarded";
+        frame_data.truncate(frame_line_start);
+        return;
+    }
+
+    if (decode_line_error == false && decode_quantum_count > 0)
+    {
+        //Final quantum without padding
+        if (decode_quantum_count == 1)
+        {
+            decode_line_error = true;
+        }
+        else
+        {
+            decode_quantum <<= 6 * (4 - decode_quantum_count);
+            frame_data.append((char)(decode_quantum >> 16));
+
+            if (decode_quantum_count == 3)
             {
-                posA_other = SerialData.indexOf(0x0a, pos_other + 2);
+                frame_data.append((char)(decode_quantum >> 8));
             }
         }
     }
 
-    if (SerialData.length() > 10 && SerialData.indexOf(smp_first_header) == -1 && SerialData.indexOf(smp_continuation_header) == -1)
+    if (decode_line_error == true || frame_data.length() == frame_line_start)
     {
-        log_error() << "Cleared garbage data in UART SMP transport buffer";
-        SerialData.clear();
+        log_error() << "Failed decoding base64";
+        frame_data.truncate(frame_line_start);
+        return;
+    }
+
+    if (decode_first_line == true)
+    {
+        if (frame_data.length() <= smp_frame_length_size)
+        {
+            frame_data.truncate(0);
+            return;
+        }
+
+        waiting_packet_length = ((uint16_t)(uint8_t)frame_data.at(0)) << 8;
+        waiting_packet_length |= (uint16_t)(uint8_t)frame_data.at(1);
+        frame_waiting = true;
     }
+
+    if ((frame_data.length() - smp_frame_length_size) >= waiting_packet_length)
+    {
+        decode_frame_complete();
+    }
+}
+
+void smp_uart_auterm::decode_frame_complete()
+{
+    const uint8_t *frame = (const uint8_t *)frame_data.constData();
+    int32_t frame_length = frame_data.length();
+
+    if (frame_length < (smp_frame_length_size + smp_crc_size))
+    {
+        log_error() << "SMP frame too short for CRC";
+    }
+    else
+    {
+        //We have a full packet, check the checksum
+        uint16_t crc = crc16(&frame[smp_frame_length_size], (frame_length - smp_frame_length_size - smp_crc_size), 0x1021, 0, true);
+        uint16_t message_crc = ((uint16_t)frame[(frame_length - 2)]) << 8;
+        message_crc |= frame[(frame_length - 1)];
+
+        if (crc == message_crc)
+        {
+            //Good to parse message, pass a view of the data excluding length and CRC
+            QByteArray message = QByteArray::fromRawData((const char *)&frame[smp_frame_length_size], (frame_length - smp_frame_length_size - smp_crc_size));
+            data_received(&message);
+        }
+        else
+        {
+            //CRC failure
+            log_error() << "CRC failure, expected " << message_crc << " but got " << crc;
+            ++crc_failure_count;
+        }
+    }
+
+    frame_data.truncate(0);
+    frame_line_start = 0;
+    frame_waiting = false;
 }
 
 smp_transport_error_t smp_uart_auterm::send(smp_message *message)
 {
     //127 bytes = 3 + base 64 message
     //base64 = 4 bytes output per 3 byte input
-    QByteArray output;
-    uint16_t size = message->size();
-    size += 2;
-    output.append((uint8_t)((size & 0xff00) >> 8));
-    output.append((uint8_t)(size & 0xff));
-    uint16_t crc = crc16(message->data(), 0, message->size(), 0x1021, 0, true);
-
-    QByteArray inbase;
-    inbase.append(smp_first_header);
+    const uint8_t *message_data = (const uint8_t *)message->data()->constData();
+    int32_t message_size = message->size();
+    int32_t crc_start = smp_frame_length_size + message_size;
+    int32_t raw_size = crc_start + smp_crc_size;
+    int32_t encoded_size = 0;
     int32_t pos = 0;
+    uint16_t size = message_size + smp_crc_size;
+    uint16_t crc = crc16(message_data, message_size, 0x1021, 0, true);
+    uint8_t prefix[smp_frame_length_size] = { (uint8_t)((size & 0xff00) >> 8), (uint8_t)(size & 0xff) };
+    uint8_t suffix[smp_crc_size] = { (uint8_t)((crc & 0xff00) >> 8), (uint8_t)(crc & 0xff) };
 
-    while (pos < (message->size() + 1))
+    //Work out the size of the whole encoded frame so that it is allocated once
+    while (pos < raw_size)
     {
-        /* Chunking required */
-        int16_t chunk_size = 93 - output.length();
+        int32_t line_end = smp_line_data_end(pos, crc_start, raw_size);
 
-        if ((chunk_size + pos) > message->size())
+        encoded_size += smp_first_header.length() + ((line_end - pos + 2) / 3) * 4 + 1;
+        pos = line_end;
+    }
+
+    //The buffer is kept between frames, it is only allocated again if it has to grow or a previous write still holds it
+    if (encode_buffer.isDetached() == false || encode_buffer.capacity() < encoded_size)
+    {
+        ++encode_allocation_count;
+    }
+
+    encode_buffer.resize(encoded_size);
+    char *out = encode_buffer.data();
+    pos = 0;
+
+    while (pos < raw_size)
+    {
+        int32_t line_end = smp_line_data_end(pos, crc_start, raw_size);
+        const QByteArray *header = (pos == 0 ? &smp_first_header : &smp_continuation_header);
+
+        *out++ = header->at(0);
+        *out++ = header->at(1);
+
+        while (pos < line_end)
         {
-            chunk_size = message->size() - pos;
+            int32_t count = line_end - pos;
+            uint32_t quantum = (uint32_t)smp_raw_byte(pos, prefix, message_data, message_size, suffix) << 16;
 
-            if (chunk_size == 0)
+            if (count > 1)
             {
-                goto end;
+                quantum |= (uint32_t)smp_raw_byte((pos + 1), prefix, message_data, message_size, suffix) << 8;
             }
-        }
 
-        output.append(message->data()->mid(pos, chunk_size));
-        pos += chunk_size;
+            if (count > 2)
+            {
+                quantum |= (uint32_t)smp_raw_byte((pos + 2), prefix, message_data, message_size, suffix);
+                count = 3;
+            }
 
-        if (pos == message->size() && (93 - chunk_size) > 2)
-        {
-end:
-            output.append((uint8_t)((crc & 0xff00) >> 8));
-            output.append((uint8_t)(crc & 0xff));
-            pos += 2;
+            out[0] = base64_alphabet[(quantum >> 18) & 0x3f];
+            out[1] = base64_alphabet[(quantum >> 12) & 0x3f];
+            out[2] = (count > 1 ? base64_alphabet[(quantum >> 6) & 0x3f] : '=');
+            out[3] = (count > 2 ? base64_alphabet[quantum & 0x3f] : '=');
+            out += 4;
+            pos += count;
         }
 
-        inbase.append(output.toBase64());
-        inbase.append((uint8_t)0x0a);
-        emit serial_write(&inbase);
-
-        inbase.clear();
-        inbase.append(smp_continuation_header);
-        output.clear();
+        *out++ = smp_line_end;
     }
 
+    //Whole frame is handed over in a single write
+    emit serial_write(&encode_buffer);
+
     return SMP_TRANSPORT_ERROR_OK;
 }
 
+uint32_t smp_uart_auterm::encode_allocations()
+{
+    //Number of times the frame buffer has been allocated, does not change once frames reach a steady state size
+    return encode_allocation_count;
+}
+
+uint32_t smp_uart_auterm::crc_failures()
+{
+    //Number of received frames which were dropped because their CRC did not match
+    return crc_failure_count;
+}
+
 uint16_t smp_uart_auterm::max_message_data_size(uint16_t mtu)
 {
     float available_mtu = mtu;
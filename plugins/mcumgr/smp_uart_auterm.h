@@ -28,6 +28,12 @@
 #include "smp_message.h"
 #include "debug_logger.h"
 
+enum smp_uart_decode_state_t {
+    DECODE_STATE_IDLE,
+    DECODE_STATE_HEADER,
+    DECODE_STATE_BODY
+};
+
 class smp_uart_auterm : public smp_transport
 {
     Q_OBJECT
@@ -37,9 +43,15 @@ public:
     ~smp_uart_auterm();
     smp_transport_error_t send(smp_message *message) override;
     uint16_t max_message_data_size(uint16_t mtu) override;
+    uint32_t encode_allocations();
+    uint32_t crc_failures();
 
 private:
     void data_received(QByteArray *message);
+    void decode_line_start(bool first_line);
+    void decode_base64_byte(uint8_t data);
+    void decode_line_end();
+    void decode_frame_complete();
 
 signals:
     void serial_write(QByteArray *data);
@@ -48,13 +60,27 @@ public slots:
     void serial_read(QByteArray *rec_data);
 
 private:
-    QByteArray SerialData;
-    QByteArray SMPBuffer;
-    QByteArray SMPBufferActualData;
-    bool SMPWaitingForContinuation = false;
     const QByteArray smp_first_header = QByteArrayLiteral("\x06\x09");
     const QByteArray smp_continuation_header = QByteArrayLiteral("\x04\x14");
     uint16_t waiting_packet_length = 0;
+
+    //Incremental decoder state, received data is scanned once and decoded straight into frame_data
+    smp_uart_decode_state_t decode_state = DECODE_STATE_IDLE;
+    uint8_t decode_header = 0;
+    bool decode_first_line = false;
+    bool decode_line_error = false;
+    uint16_t decode_line_length = 0;
+    uint32_t decode_quantum = 0;
+    uint8_t decode_quantum_count = 0;
+    uint8_t decode_padding = 0;
+    uint32_t decode_garbage = 0;
+    QByteArray frame_data;
+    int32_t frame_line_start = 0;
+    bool frame_waiting = false;
+    smp_message received_message; //Reused for each response so its buffer is only allocated once
+    QByteArray encode_buffer; //Reused for each frame sent
+    uint32_t encode_allocation_count = 0;
+    uint32_t crc_failure_count = 0;
 };
 
 #endif // SMP_UART_AUTERM_H
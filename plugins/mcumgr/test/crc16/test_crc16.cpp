@@ -0,0 +1,205 @@
+/******************************************************************************
+** Copyright (C) 2024 Jamie M.
+**
+** Project: AuTerm
+**
+** Module:  test_crc16.cpp
+**
+** Notes:
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include <QtTest>
+#include <QRandomGenerator>
+#include "crc16.h"
+
+/******************************************************************************/
+// Constants
+/******************************************************************************/
+//CCITT polynomial and initial value used by the SMP serial transport
+const uint16_t test_polynomial = 0x1021;
+const uint16_t test_initial_value = 0;
+//Seed for the test data, fixed so that runs are repeatable
+const quint32 test_seed = 0x5eed;
+//Number of random initial values each buffer size is checked with
+const int test_initial_values = 64;
+
+/******************************************************************************/
+// Class definitions
+/******************************************************************************/
+class test_crc16 : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void matches_previous_data();
+    void matches_previous();
+    void benchmark_table_data();
+    void benchmark_table();
+    void benchmark_previous_data();
+    void benchmark_previous();
+
+private:
+    static uint16_t previous_crc16(const QByteArray *src, size_t i, size_t len, uint16_t polynomial, uint16_t initial_value, bool pad);
+    static QByteArray test_data(int size);
+    static void add_benchmark_sizes();
+};
+
+/******************************************************************************/
+// Local Functions or Private Members
+/******************************************************************************/
+uint16_t test_crc16::previous_crc16(const QByteArray *src, size_t i, size_t len, uint16_t polynomial, uint16_t initial_value, bool pad)
+{
+    //Previous bitwise implementation of crc16(), the table version must give the same results
+    uint16_t crc = initial_value;
+    size_t padding = pad ? sizeof(crc) : 0;
+    size_t b;
+
+    while (i < (len + padding))
+    {
+        for (b = 0; b < 8; b++)
+        {
+            uint16_t divide = crc & 0x8000UL;
+
+            crc = (crc << 1U);
+
+            if (i < len)
+            {
+                crc |= !!(src->at(i) & (0x80U >> b));
+            }
+
+            if (divide != 0U)
+            {
+                crc = crc ^ polynomial;
+            }
+        }
+
+        ++i;
+    }
+
+    return crc;
+}
+
+QByteArray test_crc16::test_data(int size)
+{
+    QRandomGenerator generator(test_seed);
+    QByteArray data(size, 0);
+    int i = 0;
+
+    while (i < size)
+    {
+        data[i] = (char)generator.bounded(256);
+        ++i;
+    }
+
+    return data;
+}
+
+void test_crc16::add_benchmark_sizes()
+{
+    QTest::addColumn<int>("size");
+
+    QTest::newRow("1KiB") << 1024;
+    QTest::newRow("4KiB") << 4096;
+    QTest::newRow("16KiB") << 16384;
+    QTest::newRow("64KiB") << 65536;
+}
+
+void test_crc16::matches_previous_data()
+{
+    //Sizes either side of the 8 byte slice boundary as well as whole frames
+    QTest::addColumn<int>("size");
+    QTest::addColumn<bool>("pad");
+
+    QTest::newRow("0 bytes, padded") << 0 << true;
+    QTest::newRow("1 byte, padded") << 1 << true;
+    QTest::newRow("7 bytes, padded") << 7 << true;
+    QTest::newRow("8 bytes, padded") << 8 << true;
+    QTest::newRow("9 bytes, padded") << 9 << true;
+    QTest::newRow("1KiB, padded") << 1024 << true;
+    QTest::newRow("1KiB + 3 bytes, padded") << 1027 << true;
+    QTest::newRow("0 bytes, unpadded") << 0 << false;
+    QTest::newRow("1 byte, unpadded") << 1 << false;
+    QTest::newRow("9 bytes, unpadded") << 9 << false;
+    QTest::newRow("1KiB + 3 bytes, unpadded") << 1027 << false;
+}
+
+void test_crc16::matches_previous()
+{
+    QFETCH(int, size);
+    QFETCH(bool, pad);
+    QByteArray data = test_data(size);
+    QRandomGenerator generator(test_seed);
+    int i = 0;
+
+    QCOMPARE(crc16(&data, 0, size, test_polynomial, test_initial_value, pad), previous_crc16(&data, 0, size, test_polynomial, test_initial_value, pad));
+
+    while (i < test_initial_values)
+    {
+        uint16_t initial_value = (uint16_t)generator.bounded(0x10000);
+
+        QCOMPARE(crc16((const uint8_t *)data.constData(), size, test_polynomial, initial_value, pad), previous_crc16(&data, 0, size, test_polynomial, initial_value, pad));
+        ++i;
+    }
+}
+
+void test_crc16::benchmark_table_data()
+{
+    add_benchmark_sizes();
+}
+
+void test_crc16::benchmark_table()
+{
+    QFETCH(int, size);
+    QByteArray data = test_data(size);
+    uint16_t crc = 0;
+
+    QBENCHMARK
+    {
+        crc ^= crc16((const uint8_t *)data.constData(), size, test_polynomial, test_initial_value, true);
+    }
+
+    Q_UNUSED(crc);
+}
+
+void test_crc16::benchmark_previous_data()
+{
+    add_benchmark_sizes();
+}
+
+void test_crc16::benchmark_previous()
+{
+    QFETCH(int, size);
+    QByteArray data = test_data(size);
+    uint16_t crc = 0;
+
+    QBENCHMARK
+    {
+        crc ^= previous_crc16(&data, 0, size, test_polynomial, test_initial_value, true);
+    }
+
+    Q_UNUSED(crc);
+}
+
+QTEST_APPLESS_MAIN(test_crc16)
+
+#include "test_crc16.moc"
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
@@ -0,0 +1,23 @@
+# Test and benchmark of crc16 against the previous bitwise implementation, run with: qmake && make check
+
+include(../../../../AuTerm-includes.pri)
+
+QT += core testlib
+QT -= gui
+
+TEMPLATE = app
+TARGET = test_crc16
+
+CONFIG += c++17
+CONFIG += console
+CONFIG += testcase
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+    ../../crc16.cpp \
+    test_crc16.cpp
+
+HEADERS += \
+    ../../crc16.h
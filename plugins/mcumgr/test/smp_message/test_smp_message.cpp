@@ -0,0 +1,172 @@
+/******************************************************************************
+** Copyright (C) 2024 Jamie M.
+**
+** Project: AuTerm
+**
+** Module:  test_smp_message.cpp
+**
+** Notes:
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include <QtTest>
+#include "smp_message.h"
+#include "smp_uart_auterm.h"
+
+/******************************************************************************/
+// Constants
+/******************************************************************************/
+//Messages outstanding at once, the same as a full processor window
+const int test_window_size = 8;
+//Number of times a full window of messages is built and released
+const int test_iterations = 1000;
+//Size of the data added to each message, similar to an image upload chunk
+const int test_data_size = 496;
+
+/******************************************************************************/
+// Class definitions
+/******************************************************************************/
+class test_smp_message : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void cleanup();
+    void steady_state_does_not_allocate();
+    void free_pool_releases_messages();
+    void uart_upload_does_not_allocate();
+
+private:
+    static void build_window(const QByteArray &data, smp_uart_auterm *transport = nullptr);
+};
+
+/******************************************************************************/
+// Local Functions or Private Members
+/******************************************************************************/
+void test_smp_message::build_window(const QByteArray &data, smp_uart_auterm *transport)
+{
+    //Builds a window of upload-like messages, sends them if a transport is given, then gives them all back to the pool
+    smp_message *messages[test_window_size];
+    int i = 0;
+
+    while (i < test_window_size)
+    {
+        messages[i] = smp_message::acquire();
+        messages[i]->start_message(SMP_OP_WRITE, 1, 1, 1);
+        messages[i]->writer()->append("off");
+        messages[i]->writer()->append((quint64)(i * data.length()));
+        messages[i]->writer()->append("data");
+        messages[i]->writer()->append(data);
+        messages[i]->end_message();
+        QVERIFY(messages[i]->is_valid() == true);
+
+        if (transport != nullptr)
+        {
+            QCOMPARE(transport->send(messages[i]), SMP_TRANSPORT_ERROR_OK);
+        }
+
+        ++i;
+    }
+
+    i = 0;
+
+    while (i < test_window_size)
+    {
+        smp_message::release(messages[i]);
+        ++i;
+    }
+}
+
+void test_smp_message::cleanup()
+{
+    smp_message::free_pool();
+}
+
+void test_smp_message::steady_state_does_not_allocate()
+{
+    QByteArray data(test_data_size, 'a');
+    uint32_t allocations;
+    int i = 0;
+
+    //First window allocates the messages and grows their buffers
+    build_window(data);
+    allocations = smp_message::allocations();
+    QVERIFY(allocations > 0);
+
+    while (i < test_iterations)
+    {
+        build_window(data);
+        ++i;
+    }
+
+    QCOMPARE(smp_message::allocations(), allocations);
+}
+
+void test_smp_message::free_pool_releases_messages()
+{
+    QByteArray data(test_data_size, 'a');
+    uint32_t allocations;
+
+    build_window(data);
+    allocations = smp_message::allocations();
+
+    //Once the pool is emptied, messages have to be allocated again
+    smp_message::free_pool();
+    build_window(data);
+    QVERIFY(smp_message::allocations() > allocations);
+}
+
+void test_smp_message::uart_upload_does_not_allocate()
+{
+    //Same as an image upload over UART: messages from the pool are encoded into frames, which are written out and
+    //not kept, so neither the messages nor the frame buffer are allocated again
+    smp_uart_auterm transport;
+    QByteArray data(test_data_size, 'a');
+    uint32_t allocations;
+    uint32_t encode_allocations;
+    int frames = 0;
+    int i = 0;
+
+    QObject::connect(&transport, &smp_uart_auterm::serial_write, [&frames](QByteArray *frame) {
+        QVERIFY(frame->startsWith("\x06\x09") == true);
+        ++frames;
+    });
+
+    build_window(data, &transport);
+    allocations = smp_message::allocations();
+    encode_allocations = transport.encode_allocations();
+    QVERIFY(encode_allocations > 0);
+
+    while (i < test_iterations)
+    {
+        build_window(data, &transport);
+        ++i;
+    }
+
+    QCOMPARE(frames, (test_iterations + 1) * test_window_size);
+    QCOMPARE(smp_message::allocations(), allocations);
+    QCOMPARE(transport.encode_allocations(), encode_allocations);
+}
+
+QTEST_APPLESS_MAIN(test_smp_message)
+
+#include "test_smp_message.moc"
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
@@ -0,0 +1,30 @@
+# Test of smp_message pooling and the UART transport frame buffer, run with: qmake && make check
+
+include(../../../../AuTerm-includes.pri)
+
+QT += core testlib
+QT -= gui
+
+TEMPLATE = app
+TARGET = test_smp_message
+
+CONFIG += c++17
+CONFIG += console
+CONFIG += testcase
+CONFIG -= app_bundle
+
+DEFINES += SKIPPLUGIN_LOGGER
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+    ../../crc16.cpp \
+    ../../smp_message.cpp \
+    ../../smp_uart_auterm.cpp \
+    test_smp_message.cpp
+
+HEADERS += \
+    ../../crc16.h \
+    ../../smp_message.h \
+    ../../smp_transport.h \
+    ../../smp_uart_auterm.h
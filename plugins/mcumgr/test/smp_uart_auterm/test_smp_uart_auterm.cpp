@@ -0,0 +1,183 @@
+/******************************************************************************
+** Copyright (C) 2024 Jamie M.
+**
+** Project: AuTerm
+**
+** Module:  test_smp_uart_auterm.cpp
+**
+** Notes:
+**
+** License: This program is free software: you can redistribute it and/or
+**          modify it under the terms of the GNU General Public License as
+**          published by the Free Software Foundation, version 3.
+**
+**          This program is distributed in the hope that it will be useful,
+**          but WITHOUT ANY WARRANTY; without even the implied warranty of
+**          MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**          GNU General Public License for more details.
+**
+**          You should have received a copy of the GNU General Public License
+**          along with this program.  If not, see http://www.gnu.org/licenses/
+**
+*******************************************************************************/
+
+/******************************************************************************/
+// Include Files
+/******************************************************************************/
+#include <QtTest>
+#include "smp_message.h"
+#include "smp_uart_auterm.h"
+
+/******************************************************************************/
+// Constants
+/******************************************************************************/
+//Recorded OS echo response ("hello") which fits in a single line
+static const QByteArray echo_short_frame = QByteArrayLiteral("\x06\x09" "ABMLAAAJAAABAKFhcmVoZWxsb/yK\n");
+static const QByteArray echo_short_message = QByteArray::fromHex("0b00000900000100a161726568656c6c6f");
+
+//Recorded OS echo response which is split over 3 lines, the final line is padded
+static const QByteArray echo_long_frame = QByteArrayLiteral(
+    "\x06\x09" "AMMLAAC5AAACAKFhcni0VGhlIHF1aWNrIGJyb3duIGZveCBqdW1wcyBvdmVyIHRoZSBsYXp5IGRvZy4gVGhlIHF1aWNrIGJyb3duIGZveCBqdW1wcyBvdmVyIHRo\n"
+    "\x04\x14" "ZSBsYXp5IGRvZy4gVGhlIHF1aWNrIGJyb3duIGZveCBqdW1wcyBvdmVyIHRoZSBsYXp5IGRvZy4gVGhlIHF1aWNrIGJyb3duIGZveCBqdW1wcyBvdmVyIHRoZSBs\n"
+    "\x04\x14" "YXp5IGRvZy4g548=\n");
+static const QByteArray echo_long_message = QByteArray::fromHex("0b0000b900000200a1617278b4") + QByteArray("The quick brown fox jumps over the lazy dog. ").repeated(4);
+
+//Short echo response with the last bit of the CRC flipped
+static const QByteArray echo_bad_crc_frame = QByteArrayLiteral("\x06\x09" "ABMLAAAJAAABAKFhcmVoZWxsb/yL\n");
+
+//Shell output and stray bytes which look like the start of a header, as seen when the SMP and shell share a UART
+static const QByteArray noise = QByteArrayLiteral(
+    "\r\nuart:~$ \x1b[m\r\n[00:00:01.000,000] <inf> main: Booting\r\n"
+    "\x06\x06\x04\x04\x0a"
+    "\x04\x14" "AAAA\n");
+
+/******************************************************************************/
+// Class definitions
+/******************************************************************************/
+class test_smp_uart_auterm : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void decodes_frames_data();
+    void decodes_frames();
+    void decodes_frames_with_noise_data();
+    void decodes_frames_with_noise();
+    void crc_failure_is_dropped_data();
+    void crc_failure_is_dropped();
+
+private:
+    static void add_chunk_sizes();
+    static void feed(smp_uart_auterm *transport, const QByteArray &data, int chunk_size);
+    static void connect_received(smp_uart_auterm *transport, QList<QByteArray> *received);
+};
+
+/******************************************************************************/
+// Local Functions or Private Members
+/******************************************************************************/
+void test_smp_uart_auterm::add_chunk_sizes()
+{
+    //A chunk size of 0 passes all the data at once
+    QTest::addColumn<int>("chunk_size");
+
+    QTest::newRow("all at once") << 0;
+    QTest::newRow("byte at a time") << 1;
+    QTest::newRow("7 bytes at a time") << 7;
+}
+
+void test_smp_uart_auterm::feed(smp_uart_auterm *transport, const QByteArray &data, int chunk_size)
+{
+    //Passes data to the transport the way the serial port would, in chunks of the given size
+    int i = 0;
+
+    if (chunk_size == 0)
+    {
+        chunk_size = data.length();
+    }
+
+    while (i < data.length())
+    {
+        QByteArray chunk = data.mid(i, chunk_size);
+
+        transport->serial_read(&chunk);
+        i += chunk_size;
+    }
+}
+
+void test_smp_uart_auterm::connect_received(smp_uart_auterm *transport, QList<QByteArray> *received)
+{
+    //The transport reuses its message, so a copy of the data is kept
+    QObject::connect(transport, &smp_uart_auterm::receive_waiting, [received](smp_message *message) {
+        received->append(*message->data());
+    });
+}
+
+void test_smp_uart_auterm::decodes_frames_data()
+{
+    add_chunk_sizes();
+}
+
+void test_smp_uart_auterm::decodes_frames()
+{
+    QFETCH(int, chunk_size);
+    smp_uart_auterm transport;
+    QList<QByteArray> received;
+
+    connect_received(&transport, &received);
+    feed(&transport, echo_short_frame + echo_long_frame + echo_short_frame, chunk_size);
+
+    QCOMPARE(received.length(), 3);
+    QCOMPARE(received.at(0), echo_short_message);
+    QCOMPARE(received.at(1), echo_long_message);
+    QCOMPARE(received.at(2), echo_short_message);
+    QCOMPARE(transport.crc_failures(), (uint32_t)0);
+}
+
+void test_smp_uart_auterm::decodes_frames_with_noise_data()
+{
+    add_chunk_sizes();
+}
+
+void test_smp_uart_auterm::decodes_frames_with_noise()
+{
+    QFETCH(int, chunk_size);
+    smp_uart_auterm transport;
+    QList<QByteArray> received;
+
+    connect_received(&transport, &received);
+    feed(&transport, noise + echo_long_frame + noise + echo_short_frame + noise + echo_long_frame + noise, chunk_size);
+
+    QCOMPARE(received.length(), 3);
+    QCOMPARE(received.at(0), echo_long_message);
+    QCOMPARE(received.at(1), echo_short_message);
+    QCOMPARE(received.at(2), echo_long_message);
+    QCOMPARE(transport.crc_failures(), (uint32_t)0);
+}
+
+void test_smp_uart_auterm::crc_failure_is_dropped_data()
+{
+    add_chunk_sizes();
+}
+
+void test_smp_uart_auterm::crc_failure_is_dropped()
+{
+    //A frame with a bad CRC is not passed on and does not stop the following frame from being decoded
+    QFETCH(int, chunk_size);
+    smp_uart_auterm transport;
+    QList<QByteArray> received;
+
+    connect_received(&transport, &received);
+    feed(&transport, echo_bad_crc_frame + noise + echo_long_frame, chunk_size);
+
+    QCOMPARE(received.length(), 1);
+    QCOMPARE(received.at(0), echo_long_message);
+    QCOMPARE(transport.crc_failures(), (uint32_t)1);
+}
+
+QTEST_APPLESS_MAIN(test_smp_uart_auterm)
+
+#include "test_smp_uart_auterm.moc"
+
+/******************************************************************************/
+// END OF FILE
+/******************************************************************************/
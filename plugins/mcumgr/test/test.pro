@@ -0,0 +1,8 @@
+# MCUmgr plugin tests, run with: qmake && make check
+
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    crc16 \
+    smp_message \
+    smp_uart_auterm
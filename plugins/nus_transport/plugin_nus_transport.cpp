@@ -851,23 +851,32 @@ qint64 plugin_nus_transport::bytesAvailable() const
 
 QByteArray plugin_nus_transport::peek(qint64 maxlen)
 {
-    return received_data.left(maxlen);
+    return received_data.peek(maxlen);
 }
 
 QByteArray plugin_nus_transport::read(qint64 maxlen)
 {
-    QByteArray data = received_data.left(maxlen);
-
-    received_data.remove(0, maxlen);
-    return data;
+    return received_data.read(maxlen);
 }
 
 QByteArray plugin_nus_transport::readAll()
 {
-    QByteArray data = received_data;
+    return received_data.read_all();
+}
+
+qint64 plugin_nus_transport::read_into(char *data, qint64 maxlen)
+{
+    return received_data.read_into(data, maxlen);
+}
 
-    received_data.clear();
-    return data;
+const char *plugin_nus_transport::peek_pointer(qint64 *length)
+{
+    return received_data.peek_pointer(length);
+}
+
+qint64 plugin_nus_transport::consume(qint64 length)
+{
+    return received_data.consume(length);
 }
 
 bool plugin_nus_transport::clear(QSerialPort::Directions directions)
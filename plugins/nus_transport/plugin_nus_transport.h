@@ -108,6 +108,9 @@ public:
     QByteArray peek(qint64 maxlen) override;
     QByteArray read(qint64 maxlen) override;
     QByteArray readAll() override;
+    qint64 read_into(char *data, qint64 maxlen) override;
+    const char *peek_pointer(qint64 *length) override;
+    qint64 consume(qint64 length) override;
     bool clear(QSerialPort::Directions directions = QSerialPort::AllDirections) override;
     QSerialPort::PinoutSignals pinoutSignals() override;
     QString to_error_string(int error) override;
@@ -159,7 +162,7 @@ private:
     QBluetoothDeviceDiscoveryAgent *discoveryAgent = nullptr;
     QLowEnergyController *controller = nullptr;
     bool device_connected;
-    QByteArray received_data;
+    AutTransportReceiveBuffer received_data;
     QList<QBluetoothDeviceInfo> bluetooth_device_list;
     QList<QBluetoothUuid> services;
     QLowEnergyService *bluetooth_service_nus;